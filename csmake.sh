@@ -27,7 +27,7 @@ MBCC=0
 MULTIPLE_RUN=1
 CLEAN=0
 SKIP_TEST=0
-GROUP_LIST=(getlog deletelog net2com commander settime) # insert the group of the test here.
+GROUP_LIST=(getlog deletelog net2com commander settime retention registry wire arena result base64 decode upload patch update timesync asynclog eventlog journal pipeline batch) # insert the group of the test here.
 
 
 #++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -93,6 +93,22 @@ if [ "$GROUP" != "" ]; then
         'net2com')      ARGUMENTS="-g Net2ComTestGroup" ;;
         'commander')    ARGUMENTS="-g CommanderTestGroup";;
         'settime')      ARGUMENTS="-g SetTimeTestGroup";;
+        'retention')    ARGUMENTS="-g RetentionTestGroup";;
+        'registry')     ARGUMENTS="-g CommandRegistryTestGroup";;
+        'wire')         ARGUMENTS="-g WireTestGroup";;
+        'arena')        ARGUMENTS="-g SessionArenaTestGroup";;
+        'result')       ARGUMENTS="-g ResultBufferTestGroup";;
+        'base64')       ARGUMENTS="-g Base64TestGroup";;
+        'decode')       ARGUMENTS="-g DecodeTestGroup";;
+        'upload')       ARGUMENTS="-g UploadTestGroup";;
+        'patch')        ARGUMENTS="-g PatchTestGroup";;
+        'update')       ARGUMENTS="-g UpdateTestGroup";;
+        'timesync')     ARGUMENTS="-g TimeSyncTestGroup";;
+        'asynclog')     ARGUMENTS="-g AsyncLogTestGroup";;
+        'eventlog')     ARGUMENTS="-g EventLogTestGroup";;
+        'journal')      ARGUMENTS="-g CommandJournalTestGroup";;
+        'pipeline')     ARGUMENTS="-g CommandPipelineTestGroup";;
+        'batch')        ARGUMENTS="-g BatchCommandTestGroup";;
     esac
 fi
 
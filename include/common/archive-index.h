@@ -0,0 +1,85 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : archive-index.h
+*
+* DESCRIPTION : In-memory index of the files of a directory (CS1_TGZ), by
+*               inode. Used to resolve the inode sent by the ground (see the
+*               GetLog info bytes) back to a filename without spawning a
+*               'find' process.
+*
+*               The index is built with a single getdents64 scan and then
+*               kept up to date with inotify events, which are drained on
+*               each access. If a lookup misses, or if inotify is not
+*               available / overflowed, the directory is scanned again.
+*
+*               The total size of the indexed files is maintained along with
+*               the entries, so it is known without walking the directory.
+*               IN_MODIFY keeps it right for a file still being written.
+*
+*               The ArchiveRemovedFunction is called with the inode of every
+*               file that leaves the directory (see the RetentionManager).
+*
+*----------------------------------------------------------------------------*/
+#ifndef ARCHIVE_INDEX_H
+#define ARCHIVE_INDEX_H
+
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <time.h>
+
+#include "SpaceDecl.h"
+
+#define ARCHIVE_INDEX_MAX_DIRS 4
+
+struct ArchiveEntry {
+    ino_t inode;
+    std::string name;
+    size_t size;
+    time_t mtime;
+};
+
+/* A file left the directory, 'inode' may be reused from now on */
+typedef void (*ArchiveRemovedFunction)(ino_t inode, void *context);
+
+class ArchiveIndex
+{
+    private :
+        char directory[CS1_PATH_MAX];
+        int inotify_fd;
+        int watch_fd;
+        bool scanned;
+        size_t total_size;
+
+        std::map<ino_t, ArchiveEntry> entries;
+        std::map<std::string, ino_t> inodes;    // name -> inode, to handle IN_DELETE
+
+        ArchiveRemovedFunction removed;
+        void *removed_context;
+
+        void Watch();
+        void Update(const char *name);
+        void Remove(const char *name);
+
+    public :
+        ArchiveIndex();
+        ~ArchiveIndex();
+
+        static ArchiveIndex* GetInstance(const char *directory);
+        void Open(const char *directory);
+        void Clear();
+        void SetRemovedFunction(ArchiveRemovedFunction removed, void *context);
+
+        bool Lookup(ino_t inode, char *name, size_t name_size);
+        bool Refresh();
+        void Rescan();
+
+        const char* GetDirectory() { return directory; }
+        size_t GetCount();
+        size_t GetTotalSize();
+        const std::map<ino_t, ArchiveEntry>& GetEntries();
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : async-log.h
+*
+* DESCRIPTION : Logging off the command path. The caller copies a fixed-size
+*               record (the format, up to 3 numbers and one string) into a
+*               ring, a background thread formats it and hands it to
+*               Shakespeare::log, i.e. opens and writes the log file.
+*
+*                   AsyncLog::Log(Shakespeare::NOTICE, CS1_COMMANDER, " Finding oldest tgz...\n");
+*                   AsyncLog::Log(Shakespeare::DEBUG, CS1_COMMANDER, " inode %lu\n", inode);
+*                   AsyncLog::LogString(Shakespeare::DEBUG, CS1_COMMANDER, " file : %s (%ld)\n", name, size);
+*
+*               - 'format' must be a string literal (only its address is
+*                 kept). The numbers are passed as long : their conversions
+*                 are %ld / %lu / %lx (flags and width allowed), LogString 
+*                 prints its string first, with the only %s, truncated to 
+*                 ASYNC_LOG_TEXT_SIZE. GCC checks the format and the types
+*                 of the CS1_LOG arguments (cast an int to long), Log and 
+*                 LogString refuse any other conversion at run time.
+*               - the ring is lock-free for the producers (any thread), the
+*                 thread of the commander never waits for the log file.
+*               - when the ring is full the record is dropped and counted,
+*                 the thread logs how many were dropped once it catches up.
+*                 The errors should still go to Shakespeare::log directly.
+*               - until Start, and after Stop, the records are formatted and
+*                 written by the caller, as before.
+*
+*               Levels : the CS1_LOG macros drop a record below the level of
+*               the build (CS1_LOG_MIN_LEVEL, set by the Makefile : DEBUG on
+*               the PC, WARNING for the Q6) or below the level of the process
+*               (AsyncLog::SetLevel). The first test is a constant, the
+*               compiler removes the call and its arguments are never
+*               evaluated; the second one is a load.
+*
+*                   CS1_LOG(CS1_LOG_DEBUG, CS1_COMMANDER, " inode %lu\n", inode);
+*                   CS1_LOG_STRING(CS1_LOG_NOTICE, CS1_COMMANDER, " file : %s\n", name);
+*
+*                   if (CS1_LOG_ENABLED(CS1_LOG_DEBUG)) {
+*                       ... a message that is expensive to build
+*                   }
+*
+*----------------------------------------------------------------------------*/
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stddef.h>
+
+#include "shakespeare.h"
+
+#define ASYNC_LOG_RING_SIZE 128             // records, a power of 2
+#define ASYNC_LOG_TEXT_SIZE 80
+#define ASYNC_LOG_FLUSH_TIMEOUT_MS 2000
+
+// the Shakespeare::Priority values
+#define CS1_LOG_DEBUG 0
+#define CS1_LOG_NOTICE 1
+#define CS1_LOG_WARNING 2
+#define CS1_LOG_ERROR 3
+#define CS1_LOG_URGENT 4
+
+#ifndef CS1_LOG_MIN_LEVEL
+#define CS1_LOG_MIN_LEVEL CS1_LOG_DEBUG
+#endif
+
+#define CS1_LOG_ENABLED(level) ((level) >= CS1_LOG_MIN_LEVEL && (level) >= AsyncLog::GetLevel())
+
+#ifdef __GNUC__
+#define CS1_LOG_PRINTF(format_index, first_arg) __attribute__((format(printf, format_index, first_arg)))
+#else
+#define CS1_LOG_PRINTF(format_index, first_arg)
+#endif
+
+// the 'if (0)' call is never made, it lets the compiler check the format against the arguments
+#define CS1_LOG(level, system, ...) \
+    do { \
+        if (0) { \
+            AsyncLog::CheckFormat(__VA_ARGS__); \
+        } \
+        if (CS1_LOG_ENABLED(level)) { \
+            AsyncLog::Log((Shakespeare::Priority)(level), (system), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define CS1_LOG_STRING(level, system, ...) \
+    do { \
+        if (0) { \
+            AsyncLog::CheckFormat(__VA_ARGS__); \
+        } \
+        if (CS1_LOG_ENABLED(level)) { \
+            AsyncLog::LogString((Shakespeare::Priority)(level), (system), __VA_ARGS__); \
+        } \
+    } while (0)
+
+class AsyncLog
+{
+    private :
+        static int level;
+
+    public :
+        typedef int (*SinkFunction)(Shakespeare::Priority priority, const char* system, const char* message);
+
+        static bool Start();
+        static void Stop();
+        static bool Flush(int timeout_ms);
+
+        static bool Log(Shakespeare::Priority priority, unsigned char system, const char* format,
+                                                        long a1 = 0, long a2 = 0, long a3 = 0);
+        static bool LogString(Shakespeare::Priority priority, unsigned char system, const char* format,
+                                                        const char* text, long a1 = 0, long a2 = 0);
+
+        static unsigned int Dropped();
+
+        static void CheckFormat(const char* format, ...) CS1_LOG_PRINTF(1, 2);
+
+        static int GetLevel() { return level; }
+        static void SetLevel(int minimum) { level = minimum; }
+
+        // tests and benchmarks, NULL for Shakespeare::log
+        static void SetSink(SinkFunction sink);
+};
+
+inline void AsyncLog::CheckFormat(const char*, ...)
+{
+}
+
+#endif
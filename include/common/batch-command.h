@@ -0,0 +1,128 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : batch-command.h
+*
+* DESCRIPTION : Several commands in one uplink session, executed in order,
+*               their results in one reply.
+*
+*               [BATCH_CMD][flags (1)][count (1)] then 'count' entries :
+*                   [condition (1)][ref (1)][length (1)][command]
+*                           same in WIRE_V1 and WIRE_V2
+*
+*                   flags     : BATCH_STOP_ON_FAILURE, the entries after a
+*                               command that failed are not run
+*                   condition : BATCH_ALWAYS, or BATCH_IF_SUCCEEDED /
+*                               BATCH_IF_FAILED entry 'ref' (an earlier one),
+*                               i.e. DeleteLog only if GetLog succeeded
+*
+*               Result : [BATCH_CMD][CMD_STS][count (1)]
+*                        then 'count' times [state (1)][size (4)]
+*                        then the results of the commands run, one after the
+*                        other ('size' bytes each)
+*
+*                   state   : BATCH_SUCCEEDED, BATCH_FAILED (CMD_STS of its
+*                             result, or no result), BATCH_SKIPPED (its
+*                             condition is false), BATCH_NOT_RUN (stopped
+*                             before), BATCH_INVALID (unknown or too short)
+*                   CMD_STS : CS1_FAILURE if a command failed or is invalid
+*
+*               An entry that runs past the bytes received is BATCH_INVALID
+*               and the last one reported : 'count' is then the entries
+*               received whole, plus that one.
+*
+*               The commands are built one at a time in the same
+*               CommandStorage, from the session arena. A batch cannot hold
+*               another batch.
+*
+*----------------------------------------------------------------------------*/
+#ifndef BATCH_COMMAND_H
+#define BATCH_COMMAND_H
+
+#include <string>
+#include <sstream>
+
+#include "icommand.h"
+#include "infobytes.h"
+#include "wire.h"
+#include "wire-schema.h"
+#include "commands.h"
+
+#define BATCH_MAX_COMMANDS 16
+#define BATCH_MAX_COMMAND_SIZE 255
+
+#define BATCH_STOP_ON_FAILURE 0x01
+
+#define BATCH_ALWAYS 0
+#define BATCH_IF_SUCCEEDED 1
+#define BATCH_IF_FAILED 2
+
+#define BATCH_SUCCEEDED 0
+#define BATCH_FAILED 1
+#define BATCH_SKIPPED 2
+#define BATCH_NOT_RUN 3
+#define BATCH_INVALID 4
+
+typedef WireSchema<WireCommandId<BATCH_CMD>, WireByte, WireByte> BatchSchema;
+enum { BATCH_FIELD_FLAGS = 1, BATCH_FIELD_COUNT };
+
+#define BATCH_ENTRY_HEAD_SIZE 3             // condition, ref, length
+
+typedef WireSchema<WireCommandId<BATCH_CMD>, WireByte, WireByte> BatchResultSchema;
+enum { BATCH_RES_FIELD_COUNT = 2 };
+
+#define BATCH_RES_ENTRY_SIZE 5              // state, size
+#define BATCH_CMD_MIN_SIZE ((size_t)BatchSchema::SIZE)
+
+/* An entry for Build_BatchCommand, 'command' is not copied */
+struct BatchEntry
+{
+    WireView command;
+    char condition;
+    unsigned char ref;
+};
+
+class InfoBytesBatch : public InfoBytes
+{
+    public:
+    char batch_status;
+    unsigned char count;
+    char states[BATCH_MAX_COMMANDS];
+    char statuses[BATCH_MAX_COMMANDS];          // CMD_STS of the result, CS1_FAILURE if none
+    const char* results[BATCH_MAX_COMMANDS];    // into the result parsed, 0 if none
+    size_t sizes[BATCH_MAX_COMMANDS];
+
+    std::string* ToString() {
+        std::stringstream ss;
+        ss << (int)batch_status;
+
+        for (unsigned char i = 0; i < count && i < BATCH_MAX_COMMANDS; i++) {
+            ss << " " << (int)states[i] << ":" << (int)statuses[i];
+        }
+
+        return new std::string(ss.str());
+    }
+};
+
+class BatchCommand : public ICommand {
+public:
+    BatchCommand() : flags(0), count(0) { }
+
+    // the entries are not copied, all the bytes received after the header
+    BatchCommand(char flags, unsigned char count, WireView entries)
+        : flags(flags), count(count), entries(entries) { }
+
+    ~BatchCommand() { }
+
+    void Execute(ResultBuffer& result);
+    InfoBytes* ParseResult(char* result);
+
+    static ICommand* Create(char* data, size_t length, void* storage);
+    static size_t Build_BatchCommand(char* cmd_buf, size_t cmd_size, char flags, const BatchEntry* entries, size_t count);
+private:
+    char flags;
+    unsigned char count;
+    WireView entries;
+};
+#endif
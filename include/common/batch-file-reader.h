@@ -0,0 +1,83 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : batch-file-reader.h
+*
+* DESCRIPTION : Reads a batch of small files (i.e. the archives selected by a
+*               GetLogCommand) with as few system calls as possible.
+*
+*               - io_uring backend (CS1_IO_URING) : the statx and openat of
+*                 every file are submitted in one io_uring_enter, then the
+*                 read + close of every file in a second one.
+*               - fallback : open + fstat + preadv per file, used when the
+*                 kernel does not support io_uring or when the binary is built
+*                 without CS1_IO_URING (i.e. buildQ6).
+*
+*               Each entry gets the inode, modification time and size of the
+*               file, so the caller does not have to stat it again.
+*
+*----------------------------------------------------------------------------*/
+#ifndef BATCH_FILE_READER_H
+#define BATCH_FILE_READER_H
+
+#include <cstddef>
+#include <sys/types.h>
+#include <time.h>
+
+#define BATCH_READER_MAX_FILES 16   // must be a power of 2 (io_uring queue depth is 2x this)
+
+struct statx;
+
+struct BatchFileEntry {
+    const char *path;       // IN  : file to read
+    char *buffer;           // IN  : destination
+    size_t capacity;        // IN  : size of 'buffer'
+
+    size_t bytes;           // OUT : number of bytes read into 'buffer'
+    size_t file_size;       // OUT : size of the file (may be > capacity)
+    ino_t inode;            // OUT
+    time_t mtime;           // OUT
+    int error;              // OUT : 0 on success, errno otherwise (the inode is not known)
+};
+
+class BatchFileReader
+{
+    private :
+        int ring_fd;
+        bool ring_broken;   // set when the kernel rejects one of the opcodes
+
+        void *sq_ptr;
+        void *cq_ptr;
+        void *sqes_ptr;
+        size_t sq_ring_size;
+        size_t cq_ring_size;
+        size_t sqes_size;
+
+        unsigned *sq_head;
+        unsigned *sq_tail;
+        unsigned *sq_mask;
+        unsigned *sq_array;
+        unsigned *cq_head;
+        unsigned *cq_tail;
+        unsigned *cq_mask;
+        void *cqes;
+
+        bool SetupRing();
+        void TeardownRing();
+        unsigned SubmitRing(unsigned tail, unsigned count);
+        void ReapRing(BatchFileEntry *entries, struct statx *stx, int *fds, unsigned submitted);
+        size_t ReadAll_IoUring(BatchFileEntry *entries, size_t count);
+        size_t ReadAll_Preadv(BatchFileEntry *entries, size_t count);
+
+    public :
+        BatchFileReader();
+        ~BatchFileReader();
+
+        size_t ReadAll(BatchFileEntry *entries, size_t count);
+        bool UsesIoUring();
+
+        static int ReadOne_Preadv(BatchFileEntry *entry);
+};
+
+#endif
@@ -0,0 +1,123 @@
+/*=============================================================================
+*
+*   AUTHOR      : Space Concordia 2015
+*
+*   PURPOSE     : The BulkDeleteLogCommand deletes several files of the CS1_TGZ
+*                 directory in one command, either from a list of inodes or
+*                 from a predicate (older than, subsystem, larger than).
+*                 Every unlinkat is done against one open directory fd and the
+*                 result is a bitmap of per-item success.
+*
+*   FORMAT      : Inode list
+*                   [0]         :   DELETELOG_CMD
+*                   [1]         :   BULK_OPT_LIST ('B')
+*                   [2]         :   N, number of inodes (max BULKDELETE_MAX_ITEMS)
+*                   [3-(3+4N)]  :   N inodes (4 bytes each)
+*
+*                 Predicate
+*                   [0]         :   DELETELOG_CMD
+*                   [1]         :   BULK_OPT_PREDICATE ('P')
+*                   [2]         :   predicate flags (PRED_OLDER | PRED_SUB | PRED_LARGER)
+*                   [3]         :   subsystem    (PRED_SUB)
+*                   [4-7]       :   time_t       (PRED_OLDER : mtime < time_t)
+*                   [8-11]      :   size         (PRED_LARGER : size > size)
+*
+*   RESULT      :   [0]         :   DELETELOG_CMD
+*                   [1]         :   status, CS1_FAILURE if at least one item was not deleted
+*                   [2]         :   N, number of items (inodes sent or files matched)
+*                   [3]         :   BULK_MORE if the predicate matched more than BULKDELETE_MAX_ITEMS
+*                   [4-...]     :   bitmap, ceil(N / 8) bytes, bit i set if item i was deleted
+*
+*============================================================================*/
+#ifndef BULKDELETELOG_COMMAND_H
+#define BULKDELETELOG_COMMAND_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include "icommand.h"
+#include "infobytes.h"
+#include "wire-schema.h"
+#include "commands.h"
+
+#define BULK_OPT_LIST       'B'
+#define BULK_OPT_PREDICATE  'P'
+
+#define PRED_OLDER  0x01
+#define PRED_SUB    0x02
+#define PRED_LARGER 0x04
+
+#define BULK_MORE 0x01
+
+#define BULKDELETE_MAX_ITEMS 64
+#define BULKDELETE_BITMAP_SIZE(n) (((n) + 7) / 8)
+/* see FORMAT and RESULT above, and wire-schema.h */
+typedef WireSchema<WireCommandId<DELETELOG_CMD>, WireByte, WireByte> BulkDeleteListSchema;   // + N x WireUInt32
+enum { BULKDELETE_FIELD_OPT = 1, BULKDELETE_FIELD_COUNT };
+
+typedef WireSchema<WireCommandId<DELETELOG_CMD>, WireByte, WireByte, WireByte, 
+                                            WireUInt32, WireUInt32> BulkDeletePredicateSchema;
+enum { BULKDELETE_FIELD_PREDICATE = 2, BULKDELETE_FIELD_SUBSYSTEM, 
+                                            BULKDELETE_FIELD_OLDER_THAN, BULKDELETE_FIELD_LARGER_THAN };
+
+typedef WireSchema<WireCommandId<DELETELOG_CMD>, WireByte, WireByte, WireByte> BulkDeleteResultSchema;   // + bitmap
+enum { BULKDELETE_FIELD_RESULT_COUNT = 2, BULKDELETE_FIELD_RESULT_FLAGS };
+
+#define BULKDELETE_HEAD_SIZE ((size_t)BulkDeleteListSchema::SIZE)
+#define BULKDELETE_LIST_CMD_SIZE(n) (BULKDELETE_HEAD_SIZE + WireUInt32::SIZE * (n))
+#define BULKDELETE_PRED_CMD_SIZE ((size_t)BulkDeletePredicateSchema::SIZE)
+#define BULKDELETE_RTN_HEAD_SIZE ((size_t)BulkDeleteResultSchema::SIZE)
+
+using namespace std;
+
+class InfoBytesBulkDeleteLog : public InfoBytes
+{
+    public:
+    char delete_status;
+    unsigned char count;
+    bool more;
+    const char* bitmap;
+
+    bool IsDeleted(size_t i) {
+        return i < count && (bitmap[i / 8] & (1 << (i % 8)));
+    }
+
+    string* ToString() {
+        return new string (1, delete_status);
+    }
+};
+
+class BulkDeleteLogCommand : public ICommand
+{
+    private :
+        char opt_byte;
+
+        // BULK_OPT_LIST
+        size_t number_of_inodes;
+        ino_t inodes[BULKDELETE_MAX_ITEMS];
+
+        // BULK_OPT_PREDICATE
+        char predicate;
+        char subsystem;
+        time_t older_than;
+        size_t larger_than;
+
+        size_t DeleteList(int dir_fd, char* bitmap);
+        size_t DeletePredicate(int dir_fd, char* bitmap, bool* more);
+
+    public :
+        BulkDeleteLogCommand(const ino_t* inodes, size_t count);
+        BulkDeleteLogCommand(char predicate, char subsystem, time_t older_than, size_t larger_than);
+        virtual ~BulkDeleteLogCommand();
+
+        virtual void Execute(ResultBuffer& result);
+        char* GetCmdStr(char* cmd_buf);
+        size_t GetCmdSize();
+        InfoBytes* ParseResult(char *result);
+
+        bool Matches(const char* filename, const struct stat* attr);
+
+        static ICommand* Create(char* data, size_t length, void* storage);
+};
+
+#endif
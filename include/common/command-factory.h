@@ -1,33 +1,34 @@
 #ifndef COMMAND_FACTORY_H
 #define COMMAND_FACTORY_H
 
+#include "batch-command.h"
+#include "bulkdeletelog-command.h"
+#include "command-registry.h"
 #include "decode-command.h"
 #include "deletelog-command.h"
 #include "getlog-command.h"
 #include "gettime-command.h"
 #include "icommand.h"
+#include "patch-command.h"
 #include "reboot-command.h"
 #include "settime-command.h"
+#include "timesync-command.h"
 #include "update-command.h"
+#include "upload-command.h"
+#include "version-command.h"
 
 class CommandFactory {
 public:
+    static ICommand* CreateCommand(char* data, size_t length);
     static ICommand* CreateCommand(char* data);
 
-private:
-    static ICommand* CreateGetLog(char* data); 
-    static ICommand* CreateUpdate(char* data); 
-    static ICommand* CreateSetTime(char* data); 
-    static ICommand* CreateGetTime(char* data); 
-    static ICommand* CreateReboot(char* data);
-    static ICommand* CreateDecode(char* data); 
-    static ICommand* CreateDeleteLog(char* data); 
-        
+    // no allocation : the command is built in 'storage', destroy it with DestroyCommand
+    static ICommand* CreateCommand(char* data, size_t length, CommandStorage* storage);
+    static void DestroyCommand(ICommand* command);
+
+    // helpers for the Create function of the commands (see command-registry.h)
     static int GetLength3(char* data, int offset);
     static int GetLength10(char* data, int offset);
-
-    // This method allocate memory on the heap. Free it!
-    static char* GetPath(char* data, size_t length, int offset);        
 };
 
 #endif
@@ -0,0 +1,93 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : command-journal.h
+*
+* DESCRIPTION : The queue of the commands of the ground commander : a file of
+*               one command per line, appended to, and the offset of the
+*               first command not consumed yet in 'path.cursor'.
+*
+*                   CommandJournal::Append(CMD_INPUT_FILE, "...");      // any process
+*
+*                   CommandJournal journal(CMD_INPUT_FILE);            // the ground commander
+*                   while (journal.Next(&command)) { ... }
+*                   journal.Commit();
+*                   journal.Wait(timeout_ms);
+*
+*               - Append and Next are O(1), nothing is copied or rewritten.
+*               - Commit saves the cursor (written aside and renamed), the
+*                 commands returned by Next since the last Commit are
+*                 returned again after a restart. Commit(offset) consumes
+*                 the commands up to a GetOffset taken after a Next, when
+*                 they complete out of order.
+*               - a line is a command once it ends with '\n', a command
+*                 being appended is not returned half. The empty lines and
+*                 the ones starting with '#' are skipped.
+*               - once every command is consumed and the file is over
+*                 JOURNAL_COMPACT_SIZE, Commit starts a new file :
+*                 '#journal <generation>' is its first line, renamed over
+*                 the old one under flock(). The cursor holds the
+*                 generation, a cursor of an older file restarts at the
+*                 first command of the new one.
+*               - Wait sleeps until the journal changes (inotify on its
+*                 directory) or the timeout.
+*
+*               A line appended without Append (echo >>) is read as well,
+*               but may be lost if it comes in during a compaction.
+*
+*----------------------------------------------------------------------------*/
+#ifndef COMMAND_JOURNAL_H
+#define COMMAND_JOURNAL_H
+
+#include <sys/types.h>
+#include <string>
+
+#include "SpaceDecl.h"
+
+#define JOURNAL_CURSOR_EXT ".cursor"
+#define JOURNAL_HEADER "#journal "
+#define JOURNAL_READ_SIZE 4096              // a longer command is skipped
+#define JOURNAL_COMPACT_SIZE (64 * 1024)    // bytes
+
+class CommandJournal
+{
+    private :
+        char path[CS1_PATH_MAX];
+        char cursor_path[CS1_PATH_MAX];
+        int fd;
+        int watch_fd;                       // inotify
+        unsigned int generation;
+        off_t header_size;
+        off_t offset;                       // of the next command
+        off_t committed;
+
+        char buffer[JOURNAL_READ_SIZE];     // buffer[start] is at 'offset' in the file
+        size_t start;
+        size_t end;
+        bool skipping;                      // a command longer than the buffer
+
+        bool OpenFile();
+        void CloseFile();
+        bool SaveCursor(off_t offset);
+        bool Compact();
+
+        CommandJournal(const CommandJournal&);
+        CommandJournal& operator=(const CommandJournal&);
+
+    public :
+        CommandJournal(const char* path);
+        ~CommandJournal();
+
+        bool Next(std::string* command);
+        bool Commit();
+        bool Commit(off_t offset);
+        bool Wait(int timeout_ms);
+
+        off_t GetOffset() const { return this->offset; }
+        unsigned int GetGeneration() const { return this->generation; }
+
+        static bool Append(const char* path, const char* command);
+};
+
+#endif
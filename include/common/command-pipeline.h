@@ -0,0 +1,128 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : command-pipeline.h
+*
+* DESCRIPTION : Several commands in flight instead of one per round trip.
+*
+*               Frame : [PIPELINE_FRAME][version][cid, uint16][command]
+*               Reply : [PIPELINE_FRAME][version][cid, uint16][result]
+*
+*               The cid (correlation id, the CMD_CID of icommand.h) is
+*               little-endian. A reply without a result means the command
+*               could not be created or executed.
+*
+*               'version' is the wire version the command was built with
+*               (see wire.h). The satellite does not execute a frame of
+*               another version than its own, it answers the header alone
+*               with its version : the ground gives the command up and
+*               builds the next ones in that version. Its commander
+*               restarting in WIRE_V1 is caught this way.
+*
+*               Ground, CommandPipeline : the queue of the commands waiting
+*               to be sent, the bytes built by their Build_* / GetCmdStr.
+*               Up to 'window' frames are in flight, a frame without a reply
+*               after 'timeout_ms' is sent again, at most PIPELINE_MAX_RETRIES
+*               times. A reply is matched to its command by cid whatever the
+*               order, parsed by the parser registered for the command byte
+*               (see command-registry.h, nothing of the space side runs on
+*               the ground) and handed to the PipelineReplyFunction with the
+*               'tag' of Submit. The next frame of the queue is sent right
+*               away.
+*
+*                   CommandPipeline pipeline(send, on_reply, context);
+*                   pipeline.Submit(cmd, size, tag);
+*                   pipeline.OnReply(reply, size);      // each reply received
+*                   pipeline.Pump();                    // now and then : the timeouts
+*
+*               Space, PipelineServer : executes the command of a frame and
+*               keeps the last PIPELINE_CACHE_SIZE replies (up to
+*               PIPELINE_CACHE_MAX_REPLY bytes). A frame sent again because
+*               its reply was lost gets the same reply, it is not executed
+*               twice. The larger replies (logs, files) are not kept, those
+*               commands are executed again.
+*
+*----------------------------------------------------------------------------*/
+#ifndef COMMAND_PIPELINE_H
+#define COMMAND_PIPELINE_H
+
+#include <stddef.h>
+#include <deque>
+#include <string>
+
+#include "command-registry.h"
+#include "icommand.h"
+#include "infobytes.h"
+#include "result-buffer.h"
+
+#define PIPELINE_HEAD_SIZE 4            // PIPELINE_FRAME, version, cid
+#define PIPELINE_VERSION 1
+#define PIPELINE_CID 2
+#define PIPELINE_WINDOW 8               // frames in flight by default
+#define PIPELINE_MAX_WINDOW 32
+#define PIPELINE_TIMEOUT 2000           // ms before a frame is sent again
+#define PIPELINE_MAX_RETRIES 3
+#define PIPELINE_CACHE_SIZE 16
+#define PIPELINE_CACHE_MAX_REPLY 512    // bytes, PIPELINE_HEAD_SIZE included
+
+// false if the frame could not be sent, it is sent again after the timeout
+typedef bool (*PipelineSendFunction)(const char* frame, size_t size, void* context);
+
+// 'id' is the command byte, 'tag' the one given to Submit. 'info' is 0 if
+// the command got no reply after PIPELINE_MAX_RETRIES.
+typedef void (*PipelineReplyFunction)(unsigned char id, InfoBytes* info, long tag, void* context);
+
+struct PipelineEntry {
+    bool used;
+    unsigned char id;           // CMD_ID of the command, selects its parser
+    long tag;
+    unsigned short cid;
+    std::string frame;
+    long long sent_ms;
+    int retries;
+};
+
+class CommandPipeline
+{
+    private :
+        PipelineSendFunction send;
+        PipelineReplyFunction reply;
+        void* context;
+        size_t window;
+        int timeout_ms;
+        unsigned short next_cid;
+
+        std::deque<PipelineEntry> queue;
+        PipelineEntry in_flight[PIPELINE_MAX_WINDOW];
+        size_t number_in_flight;
+
+        void Send(PipelineEntry& entry, long long now_ms);
+        void Done(PipelineEntry& entry, InfoBytes* info);
+
+        CommandPipeline(const CommandPipeline&);
+        CommandPipeline& operator=(const CommandPipeline&);
+
+    public :
+        CommandPipeline(PipelineSendFunction send, PipelineReplyFunction reply, void* context,
+                            size_t window = PIPELINE_WINDOW, int timeout_ms = PIPELINE_TIMEOUT);
+
+        bool Submit(const char* cmd, size_t size, long tag = 0);
+        bool OnReply(char* reply, size_t size);
+        void Pump();
+        void Pump(long long now_ms);
+
+        size_t InFlight() const { return this->number_in_flight; }
+        size_t Queued() const { return this->queue.size(); }
+
+        static long long Now();
+};
+
+class PipelineServer
+{
+    public :
+        static bool Execute(char* frame, size_t size, CommandStorage* storage, ResultBuffer& reply);
+        static void Reset();
+};
+
+#endif
@@ -0,0 +1,188 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : command-registry.h
+*
+* DESCRIPTION : 256-entry dispatch table indexed by the command byte (CMD_ID).
+*
+*               Each ICommand subclass registers itself in its own .cpp with a
+*               static CommandRegistrar :
+*
+*                   static CommandRegistrar<GetTimeCommand> 
+*                           registrar(GETTIME_CMD, GETTIME_CMD_SIZE);
+*
+*               The minimal length can differ with the wire format (see wire.h),
+*               pass the WIRE_V2 one last if it does.
+*
+*               The class must provide :
+*                   static ICommand* Create(char* data, size_t length, void* storage);  // space side
+*                   T();  InfoBytes* ParseResult(char*);                                // ground side
+*
+*               Create builds the command with ConstructCommand<T>(storage, ...) :
+*               in 'storage' (a CommandStorage) if not 0, on the heap otherwise.
+*               It must not allocate anything else, the paths and payloads are
+*               WireViews into 'data' (see wire.h).
+*
+*               'length' is the number of bytes received, at least the minimal
+*               length. Create returns 0 if a field or a view runs past it
+*               (see Wire::Fits), the command keeps it if it reads 'data' in
+*               Execute.
+*
+*               The table is plain data in static storage, it is zeroed before
+*               any constructor runs and filled by the registrars during the
+*               static initialization, i.e. before main(). (the compilers of 
+*               the Q6 toolchain predate constexpr, this is the closest we get
+*               to a compile-time table)
+*
+*               Dispatching is a single indexed load, a free slot means an
+*               unknown command.
+*
+*               CommandStorage is sized from the command classes : a new
+*               command also goes in its union, ConstructCommand refuses to 
+*               compile a command that does not fit.
+*
+*----------------------------------------------------------------------------*/
+#ifndef COMMAND_REGISTRY_H
+#define COMMAND_REGISTRY_H
+
+#include <cstddef>
+#include <new>
+
+#include "icommand.h"
+#include "infobytes.h"
+#include "batch-command.h"
+#include "bulkdeletelog-command.h"
+#include "decode-command.h"
+#include "deletelog-command.h"
+#include "getlog-command.h"
+#include "gettime-command.h"
+#include "patch-command.h"
+#include "reboot-command.h"
+#include "settime-command.h"
+#include "timesync-command.h"
+#include "update-command.h"
+#include "upload-command.h"
+#include "version-command.h"
+
+#define CMD_REGISTRY_SIZE 256
+
+#define CMD_LENGTH_UNKNOWN ((size_t)-1)  // CommandFactory::CreateCommand(data), the buffer is trusted
+
+typedef ICommand* (*CommandCreateFn)(char *data, size_t length, void *storage);
+typedef InfoBytes* (*CommandParseFn)(char *result);
+
+struct CommandEntry {
+    unsigned char id;
+    CommandCreateFn create;     // 0 if the slot is free
+    CommandParseFn parse;
+    size_t min_length;          // smallest valid command, CMD_ID included
+    size_t min_length_v2;       // same, in WIRE_V2
+};
+
+class CommandRegistry 
+{
+    private :
+        static CommandEntry table[CMD_REGISTRY_SIZE];
+
+    public :
+        static bool Register(unsigned char id, CommandCreateFn create, CommandParseFn parse, 
+                                    size_t min_length, size_t min_length_v2);
+
+        static const CommandEntry* Get(unsigned char id) {
+            return table[id].create ? &table[id] : 0;
+        }
+
+        static ICommand* Create(const char *data, size_t length, void *storage = 0);
+        static InfoBytes* Parse(char *result);
+};
+
+template <class T>
+class CommandRegistrar 
+{
+    public :
+        CommandRegistrar(unsigned char id, size_t min_length, size_t min_length_v2 = 0) {
+            CommandRegistry::Register(id, &T::Create, &CommandRegistrar<T>::Parse, min_length,
+                                                    min_length_v2 ? min_length_v2 : min_length);
+        }
+
+        static InfoBytes* Parse(char *result) {
+            T parser;
+            return parser.ParseResult(result);  // InfoBytes are in static memory
+        }
+};
+
+/*
+ * Room for any command, i.e. one per session : the command is built in
+ * place and destroyed with CommandFactory::DestroyCommand, nothing is 
+ * allocated. One member per command class, so it is as large as the 
+ * largest of them whatever CS1_MAX_LOG_ENTRY / CS1_PATH_MAX are, and 
+ * aligned for any member of a command.
+ */
+union CommandStorage {
+    char batch[sizeof(BatchCommand)];
+    char bulkdeletelog[sizeof(BulkDeleteLogCommand)];
+    char decode[sizeof(DecodeCommand)];
+    char deletelog[sizeof(DeleteLogCommand)];
+    char getlog[sizeof(GetLogCommand)];
+    char gettime[sizeof(GetTimeCommand)];
+    char patch[sizeof(PatchCommand)];
+    char reboot[sizeof(RebootCommand)];
+    char settime[sizeof(SetTimeCommand)];
+    char timesync[sizeof(TimeSyncCommand)];
+    char update[sizeof(UpdateCommand)];
+    char upload[sizeof(UploadCommand)];
+    char version[sizeof(VersionCommand)];
+    long long align_ll;
+    double align_d;
+    void *align_p;
+};
+
+#ifdef new                  // CppUTest leak detection macro (make test), it breaks the placement new
+#pragma push_macro("new")
+#undef new
+#define CMD_REGISTRY_RESTORE_NEW
+#endif
+
+/*
+ * Constructs a T in 'storage' or on the heap if 'storage' is 0, with 0 to 4 
+ * constructor arguments.
+ */
+#define CMD_STORAGE_CHECK(T) (void)sizeof(char[(sizeof(T) <= sizeof(CommandStorage)) ? 1 : -1])   // T is missing from CommandStorage
+
+template <class T>
+T* ConstructCommand(void *storage) {
+    CMD_STORAGE_CHECK(T);
+    return storage ? new (storage) T() : new T();
+}
+
+template <class T, class A1>
+T* ConstructCommand(void *storage, A1 a1) {
+    CMD_STORAGE_CHECK(T);
+    return storage ? new (storage) T(a1) : new T(a1);
+}
+
+template <class T, class A1, class A2>
+T* ConstructCommand(void *storage, A1 a1, A2 a2) {
+    CMD_STORAGE_CHECK(T);
+    return storage ? new (storage) T(a1, a2) : new T(a1, a2);
+}
+
+template <class T, class A1, class A2, class A3>
+T* ConstructCommand(void *storage, A1 a1, A2 a2, A3 a3) {
+    CMD_STORAGE_CHECK(T);
+    return storage ? new (storage) T(a1, a2, a3) : new T(a1, a2, a3);
+}
+
+template <class T, class A1, class A2, class A3, class A4>
+T* ConstructCommand(void *storage, A1 a1, A2 a2, A3 a3, A4 a4) {
+    CMD_STORAGE_CHECK(T);
+    return storage ? new (storage) T(a1, a2, a3, a4) : new T(a1, a2, a3, a4);
+}
+
+#ifdef CMD_REGISTRY_RESTORE_NEW
+#pragma pop_macro("new")
+#undef CMD_REGISTRY_RESTORE_NEW
+#endif
+
+#endif
@@ -8,5 +8,12 @@
 #define REBOOT_CMD 0x34
 #define DECODE_CMD 0x36
 #define DELETELOG_CMD 0x37
+#define VERSION_CMD 0x38
+#define UPLOAD_CMD 0x39
+#define PATCH_CMD 0x3A
+#define UPDATE_LZ_CMD 0x3B
+#define TIMESYNC_CMD 0x3C
+#define BATCH_CMD 0x3D
+#define PIPELINE_FRAME 0x3E       // not a command : a command with its cid, see command-pipeline.h
 
 #endif
@@ -0,0 +1,22 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : crc32.h
+*
+* DESCRIPTION : CRC-32 (IEEE 802.3, same as zlib/gzip), used to verify the 
+*               files transferred between the ground and the satellite.
+*
+*               Crc32(data, size) computes the CRC of a buffer, to compute it
+*               over several buffers, pass the previous result as 'crc'.
+*
+*----------------------------------------------------------------------------*/
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstddef>
+
+unsigned int Crc32(const void *data, size_t size, unsigned int crc = 0);
+bool Crc32_File(int fd, unsigned int *crc);
+
+#endif
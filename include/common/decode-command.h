@@ -4,14 +4,52 @@
 #include <string>
 #include "icommand.h"
 #include "infobytes.h"
+#include "wire.h"
+#include "wire-schema.h"
 #include <cstdlib>
 
 using namespace std;
 
+/*
+ * WIRE_V1 : [CMD_ID][exec ('0'|'1'|'2')][src length (3 ASCII digits)][src]
+ *                                   [dest length (3 ASCII digits)][dest][size (10 ASCII digits)]
+ * WIRE_V2 : [CMD_ID][exec (0|1|2)][src length (varint)][src][dest length (varint)][dest][size (varint)]
+ */
+#define DECODE_CMD_MIN_SIZE 18      // [CMD_ID][exec][src length (3)][dest length (3)][size (10)]
+#define DECODE_CMD_MIN_SIZE_V2 5    // [CMD_ID][exec][src length (1)][dest length (1)][size (1)]
+#define DECODE_V1_MAX_LENGTH 999
+
+/*
+ * Execute reads the source DECODE_CHUNK_SIZE characters at a time, the memory
+ * used does not depend on the size of the file. The progress is logged every
+ * DECODE_PROGRESS_STEP bytes written.
+ *
+ * Result : [CMD_ID][CMD_STS][bytes written (ASCII, DECODE_RES_DATA_SIZE bytes)]
+ */
+#define DECODE_CHUNK_SIZE 8192
+#define DECODE_PROGRESS_STEP (256 * 1024)
+#define DECODE_RES_DATA_SIZE 50
+
+/*
+ * exec : DECODE_MODE_FILE        decodes src into the file dest
+ *        DECODE_MODE_EXECUTABLE  same, dest is made executable
+ *        DECODE_MODE_UNPACK      src is a base64 tgz, extracted into the directory
+ *                                dest (see tar-extract.h) without writing the tgz
+ *                                nor the tar, 'size' is the size of the tgz
+ *
+ * Result of DECODE_MODE_UNPACK : [CMD_ID][CMD_STS][bytes extracted (ASCII, DECODE_RES_DATA_SIZE bytes)]
+ *                                [manifest, "[size] [name]\n" per file, at most DECODE_MANIFEST_MAX_SIZE]['\0']
+ */
+#define DECODE_MODE_FILE 0
+#define DECODE_MODE_EXECUTABLE 1
+#define DECODE_MODE_UNPACK 2
+#define DECODE_MANIFEST_MAX_SIZE 1024
+
 class InfoBytesDecode : public InfoBytes
 {
     public:
         char decode_status;
+        string manifest;                // DECODE_MODE_UNPACK
         string* ToString() {
         string* infoStatus = new string (1, decode_status);
         return infoStatus;
@@ -19,27 +57,40 @@ class InfoBytesDecode : public InfoBytes
 };
 class DecodeCommand : public ICommand {
 public:
-    DecodeCommand(char* destPath, char* srcPath, int isExecutable, int totalSize) {
+    DecodeCommand() {
+        this->isExecutable = 0;
+        this->totalSize    = 0;
+    }
+
+    // the paths are not copied (see WireView)
+    DecodeCommand(WireView destPath, WireView srcPath, int isExecutable, int totalSize) {
         this->destPath     = destPath;
         this->srcPath      = srcPath;
         this->isExecutable = isExecutable;
         this->totalSize    = totalSize;
     }
     
-    ~DecodeCommand(){ 
-        if (srcPath  != NULL) { delete srcPath;  }
-        if (destPath != NULL) { delete destPath; }
-    }
+    ~DecodeCommand() { }
 
-    void* Execute();       
+    void Execute(ResultBuffer& result);
     InfoBytes* ParseResult(char *result);
-    char* GetDestPath() { return destPath; }
-    char* GetSrcPath()  { return srcPath; }
-    int IsExecutable()  { return isExecutable; }
+    char* GetCmdStr(char* cmd_buf);
+    size_t GetCmdSize();
+    const WireView& GetDestPath() { return destPath; }
+    const WireView& GetSrcPath()  { return srcPath; }
+    int IsExecutable()  { return isExecutable == DECODE_MODE_EXECUTABLE; }
+    int IsUnpack()      { return isExecutable == DECODE_MODE_UNPACK; }
     int GetTotalSize()  { return totalSize; }
+
+    static ICommand* Create(char* data, size_t length, void* storage);
+    static size_t Build_DecodeCommand(char* cmd_buf, WireView src, WireView dest, int executable, unsigned int size);
+    static size_t GetCmdSize(size_t src_length, size_t dest_length, unsigned int size);
 private:
-    char* destPath;
-    char* srcPath;
+    ssize_t DecodeFile(int src_fd, int dest_fd, const char* destPath);
+    ssize_t UnpackFile(int src_fd, const char* destPath, string* manifest);
+
+    WireView destPath;
+    WireView srcPath;
     int isExecutable;
     int totalSize;
 };
@@ -15,10 +15,18 @@
 #include <sys/types.h>
 #include "icommand.h"
 #include "infobytes.h"
+#include "wire-schema.h"
+#include "commands.h"
 
 #define LOG 0x0
 #define TGZ 0x1
 
+#define DELETELOG_CMD_MIN_SIZE 3    // [CMD_ID][opt byte][filename | inode...]
+
+/* opt byte 'I' : [DELETELOG_CMD]['I'][inode], see wire-schema.h */
+typedef WireSchema<WireCommandId<DELETELOG_CMD>, WireByte, WireUInt32> DeleteLogInodeSchema;
+enum { DELETELOG_FIELD_OPT = 1, DELETELOG_FIELD_INODE };
+
 using namespace std;
 
 class InfoBytesDeleteLog : public InfoBytes
@@ -42,14 +50,16 @@ class DeleteLogCommand : public ICommand
 
     public :
 
+        DeleteLogCommand();
         DeleteLogCommand(const char* filename);
         DeleteLogCommand(ino_t inode);
         virtual ~DeleteLogCommand();
-        virtual void* Execute(size_t* size);
+        virtual void Execute(ResultBuffer& result);
         char FindType();
-        void SaveFilename(ino_t inode);
-        char* ExtractFilenameFromFile();
+        char* ResolveInode(ino_t inode);
         InfoBytes* ParseResult(char *result);
+
+        static ICommand* Create(char* data, size_t length, void* storage);
 };
 
 #endif
@@ -0,0 +1,62 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : delta-patch.h
+*
+* DESCRIPTION : Binary delta between two versions of a file, in the style of
+*               bsdiff (C. Percival) : the new file is a sequence of
+*
+*                   diff  : 'diff length' bytes of the old file at the current
+*                           position, each plus a byte of the patch
+*                   extra : 'extra length' bytes of the patch
+*                   seek  : moves the position in the old file
+*
+*               A small change to a program mostly shifts addresses, the diff
+*               bytes are then almost all zero. bsdiff leaves them to bzip2,
+*               there is no compressor on board : the runs of zeros are
+*               encoded instead.
+*
+*               Patch : [magic (4)][old size (4)][old crc (4)][new size (4)][new crc (4)]
+*                       then, until 'new size' bytes are produced :
+*                       [diff length][extra length][seek (zigzag)]   varints (wire.h)
+*                       diff  : [zeros][literals][literals bytes]... up to 'diff length'
+*                       [extra bytes]
+*               The 4 bytes fields are little-endian (Wire::PutUInt32).
+*
+*               DeltaPatch_Create (ground) sorts the suffixes of the old file
+*               and needs about 16 times its size in memory.
+*               DeltaPatch_Apply (space) streams the three files, its memory
+*               use does not depend on their size.
+*
+*----------------------------------------------------------------------------*/
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <cstddef>
+#include <string>
+
+#define DELTA_PATCH_MAGIC 0x43534431     // "CSD1"
+#define DELTA_PATCH_HEAD_SIZE 20
+#define DELTA_PATCH_BUFFER_SIZE 4096
+
+#define DELTA_OK 0
+#define DELTA_IO_ERROR 1
+#define DELTA_BAD_PATCH 2
+#define DELTA_OLD_MISMATCH 3            // not the file the patch was made from
+#define DELTA_NEW_MISMATCH 4            // size or CRC of the result
+
+struct DeltaPatchHead
+{
+    unsigned int old_size;
+    unsigned int old_crc;
+    unsigned int new_size;
+    unsigned int new_crc;
+};
+
+bool DeltaPatch_Create(const unsigned char *old_data, size_t old_size,
+                       const unsigned char *new_data, size_t new_size, std::string *patch);
+
+int DeltaPatch_Apply(int old_fd, int patch_fd, int new_fd, DeltaPatchHead *head);
+
+#endif
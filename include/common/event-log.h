@@ -0,0 +1,67 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : event-log.h
+*
+* DESCRIPTION : Binary log of the commander events, i.e. one record per
+*               command executed instead of the "Executing command" and
+*               "Command output = N bytes" lines. Downlink the files of
+*               CS1_LOGS as any log, 'decode-events' renders them on the
+*               ground (make buildGroundCommander).
+*
+*               File   : [magic "CS1E"][version] then the records, appended
+*               Record : [type][length of the fields][time, uint32][fields]
+*
+*                   EVENT_START   : no fields, the space-commander started
+*                   EVENT_COMMAND : [command id][status][result size, varint]
+*                                   [duration in us, varint]
+*
+*               The numbers are little-endian, the varints are the ones of
+*               WIRE_V2 (wire.h). A record is written with a single write,
+*               an event takes 12 bytes where the two lines took about 120.
+*
+*               The file is rotated when it reaches EVENT_LOG_MAX_SIZE : it
+*               is renamed 'commander.evt.<time>' and the RetentionManager
+*               of CS1_LOGS evicts the old ones with the other logs.
+*
+*               A decoder skips the types it does not know (the length).
+*
+*----------------------------------------------------------------------------*/
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stddef.h>
+
+#include "result-buffer.h"
+
+#define EVENT_LOG_NAME "commander.evt"
+#define EVENT_LOG_MAGIC "CS1E"
+#define EVENT_LOG_MAGIC_SIZE 4
+#define EVENT_LOG_VERSION 1
+#define EVENT_LOG_FILE_HEADER_SIZE (EVENT_LOG_MAGIC_SIZE + 1)
+#define EVENT_LOG_HEADER_SIZE 6                     // type, length, time
+#define EVENT_LOG_MAX_FIELDS_SIZE 32
+#define EVENT_LOG_MAX_SIZE (32 * 1024)
+
+#define EVENT_START 0
+#define EVENT_COMMAND 1
+
+#define EVENT_STATUS_NO_RESULT 0xFF                 // the command replied nothing
+
+class EventLog
+{
+    public :
+        static bool Open(const char* path);         // CS1_LOGS/EVENT_LOG_NAME by default
+        static void Close();
+
+        static bool Start();
+        static bool Command(unsigned char id, unsigned char status, size_t result_size, unsigned int duration_us);
+        static bool Command(unsigned char id, const ResultBuffer& result, unsigned int duration_us);
+        static bool Write(unsigned char type, const char* fields, size_t size);
+
+        // the ground : one record to one line of text or CSV (no newline)
+        static size_t Format(const char* record, size_t size, char* line, size_t line_size, bool csv);
+};
+
+#endif
@@ -14,6 +14,11 @@
 *                 [3-6]   :   Size
 *                [7-10]   :   Date as a time_t
 *
+*                 With OPT_ACK, the acknowledgements of the archives already
+*                 received and verified by the ground follow :
+*                  [11]   :   N, number of acknowledgements (max GETLOG_MAX_ACKS)
+*          [12-(12+8N)]   :   N x ([4 bytes inode][4 bytes CRC-32 of the archive])
+*
 *       Execute() :
 *               if there is no option specified     
 *                       - Returns the oldest file present in CS1_TGZ
@@ -23,6 +28,11 @@
 *                       -   Returns the floor(Size / CS1_TGZ_MAX) oldest files in CS1_TGZ
 *               if only Date is specified
 *                       -   Returns the first file that matches this Date  in CS1_TGZ
+*               if OPT_ACK is specified
+*                       -   Before selecting the files, deletes every acknowledged
+*                           archive whose CRC-32 matches the one sent by the ground.
+*                           The result then starts with [N][bitmap], bit i is
+*                           set if acknowledgement i was applied (see GETLOG_ACK_RTN_SIZE)
 *
 *----------------------------------------------------------------------------*/
 #ifndef GETLOG_COMMAND_H
@@ -37,21 +47,38 @@
 #include "commands.h"
 #include "icommand.h"
 #include "infobytes.h"
+#include "wire-schema.h"
 
 using namespace std;
 
-#define GETLOG_CMD_SIZE 11
+/* [GETLOG_CMD][opt][subsystem][size][date], see wire-schema.h */
+typedef WireSchema<WireCommandId<GETLOG_CMD>, WireByte, WireByte, WireUInt32, WireUInt32> GetLogSchema;
+enum { GETLOG_FIELD_OPT = 1, GETLOG_FIELD_SUBSYSTEM, GETLOG_FIELD_SIZE, GETLOG_FIELD_DATE };
+
+/* an acknowledgement, see OPT_ACK : [inode][CRC-32] */
+typedef WireSchema<WireUInt32, WireUInt32> GetLogAckSchema;
+enum { GETLOG_ACK_FIELD_INODE, GETLOG_ACK_FIELD_CRC };
+
+#define GETLOG_CMD_SIZE ((size_t)GetLogSchema::SIZE)
 #define MAX_NUMBER_OF_FILES_PER_CMD 10
 
 #define OPT_NOOPT 0x00
 #define OPT_SUB 0x01
 #define OPT_SIZE 0x02
 #define OPT_DATE 0x04
+#define OPT_ACK 0x08
 
-#define OPT_ISNOOPT(x)  ((x) == OPT_NOOPT || (x) == OPT_SIZE) // ignore OPT_SIZE
+#define OPT_ISNOOPT(x)  (((x) & ~(OPT_SIZE | OPT_ACK)) == OPT_NOOPT) // ignore OPT_SIZE and OPT_ACK
 #define OPT_ISSUB(x)    (((x) & OPT_SUB) == OPT_SUB)
 #define OPT_ISSIZE(x)   (((x) & OPT_SIZE) == OPT_SIZE)
 #define OPT_ISDATE(x)   (((x) & OPT_DATE) == OPT_DATE)
+#define OPT_ISACK(x)    (((x) & OPT_ACK) == OPT_ACK)
+
+#define GETLOG_MAX_ACKS 16
+#define GETLOG_ACK_SIZE ((size_t)GetLogAckSchema::SIZE)
+#define GETLOG_CMD_SIZE_WITH_ACKS(n) (GETLOG_CMD_SIZE + 1 + GETLOG_ACK_SIZE * (n))
+#define GETLOG_ACK_BITMAP_SIZE ((GETLOG_MAX_ACKS + 7) / 8)
+#define GETLOG_ACK_RTN_SIZE (1 + GETLOG_ACK_BITMAP_SIZE)    // [N][bitmap], after the CMD_RES_HEAD
 
 #define START 0
 #define GETLOG_ENDBYTES_SIZE 2
@@ -67,6 +94,14 @@ class GetLogInfoBytes : public InfoBytes
     const char *next_file_in_result_buffer;
     int message_bytes_size;
 
+    // OPT_ACK
+    unsigned char number_of_acks;
+    char ack_bitmap[GETLOG_ACK_BITMAP_SIZE];
+
+    bool IsAckApplied(size_t i) {
+        return i < number_of_acks && (ack_bitmap[i / 8] & (1 << (i % 8)));
+    }
+
     string* ToString() {
         return new string (1, getlog_status);
     }
@@ -82,28 +117,40 @@ class GetLogCommand : public ICommand
 
         size_t number_of_processed_files;
         unsigned long processed_files[MAX_NUMBER_OF_FILES_PER_CMD];
+        unsigned long last_found_inode;     // inode of the file returned by the last FindOldestFile
+
+        size_t number_of_acks;              // OPT_ACK
+        ino_t acked_inodes[GETLOG_MAX_ACKS];
+        unsigned int acked_crcs[GETLOG_MAX_ACKS];
+
+        size_t ApplyAcks(char *bitmap);
 
     public :
         GetLogCommand();
         GetLogCommand(char opt_byte, char subsystem, size_t size, time_t time);
         ~GetLogCommand();
-        void* Execute(size_t *pSize);
+        void Execute(ResultBuffer& result);
         
         char* GetCmdStr(char* cmd_buf);
+        size_t GetCmdSize();
+        bool AddAck(ino_t inode, unsigned int crc);
         InfoBytes* ParseResult(char *result, const char *filename); // This function SHOULD be private!!!
         InfoBytes* ParseResult(char *result); 
 
         char* GetNextFile(void);
         size_t ReadFile(char *buffer, const char *filename);
         void MarkAsProcessed(const char *filepath);
+        void MarkAsProcessed(unsigned long inode);
         bool isFileProcessed(const char *filepath);
         bool isFileProcessed(unsigned long inode);
         char* FindOldestFile(const char* directory_path, const char* pattern);
         InfoBytes* BuildInfoBytesStruct(GetLogInfoBytes* pInfo, const char *buffer);
 
 
+        static ICommand* Create(char* data, size_t length, void* storage);
         static const char* HasNextFile(const char* result);
         static char* GetInfoBytes(char *buffer, const char *filepath);
+        static char* GetInfoBytes(char *buffer, ino_t inode);
         static int GetEndBytes(char *buffer);
         static size_t ReadFile_FromStartToEnd(char *buffer, const char *filename, size_t start, 
                                                                                     size_t size);
@@ -2,16 +2,22 @@
 #define GETTIME_COMMAND_H
 
 #define GETTIME_CMD_SIZE 1
-#define GETTIME_RTN_SIZE sizeof(time_t)
+#define GETTIME_RTN_SIZE (sizeof(time_t) + 1)
 
 #include "icommand.h"
 #include "infobytes.h"
+#include "wire-schema.h"
+#include "commands.h"
 #include <time.h>
 #include <iostream>
 #include <sstream>
 
 using namespace std;
 
+/* [GETTIME_CMD][STS][time][rtc status], see wire-schema.h and rtc-writer.h */
+typedef WireSchema<WireCommandId<GETTIME_CMD>, WireByte, WireTimeT, WireByte> GetTimeResultSchema;
+enum { GETTIME_FIELD_TIME = 2, GETTIME_FIELD_RTC_STATUS };
+
 
 
 class InfoBytesGetTime : public InfoBytes
@@ -19,6 +25,7 @@ class InfoBytesGetTime : public InfoBytes
     public:
     char time_status;
     time_t time_set;
+    char rtc_status;                // of the last SetTime, see rtc-writer.h
 
     string * ToString() {
         stringstream ss;
@@ -31,7 +38,9 @@ class InfoBytesGetTime : public InfoBytes
 class GetTimeCommand : public ICommand {
 public:
     GetTimeCommand() {};
-    void* Execute(size_t* pSize);    
+    void Execute(ResultBuffer& result);
     InfoBytes* ParseResult(char *result);
+
+    static ICommand* Create(char* data, size_t length, void* storage);
 };
 #endif
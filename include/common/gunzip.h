@@ -0,0 +1,70 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : gunzip.h
+*
+* DESCRIPTION : Decompresses a gzip stream (RFC 1951/1952) without zlib, which
+*               is not on the board. The compressed bytes are pulled with
+*               'read', the decompressed ones pushed to 'write' GUNZIP_WINDOW_SIZE
+*               bytes at a time : nothing is written to the disk in between.
+*
+*                   Gunzip state;
+*                   int error = Gunzip_Run(&state, read, write, context);
+*
+*               'read' points 'data' to the next compressed bytes and returns
+*               their number, 0 at the end of the input and -1 on failure.
+*               'write' returns false on failure. The CRC-32 and the size of
+*               each member are checked against its trailer.
+*
+*               The state holds the window (32 KB), it is better not on the
+*               stack of a small thread.
+*
+*----------------------------------------------------------------------------*/
+#ifndef GUNZIP_H
+#define GUNZIP_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define GUNZIP_WINDOW_SIZE 32768
+
+#define GUNZIP_OK 0
+#define GUNZIP_IO_ERROR 1             // 'read' or 'write' failed
+#define GUNZIP_BAD_DATA 2             // not gzip, corrupt or truncated
+
+typedef ssize_t (*GunzipRead)(void *context, const unsigned char **data);
+typedef bool (*GunzipWrite)(void *context, const unsigned char *data, size_t size);
+
+struct GunzipHuffman
+{
+    short count[16];            // number of codes of each length
+    short symbol[288];          // symbols ordered by code
+};
+
+struct Gunzip
+{
+    GunzipRead read;
+    GunzipWrite write;
+    void *context;
+
+    const unsigned char *in;
+    size_t in_length;
+    bool in_error;
+    unsigned int bits;
+    int bit_count;
+
+    unsigned char window[GUNZIP_WINDOW_SIZE];
+    size_t window_pos;
+    unsigned int out_crc;
+    unsigned int out_size;       // mod 2^32, as ISIZE
+    bool out_full;               // the window was filled at least once
+    bool out_error;
+
+    GunzipHuffman length_codes;
+    GunzipHuffman distance_codes;
+};
+
+int Gunzip_Run(Gunzip *state, GunzipRead read, GunzipWrite write, void *context);
+
+#endif
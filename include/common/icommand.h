@@ -26,27 +26,22 @@
 #include <string.h>
 #include "SpaceDecl.h"
 #include "infobytes.h"
+#include "result-buffer.h"
 
 class ICommand {
     protected :
-        char* log_buffer;
+        char log_buffer[CS1_MAX_LOG_ENTRY];     // part of the command, building one allocates nothing
 
     public :
         ICommand() {
-            this->log_buffer = new char[CS1_MAX_LOG_ENTRY];
-            memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
+            this->log_buffer[0] = '\0';
         }
 
-        virtual ~ICommand() 
-        {
-            if (this->log_buffer) 
-            {
-                delete[] this->log_buffer;
-                this->log_buffer = 0;
-            }
-        };
+        virtual ~ICommand() {};
 
-        virtual void* Execute(size_t* size){return 0;} 
+        // Fills 'result' with the reply to send to the ground, left empty if the
+        // command could not be executed at all
+        virtual void Execute(ResultBuffer& result) {}
 
         // Intended to the GroundCommander
         // The GroundCommander can use the Command's contructor to build a Command and then
@@ -0,0 +1,37 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : lzss.h
+*
+* DESCRIPTION : LZSS (Storer-Szymanski), small enough for the Q6 : the
+*               decompression is a loop over the input, without tables nor
+*               allocation.
+*
+*               The matches can reach back into a dictionary, the bytes that
+*               precede the data (for the UpdateCommand, the end of the file
+*               the data is appended to) : a chunk of a text file compresses
+*               nearly as well as the whole file.
+*
+*               Stream : [flags][8 items]... , bit i of the flags (LSB first)
+*                   0 : [literal byte]
+*                   1 : [offset - 1 (low 8 bits)][offset - 1 (high 4 bits) | length - 3 (4 bits)]
+*                       copies 'length' bytes from 'offset' bytes back
+*
+*----------------------------------------------------------------------------*/
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <stddef.h>
+
+#define LZSS_WINDOW_SIZE 4096
+#define LZSS_MIN_MATCH 3
+#define LZSS_MAX_MATCH 18
+
+size_t Lzss_Compress(const unsigned char *dict, size_t dict_size, const unsigned char *in, size_t in_size,
+                     unsigned char *out, size_t out_size, size_t *consumed, size_t *dict_used);
+
+bool Lzss_Decompress(const unsigned char *dict, size_t dict_size, const unsigned char *in, size_t in_size,
+                     unsigned char *out, size_t out_size);
+
+#endif
@@ -0,0 +1,86 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : patch-command.h
+*
+* DESCRIPTION : Applies a delta patch (see delta-patch.h), uploaded before
+*               with the UploadCommand, to a file already on board : the
+*               result is written to 'target.new', its size and CRC checked,
+*               then it replaces 'target' with rename(2) and keeps its mode.
+*               The patch is removed on success.
+*
+*               [PATCH_CMD][target length (1)][target][patch length (1)][patch]
+*                           same in WIRE_V1 and WIRE_V2
+*
+*               Result : [PATCH_CMD][CMD_STS][error (1)][crc of the result (4)]
+*                   error : DELTA_OK, DELTA_IO_ERROR, DELTA_BAD_PATCH,
+*                           DELTA_OLD_MISMATCH, DELTA_NEW_MISMATCH
+*
+*               The patches are made on the ground with bin/ground-commander/make-patch.
+*
+*----------------------------------------------------------------------------*/
+#ifndef PATCH_COMMAND_H
+#define PATCH_COMMAND_H
+
+#include <string>
+#include <sstream>
+
+#include "icommand.h"
+#include "infobytes.h"
+#include "wire.h"
+#include "wire-schema.h"
+#include "commands.h"
+#include "delta-patch.h"
+
+#define PATCH_NEW_EXT ".new"
+#define PATCH_MAX_PATH_LENGTH 255
+
+typedef WireSchema<WireCommandId<PATCH_CMD>, WireByte> PatchSchema;
+enum { PATCH_FIELD_TARGET_LENGTH = 1 };
+
+typedef WireSchema<WireCommandId<PATCH_CMD>, WireByte, WireByte, WireUInt32> PatchResultSchema;
+enum { PATCH_RES_FIELD_ERROR = 2, PATCH_RES_FIELD_CRC };
+
+#define PATCH_CMD_MIN_SIZE ((size_t)PatchSchema::SIZE + 1)     // [CMD_ID][0][0]
+
+class InfoBytesPatch : public InfoBytes
+{
+    public:
+    char patch_status;
+    char error;
+    unsigned int crc;
+
+    std::string* ToString() {
+        std::stringstream ss;
+        ss << (int)patch_status << " " << (int)error << " " << crc;
+        return new std::string(ss.str());
+    }
+};
+
+class PatchCommand : public ICommand {
+public:
+    PatchCommand() { }
+
+    // the paths are not copied (see WireView)
+    PatchCommand(WireView target, WireView patch) {
+        this->target = target;
+        this->patch = patch;
+    }
+
+    ~PatchCommand() { }
+
+    void Execute(ResultBuffer& result);
+    InfoBytes* ParseResult(char* result);
+    char* GetCmdStr(char* cmd_buf);
+    size_t GetCmdSize();
+
+    static ICommand* Create(char* data, size_t length, void* storage);
+    static size_t Build_PatchCommand(char* cmd_buf, WireView target, WireView patch);
+private:
+    int Apply(const char* target, const char* patch, unsigned int* crc);
+
+    WireView target;
+    WireView patch;
+};
+#endif
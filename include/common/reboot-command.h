@@ -3,6 +3,7 @@
 #define REBOOT_RTN_SIZE 2
 #include "icommand.h"
 #include "infobytes.h"
+#include "wire-schema.h"
 using namespace std;
 
 class InfoBytesReboot : public InfoBytes
@@ -18,7 +19,9 @@ class InfoBytesReboot : public InfoBytes
 class RebootCommand : public ICommand {
 public:
     RebootCommand() {};
-    void* Execute(size_t* pSize);
+    void Execute(ResultBuffer& result);
     InfoBytes* ParseResult(char* result);        
+
+    static ICommand* Create(char* data, size_t length, void* storage);
 };
 #endif
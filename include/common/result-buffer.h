@@ -0,0 +1,86 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : result-buffer.h
+*
+* DESCRIPTION : The result of ICommand::Execute, i.e. what is sent back to the
+*               ground : [CMD_ID][CMD_STS][data]. It carries its size and owns
+*               its memory, there is nothing to free.
+*
+*               A result is a chain of at most RESULT_MAX_SEGMENTS segments :
+*                   - memory : a buffer from Alloc (owned), or any buffer that
+*                              outlives the result (Append)
+*                   - file   : 'length' bytes of a file from 'offset', sent
+*                              without being read in memory (AppendFile)
+*
+*               WriteTo sends the chain as it is : writev for the memory
+*               segments, splice for the file segments (pread + write if the
+*               destination is not a pipe). GetData flattens it for the ones
+*               that need a contiguous buffer (ParseResult, the unit tests).
+*
+*               The owned buffers come from the current SessionArena, or
+*               malloc if there is none, see SessionArena::AllocCurrent.
+*
+*               A ResultBuffer cannot be copied, ownership is transfered
+*               with Swap.
+*
+*----------------------------------------------------------------------------*/
+#ifndef RESULT_BUFFER_H
+#define RESULT_BUFFER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define RESULT_MAX_SEGMENTS 8
+#define RESULT_WRITE_TIMEOUT 1000   // ms, WriteTo waits that long for a full pipe
+#define RESULT_COPY_SIZE 4096       // bytes, buffer of the pread + write fallback
+
+enum ResultSegmentType {
+    RESULT_SEGMENT_MEMORY,
+    RESULT_SEGMENT_FILE
+};
+
+struct ResultSegment {
+    ResultSegmentType type;
+    const char *data;       // RESULT_SEGMENT_MEMORY
+    int fd;                 // RESULT_SEGMENT_FILE
+    off_t offset;
+    size_t length;
+    bool owned;             // freed / closed by the ResultBuffer
+};
+
+class ResultBuffer
+{
+    private :
+        ResultSegment segments[RESULT_MAX_SEGMENTS];
+        size_t number_of_segments;
+        size_t size;
+        char *flat;                 // built by GetData when there is more than one segment
+
+        ResultBuffer(const ResultBuffer&);              // not copyable, see Swap
+        ResultBuffer& operator=(const ResultBuffer&);
+
+    public :
+        ResultBuffer();
+        ~ResultBuffer();
+
+        char* Alloc(size_t size);
+        bool Append(const char *data, size_t length, bool owned);
+        bool AppendFile(int fd, off_t offset, size_t length, bool owned);
+        bool Prepend(const char *data, size_t length, bool owned);
+        bool AppendResult(ResultBuffer &other);
+        void Truncate(size_t size);
+        void Clear();
+        void Swap(ResultBuffer &other);
+
+        bool IsEmpty() const { return this->number_of_segments == 0; }
+        size_t GetSize() const { return this->size; }
+        size_t GetNumberOfSegments() const { return this->number_of_segments; }
+        const ResultSegment& GetSegment(size_t i) const { return this->segments[i]; }
+
+        char* GetData();
+        ssize_t WriteTo(int fd) const;
+};
+
+#endif
@@ -0,0 +1,83 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : retention-manager.h
+*
+* DESCRIPTION : Keeps a directory (CS1_TGZ, CS1_LOGS) under a storage budget.
+*
+*               The size of the directory comes from its ArchiveIndex, which
+*               maintains it incrementally from the inotify events, so 
+*               checking the budget does not walk the directory.
+*
+*               When the budget is exceeded, the files are evicted in this
+*               order :
+*                   1. the files already delivered to the ground (see
+*                      MarkDelivered, set by the GetLogCommand), oldest first
+*                   2. the other files, oldest first
+*               a file is never evicted if its subsystem would be left with
+*               less files than its floor (see SetFloor).
+*
+*               RunOnce evicts at most 'max_evictions' files, the commander
+*               calls it when there is no command to process.
+*
+*----------------------------------------------------------------------------*/
+#ifndef RETENTION_MANAGER_H
+#define RETENTION_MANAGER_H
+
+#include <set>
+#include <sys/types.h>
+
+#include "SpaceDecl.h"
+#include "common/subsystems.h"
+
+#ifndef CS1_TGZ_BUDGET
+#define CS1_TGZ_BUDGET  (8 * 1024 * 1024)   // bytes
+#endif
+
+#ifndef CS1_LOGS_BUDGET
+#define CS1_LOGS_BUDGET (4 * 1024 * 1024)   // bytes
+#endif
+
+#define RETENTION_MAX_DIRS 4
+#define RETENTION_MAX_EVICTIONS_PER_PASS 4
+#define RETENTION_NUMBER_OF_SUBSYSTEMS (GROUND_COMMANDER + 1)
+#define RETENTION_NO_SUBSYSTEM -1
+
+class ArchiveIndex;
+
+class RetentionManager
+{
+    private :
+        ArchiveIndex *index;
+        char directory[CS1_PATH_MAX];
+        size_t budget;
+        size_t floors[RETENTION_NUMBER_OF_SUBSYSTEMS];
+        std::set<ino_t> delivered;           // forgotten when the index loses the file
+
+        static void Forget(ino_t inode, void *context);
+
+    public :
+        RetentionManager();
+        ~RetentionManager();
+
+        static RetentionManager* GetInstance(const char *directory);
+        void Open(const char *directory, size_t budget);
+        void Clear();
+        const char* GetDirectory() { return directory; }
+
+        void SetBudget(size_t budget) { this->budget = budget; }
+        size_t GetBudget() { return this->budget; }
+        void SetFloor(int subsystem, size_t min_files);
+
+        void MarkDelivered(ino_t inode);
+        bool IsDelivered(ino_t inode);
+
+        size_t GetUsage();
+        bool IsOverBudget();
+        size_t RunOnce(size_t max_evictions);
+
+        static int GetSubsystem(const char *filename);
+};
+
+#endif
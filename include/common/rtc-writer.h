@@ -0,0 +1,47 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : rtc-writer.h
+*
+* DESCRIPTION : Writes the system time to the RTC on a background thread, so
+*               the SetTimeCommand replies as soon as the system clock is set
+*               instead of waiting for the I2C bus.
+*
+*               The writes are coalesced : a request made while another is
+*               pending replaces it, and the worker writes the system time of
+*               the moment it gets the bus (not the time of the request, the
+*               RTC is not behind by the time spent waiting).
+*
+*               The status is the one of the latest request, it is PENDING
+*               until that request is written. The SetTime reply carries
+*               PENDING, the GetTime replies carry the outcome.
+*
+*----------------------------------------------------------------------------*/
+#ifndef RTC_WRITER_H
+#define RTC_WRITER_H
+
+#include <linux/rtc.h>
+
+#define RTC_STATUS_NONE 0           // no write requested since startup
+#define RTC_STATUS_PENDING 1
+#define RTC_STATUS_OK 2
+#define RTC_STATUS_FAILED 3
+
+#define RTC_FLUSH_TIMEOUT_MS 2000
+
+class RtcWriter
+{
+    public :
+        typedef int (*WriteFunction)(struct rtc_time rt, int bus);      // -1 on failure
+
+        static void Submit(int bus);
+        static char GetStatus();
+        static bool Flush(int timeout_ms);
+
+        // tests
+        static void SetWriteFunction(WriteFunction write);
+        static void Reset();
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : session-arena.h
+*
+* DESCRIPTION : Bump-pointer allocator for what lives only until the reply of
+*               a command is written : the command itself (see CommandStorage),
+*               its log buffer (part of the command) and its result buffer
+*               (see ICommand::AllocResult).
+*
+*               The space-commander has one arena in static storage, Reset
+*               releases everything at once after the reply is written, so the
+*               heap is not touched by the commands and does not fragment over
+*               long uptimes.
+*
+*               When the arena is full, Alloc falls back to malloc. Those
+*               blocks are chained and freed by Reset as well, the caller never
+*               has to know where a block comes from.
+*
+*               There is at most one current arena (SetCurrent), the results
+*               of the commands are allocated from it (AllocCurrent, see
+*               ResultBuffer). Without a current arena AllocCurrent is malloc,
+*               i.e. in the unit tests and the ground commander.
+*
+*----------------------------------------------------------------------------*/
+#ifndef SESSION_ARENA_H
+#define SESSION_ARENA_H
+
+#include <stddef.h>
+
+#ifndef SESSION_ARENA_SIZE
+#define SESSION_ARENA_SIZE (8 * 1024)   // bytes, a CommandStorage, the file names and the largest GetLog result
+#endif
+
+#define SESSION_ARENA_ALIGN 8           // enough for long long, double and pointers
+
+class SessionArena
+{
+    private :
+        union FallbackBlock {               // header of the blocks allocated with malloc
+            FallbackBlock *next;
+            long long align_ll;
+            double align_d;
+        };
+
+        union {
+            char bytes[SESSION_ARENA_SIZE];
+            long long align_ll;
+            double align_d;
+            void *align_p;
+        } storage;
+
+        size_t used;
+        size_t high_water;
+        FallbackBlock *fallbacks;
+        unsigned long number_of_fallbacks;     // since the creation of the arena
+
+        static SessionArena *current;
+
+    public :
+        SessionArena();
+        ~SessionArena();
+
+        void* Alloc(size_t size);
+        void Reset();
+        bool Owns(const void *pointer) const;
+
+        size_t GetUsed() const { return this->used; }
+        size_t GetHighWater() const { return this->high_water; }
+        unsigned long GetNumberOfFallbacks() const { return this->number_of_fallbacks; }
+
+        static SessionArena* GetCurrent() { return SessionArena::current; }
+        static void SetCurrent(SessionArena *arena) { SessionArena::current = arena; }
+
+        static void* AllocCurrent(size_t size);
+        static void FreeCurrent(void *pointer);
+};
+
+#endif
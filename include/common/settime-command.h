@@ -1,17 +1,35 @@
 #ifndef SETTIME_COMMAND_H
 #define SETTIME_COMMAND_H
 
-#define RTC_BYTE_SIZE 1
-#define SETTIME_CMD_SIZE (CMD_HEAD_SIZE + sizeof(time_t) + RTC_BYTE_SIZE)
-#define SETTIME_RTN_SIZE sizeof(time_t)
-#define SETTIME_RTN_SIZE_TOTAL (sizeof(time_t) + CMD_RES_HEAD_SIZE)
-
 #include <cstdio>
 #include <iostream>
 #include <time.h>
 
 #include "icommand.h"
 #include "infobytes.h"
+#include "wire-schema.h"
+#include "commands.h"
+
+/* [SETTIME_CMD][time][rtc bus number], see wire-schema.h */
+typedef WireSchema<WireCommandId<SETTIME_CMD>, WireTimeT, WireByte> SetTimeSchema;         // WIRE_V1 : host time_t
+typedef WireSchema<WireCommandId<SETTIME_CMD>, WireUInt32LE, WireByte> SetTimeSchemaV2;    // WIRE_V2 : 4 bytes little-endian
+enum { SETTIME_FIELD_TIME = 1, SETTIME_FIELD_RTC };
+
+/*
+ * [SETTIME_CMD][STS][time set][rtc status]
+ *
+ * STS is the status of the system clock. The RTC is written after the reply
+ * (see rtc-writer.h) : 'rtc status' is RTC_STATUS_PENDING, or RTC_STATUS_NONE
+ * without an RTC bus, the GetTime replies carry its outcome.
+ */
+typedef WireSchema<WireCommandId<SETTIME_CMD>, WireByte, WireTimeT, WireByte> SetTimeResultSchema;
+enum { SETTIME_FIELD_TIME_SET = 2, SETTIME_FIELD_RTC_STATUS };
+
+#define RTC_BYTE_SIZE 1
+#define SETTIME_CMD_SIZE ((size_t)SetTimeSchema::SIZE)
+#define SETTIME_CMD_SIZE_V2 ((size_t)SetTimeSchemaV2::SIZE)
+#define SETTIME_RTN_SIZE (sizeof(time_t) + 1)
+#define SETTIME_RTN_SIZE_TOTAL ((size_t)SetTimeResultSchema::SIZE)
 
 using namespace std;
 
@@ -19,6 +37,7 @@ class InfoBytesSetTime : public InfoBytes {
 public:
     char time_status;
     time_t time_set;
+    char rtc_status;
 
     string* ToString() {
         string* infoStatus = new string(1, time_status);
@@ -44,13 +63,18 @@ public:
 
 class SetTimeCommand : public ICommand {
 public:
+    SetTimeCommand();  
     SetTimeCommand(time_t time);  
     SetTimeCommand(time_t time, char rtc_bus_number);   
     time_t GetSeconds() { return seconds; };
-    void* Execute(size_t* pSize);
+    void Execute(ResultBuffer& result);
 
     virtual InfoBytes* ParseResult(char* result);
-    //char* GetCmdStr(char *cmd_buf);
+    char* GetCmdStr(char *cmd_buf);
+    size_t GetCmdSize();
+
+    static ICommand* Create(char* data, size_t length, void* storage);
+    static size_t Build_SetTimeCommand(char* cmd_buf, time_t time, char rtc_bus_number);
 
     char rtc_bus_number;        
 private:
@@ -0,0 +1,66 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : tar-extract.h
+*
+* DESCRIPTION : Extracts a tar archive (ustar, and the GNU long names) into a
+*               directory as its bytes arrive, in pieces of any size :
+*
+*                   TarExtract tar;
+*                   TarExtract_Init(&tar, "/home/apps/new");
+*                   TarExtract_Write(&tar, data, size);    // as many times as needed
+*                   int error = TarExtract_Finish(&tar);
+*
+*               The regular files and the directories are extracted with the
+*               permissions of their header (the executable bits included),
+*               the other entries (links, devices...) are skipped. A name that
+*               is absolute or contains ".." is refused, nothing is written
+*               out of the directory.
+*
+*               'manifest' lists the files extracted : "[size] [name]\n"
+*
+*----------------------------------------------------------------------------*/
+#ifndef TAR_EXTRACT_H
+#define TAR_EXTRACT_H
+
+#include <stddef.h>
+#include <string>
+
+#include "SpaceDecl.h"
+
+#define TAR_BLOCK_SIZE 512
+
+#define TAR_OK 0
+#define TAR_IO_ERROR 1
+#define TAR_BAD_ARCHIVE 2             // checksum, truncated, or a name out of the directory
+
+struct TarExtract
+{
+    char dir[CS1_PATH_MAX];
+    char header[TAR_BLOCK_SIZE];
+    size_t header_length;
+
+    char long_name[CS1_PATH_MAX];     // GNU 'L' entry, name of the next one
+    size_t long_name_length;
+    bool long_name_pending;
+
+    char path[CS1_PATH_MAX];          // the file being extracted
+    int fd;                           // -1 if the entry is skipped
+    char type;
+    size_t remaining;                 // data bytes of the entry
+    size_t padding;                   // up to the next block
+
+    bool done;                        // end of archive (a zero block)
+    int error;
+
+    unsigned int files;
+    unsigned long bytes;
+    std::string manifest;
+};
+
+void TarExtract_Init(TarExtract *tar, const char *dir);
+bool TarExtract_Write(TarExtract *tar, const unsigned char *data, size_t size);
+int TarExtract_Finish(TarExtract *tar);
+
+#endif
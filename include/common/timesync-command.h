@@ -0,0 +1,147 @@
+/*=============================================================================
+*
+*   AUTHOR      : Space Concordia 2015
+*
+*   PURPOSE     : The TimeSyncCommand measures the offset between the clocks of
+*                 the ground and of the satellite, and slews the clock of the
+*                 satellite, NTP-style :
+*
+*                   t0 ground sends        t1 satellite receives
+*                   t3 ground receives     t2 satellite replies
+*
+*                   offset = ((t1 - t0) + (t2 - t3)) / 2      satellite - ground
+*                   delay  = (t3 - t0) - (t2 - t1)            round trip on the link
+*
+*                 The offset is exact when the uplink and the downlink take
+*                 the same time, it is off by at most delay / 2 otherwise. The
+*                 ground sends several TIMESYNC_OP_SAMPLE in a session and
+*                 keeps the one of lowest delay (see Estimate), then sends
+*                 TIMESYNC_OP_SLEW with the opposite of the offset : adjtime
+*                 speeds up or slows down the clock until it is corrected, the
+*                 time never jumps (the logs and the tgz stay in order).
+*
+*                 The satellite reports t1 and t2 twice : CLOCK_REALTIME, and
+*                 CLOCK_MONOTONIC for the time spent between the two (a sample
+*                 during which the clock was set is discarded). t1 is taken
+*                 by MarkArrival when the space commander reads the frame,
+*                 the ground stamps t0 when it sends it : the ground commander
+*                 runs the exchange for the "timesync N" line of its journal.
+*
+*                 All the times are nanoseconds, 8 bytes little-endian. The
+*                 command is the same in every wire version.
+*
+*   FORMAT      :   [0]         :   TIMESYNC_CMD
+*                   [1]         :   op
+*                   [2-9]       :   TIMESYNC_OP_SAMPLE : t0, CLOCK_REALTIME of the ground
+*                                   TIMESYNC_OP_SLEW   : nanoseconds to add to the clock
+*
+*   RESULT      :   [0]         :   TIMESYNC_CMD
+*                   [1]         :   status
+*                   [2]         :   op
+*                   [3-10]      :   t0 / nanoseconds to add
+*                   [11-18]     :   t1 CLOCK_REALTIME / the adjustment it replaced, not yet applied
+*                   [19-26]     :   t1 CLOCK_MONOTONIC
+*                   [27-34]     :   t2 CLOCK_REALTIME
+*                   [35-42]     :   t2 CLOCK_MONOTONIC
+*
+*                 A slew larger than TIMESYNC_MAX_SLEW_NS is refused, the
+*                 clock slews by 0.5 ms per second : step it with the
+*                 SetTimeCommand first.
+*
+*============================================================================*/
+#ifndef TIMESYNC_COMMAND_H
+#define TIMESYNC_COMMAND_H
+
+#include <time.h>
+#include <string>
+
+#include "icommand.h"
+#include "infobytes.h"
+#include "wire-schema.h"
+#include "commands.h"
+
+#define TIMESYNC_OP_SAMPLE 0
+#define TIMESYNC_OP_SLEW 1
+
+#define TIMESYNC_NS_PER_SEC 1000000000LL
+#define TIMESYNC_MAX_SLEW_NS TIMESYNC_NS_PER_SEC
+#define TIMESYNC_STEP_TOLERANCE_NS 1000000LL     // realtime and monotonic elapsed differ : the clock was set
+
+/* [TIMESYNC_CMD][op][t0 or slew], see wire-schema.h */
+typedef WireSchema<WireCommandId<TIMESYNC_CMD>, WireByte, WireInt64LE> TimeSyncSchema;
+enum { TIMESYNC_FIELD_OP = 1, TIMESYNC_FIELD_VALUE };
+
+/* [TIMESYNC_CMD][STS][op][t0 or slew][t1 realtime or previous slew][t1 monotonic][t2 realtime][t2 monotonic] */
+typedef WireSchema<WireCommandId<TIMESYNC_CMD>, WireByte, WireByte, WireInt64LE,
+                   WireInt64LE, WireInt64LE, WireInt64LE, WireInt64LE> TimeSyncResultSchema;
+enum { TIMESYNC_FIELD_RESULT_OP = 2, TIMESYNC_FIELD_T0, TIMESYNC_FIELD_T1_REALTIME, TIMESYNC_FIELD_T1_MONOTONIC,
+       TIMESYNC_FIELD_T2_REALTIME, TIMESYNC_FIELD_T2_MONOTONIC };
+enum { TIMESYNC_FIELD_SLEW = TIMESYNC_FIELD_T0, TIMESYNC_FIELD_PREVIOUS_SLEW = TIMESYNC_FIELD_T1_REALTIME };
+
+#define TIMESYNC_CMD_SIZE ((size_t)TimeSyncSchema::SIZE)
+#define TIMESYNC_RTN_SIZE_TOTAL ((size_t)TimeSyncResultSchema::SIZE)
+
+/* One exchange, t3 is the CLOCK_REALTIME of the ground when the result arrived */
+struct TimeSyncSample
+{
+    long long t0;
+    long long t1_realtime;
+    long long t1_monotonic;
+    long long t2_realtime;
+    long long t2_monotonic;
+    long long t3;
+};
+
+struct TimeSyncEstimate
+{
+    long long offset;               // satellite - ground
+    long long delay;                // of the sample kept, |error| <= delay / 2
+    size_t samples;                 // valid samples
+};
+
+using namespace std;
+
+class InfoBytesTimeSync : public InfoBytes
+{
+    public:
+    char timesync_status;
+    char op;
+    TimeSyncSample sample;          // TIMESYNC_OP_SAMPLE, t3 is for the caller to fill
+    long long slew;                 // TIMESYNC_OP_SLEW
+    long long previous_slew;
+
+    string* ToString() {
+        return new string(1, timesync_status);
+    }
+};
+
+class TimeSyncCommand : public ICommand
+{
+    private :
+        char op;
+        long long value;
+        long long t1_realtime;
+        long long t1_monotonic;
+
+        static long long arrival_realtime;
+        static long long arrival_monotonic;
+
+    public :
+        TimeSyncCommand();
+        TimeSyncCommand(char op, long long value);
+        TimeSyncCommand(char op, long long value, long long t1_realtime, long long t1_monotonic);
+        virtual ~TimeSyncCommand();
+
+        virtual void Execute(ResultBuffer& result);
+        char* GetCmdStr(char* cmd_buf);
+        InfoBytes* ParseResult(char *result);
+
+        static ICommand* Create(char* data, size_t length, void* storage);
+        static size_t Build_TimeSyncCommand(char* cmd_buf, char op, long long value);
+
+        static long long Now(clockid_t clock);
+        static void MarkArrival();
+        static bool Estimate(const TimeSyncSample* samples, size_t count, TimeSyncEstimate* estimate);
+};
+
+#endif
@@ -4,10 +4,32 @@
 #include <string>
 #include "icommand.h"
 #include "infobytes.h"
+#include "wire.h"
+#include "wire-schema.h"
 #include <cstdlib>
 
 using namespace std;
 
+/*
+ * WIRE_V1 : [CMD_ID][path length (3 ASCII digits)][path][data length (3 ASCII digits)][data]
+ * WIRE_V2 : [CMD_ID][path length (varint)][path][data length (varint)][data]
+ */
+#define UPDATE_CMD_MIN_SIZE 7       // [CMD_ID][path length (3)][data length (3)]
+#define UPDATE_CMD_MIN_SIZE_V2 3    // [CMD_ID][path length (1)][data length (1)]
+#define UPDATE_V1_MAX_LENGTH 999
+
+/*
+ * UPDATE_LZ_CMD : same layouts, the data is compressed with LZSS (see lzss.h)
+ *      [size (varint)][dictionary size (varint)][dictionary crc (4, if its size > 0)][lzss]
+ * The dictionary is the end of the file before this chunk, its CRC-32 is
+ * checked before anything is written : a chunk lost or sent twice fails
+ * instead of corrupting the file. At most UPDATE_LZ_MAX_SIZE bytes per chunk.
+ *
+ * Result : [CMD_ID][CMD_STS][bytes written (ASCII, 50 bytes)], -1 on failure
+ */
+#define UPDATE_LZ_MAX_SIZE 4096
+#define UPDATE_LZ_HEAD_MAX_SIZE 8   // [size (2)][dictionary size (2)][dictionary crc (4)]
+
 class InfoBytesUpdate : public InfoBytes {
     public:
     const char* bytes_written; 
@@ -21,34 +43,38 @@ class InfoBytesUpdate : public InfoBytes {
 
 class UpdateCommand : public ICommand {
 public:
-    UpdateCommand() {}
+    UpdateCommand() {
+        this->compressed = false;
+    }
 
-    UpdateCommand(char* path, int data_length, char* file_data) {
+    // 'path' and 'file_data' are not copied (see WireView)
+    UpdateCommand(WireView path, WireView file_data, bool compressed = false) {
         this->path = path;
-        this->data_length = data_length;
         this->file_data = file_data;
+        this->compressed = compressed;
     }
     
-    ~UpdateCommand(){ 
-        //Does file_data need to be set to null as well? yes!
-        if (file_data != NULL){
-            delete file_data;
-            file_data = NULL;
-        }
-        
-        if (path != NULL) {
-            delete path;
-            path = NULL;
-        }
-    }
+    ~UpdateCommand() { }
 
-    void* Execute(size_t* pSize);
+    void Execute(ResultBuffer& result);
     InfoBytes* ParseResult(char* result);
-    char* GetPath()       { return path; }
-    int   GetDataLength() { return data_length; }
+    char* GetCmdStr(char* cmd_buf);
+    size_t GetCmdSize();
+    const WireView& GetPath() { return path; }
+    const WireView& GetData() { return file_data; }
+    int   GetDataLength()     { return file_data.length; }
+    bool  IsCompressed()      { return compressed; }
+
+    static ICommand* Create(char* data, size_t length, void* storage);
+    static size_t Build_UpdateCommand(char* cmd_buf, WireView path, WireView data, bool compressed = false);
+    static size_t Build_UpdateChunk(char* cmd_buf, size_t cmd_size, WireView path, WireView file,
+                                                                    size_t offset, size_t* consumed);
+    static size_t GetCmdSize(size_t path_length, size_t data_length);
 private:
-    char* path;
-    int data_length;
-    char* file_data;
+    ssize_t Decompress(int fd, unsigned char* out);
+
+    WireView path;
+    WireView file_data;
+    bool compressed;
 };
 #endif
@@ -0,0 +1,116 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : upload-command.h
+*
+* DESCRIPTION : Uploads a file in chunks addressed by their offset, in any
+*               order and over several passes (see upload-session.h). The
+*               UpdateCommand appends its chunks and stays for the small files.
+*
+*               [UPLOAD_CMD][op][upload id (4)]...  the 4 bytes fields as
+*               SpaceString::get4Char, in WIRE_V1 and WIRE_V2 :
+*
+*               'O' open     : [size (4)][crc (4)][path length (1)][path]
+*               'W' write    : [offset (4)][data length (4)][data]
+*                              whole blocks (UPLOAD_BLOCK_SIZE) : 'offset'
+*                              is a multiple of it, and 'data length' too
+*                              unless the chunk ends the file. Create and
+*                              Build_Write refuse an unaligned offset, the
+*                              write fails for an unaligned length.
+*               'M' missing  : [from (4)]
+*               'F' finalize :
+*               'A' abort    :
+*
+*               The ground opens the upload, writes the chunks, asks for the
+*               missing ranges until there is none, then finalizes : the CRC
+*               is checked and the file renamed to 'path'. Opening it again
+*               after an interruption resumes it.
+*
+*               Result : [UPLOAD_CMD][CMD_STS][op][value (4)]
+*                   value : the bytes received ('O', 'W', 'M'), the CRC of the
+*                           file ('F', 0 if blocks are missing)
+*                   'M' adds [count (1)][count x ([offset (4)][length (4)])],
+*                   the missing ranges from 'from', at most UPLOAD_MAX_RANGES
+*
+*----------------------------------------------------------------------------*/
+#ifndef UPLOAD_COMMAND_H
+#define UPLOAD_COMMAND_H
+
+#include <string>
+#include <sstream>
+
+#include "icommand.h"
+#include "infobytes.h"
+#include "wire.h"
+#include "wire-schema.h"
+#include "commands.h"
+#include "upload-session.h"
+
+#define UPLOAD_OPEN 'O'
+#define UPLOAD_WRITE 'W'
+#define UPLOAD_MISSING 'M'
+#define UPLOAD_FINALIZE 'F'
+#define UPLOAD_ABORT 'A'
+
+typedef WireSchema<WireCommandId<UPLOAD_CMD>, WireByte, WireUInt32> UploadSchema;
+enum { UPLOAD_FIELD_OP = 1, UPLOAD_FIELD_ID };
+
+typedef WireSchema<WireCommandId<UPLOAD_CMD>, WireByte, WireUInt32, WireUInt32, WireUInt32, WireByte> UploadOpenSchema;
+enum { UPLOAD_OPEN_FIELD_SIZE = 3, UPLOAD_OPEN_FIELD_CRC, UPLOAD_OPEN_FIELD_PATH_LENGTH };
+
+typedef WireSchema<WireCommandId<UPLOAD_CMD>, WireByte, WireUInt32, WireUInt32, WireUInt32> UploadWriteSchema;
+enum { UPLOAD_WRITE_FIELD_OFFSET = 3, UPLOAD_WRITE_FIELD_LENGTH };
+
+typedef WireSchema<WireCommandId<UPLOAD_CMD>, WireByte, WireUInt32, WireUInt32> UploadMissingSchema;
+enum { UPLOAD_MISSING_FIELD_FROM = 3 };
+
+typedef WireSchema<WireCommandId<UPLOAD_CMD>, WireByte, WireByte, WireUInt32> UploadResultSchema;
+enum { UPLOAD_RES_FIELD_OP = 2, UPLOAD_RES_FIELD_VALUE };
+
+typedef WireSchema<WireUInt32, WireUInt32> UploadRangeSchema;
+enum { UPLOAD_RANGE_FIELD_OFFSET = 0, UPLOAD_RANGE_FIELD_LENGTH };
+
+#define UPLOAD_CMD_MIN_SIZE ((size_t)UploadSchema::SIZE)
+#define UPLOAD_MAX_PATH_LENGTH 255
+#define UPLOAD_RES_MAX_SIZE ((size_t)UploadResultSchema::SIZE + 1 + UPLOAD_MAX_RANGES * (size_t)UploadRangeSchema::SIZE)
+
+class InfoBytesUpload : public InfoBytes
+{
+    public:
+    char upload_status;
+    char op;
+    unsigned int value;
+    size_t range_count;
+    UploadRange ranges[UPLOAD_MAX_RANGES];
+
+    std::string* ToString() {
+        std::stringstream ss;
+        ss << op << " " << (int)upload_status << " " << value;
+        return new std::string(ss.str());
+    }
+};
+
+class UploadCommand : public ICommand {
+public:
+    UploadCommand() { }
+
+    // 'command' is not copied, all the bytes received (see WireView)
+    UploadCommand(WireView command) : command(command) { }
+
+    ~UploadCommand() { }
+
+    void Execute(ResultBuffer& result);
+    InfoBytes* ParseResult(char* result);
+
+    static ICommand* Create(char* data, size_t length, void* storage);
+
+    static size_t Build_Open(char* cmd_buf, unsigned int id, unsigned int size, unsigned int crc, WireView path);
+    static size_t Build_Write(char* cmd_buf, unsigned int id, unsigned int offset, WireView data);
+    static size_t Build_Missing(char* cmd_buf, unsigned int id, unsigned int from);
+    static size_t Build_Finalize(char* cmd_buf, unsigned int id);
+    static size_t Build_Abort(char* cmd_buf, unsigned int id);
+private:
+    WireView command;
+};
+#endif
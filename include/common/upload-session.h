@@ -0,0 +1,93 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : upload-session.h
+*
+* DESCRIPTION : A file uploaded by the ground in chunks, in any order and
+*               over several passes (see UploadCommand).
+*
+*               The chunks are written at their offset in 'path.part', a
+*               bitmap of the UPLOAD_BLOCK_SIZE blocks received is kept in
+*               'path.upload' :
+*
+*                   [magic (4)][id (4)][size (4)][crc (4)][bitmap]
+*
+*               so an upload interrupted (end of the pass, reboot) resumes
+*               where it stopped when it is opened again with the same id,
+*               size and CRC. A chunk received twice is written twice at the
+*               same place.
+*
+*               Finalize checks that every block was received and the CRC-32
+*               (crc32.h) of the file, then renames 'path.part' to 'path',
+*               the file appears whole or not at all. If the CRC does not
+*               match, every block is missing again.
+*
+*               At most UPLOAD_MAX_SESSIONS uploads are open at once, the
+*               sessions are process wide.
+*
+*----------------------------------------------------------------------------*/
+#ifndef UPLOAD_SESSION_H
+#define UPLOAD_SESSION_H
+
+#include <cstddef>
+
+#include "SpaceDecl.h"
+
+#define UPLOAD_MAX_SESSIONS 4
+#define UPLOAD_BLOCK_SIZE 32                    // bytes per bit of the bitmap
+#define UPLOAD_MAX_SIZE (16 * 1024 * 1024)      // bytes
+#define UPLOAD_MAX_RANGES 16                    // per GetMissing
+#define UPLOAD_PART_EXT ".part"
+#define UPLOAD_STATE_EXT ".upload"
+#define UPLOAD_STATE_MAGIC 0x55504c31           // "UPL1"
+#define UPLOAD_STATE_HEAD_SIZE 16
+
+struct UploadRange
+{
+    unsigned int offset;
+    unsigned int length;
+};
+
+class UploadSession
+{
+    private :
+        unsigned int id;
+        unsigned int size;
+        unsigned int crc;
+        char path[CS1_PATH_MAX];
+        int fd;                     // path.part
+        int state_fd;               // path.upload
+        unsigned char *bitmap;
+        unsigned int blocks;
+        unsigned int received_blocks;
+
+        bool Load();
+        bool Create();
+        void Mark(unsigned int first, unsigned int last);
+        bool IsReceived(unsigned int block) const {
+            return (this->bitmap[block / 8] >> (block % 8)) & 1;
+        }
+
+    public :
+        UploadSession();
+        ~UploadSession();
+
+        static UploadSession* Open(unsigned int id, const char *path, unsigned int size, unsigned int crc);
+        static UploadSession* Find(unsigned int id);
+        static void CloseAll();
+
+        bool Write(unsigned int offset, const char *data, size_t length);
+        size_t GetMissing(unsigned int from, UploadRange *ranges, size_t max_ranges) const;
+        unsigned int GetReceived() const;
+        bool Finalize(unsigned int *crc);
+        void Abort();
+        void Close();
+
+        bool IsOpen() const { return this->fd != -1; }
+        unsigned int GetId() const { return this->id; }
+        unsigned int GetSize() const { return this->size; }
+        const char* GetPath() const { return this->path; }
+};
+
+#endif
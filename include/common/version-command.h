@@ -0,0 +1,74 @@
+/*=============================================================================
+*
+*   AUTHOR      : Space Concordia 2015
+*
+*   PURPOSE     : The VersionCommand negotiates the wire format of the session
+*                 (see wire.h). The ground sends the highest version it
+*                 supports, the satellite answers with the version it will use
+*                 for the following commands, i.e. the lowest of the two.
+*                 The version is kept from one session to the next, until it
+*                 is negotiated again or a commander restarts in WIRE_V1.
+*                 Each pipeline frame carries the version of its command and
+*                 the satellite refuses the other ones (see
+*                 command-pipeline.h). The command itself is the same in
+*                 every version.
+*
+*   FORMAT      :   [0]         :   VERSION_CMD
+*                   [1]         :   highest version supported by the ground
+*
+*   RESULT      :   [0]         :   VERSION_CMD
+*                   [1]         :   status
+*                   [2]         :   version in use
+*
+*============================================================================*/
+#ifndef VERSION_COMMAND_H
+#define VERSION_COMMAND_H
+
+#include "icommand.h"
+#include "infobytes.h"
+#include "wire.h"
+#include "wire-schema.h"
+#include "commands.h"
+
+/* [VERSION_CMD][highest version of the ground], see wire-schema.h */
+typedef WireSchema<WireCommandId<VERSION_CMD>, WireByte> VersionSchema;
+enum { VERSION_FIELD_VERSION = 1 };
+
+/* [VERSION_CMD][STS][version in use] */
+typedef WireSchema<WireCommandId<VERSION_CMD>, WireByte, WireByte> VersionResultSchema;
+enum { VERSION_FIELD_VERSION_IN_USE = 2 };
+
+#define VERSION_CMD_SIZE ((size_t)VersionSchema::SIZE)
+#define VERSION_RTN_SIZE 1
+
+using namespace std;
+
+class InfoBytesVersion : public InfoBytes
+{
+    public:
+    char version_status;
+    unsigned char version;
+
+    string* ToString() {
+        return new string (1, version_status);
+    }
+};
+
+class VersionCommand : public ICommand
+{
+    private :
+        unsigned char version;
+
+    public :
+        VersionCommand();
+        VersionCommand(unsigned char version);
+        virtual ~VersionCommand();
+
+        virtual void Execute(ResultBuffer& result);
+        char* GetCmdStr(char* cmd_buf);
+        InfoBytes* ParseResult(char *result);
+
+        static ICommand* Create(char* data, size_t length, void* storage);
+};
+
+#endif
@@ -0,0 +1,242 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : wire-schema.h
+*
+* DESCRIPTION : Compile-time description of the fixed-width part of a command
+*               or of a result, as a list of typed fields :
+*
+*                   typedef WireSchema<WireCommandId<GETLOG_CMD>,   // [0]
+*                                      WireByte,                    // [1]   opt
+*                                      WireByte,                    // [2]   subsystem
+*                                      WireUInt32,                  // [3-6] size
+*                                      WireUInt32> GetLogSchema;    // [7-10] date
+*
+*               The offsets and the sizes are computed by the compiler, the
+*               accessors are inlined to a load / store at a constant offset :
+*
+*                   GetLogSchema::SIZE                      11
+*                   GetLogSchema::Init(buffer)              writes the constant fields (CMD_ID)
+*                   GetLogSchema::Put<3>(buffer, size)      writes field 3
+*                   GetLogSchema::Get<3>(buffer)            reads field 3 in place
+*                   GetLogSchema::Check(buffer, length)     length >= SIZE and the
+*                                                           constant fields match
+*
+*               A field is a struct with a value_type, a SIZE, Put and Get,
+*               and IsValid / Init for the constant ones (see WireCommandId).
+*               An index out of the list does not compile.
+*
+*               The commands keep their byte layout, the variable-length parts
+*               (paths, payloads, the acknowledgements of GetLog) follow the
+*               schema and are still read by hand, see wire.h.
+*
+*               (the compilers of the Q6 toolchain predate constexpr and the
+*               variadic templates : the list is built with default template
+*               arguments and the constants are enums)
+*
+*----------------------------------------------------------------------------*/
+#ifndef WIRE_SCHEMA_H
+#define WIRE_SCHEMA_H
+
+#include <cstddef>
+#include <string.h>
+#include <time.h>
+
+#include "SpaceString.h"
+#include "wire.h"
+
+/*
+ * Fields
+ */
+struct WireByte                 // one byte
+{
+    typedef char value_type;
+    enum { SIZE = 1 };
+
+    static void Put(char *buffer, char value) { *buffer = value; }
+    static char Get(const char *buffer) { return *buffer; }
+    static void Init(char *) {}
+    static bool IsValid(const char *) { return true; }
+};
+
+template <unsigned char ID>
+struct WireCommandId            // [CMD_ID], written by Init, checked by Check
+{
+    typedef unsigned char value_type;
+    enum { SIZE = 1 };
+
+    static void Put(char *buffer, unsigned char) { *buffer = (char)ID; }
+    static unsigned char Get(const char *buffer) { return (unsigned char)*buffer; }
+    static void Init(char *buffer) { *buffer = (char)ID; }
+    static bool IsValid(const char *buffer) { return (unsigned char)*buffer == ID; }
+};
+
+struct WireUInt32               // 4 bytes, as SpaceString::get4Char / getUInt
+{
+    typedef unsigned int value_type;
+    enum { SIZE = 4 };
+
+    static void Put(char *buffer, unsigned int value) { SpaceString::get4Char(buffer, value); }
+    static unsigned int Get(const char *buffer) { return SpaceString::getUInt(buffer); }
+    static void Init(char *) {}
+    static bool IsValid(const char *) { return true; }
+};
+
+struct WireUInt32LE             // 4 bytes little-endian, WIRE_V2
+{
+    typedef unsigned int value_type;
+    enum { SIZE = WIRE_UINT32_SIZE };
+
+    static void Put(char *buffer, unsigned int value) { Wire::PutUInt32(buffer, value); }
+    static unsigned int Get(const char *buffer) { return Wire::GetUInt32(buffer); }
+    static void Init(char *) {}
+    static bool IsValid(const char *) { return true; }
+};
+
+struct WireInt64LE              // 8 bytes little-endian, signed (nanoseconds)
+{
+    typedef long long value_type;
+    enum { SIZE = WIRE_INT64_SIZE };
+
+    static void Put(char *buffer, long long value) { Wire::PutInt64(buffer, value); }
+    static long long Get(const char *buffer) { return Wire::GetInt64(buffer); }
+    static void Init(char *) {}
+    static bool IsValid(const char *) { return true; }
+};
+
+struct WireTimeT                // time_t in host byte order, WIRE_V1
+{
+    typedef time_t value_type;
+    enum { SIZE = sizeof(time_t) };
+
+    static void Put(char *buffer, time_t value) { memcpy(buffer, &value, sizeof(time_t)); }
+    static time_t Get(const char *buffer) { time_t value; memcpy(&value, buffer, sizeof(time_t)); return value; }
+    static void Init(char *) {}
+    static bool IsValid(const char *) { return true; }
+};
+
+/*
+ * Field list : WireList<F1, WireList<F2, ... WireEnd> >
+ */
+struct WireEnd {};
+
+template <class Head, class Tail>
+struct WireList
+{
+    typedef Head head;
+    typedef Tail tail;
+};
+
+template <class List>
+struct WireListSize
+{
+    enum { VALUE = List::head::SIZE + WireListSize<typename List::tail>::VALUE };
+};
+
+template <>
+struct WireListSize<WireEnd>
+{
+    enum { VALUE = 0 };
+};
+
+template <class List, int I>
+struct WireListAt               // field I and its offset
+{
+    typedef typename WireListAt<typename List::tail, I - 1>::field field;
+    enum { OFFSET = List::head::SIZE + WireListAt<typename List::tail, I - 1>::OFFSET };
+};
+
+template <class List>
+struct WireListAt<List, 0>
+{
+    typedef typename List::head field;
+    enum { OFFSET = 0 };
+};
+
+template <class List>
+struct WireListConstants        // Init / IsValid of every field
+{
+    static void Init(char *buffer) {
+        List::head::Init(buffer);
+        WireListConstants<typename List::tail>::Init(buffer + List::head::SIZE);
+    }
+
+    static bool IsValid(const char *buffer) {
+        return List::head::IsValid(buffer)
+                    && WireListConstants<typename List::tail>::IsValid(buffer + List::head::SIZE);
+    }
+};
+
+template <>
+struct WireListConstants<WireEnd>
+{
+    static void Init(char *) {}
+    static bool IsValid(const char *) { return true; }
+};
+
+/*
+ * WireSchema<F1, ..., F8>
+ */
+template <class F1, class F2 = WireEnd, class F3 = WireEnd, class F4 = WireEnd,
+          class F5 = WireEnd, class F6 = WireEnd, class F7 = WireEnd, class F8 = WireEnd>
+struct WireSchemaList
+{
+    typedef WireList<F1, typename WireSchemaList<F2, F3, F4, F5, F6, F7, F8>::type> type;
+};
+
+template <>
+struct WireSchemaList<WireEnd, WireEnd, WireEnd, WireEnd, WireEnd, WireEnd, WireEnd, WireEnd>
+{
+    typedef WireEnd type;
+};
+
+template <class F1, class F2 = WireEnd, class F3 = WireEnd, class F4 = WireEnd,
+          class F5 = WireEnd, class F6 = WireEnd, class F7 = WireEnd, class F8 = WireEnd>
+class WireSchema
+{
+    public :
+        typedef typename WireSchemaList<F1, F2, F3, F4, F5, F6, F7, F8>::type fields;
+
+        enum { SIZE = WireListSize<fields>::VALUE };
+
+        template <int I>
+        struct At {
+            typedef typename WireListAt<fields, I>::field field;
+            typedef typename field::value_type value_type;
+            enum { OFFSET = WireListAt<fields, I>::OFFSET };
+        };
+
+        static void Init(char *buffer) {
+            WireListConstants<fields>::Init(buffer);
+        }
+
+        template <int I>
+        static void Put(char *buffer, typename At<I>::value_type value) {
+            At<I>::field::Put(buffer + At<I>::OFFSET, value);
+        }
+
+        template <int I>
+        static typename At<I>::value_type Get(const char *buffer) {
+            return At<I>::field::Get(buffer + At<I>::OFFSET);
+        }
+
+        /* 'length' bytes at 'buffer' hold the schema and its constant fields */
+        static bool Check(const char *buffer, size_t length) {
+            return buffer && length >= (size_t)SIZE && WireListConstants<fields>::IsValid(buffer);
+        }
+
+        /* Same, when the length is not known (i.e. in ParseResult) */
+        static bool Check(const char *buffer) {
+            return buffer && WireListConstants<fields>::IsValid(buffer);
+        }
+};
+
+/*
+ * Header of every result : [CMD_ID][CMD_STS], CMD_ID = 0 and CMD_STS = 1 (see
+ * icommand.h) are the indices of the fields.
+ */
+template <unsigned char ID>
+struct WireResultHead : public WireSchema<WireCommandId<ID>, WireByte> {};
+
+#endif
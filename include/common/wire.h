@@ -0,0 +1,91 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : wire.h
+*
+* DESCRIPTION : Encoding of the command fields sent from the ground.
+*
+*               WIRE_V1 : lengths as ASCII digits (3 or 10), time_t in host
+*                         byte order. Paths and payloads are capped at 999 bytes.
+*               WIRE_V2 : lengths and sizes as varints (LEB128, 7 bits per byte,
+*                         least significant group first), time_t as 4 bytes
+*                         little-endian.
+*
+*               GetLog, DeleteLog, GetTime and Reboot only have fixed-width
+*               binary fields, they are the same in both versions.
+*
+*               A process starts in WIRE_V1, the ground switches to WIRE_V2
+*               with the VersionCommand (see version-command.h). The version
+*               is process wide and kept from one session to the next, until
+*               the ground negotiates again or the process restarts : the
+*               satellite reads it in the Create of the commands, the ground
+*               in the GetCmdStr/Build_* functions. A pipeline frame carries
+*               the version its command was built with, a mismatch is
+*               refused (see command-pipeline.h).
+*
+*               Whatever the version, the space commander reads a command of
+*               at most MAX_COMMAND_SIZE (255) bytes from last-command : the
+*               varints do not make a longer one go through that path.
+*
+*----------------------------------------------------------------------------*/
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <cstddef>
+#include <string.h>
+
+#define WIRE_V1 1
+#define WIRE_V2 2
+#define WIRE_MAX_VERSION WIRE_V2
+
+#define WIRE_VARINT_MAX_SIZE 5      // 32 bits values
+#define WIRE_UINT32_SIZE 4
+#define WIRE_INT64_SIZE 8
+
+/*
+ * Non-owning view of 'length' bytes, NOT null terminated. The views of a
+ * command point into the buffer it was created from, that buffer has to
+ * outlive the command.
+ */
+struct WireView
+{
+    const char *data;
+    size_t length;
+
+    WireView() : data(0), length(0) {}
+    WireView(const char *data, size_t length) : data(data), length(length) {}
+    WireView(const char *str) : data(str), length(str ? strlen(str) : 0) {}
+
+    bool CopyTo(char *buffer, size_t size) const;
+    bool Equals(const char *str) const { return strlen(str) == length && memcmp(str, data, length) == 0; }
+};
+
+class Wire
+{
+    private :
+        static unsigned char version;
+
+    public :
+        static unsigned char GetVersion() { return version; }
+        static bool SetVersion(unsigned char version);
+        static void Reset() { version = WIRE_V1; }
+
+        static size_t PutVarint(char *buffer, unsigned int value);
+        static size_t GetVarint(const char *buffer, unsigned int *value);
+        static size_t GetVarint(const char *buffer, size_t size, unsigned int *value);
+        static size_t VarintSize(unsigned int value);
+
+        static void PutUInt32(char *buffer, unsigned int value);
+        static unsigned int GetUInt32(const char *buffer);
+
+        static void PutInt64(char *buffer, long long value);
+        static long long GetInt64(const char *buffer);
+
+        // true if 'length' bytes at 'offset' are within the 'size' bytes received
+        static bool Fits(size_t offset, size_t length, size_t size) {
+            return offset <= size && length <= size - offset;
+        }
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef NAMEDPIPE_H_
 #define NAMEDPIPE_H_
 #include <cstdio>
+#include "common/result-buffer.h"
 class  NamedPipe{
     private :
         const static int MAX_RETRY = 5;
@@ -15,6 +16,7 @@ class  NamedPipe{
         bool Exist();
         int ReadFromPipe(char* buffer, int buf_size);   // Return value : On success, buffer is returned. On failure, NULL is returned.
         int WriteToPipe(const void* data, int size); // Return value : On success, the number of bytes written. On failure, negative value.
+        int WriteToPipe(const ResultBuffer& result); // Return value : On success, result.GetSize(). On failure, negative value.
         bool Open(char mode);
         void closePipe();
 };
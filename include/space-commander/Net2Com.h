@@ -32,6 +32,7 @@ class Net2Com{
         int WriteToDataPipe(const char* str);
         int WriteToDataPipe(unsigned char);
         int WriteToDataPipe(const void*, int);
+        int WriteToDataPipe(const ResultBuffer& result);
         int ReadFromDataPipe(char* buffer, int buf_size);
         int WriteToInfoPipe(const char* str);
         int WriteToInfoPipe(const void*, int);
@@ -1,5 +1,66 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* TITLE : base64.h
+*
+* DESCRIPTION : Base64 (RFC 4648, '+' '/' and '=' padding) on buffers provided
+*               by the caller, nothing is allocated :
+*
+*                   char out[BASE64_ENCODED_SIZE(len)];
+*                   size_t n = base64_encode_buffer(in, len, out);
+*
+*                   unsigned char out[BASE64_DECODED_MAX_SIZE(len)];
+*                   size_t n = base64_decode_buffer(in, len, out);
+*
+*               The decoder stops at the first '=' or character that is not
+*               base64, as base64_decode always did, and returns the number of
+*               bytes written.
+*
+*               On x86 the decoder translates 16 (SSSE3) or 32 (AVX2)
+*               characters at a time, chosen when the process starts. Elsewhere
+*               (buildQ6) and for the tail it uses a 256-entry table.
+*               Build with -DBASE64_NO_SIMD to keep the scalar path only.
+*
+*               A long input is decoded in chunks with a Base64Stream, which
+*               keeps the characters of a group split between two chunks :
+*
+*                   Base64Stream stream;
+*                   base64_stream_init(&stream);
+*                   while (... chunk of len characters ...)
+*                       n = base64_stream_decode(&stream, chunk, len, out);    // out : BASE64_STREAM_MAX_SIZE(len)
+*                   n = base64_stream_finish(&stream, out);                    // out : 2 bytes
+*
+*               The bytes are the same as decoding the chunks at once.
+*
+*               base64_encode / base64_decode return a std::string, as before.
+*
+*----------------------------------------------------------------------------*/
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <cstddef>
 #include <string>
 
+#define BASE64_ENCODED_SIZE(len) ((((len) + 2) / 3) * 4)
+#define BASE64_DECODED_MAX_SIZE(len) ((((len) + 3) / 4) * 3)
+#define BASE64_STREAM_MAX_SIZE(len) BASE64_DECODED_MAX_SIZE((len) + 3)
+
+struct Base64Stream
+{
+    unsigned char group[3];     // values of the characters of an incomplete group
+    size_t pending;             // how many
+    bool done;                  // '=' or a non base64 character was reached
+};
+
+size_t base64_encode_buffer(const unsigned char *in, size_t len, char *out);
+size_t base64_decode_buffer(const char *in, size_t len, unsigned char *out);
+size_t base64_decode_scalar(const char *in, size_t len, unsigned char *out);
+const char* base64_decode_path();
+
+void base64_stream_init(Base64Stream *stream);
+size_t base64_stream_decode(Base64Stream *stream, const char *in, size_t len, unsigned char *out);
+size_t base64_stream_finish(Base64Stream *stream, unsigned char *out);
+
 std::string base64_encode(unsigned char const* , unsigned int len);
 std::string base64_decode(std::string const& s);
 
+#endif
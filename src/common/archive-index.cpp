@@ -0,0 +1,420 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : archive-index.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/archive-index.h"
+
+#define GETDENTS_BUF_SIZE 4096
+#define INOTIFY_BUF_SIZE (sizeof(struct inotify_event) + CS1_NAME_MAX + 1) * 16
+#define WATCH_MASK (IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF)
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ArchiveIndex
+*
+*-----------------------------------------------------------------------------*/
+ArchiveIndex::ArchiveIndex()
+{
+    memset(this->directory, '\0', CS1_PATH_MAX);
+    this->inotify_fd = -1;
+    this->watch_fd = -1;
+    this->scanned = false;
+    this->total_size = 0;
+    this->removed = 0;
+    this->removed_context = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Open
+*
+* ARGUMENTS : directory - directory to index, not scanned until first used
+*
+*-----------------------------------------------------------------------------*/
+void ArchiveIndex::Open(const char *directory)
+{
+    strncpy(this->directory, directory, CS1_PATH_MAX - 1);
+
+    if (this->inotify_fd < 0) {
+        this->inotify_fd = inotify_init();
+    }
+
+    if (this->inotify_fd >= 0) {
+        fcntl(this->inotify_fd, F_SETFL, fcntl(this->inotify_fd, F_GETFL) | O_NONBLOCK);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ~ArchiveIndex
+*
+*-----------------------------------------------------------------------------*/
+ArchiveIndex::~ArchiveIndex()
+{
+    if (this->inotify_fd >= 0) {
+        close(this->inotify_fd);    // also removes the watch
+        this->inotify_fd = -1;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetInstance
+*
+* PURPOSE : Returns the process wide index of 'directory', the index has to
+*           outlive the commands to be of any use. The instances are not
+*           allocated on the heap.
+*
+*-----------------------------------------------------------------------------*/
+ArchiveIndex* ArchiveIndex::GetInstance(const char *directory)
+{
+    static ArchiveIndex instances[ARCHIVE_INDEX_MAX_DIRS];
+
+    for (int i = 0; i < ARCHIVE_INDEX_MAX_DIRS; i++) {
+        if (instances[i].GetDirectory()[0] == '\0') {
+            instances[i].Open(directory);
+            return &instances[i];
+        }
+
+        if (strcmp(instances[i].GetDirectory(), directory) == 0) {
+            return &instances[i];
+        }
+    }
+
+    return 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Clear
+*
+* PURPOSE : Releases the entries, the next access scans the directory again.
+*
+*-----------------------------------------------------------------------------*/
+void ArchiveIndex::Clear()
+{
+    this->entries.clear();
+    this->inodes.clear();
+    this->scanned = false;
+    this->total_size = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : SetRemovedFunction
+*
+* PURPOSE : 'removed' is called with the inode of every file that leaves
+*           the directory, as the index learns it
+*
+*-----------------------------------------------------------------------------*/
+void ArchiveIndex::SetRemovedFunction(ArchiveRemovedFunction removed, void *context)
+{
+    this->removed = removed;
+    this->removed_context = context;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Lookup
+*
+* PURPOSE : Saves the name of the file with inode 'inode' into 'name'
+*
+* RETURN : true if found, 'name' is an empty string otherwise.
+*
+*-----------------------------------------------------------------------------*/
+bool ArchiveIndex::Lookup(ino_t inode, char *name, size_t name_size)
+{
+    std::map<ino_t, ArchiveEntry>::iterator it;
+
+    bool rescanned = this->Refresh();
+    it = this->entries.find(inode);
+
+    if (it == this->entries.end() && !rescanned) {
+        this->Rescan();     // the index may be stale (no inotify, queue overflow...)
+        it = this->entries.find(inode);
+    }
+
+    if (it == this->entries.end()) {
+        if (name_size > 0) {
+            name[0] = '\0';
+        }
+        return false;
+    }
+
+    snprintf(name, name_size, "%s", it->second.name.c_str());
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCount
+*
+*-----------------------------------------------------------------------------*/
+size_t ArchiveIndex::GetCount()
+{
+    this->Refresh();
+    return this->entries.size();
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetTotalSize
+*
+* PURPOSE : Returns the sum of the sizes of the indexed files, in bytes
+*
+*-----------------------------------------------------------------------------*/
+size_t ArchiveIndex::GetTotalSize()
+{
+    this->Refresh();
+    return this->total_size;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetEntries
+*
+* PURPOSE : Returns the up to date entries, by inode. The reference is only
+*           valid until the next call on the index.
+*
+*-----------------------------------------------------------------------------*/
+const std::map<ino_t, ArchiveEntry>& ArchiveIndex::GetEntries()
+{
+    this->Refresh();
+    return this->entries;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Refresh
+*
+* PURPOSE : Applies the pending inotify events to the index, never blocks.
+*
+* RETURN : true if the directory had to be scanned again
+*
+*-----------------------------------------------------------------------------*/
+bool ArchiveIndex::Refresh()
+{
+    char buffer[INOTIFY_BUF_SIZE] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t bytes = 0;
+
+    if (!this->scanned || this->watch_fd < 0) {
+        this->Rescan();
+        return true;
+    }
+
+    while ((bytes = read(this->inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + bytes; ) {
+            struct inotify_event *event = (struct inotify_event*)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->wd != this->watch_fd) {
+                continue;   // left over from a previous watch
+            }
+
+            if (event->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                this->scanned = false;  // the directory was removed/moved or we lost events
+                continue;
+            }
+
+            if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                this->Remove(event->name);
+            } else {
+                this->Update(event->name);
+            }
+        }
+    }
+
+    if (!this->scanned) {
+        this->Rescan();
+        return true;
+    }
+
+    return false;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Rescan
+*
+* PURPOSE : Rebuilds the index with a single pass of getdents64 on the
+*           directory. The files gone since the last scan are reported to
+*           the ArchiveRemovedFunction.
+*
+*-----------------------------------------------------------------------------*/
+void ArchiveIndex::Rescan()
+{
+    char buffer[GETDENTS_BUF_SIZE] __attribute__ ((aligned(8)));
+    long bytes = 0;
+    std::map<ino_t, ArchiveEntry> previous;
+
+    previous.swap(this->entries);
+    this->inodes.clear();
+    this->scanned = false;
+    this->total_size = 0;
+
+    this->Watch();
+
+    int dir_fd = open(this->directory, O_RDONLY | O_DIRECTORY);
+
+    if (dir_fd < 0) {
+        return;
+    }
+
+    while ((bytes = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer))) > 0) {
+        for (long offset = 0; offset < bytes; ) {
+            struct linux_dirent64 *dirent = (struct linux_dirent64*)(buffer + offset);
+            offset += dirent->d_reclen;
+
+            if (dirent->d_type != DT_REG && dirent->d_type != DT_UNKNOWN) {
+                continue;
+            }
+
+            struct stat attr;
+            if (fstatat(dir_fd, dirent->d_name, &attr, 0) != 0 || !S_ISREG(attr.st_mode)) {
+                continue;
+            }
+
+            ArchiveEntry entry;
+            entry.inode = attr.st_ino;
+            entry.name = dirent->d_name;
+            entry.size = attr.st_size;
+            entry.mtime = attr.st_mtime;
+
+            this->entries[entry.inode] = entry;
+            this->inodes[entry.name] = entry.inode;
+            this->total_size += entry.size;
+        }
+    }
+
+    close(dir_fd);
+    this->scanned = true;
+
+    for (std::map<ino_t, ArchiveEntry>::iterator it = previous.begin(); it != previous.end() && this->removed; ++it) {
+        if (this->entries.find(it->first) == this->entries.end()) {
+            this->removed(it->first, this->removed_context);
+        }
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Watch
+*
+* PURPOSE : (Re)adds the inotify watch on the directory. Must be done before
+*           the scan so that no event falls in between.
+*
+*-----------------------------------------------------------------------------*/
+void ArchiveIndex::Watch()
+{
+    char buffer[INOTIFY_BUF_SIZE];
+
+    if (this->inotify_fd < 0) {
+        return;
+    }
+
+    if (this->watch_fd >= 0) {
+        inotify_rm_watch(this->inotify_fd, this->watch_fd);
+    }
+
+    while (read(this->inotify_fd, buffer, sizeof(buffer)) > 0) {
+        // drop the stale events, the scan will see everything
+    }
+
+    this->watch_fd = inotify_add_watch(this->inotify_fd, this->directory, WATCH_MASK);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Update
+*
+* PURPOSE : Adds or updates 'name' in the index
+*
+*-----------------------------------------------------------------------------*/
+void ArchiveIndex::Update(const char *name)
+{
+    char path[CS1_PATH_MAX] = {'\0'};
+    struct stat attr;
+
+    snprintf(path, CS1_PATH_MAX, "%s/%s", this->directory, name);
+
+    if (stat(path, &attr) != 0 || !S_ISREG(attr.st_mode)) {
+        return;
+    }
+
+    std::map<std::string, ino_t>::iterator it = this->inodes.find(name);
+
+    if (it != this->inodes.end() && it->second == attr.st_ino && this->entries.count(attr.st_ino) > 0) {
+        ArchiveEntry& entry = this->entries[attr.st_ino];      // written to, or its mtime changed
+
+        this->total_size = this->total_size - entry.size + attr.st_size;
+        entry.size = attr.st_size;
+        entry.mtime = attr.st_mtime;
+        return;
+    }
+
+    this->Remove(name);     // the name may have been reused by another inode
+
+    ArchiveEntry entry;
+    entry.inode = attr.st_ino;
+    entry.name = name;
+    entry.size = attr.st_size;
+    entry.mtime = attr.st_mtime;
+
+    this->entries[entry.inode] = entry;
+    this->inodes[entry.name] = entry.inode;
+    this->total_size += entry.size;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Remove
+*
+*-----------------------------------------------------------------------------*/
+void ArchiveIndex::Remove(const char *name)
+{
+    std::map<std::string, ino_t>::iterator it = this->inodes.find(name);
+
+    if (it != this->inodes.end()) {
+        std::map<ino_t, ArchiveEntry>::iterator entry = this->entries.find(it->second);
+
+        ino_t inode = it->second;
+
+        if (entry != this->entries.end()) {
+            this->total_size -= entry->second.size;
+            this->entries.erase(entry);
+        }
+
+        this->inodes.erase(it);
+
+        if (this->removed) {
+            this->removed(inode, this->removed_context);
+        }
+    }
+}
@@ -0,0 +1,394 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : async-log.cpp
+*
+* DESCRIPTION : see async-log.h
+*
+*               The ring is the bounded MPSC queue of D. Vyukov : each slot
+*               has a sequence number, a producer claims a position with a
+*               compare-and-swap and publishes the record by setting the
+*               sequence of its slot, the single consumer frees the slot by
+*               moving its sequence one lap ahead. The GCC __sync builtins
+*               are the only atomics of the Q6 toolchain.
+*
+*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SpaceDecl.h"
+#include "common/async-log.h"
+
+#define ASYNC_LOG_KIND_NUMBERS 0
+#define ASYNC_LOG_KIND_STRING 1
+
+struct AsyncLogRecord
+{
+    volatile unsigned int sequence;
+    char priority;
+    unsigned char system;
+    char kind;
+    const char* format;
+    long args[3];
+    char text[ASYNC_LOG_TEXT_SIZE];
+};
+
+int AsyncLog::level = CS1_LOG_MIN_LEVEL;
+
+static AsyncLogRecord ring[ASYNC_LOG_RING_SIZE];
+static volatile unsigned int enqueue_position = 0;
+static volatile unsigned int dequeue_position = 0;      // consumer only
+static volatile unsigned int dropped = 0;
+
+static sem_t ready;                                     // one post per record published
+static pthread_t thread;
+static volatile bool started = false;
+static volatile bool stopping = false;
+
+static int ShakespeareSink(Shakespeare::Priority priority, const char* system, const char* message)
+{
+    return Shakespeare::log(priority, system, message);
+}
+
+static AsyncLog::SinkFunction sink = ShakespeareSink;
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Write
+*
+* PURPOSE : Formats 'record' and hands it to the sink
+*
+*-----------------------------------------------------------------------------*/
+static void Write(const AsyncLogRecord& record)
+{
+    char message[CS1_MAX_LOG_ENTRY];
+
+    if (record.kind == ASYNC_LOG_KIND_STRING) {
+        snprintf(message, sizeof(message), record.format, record.text, record.args[0], record.args[1]);
+    } else {
+        snprintf(message, sizeof(message), record.format, record.args[0], record.args[1], record.args[2]);
+    }
+
+    sink((Shakespeare::Priority)record.priority, cs1_systems[record.system], message);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ValidFormat
+*
+* PURPOSE : Checks the conversions of 'format' against the record : a %s
+*           first if 'text' (and no other), then at most 'numbers' of
+*           %ld / %li / %lu / %lx / %lX, with flags and a width
+*
+* RETURN : false if snprintf would read an argument of another type
+*
+*-----------------------------------------------------------------------------*/
+static bool ValidFormat(const char* format, bool text, int numbers)
+{
+    bool string_expected = text;
+
+    for (const char* p = format; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+
+        p++;
+        if (*p == '%') {
+            continue;
+        }
+
+        while (*p && strchr("-+ #0", *p)) {
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+
+        if (string_expected) {
+            if (*p != 's') {
+                return false;
+            }
+            string_expected = false;
+            continue;
+        }
+
+        if (*p != 'l' || !p[1] || !strchr("diuxX", p[1]) || numbers == 0) {
+            return false;
+        }
+
+        p++;
+        numbers--;
+    }
+
+    return !string_expected;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Refuse
+*
+* PURPOSE : Reports a record whose format does not match, without formatting it
+*
+*-----------------------------------------------------------------------------*/
+static bool Refuse(unsigned char system, const char* format)
+{
+    char message[CS1_MAX_LOG_ENTRY];
+
+    snprintf(message, sizeof(message), "AsyncLog : format refused : %s", format);
+    sink(Shakespeare::ERROR, cs1_systems[system], message);
+
+    return false;
+}
+
+static void InitRing()
+{
+    for (unsigned int i = 0; i < ASYNC_LOG_RING_SIZE; i++) {
+        ring[i].sequence = i;
+    }
+
+    enqueue_position = 0;
+    dequeue_position = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Run
+*
+* PURPOSE : The consumer : copies the next record out of its slot, frees the
+*           slot, then formats and writes the copy
+*
+*-----------------------------------------------------------------------------*/
+static void* Run(void*)
+{
+    unsigned int reported = 0;
+    AsyncLogRecord record;
+
+    for (;;) {
+        while (sem_wait(&ready) != 0 && errno == EINTR) {
+        }
+
+        AsyncLogRecord& slot = ring[dequeue_position & (ASYNC_LOG_RING_SIZE - 1)];
+
+        if (slot.sequence != dequeue_position + 1) {
+            if (stopping) {
+                break;                  // the post of Stop, the ring is empty
+            }
+
+            // the post of a record further in the ring, this slot is claimed but not published yet
+            sem_post(&ready);
+            sched_yield();
+            continue;
+        }
+
+        __sync_synchronize();
+        memcpy(&record, &slot, sizeof(record));
+        __sync_synchronize();
+        slot.sequence = dequeue_position + ASYNC_LOG_RING_SIZE;
+
+        Write(record);
+        dequeue_position++;
+
+        if (dropped != reported) {
+            char message[CS1_MAX_LOG_ENTRY];
+            unsigned int count = dropped;
+
+            snprintf(message, sizeof(message), "AsyncLog : %u records dropped, the ring was full", count - reported);
+            sink(Shakespeare::WARNING, cs1_systems[record.system], message);
+            reported = count;
+        }
+    }
+
+    return 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Enqueue
+*
+* PURPOSE : Claims a slot, fills it with 'record' and publishes it
+*
+* RETURN : false if the ring is full (the record is dropped)
+*
+*-----------------------------------------------------------------------------*/
+static bool Enqueue(const AsyncLogRecord& record)
+{
+    unsigned int position = enqueue_position;
+    AsyncLogRecord* slot = 0;
+
+    for (;;) {
+        slot = &ring[position & (ASYNC_LOG_RING_SIZE - 1)];
+        int difference = (int)(slot->sequence - position);
+
+        if (difference == 0) {
+            if (__sync_bool_compare_and_swap(&enqueue_position, position, position + 1)) {
+                break;
+            }
+            position = enqueue_position;
+        } else if (difference < 0) {
+            __sync_fetch_and_add(&dropped, 1);
+            return false;
+        } else {
+            position = enqueue_position;
+        }
+    }
+
+    slot->priority = record.priority;
+    slot->system = record.system;
+    slot->kind = record.kind;
+    slot->format = record.format;
+    memcpy(slot->args, record.args, sizeof(slot->args));
+    memcpy(slot->text, record.text, sizeof(slot->text));
+
+    __sync_synchronize();
+    slot->sequence = position + 1;
+    sem_post(&ready);
+
+    return true;
+}
+
+static bool Submit(AsyncLogRecord& record)
+{
+    if (!started) {
+        Write(record);
+        return true;
+    }
+
+    return Enqueue(record);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Start
+*
+* PURPOSE : Starts the thread, the records logged from now on are written by
+*           it. Call it once, before the commands run.
+*
+* RETURN : false if the thread can't be started (the caller keeps writing)
+*
+*-----------------------------------------------------------------------------*/
+bool AsyncLog::Start()
+{
+    if (started) {
+        return true;
+    }
+
+    InitRing();
+    stopping = false;
+
+    if (sem_init(&ready, 0, 0) != 0) {
+        return false;
+    }
+
+    if (pthread_create(&thread, 0, Run, 0) != 0) {
+        sem_destroy(&ready);
+        return false;
+    }
+
+    started = true;
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Stop
+*
+* PURPOSE : Writes the records left and stops the thread, the callers write
+*           their records again
+*
+*-----------------------------------------------------------------------------*/
+void AsyncLog::Stop()
+{
+    if (!started) {
+        return;
+    }
+
+    AsyncLog::Flush(ASYNC_LOG_FLUSH_TIMEOUT_MS);
+
+    started = false;
+    stopping = true;
+    sem_post(&ready);
+    pthread_join(thread, 0);
+    sem_destroy(&ready);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Flush
+*
+* PURPOSE : Waits until the records logged before the call are written, i.e.
+*           before a reboot
+*
+* RETURN : false if they are not after 'timeout_ms'
+*
+*-----------------------------------------------------------------------------*/
+bool AsyncLog::Flush(int timeout_ms)
+{
+    unsigned int target = enqueue_position;
+
+    for (int waited = 0; started && (int)(dequeue_position - target) < 0; waited++) {
+        if (waited >= timeout_ms) {
+            return false;
+        }
+        usleep(1000);
+    }
+
+    return true;
+}
+
+bool AsyncLog::Log(Shakespeare::Priority priority, unsigned char system, const char* format,
+                                                   long a1, long a2, long a3)
+{
+    AsyncLogRecord record;
+
+    if (!format || !ValidFormat(format, false, 3)) {
+        return Refuse(system, format ? format : "(null)");
+    }
+
+    record.priority = (char)priority;
+    record.system = system;
+    record.kind = ASYNC_LOG_KIND_NUMBERS;
+    record.format = format;
+    record.args[0] = a1;
+    record.args[1] = a2;
+    record.args[2] = a3;
+    record.text[0] = '\0';
+
+    return Submit(record);
+}
+
+bool AsyncLog::LogString(Shakespeare::Priority priority, unsigned char system, const char* format,
+                                                         const char* text, long a1, long a2)
+{
+    AsyncLogRecord record;
+
+    if (!format || !ValidFormat(format, true, 2)) {
+        return Refuse(system, format ? format : "(null)");
+    }
+
+    record.priority = (char)priority;
+    record.system = system;
+    record.kind = ASYNC_LOG_KIND_STRING;
+    record.format = format;
+    record.args[0] = a1;
+    record.args[1] = a2;
+    record.args[2] = 0;
+    snprintf(record.text, ASYNC_LOG_TEXT_SIZE, "%s", text ? text : "(null)");
+
+    return Submit(record);
+}
+
+unsigned int AsyncLog::Dropped()
+{
+    return dropped;
+}
+
+void AsyncLog::SetSink(SinkFunction function)
+{
+    sink = function ? function : ShakespeareSink;
+}
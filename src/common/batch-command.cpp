@@ -0,0 +1,248 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : batch-command.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "common/batch-command.h"
+#include "common/command-factory.h"
+#include "common/commands.h"
+#include "common/event-log.h"
+#include "common/session-arena.h"
+#include "common/subsystems.h"
+#include "common/command-registry.h"
+#include "shakespeare.h"
+#include "SpaceDecl.h"
+
+static CommandRegistrar<BatchCommand> registrar(BATCH_CMD, BATCH_CMD_MIN_SIZE);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*           (see batch-command.h), the entries are read by Execute, within
+*           'length'
+*
+*-----------------------------------------------------------------------------*/
+ICommand* BatchCommand::Create(char* data, size_t length, void* storage)
+{
+    return ConstructCommand<BatchCommand>(storage, BatchSchema::Get<BATCH_FIELD_FLAGS>(data),
+                                          (unsigned char)BatchSchema::Get<BATCH_FIELD_COUNT>(data),
+                                          WireView(data + BatchSchema::SIZE, length - BatchSchema::SIZE));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Build_BatchCommand
+*
+* PURPOSE : Builds a BatchCommand of 'count' entries into 'cmd_buf'
+*
+* RETURN : the number of bytes written, 0 if it does not fit in 'cmd_size',
+*          there are too many entries, or a condition refers to an entry
+*          that is not before it
+*
+*-----------------------------------------------------------------------------*/
+size_t BatchCommand::Build_BatchCommand(char* cmd_buf, size_t cmd_size, char flags, const BatchEntry* entries, size_t count)
+{
+    size_t offset = BatchSchema::SIZE;
+
+    if (count > BATCH_MAX_COMMANDS || cmd_size < offset) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const BatchEntry& entry = entries[i];
+
+        if (entry.command.length == 0 || entry.command.length > BATCH_MAX_COMMAND_SIZE
+                || (entry.condition != BATCH_ALWAYS && entry.ref >= i)
+                || offset + BATCH_ENTRY_HEAD_SIZE + entry.command.length > cmd_size) {
+            return 0;
+        }
+
+        cmd_buf[offset++] = entry.condition;
+        cmd_buf[offset++] = (char)entry.ref;
+        cmd_buf[offset++] = (char)entry.command.length;
+        memcpy(cmd_buf + offset, entry.command.data, entry.command.length);
+        offset += entry.command.length;
+    }
+
+    BatchSchema::Init(cmd_buf);
+    BatchSchema::Put<BATCH_FIELD_FLAGS>(cmd_buf, flags);
+    BatchSchema::Put<BATCH_FIELD_COUNT>(cmd_buf, (char)count);
+
+    return offset;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+*
+* PURPOSE : Runs the entries in order, the result of each one is moved to
+*           'result' behind the header (see ResultBuffer::AppendResult). The
+*           walk stops at the first entry past the bytes received.
+*
+*-----------------------------------------------------------------------------*/
+void BatchCommand::Execute(ResultBuffer& result)
+{
+    char states[BATCH_MAX_COMMANDS];
+    unsigned char count = (this->count > BATCH_MAX_COMMANDS) ? BATCH_MAX_COMMANDS : this->count;
+    unsigned char received = 0;
+    size_t offset = 0;
+
+    while (received < count && Wire::Fits(offset, BATCH_ENTRY_HEAD_SIZE, this->entries.length)
+            && Wire::Fits(offset + BATCH_ENTRY_HEAD_SIZE, (unsigned char)this->entries.data[offset + 2], this->entries.length)) {
+        offset += BATCH_ENTRY_HEAD_SIZE + (unsigned char)this->entries.data[offset + 2];
+        received++;
+    }
+
+    if (received < count) {
+        count = received + 1;       // the one that overruns, BATCH_INVALID
+    }
+
+    char* head = result.Alloc(BatchResultSchema::SIZE + count * BATCH_RES_ENTRY_SIZE);
+    CommandStorage* storage = (CommandStorage*)SessionArena::AllocCurrent(sizeof(CommandStorage));
+    char status = CS1_SUCCESS;
+    bool stopped = false;
+    char* entry = (char*)this->entries.data;
+
+    if (!head || !storage) {
+        SessionArena::FreeCurrent(storage);
+        result.Clear();
+        return;
+    }
+
+    for (unsigned char i = 0; i < count; i++) {
+        char condition = BATCH_ALWAYS;
+        unsigned char ref = 0;
+        size_t length = 0;
+        char* data = entry + BATCH_ENTRY_HEAD_SIZE;
+        char state = BATCH_SUCCEEDED;
+        size_t size = 0;
+
+        if (i < received) {
+            condition = entry[0];
+            ref = (unsigned char)entry[1];
+            length = (unsigned char)entry[2];
+            entry = data + length;
+        }
+
+        if (i == received) {
+            state = BATCH_INVALID;      // past the bytes received, the last one
+        } else if (stopped) {
+            state = BATCH_NOT_RUN;
+        } else if (condition != BATCH_ALWAYS && (ref >= i || condition > BATCH_IF_FAILED)) {
+            state = BATCH_INVALID;
+        } else if ((condition == BATCH_IF_SUCCEEDED && states[ref] != BATCH_SUCCEEDED)
+                    || (condition == BATCH_IF_FAILED && states[ref] != BATCH_FAILED && states[ref] != BATCH_INVALID)) {
+            state = BATCH_SKIPPED;
+        } else {
+            ICommand* command = (length > 0 && data[CMD_ID] != (char)BATCH_CMD)
+                                    ? CommandFactory::CreateCommand(data, length, storage) : 0;
+
+            if (!command) {
+                state = BATCH_INVALID;
+            } else {
+                ResultBuffer command_result;
+                struct timespec start, end;
+
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                command->Execute(command_result);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+
+                EventLog::Command((unsigned char)data[CMD_ID], command_result,
+                                        (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
+                CommandFactory::DestroyCommand(command);
+
+                // [CMD_ID][CMD_STS] are in memory, a file segment is not read
+                const ResultSegment* command_head = command_result.IsEmpty() ? 0 : &command_result.GetSegment(0);
+                state = (command_head && command_head->type == RESULT_SEGMENT_MEMORY && command_head->length > CMD_STS
+                                      && command_head->data[CMD_STS] == CS1_SUCCESS) ? BATCH_SUCCEEDED : BATCH_FAILED;
+                size = command_result.GetSize();
+
+                if (!result.AppendResult(command_result)) {
+                    state = BATCH_FAILED;       // no memory left for its result
+                    size = 0;
+                }
+            }
+        }
+
+        if (state == BATCH_FAILED || state == BATCH_INVALID) {
+            status = CS1_FAILURE;
+            stopped = stopped || (this->flags & BATCH_STOP_ON_FAILURE);
+        }
+
+        states[i] = state;
+        head[BatchResultSchema::SIZE + i * BATCH_RES_ENTRY_SIZE] = state;
+        Wire::PutUInt32(head + BatchResultSchema::SIZE + i * BATCH_RES_ENTRY_SIZE + 1, (unsigned int)size);
+    }
+
+    SessionArena::FreeCurrent(storage);
+
+    BatchResultSchema::Init(head);
+    BatchResultSchema::Put<CMD_STS>(head, status);
+    BatchResultSchema::Put<BATCH_RES_FIELD_COUNT>(head, (char)count);
+
+    snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Batch %s: %d commands",
+                    (status == CS1_SUCCESS) ? "success" : "failure", (int)count);
+    Shakespeare::log(status == CS1_SUCCESS ? Shakespeare::NOTICE : Shakespeare::ERROR,
+                                                    cs1_systems[CS1_COMMANDER], this->log_buffer);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ParseResult
+*
+* PURPOSE : Reads the states and hands the result of each command to its
+*           own ParseResult (see CommandRegistry::Parse)
+*
+*-----------------------------------------------------------------------------*/
+InfoBytes* BatchCommand::ParseResult(char* result)
+{
+    static InfoBytesBatch info_bytes;
+
+    info_bytes.count = 0;
+
+    if (!BatchResultSchema::Check(result)) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Batch failure: Can't parse result");
+        info_bytes.batch_status = CS1_FAILURE;
+        return &info_bytes;
+    }
+
+    info_bytes.batch_status = BatchResultSchema::Get<CMD_STS>(result);
+    info_bytes.count = (unsigned char)BatchResultSchema::Get<BATCH_RES_FIELD_COUNT>(result);
+
+    if (info_bytes.count > BATCH_MAX_COMMANDS) {
+        info_bytes.count = BATCH_MAX_COMMANDS;
+    }
+
+    char* command_result = result + BatchResultSchema::SIZE + info_bytes.count * BATCH_RES_ENTRY_SIZE;
+
+    for (unsigned char i = 0; i < info_bytes.count; i++) {
+        const char* entry = result + BatchResultSchema::SIZE + i * BATCH_RES_ENTRY_SIZE;
+
+        info_bytes.states[i] = entry[0];
+        info_bytes.sizes[i] = Wire::GetUInt32(entry + 1);
+        info_bytes.statuses[i] = CS1_FAILURE;
+        info_bytes.results[i] = 0;
+
+        if (info_bytes.sizes[i] >= CMD_RES_HEAD_SIZE) {
+            info_bytes.results[i] = command_result;
+            info_bytes.statuses[i] = command_result[CMD_STS];
+            CommandRegistry::Parse(command_result);
+        }
+
+        command_result += info_bytes.sizes[i];
+    }
+
+    snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Batch %s: %d commands",
+                    (info_bytes.batch_status == CS1_SUCCESS) ? "success" : "failure", (int)info_bytes.count);
+    Shakespeare::log(info_bytes.batch_status == CS1_SUCCESS ? Shakespeare::NOTICE : Shakespeare::ERROR,
+                                                    cs1_systems[CS1_COMMANDER], this->log_buffer);
+
+    return &info_bytes;
+}
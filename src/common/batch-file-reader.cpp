@@ -0,0 +1,537 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : batch-file-reader.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef CS1_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "common/batch-file-reader.h"
+
+#define QUEUE_DEPTH (BATCH_READER_MAX_FILES * 2)
+
+#ifdef CS1_IO_URING
+/* user_data of a completion : (index << 2) | op */
+#define OP_STATX 0
+#define OP_OPEN  1
+#define OP_READ  2
+#define OP_CLOSE 3
+#define USER_DATA(index, op) (((uint64_t)(index) << 2) | (op))
+#define USER_INDEX(data)     ((size_t)((data) >> 2))
+#define USER_OP(data)        ((int)((data) & 0x3))
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+#endif
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : BatchFileReader
+*
+*-----------------------------------------------------------------------------*/
+BatchFileReader::BatchFileReader()
+{
+    this->ring_fd = -1;
+    this->ring_broken = false;
+    this->sq_ptr = 0;
+    this->cq_ptr = 0;
+    this->sqes_ptr = 0;
+    this->sq_ring_size = 0;
+    this->cq_ring_size = 0;
+    this->sqes_size = 0;
+
+    this->SetupRing();
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ~BatchFileReader
+*
+*-----------------------------------------------------------------------------*/
+BatchFileReader::~BatchFileReader()
+{
+    this->TeardownRing();
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : UsesIoUring
+*
+*-----------------------------------------------------------------------------*/
+bool BatchFileReader::UsesIoUring()
+{
+    return this->ring_fd >= 0 && !this->ring_broken;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ReadAll
+*
+* PURPOSE : Reads every entry, at most BATCH_READER_MAX_FILES at a time.
+*
+* RETURN : The number of entries read without error.
+*
+*-----------------------------------------------------------------------------*/
+size_t BatchFileReader::ReadAll(BatchFileEntry *entries, size_t count)
+{
+    size_t done = 0;
+    size_t success = 0;
+
+    while (done < count) {
+        size_t batch = count - done;
+
+        if (batch > BATCH_READER_MAX_FILES) {
+            batch = BATCH_READER_MAX_FILES;
+        }
+
+        if (this->UsesIoUring()) {
+            success += this->ReadAll_IoUring(entries + done, batch);
+        } else {
+            success += this->ReadAll_Preadv(entries + done, batch);
+        }
+
+        done += batch;
+    }
+
+    return success;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ReadAll_Preadv
+*
+* PURPOSE : Fallback, one open + fstat + preadv + close per file.
+*
+*-----------------------------------------------------------------------------*/
+size_t BatchFileReader::ReadAll_Preadv(BatchFileEntry *entries, size_t count)
+{
+    size_t success = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (BatchFileReader::ReadOne_Preadv(&entries[i]) == 0) {
+            success++;
+        }
+    }
+
+    return success;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ReadOne_Preadv
+*
+* RETURN : 0 on success, errno otherwise (also saved in entry->error)
+*
+*-----------------------------------------------------------------------------*/
+int BatchFileReader::ReadOne_Preadv(BatchFileEntry *entry)
+{
+    struct stat attr;
+    struct iovec iov;
+    ssize_t bytes = 0;
+
+    entry->bytes = 0;
+    entry->file_size = 0;
+    entry->inode = 0;
+    entry->mtime = 0;
+    entry->error = 0;
+
+    int fd = open(entry->path, O_RDONLY);
+
+    if (fd < 0) {
+        entry->error = errno;
+        return entry->error;
+    }
+
+    if (fstat(fd, &attr) != 0) {
+        entry->error = errno;
+        close(fd);
+        return entry->error;
+    }
+
+    entry->inode = attr.st_ino;
+    entry->mtime = attr.st_mtime;
+    entry->file_size = attr.st_size;
+
+    iov.iov_base = entry->buffer;
+    iov.iov_len = entry->capacity;
+    bytes = preadv(fd, &iov, 1, 0);
+
+    if (bytes < 0) {
+        entry->error = errno;
+    } else {
+        entry->bytes = (size_t)bytes;
+    }
+
+    close(fd);
+
+    return entry->error;
+}
+
+#ifdef CS1_IO_URING
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : SetupRing
+*
+* PURPOSE : Creates the io_uring instance and maps the SQ/CQ rings. On
+*           failure (ENOSYS, EPERM in a sandbox...), ring_fd stays at -1
+*           and the preadv fallback is used.
+*
+*-----------------------------------------------------------------------------*/
+bool BatchFileReader::SetupRing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    this->ring_fd = sys_io_uring_setup(QUEUE_DEPTH, &params);
+
+    if (this->ring_fd < 0) {
+        this->ring_fd = -1;
+        return false;
+    }
+
+    this->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    this->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    this->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (this->cq_ring_size > this->sq_ring_size) {
+            this->sq_ring_size = this->cq_ring_size;
+        }
+        this->cq_ring_size = this->sq_ring_size;
+    }
+
+    this->sq_ptr = mmap(0, this->sq_ring_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQ_RING);
+
+    if (this->sq_ptr == MAP_FAILED) {
+        this->sq_ptr = 0;
+        this->TeardownRing();
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        this->cq_ptr = this->sq_ptr;
+    } else {
+        this->cq_ptr = mmap(0, this->cq_ring_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_CQ_RING);
+
+        if (this->cq_ptr == MAP_FAILED) {
+            this->cq_ptr = 0;
+            this->TeardownRing();
+            return false;
+        }
+    }
+
+    this->sqes_ptr = mmap(0, this->sqes_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQES);
+
+    if (this->sqes_ptr == MAP_FAILED) {
+        this->sqes_ptr = 0;
+        this->TeardownRing();
+        return false;
+    }
+
+    char *sq = (char*)this->sq_ptr;
+    char *cq = (char*)this->cq_ptr;
+
+    this->sq_head  = (unsigned*)(sq + params.sq_off.head);
+    this->sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+    this->sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+    this->sq_array = (unsigned*)(sq + params.sq_off.array);
+    this->cq_head  = (unsigned*)(cq + params.cq_off.head);
+    this->cq_tail  = (unsigned*)(cq + params.cq_off.tail);
+    this->cq_mask  = (unsigned*)(cq + params.cq_off.ring_mask);
+    this->cqes     = cq + params.cq_off.cqes;
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : TeardownRing
+*
+*-----------------------------------------------------------------------------*/
+void BatchFileReader::TeardownRing()
+{
+    if (this->sqes_ptr) {
+        munmap(this->sqes_ptr, this->sqes_size);
+        this->sqes_ptr = 0;
+    }
+
+    if (this->cq_ptr && this->cq_ptr != this->sq_ptr) {
+        munmap(this->cq_ptr, this->cq_ring_size);
+    }
+    this->cq_ptr = 0;
+
+    if (this->sq_ptr) {
+        munmap(this->sq_ptr, this->sq_ring_size);
+        this->sq_ptr = 0;
+    }
+
+    if (this->ring_fd >= 0) {
+        close(this->ring_fd);
+        this->ring_fd = -1;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : SubmitRing
+*
+* PURPOSE : Submits the 'count' SQEs written up to 'tail' and waits for their
+*           completions. The SQEs the kernel did not take are withdrawn, the
+*           ring is left empty for the next batch.
+*
+* RETURN : The number of SQEs submitted, ReapRing has to reap as many
+*          completions.
+*
+*-----------------------------------------------------------------------------*/
+unsigned BatchFileReader::SubmitRing(unsigned tail, unsigned count)
+{
+    unsigned head = *this->sq_head;
+
+    __sync_synchronize();
+    *this->sq_tail = tail;
+    __sync_synchronize();
+
+    if (sys_io_uring_enter(this->ring_fd, count, count, IORING_ENTER_GETEVENTS) < 0) {
+        this->ring_broken = true;
+    }
+
+    __sync_synchronize();
+    unsigned submitted = *this->sq_head - head;
+
+    if (submitted < count) {
+        *this->sq_tail = *this->sq_head;    // not taken by the kernel
+        __sync_synchronize();
+        this->ring_broken = true;
+    }
+
+    return submitted;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ReapRing
+*
+* PURPOSE : Reaps the completions of the 'submitted' SQEs, in any order. It
+*           returns once all of them are in : a completion left in the ring
+*           would be taken for one of the next batch. A file whose statx or
+*           openat failed gets the error, a file closed by the kernel gets
+*           fds[i] = -1.
+*
+*-----------------------------------------------------------------------------*/
+void BatchFileReader::ReapRing(BatchFileEntry *entries, struct statx *stx, int *fds, unsigned submitted)
+{
+    struct io_uring_cqe *cqes = (struct io_uring_cqe*)this->cqes;
+    unsigned reaped = 0;
+
+    while (reaped < submitted) {
+        __sync_synchronize();
+        unsigned head = *this->cq_head;
+
+        if (head == *this->cq_tail) {
+            if (sys_io_uring_enter(this->ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                usleep(1000);       // the operations complete anyway, poll the ring
+            }
+            continue;
+        }
+
+        struct io_uring_cqe *cqe = &cqes[head & *this->cq_mask];
+        size_t i = USER_INDEX(cqe->user_data);
+
+        if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) {
+            this->ring_broken = true;   // opcode not supported by this kernel
+        }
+
+        switch (USER_OP(cqe->user_data)) {
+            case OP_STATX :
+                if (cqe->res == 0) {
+                    entries[i].inode = stx[i].stx_ino;
+                    entries[i].mtime = stx[i].stx_mtime.tv_sec;
+                    entries[i].file_size = stx[i].stx_size;
+                } else if (entries[i].error == 0) {
+                    entries[i].error = -cqe->res;
+                }
+                break;
+            case OP_OPEN :
+                if (cqe->res >= 0) {
+                    fds[i] = cqe->res;
+                } else {
+                    entries[i].error = -cqe->res;
+                }
+                break;
+            case OP_READ :
+                if (cqe->res >= 0) {
+                    entries[i].bytes = (size_t)cqe->res;
+                } else {
+                    entries[i].error = -cqe->res;
+                }
+                break;
+            case OP_CLOSE :
+                if (cqe->res >= 0) {
+                    fds[i] = -1;
+                }
+                break;
+        }
+
+        __sync_synchronize();
+        *this->cq_head = head + 1;
+        reaped++;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ReadAll_IoUring
+*
+* PURPOSE : Two io_uring_enter per batch :
+*           1. statx + openat for every file
+*           2. read (linked to) close for every file that was opened
+*           Completions are handled as they arrive, in any order. If the
+*           ring fails, what was submitted is reaped and the batch is read
+*           again with preadv.
+*
+*-----------------------------------------------------------------------------*/
+size_t BatchFileReader::ReadAll_IoUring(BatchFileEntry *entries, size_t count)
+{
+    struct statx stx[BATCH_READER_MAX_FILES];
+    int fds[BATCH_READER_MAX_FILES];
+    struct io_uring_sqe *sqes = (struct io_uring_sqe*)this->sqes_ptr;
+    unsigned tail = 0;
+    unsigned queued = 0;
+    size_t success = 0;
+
+    memset(stx, 0, sizeof(stx));
+
+    for (size_t i = 0; i < count; i++) {
+        fds[i] = -1;
+        entries[i].bytes = 0;
+        entries[i].file_size = 0;
+        entries[i].inode = 0;
+        entries[i].mtime = 0;
+        entries[i].error = 0;
+    }
+
+    // 1. statx + openat
+    tail = *this->sq_tail;
+    for (size_t i = 0; i < count; i++) {
+        unsigned index = tail & *this->sq_mask;
+        struct io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uint64_t)(uintptr_t)entries[i].path;
+        sqe->len = STATX_INO | STATX_MTIME | STATX_SIZE;
+        sqe->off = (uint64_t)(uintptr_t)&stx[i];
+        sqe->user_data = USER_DATA(i, OP_STATX);
+        this->sq_array[index] = index;
+        tail++;
+
+        index = tail & *this->sq_mask;
+        sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uint64_t)(uintptr_t)entries[i].path;
+        sqe->open_flags = O_RDONLY;
+        sqe->user_data = USER_DATA(i, OP_OPEN);
+        this->sq_array[index] = index;
+        tail++;
+    }
+
+    this->ReapRing(entries, stx, fds, this->SubmitRing(tail, count * 2));
+
+    // 2. read -> close, linked so that the close runs after the read
+    tail = *this->sq_tail;
+    for (size_t i = 0; i < count && !this->ring_broken; i++) {
+        if (fds[i] < 0) {
+            continue;
+        }
+
+        unsigned index = tail & *this->sq_mask;
+        struct io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fds[i];
+        sqe->addr = (uint64_t)(uintptr_t)entries[i].buffer;
+        sqe->len = entries[i].capacity;
+        sqe->off = 0;
+        sqe->flags = IOSQE_IO_HARDLINK; // close even if the read fails
+        sqe->user_data = USER_DATA(i, OP_READ);
+        this->sq_array[index] = index;
+        tail++;
+
+        index = tail & *this->sq_mask;
+        sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fds[i];
+        sqe->user_data = USER_DATA(i, OP_CLOSE);
+        this->sq_array[index] = index;
+        tail++;
+
+        queued += 2;
+    }
+
+    if (queued > 0) {
+        this->ReapRing(entries, stx, fds, this->SubmitRing(tail, queued));
+    }
+
+    // the files the kernel did not close (not submitted, or the close failed)
+    for (size_t i = 0; i < count; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+
+    if (this->ring_broken) {
+        return this->ReadAll_Preadv(entries, count);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i].error == 0) {
+            success++;
+        }
+    }
+
+    return success;
+}
+
+#else
+bool BatchFileReader::SetupRing()
+{
+    return false;
+}
+
+void BatchFileReader::TeardownRing()
+{
+    //
+}
+
+size_t BatchFileReader::ReadAll_IoUring(BatchFileEntry *entries, size_t count)
+{
+    return this->ReadAll_Preadv(entries, count);
+}
+#endif
@@ -0,0 +1,358 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "common/commands.h"
+#include "shakespeare.h"
+#include "SpaceDecl.h"
+#include "SpaceString.h"
+#include "common/bulkdeletelog-command.h"
+#include "common/archive-index.h"
+#include "common/getlog-command.h"
+#include "common/subsystems.h"
+#include "common/command-registry.h"
+
+extern const char* s_cs1_subsystems[];
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*
+*-----------------------------------------------------------------------------*/
+ICommand* BulkDeleteLogCommand::Create(char* data, size_t length, void* storage) {
+    BulkDeleteLogCommand* result = 0;
+
+    if (BulkDeleteListSchema::Get<BULKDELETE_FIELD_OPT>(data) == BULK_OPT_LIST) {
+        ino_t inodes[BULKDELETE_MAX_ITEMS];
+        size_t count = (unsigned char)BulkDeleteListSchema::Get<BULKDELETE_FIELD_COUNT>(data);
+
+        if (count > BULKDELETE_MAX_ITEMS) {
+            count = BULKDELETE_MAX_ITEMS;
+        }
+
+        if (!Wire::Fits(0, BULKDELETE_LIST_CMD_SIZE(count), length)) {
+            return 0;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            inodes[i] = WireUInt32::Get(data + BULKDELETE_LIST_CMD_SIZE(i));
+        }
+
+        result = ConstructCommand<BulkDeleteLogCommand>(storage, (const ino_t*)inodes, count);
+    } else if (Wire::Fits(0, BULKDELETE_PRED_CMD_SIZE, length)) {
+        result = ConstructCommand<BulkDeleteLogCommand>(storage, 
+                            BulkDeletePredicateSchema::Get<BULKDELETE_FIELD_PREDICATE>(data), 
+                            BulkDeletePredicateSchema::Get<BULKDELETE_FIELD_SUBSYSTEM>(data), 
+                            (time_t)BulkDeletePredicateSchema::Get<BULKDELETE_FIELD_OLDER_THAN>(data), 
+                            (size_t)BulkDeletePredicateSchema::Get<BULKDELETE_FIELD_LARGER_THAN>(data));
+    }
+
+    return result;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : BulkDeleteLogCommand
+*
+* ARGUMENTS : inodes    : input - inodes of the files to delete
+*             count     : number of inodes, truncated to BULKDELETE_MAX_ITEMS
+* 
+*-----------------------------------------------------------------------------*/
+BulkDeleteLogCommand::BulkDeleteLogCommand(const ino_t* inodes, size_t count)
+{
+    this->opt_byte = BULK_OPT_LIST;
+    this->predicate = 0;
+    this->subsystem = 0;
+    this->older_than = 0;
+    this->larger_than = 0;
+
+    if (count > BULKDELETE_MAX_ITEMS) {
+        count = BULKDELETE_MAX_ITEMS;
+    }
+
+    this->number_of_inodes = count;
+    for (size_t i = 0; i < count; i++) {
+        this->inodes[i] = inodes[i];
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : BulkDeleteLogCommand
+*
+* ARGUMENTS : predicate     : PRED_OLDER | PRED_SUB | PRED_LARGER, all the 
+*                             specified conditions have to match
+*             subsystem     : see subsystems.h (PRED_SUB)
+*             older_than    : delete the files last modified before (PRED_OLDER)
+*             larger_than   : delete the files larger than, in bytes (PRED_LARGER)
+* 
+*-----------------------------------------------------------------------------*/
+BulkDeleteLogCommand::BulkDeleteLogCommand(char predicate, char subsystem, time_t older_than, size_t larger_than)
+{
+    this->opt_byte = BULK_OPT_PREDICATE;
+    this->number_of_inodes = 0;
+    this->predicate = predicate;
+    this->subsystem = subsystem;
+    this->older_than = older_than;
+    this->larger_than = larger_than;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ~BulkDeleteLogCommand
+* 
+*-----------------------------------------------------------------------------*/
+BulkDeleteLogCommand::~BulkDeleteLogCommand()
+{
+    //
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+* 
+* PURPOSE : Deletes the files of CS1_TGZ matching the inodes or the predicate.
+*
+* RESULT : [DELETELOG_CMD][STS][N][MORE][bitmap]
+*           
+*-----------------------------------------------------------------------------*/
+void BulkDeleteLogCommand::Execute(ResultBuffer& result)
+{
+    char bitmap[BULKDELETE_BITMAP_SIZE(BULKDELETE_MAX_ITEMS)] = {0};
+    size_t count = 0;
+    size_t deleted = 0;
+    bool more = false;
+
+    int dir_fd = open(CS1_TGZ, O_RDONLY | O_DIRECTORY);
+
+    if (dir_fd >= 0) {
+        if (this->opt_byte == BULK_OPT_LIST) {
+            count = this->number_of_inodes;
+            deleted = this->DeleteList(dir_fd, bitmap);
+        } else {
+            count = this->DeletePredicate(dir_fd, bitmap, &more);
+            deleted = count;
+            for (size_t i = 0; i < count; i++) {
+                if (!(bitmap[i / 8] & (1 << (i % 8)))) {
+                    deleted--;
+                }
+            }
+        }
+
+        close(dir_fd);
+    }
+
+    char* data = result.Alloc(sizeof(char) * (BULKDELETE_RTN_HEAD_SIZE + BULKDELETE_BITMAP_SIZE(count)));
+
+    if (!data) {
+        return;
+    }
+
+    BulkDeleteResultSchema::Init(data);
+    BulkDeleteResultSchema::Put<CMD_STS>(data, (dir_fd >= 0 && deleted == count) ? CS1_SUCCESS : CS1_FAILURE);
+    BulkDeleteResultSchema::Put<BULKDELETE_FIELD_RESULT_COUNT>(data, (char)count);
+    BulkDeleteResultSchema::Put<BULKDELETE_FIELD_RESULT_FLAGS>(data, more ? BULK_MORE : 0);
+    memcpy(data + BULKDELETE_RTN_HEAD_SIZE, bitmap, BULKDELETE_BITMAP_SIZE(count));
+
+    #ifdef CS1_DEBUG
+        fprintf(stderr, "[DEBUG] %s():%d - %u/%u files deleted\n", __func__, __LINE__, 
+                                                    (unsigned int)deleted, (unsigned int)count);
+    #endif
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : DeleteList
+* 
+* PURPOSE : Deletes every inode of the list, they are resolved with the 
+*           ArchiveIndex.
+*
+* RETURNS : the number of files deleted
+*           
+*-----------------------------------------------------------------------------*/
+size_t BulkDeleteLogCommand::DeleteList(int dir_fd, char* bitmap)
+{
+    ArchiveIndex* index = ArchiveIndex::GetInstance(CS1_TGZ);
+    char filename[CS1_NAME_MAX] = {'\0'};
+    size_t deleted = 0;
+
+    for (size_t i = 0; i < this->number_of_inodes; i++) {
+        if (index && index->Lookup(this->inodes[i], filename, CS1_NAME_MAX)
+                && unlinkat(dir_fd, filename, 0) == 0) {
+            bitmap[i / 8] |= (1 << (i % 8));
+            deleted++;
+        }
+    }
+
+    return deleted;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : DeletePredicate
+* 
+* PURPOSE : Deletes every regular file of the directory matching the 
+*           predicate, at most BULKDELETE_MAX_ITEMS.
+*
+* RETURNS : the number of files that matched
+*           
+*-----------------------------------------------------------------------------*/
+size_t BulkDeleteLogCommand::DeletePredicate(int dir_fd, char* bitmap, bool* more)
+{
+    struct dirent* dir_entry = 0;
+    struct stat attr;
+    size_t count = 0;
+    DIR* dir = fdopendir(dup(dir_fd));
+
+    *more = false;
+
+    if (!dir) {
+        return 0;
+    }
+
+    while ((dir_entry = readdir(dir))) {
+        if (fstatat(dir_fd, dir_entry->d_name, &attr, AT_SYMLINK_NOFOLLOW) != 0
+                || !S_ISREG(attr.st_mode)
+                    || !this->Matches(dir_entry->d_name, &attr)) {
+            continue;
+        }
+
+        if (count == BULKDELETE_MAX_ITEMS) {
+            *more = true;
+            break;
+        }
+
+        if (unlinkat(dir_fd, dir_entry->d_name, 0) == 0) {
+            bitmap[count / 8] |= (1 << (count % 8));
+        }
+
+        count++;
+    }
+
+    closedir(dir);
+
+    return count;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Matches
+* 
+* PURPOSE : Returns true if 'filename' matches every condition of the 
+*           predicate.
+*           
+*-----------------------------------------------------------------------------*/
+bool BulkDeleteLogCommand::Matches(const char* filename, const struct stat* attr)
+{
+    if ((this->predicate & PRED_OLDER) && attr->st_mtime >= this->older_than) {
+        return false;
+    }
+
+    if ((this->predicate & PRED_LARGER) && (size_t)attr->st_size <= this->larger_than) {
+        return false;
+    }
+
+    if ((this->predicate & PRED_SUB) && 
+            ((unsigned char)this->subsystem > GROUND_COMMANDER 
+                || !GetLogCommand::prefixMatches(filename, s_cs1_subsystems[(size_t)this->subsystem]))) {
+        return false;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdSize
+* 
+*-----------------------------------------------------------------------------*/
+size_t BulkDeleteLogCommand::GetCmdSize()
+{
+    if (this->opt_byte == BULK_OPT_LIST) {
+        return BULKDELETE_LIST_CMD_SIZE(this->number_of_inodes);
+    }
+
+    return BULKDELETE_PRED_CMD_SIZE;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdStr
+* 
+* PURPOSE : Builds the command into 'cmd_buf' (at least GetCmdSize() bytes), 
+*           meant to be used by the GroundCommander. 
+*           
+*-----------------------------------------------------------------------------*/
+char* BulkDeleteLogCommand::GetCmdStr(char* cmd_buf)
+{
+    BulkDeleteListSchema::Init(cmd_buf);
+    BulkDeleteListSchema::Put<BULKDELETE_FIELD_OPT>(cmd_buf, this->opt_byte);
+
+    if (this->opt_byte == BULK_OPT_LIST) {
+        BulkDeleteListSchema::Put<BULKDELETE_FIELD_COUNT>(cmd_buf, (char)this->number_of_inodes);
+
+        for (size_t i = 0; i < this->number_of_inodes; i++) {
+            WireUInt32::Put(cmd_buf + BULKDELETE_LIST_CMD_SIZE(i), this->inodes[i]);
+        }
+    } else {
+        BulkDeletePredicateSchema::Put<BULKDELETE_FIELD_PREDICATE>(cmd_buf, this->predicate);
+        BulkDeletePredicateSchema::Put<BULKDELETE_FIELD_SUBSYSTEM>(cmd_buf, this->subsystem);
+        BulkDeletePredicateSchema::Put<BULKDELETE_FIELD_OLDER_THAN>(cmd_buf, this->older_than);
+        BulkDeletePredicateSchema::Put<BULKDELETE_FIELD_LARGER_THAN>(cmd_buf, this->larger_than);
+    }
+
+    return cmd_buf;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ParseResult 
+*
+* PURPOSE : Parses the result buffer returned by the execute function
+*
+* RETURN : struct InfoBytes* to STATIC memory, the bitmap points into 'result'
+* 
+*-----------------------------------------------------------------------------*/
+InfoBytes* BulkDeleteLogCommand::ParseResult(char *result)
+{
+    static struct InfoBytesBulkDeleteLog info_bytes;
+
+    if (!BulkDeleteResultSchema::Check(result)) {
+        Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER],
+                                        "BulkDeleteLog failure: Can't parse result");
+        info_bytes.delete_status = CS1_FAILURE;
+        info_bytes.count = 0;
+        info_bytes.more = false;
+        info_bytes.bitmap = 0;
+        return &info_bytes;
+    }
+
+    info_bytes.delete_status = BulkDeleteResultSchema::Get<CMD_STS>(result);
+    info_bytes.count = (unsigned char)BulkDeleteResultSchema::Get<BULKDELETE_FIELD_RESULT_COUNT>(result);
+    info_bytes.more = (BulkDeleteResultSchema::Get<BULKDELETE_FIELD_RESULT_FLAGS>(result) & BULK_MORE) == BULK_MORE;
+    info_bytes.bitmap = result + BULKDELETE_RTN_HEAD_SIZE;
+
+    size_t deleted = 0;
+    for (size_t i = 0; i < info_bytes.count; i++) {
+        if (info_bytes.IsDeleted(i)) {
+            deleted++;
+        }
+    }
+
+    snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, 
+                            "BulkDeleteLog %s: %u/%u files deleted%s",
+                            info_bytes.delete_status == CS1_SUCCESS ? "success" : "failure",
+                            (unsigned int)deleted, (unsigned int)info_bytes.count,
+                            info_bytes.more ? ", more files match" : "");
+
+    Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], this->log_buffer);
+
+    return &info_bytes;
+}
@@ -7,139 +7,66 @@
 #include "SpaceDecl.h"
 #include "SpaceString.h"
 
-ICommand* CommandFactory::CreateCommand(char *data) {
-    ICommand* result = 0;
-
-    if (!data) { 
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : CreateCommand
+*
+* PURPOSE : Creates the command from the buffer received from the ground, the
+*           commands register themselves in the CommandRegistry.
+*
+* RETURN : a new ICommand, 0 if the command is unknown (or too short)
+*
+*-----------------------------------------------------------------------------*/
+ICommand* CommandFactory::CreateCommand(char *data, size_t length) {
+    if (!data || length == 0) { 
         fprintf(stderr, "NULL argument passed to CreateCommand() in %s\n", __FILE__); // TODO log 
         return NULL; 
     }
 
-    switch (data[CMD_ID]) {
-        case SETTIME_CMD :
-            result = CommandFactory::CreateSetTime(data);
-            break; 
-        case GETTIME_CMD :
-            result = CommandFactory::CreateGetTime(data);
-            break;
-        case UPDATE_CMD : 
-            result = CommandFactory::CreateUpdate(data);
-            break;
-        case GETLOG_CMD : 
-            /*
-            * data[0]   :   Command number
-            * data[1]   :   Option      - specifies if options are present or not
-            * ... [2]   :   Subsystem   - see subsystems.h 
-            *   [3-6]   :   Size        - 
-            *   [7-10]  :   Date        - time_t
-            */
-            result = CommandFactory::CreateGetLog(data);
-            break;
-        case REBOOT_CMD : 
-            result = CommandFactory::CreateReboot(data);
-            break;
-        case DECODE_CMD : 
-            result = CommandFactory::CreateDecode(data);
-            break;
-        case DELETELOG_CMD : 
-            result = CommandFactory::CreateDeleteLog(data);
-            break;
-    }
-
-    return result;
+    return CommandRegistry::Create(data, length);
 }
 
-ICommand* CommandFactory::CreateDeleteLog(char* data) {
-    DeleteLogCommand* result = 0;
-    char opt_byte = data[1];
-
-    if (opt_byte == 'I') { 
-        // 'I' means that we exepect 4 bytes representing an ino_t (unsigned long)
-        unsigned int inode = SpaceString::getUInt(data + 2);
-        result = new DeleteLogCommand(inode); 
-    } else {        
-        // we expect a null terminated string (filename)
-        result = new DeleteLogCommand(&data[2]); 
+/* Same as above, the length is not known : the buffer has to be trusted */
+ICommand* CommandFactory::CreateCommand(char *data) {
+    if (!data) { 
+        fprintf(stderr, "NULL argument passed to CreateCommand() in %s\n", __FILE__); // TODO log 
+        return NULL; 
     }
 
-    return result;
-}
-
-ICommand* CommandFactory::CreateGetLog(char* data) {    // 0x33 or '3'
-    char opt_byte = data[1];
-    char subsystem = data[2];
-    size_t size = SpaceString::getUInt(data + 3);
-    time_t raw_time = SpaceString::getUInt(data + 7);
-
-    GetLogCommand* result = new GetLogCommand(opt_byte, subsystem, size, raw_time);
-
-    return result;
-}
-
-ICommand* CommandFactory::CreateUpdate(char* data) {
-    const int PATH_LENGTH = 3;
-    int offset = 1;
-
-    int pathLength = GetLength3(data, offset);
-
-    offset += PATH_LENGTH;
-    char* path = GetPath(data, pathLength, offset);
-
-    offset += pathLength;
-    int fileDataLength = GetLength3(data, offset);
-
-    offset += PATH_LENGTH;
-    char* fileData = GetPath(data, fileDataLength, offset);
-
-    UpdateCommand* result = new UpdateCommand(path, fileDataLength, fileData);
-    return result;
-}
-
-ICommand* CommandFactory::CreateSetTime(char* data) {
-    time_t timeRecieved;
-    memcpy(&timeRecieved, data + CMD_HEAD_SIZE, sizeof(time_t));
-    
-    SetTimeCommand* result = new SetTimeCommand(timeRecieved, data[SETTIME_CMD_SIZE - 1] );
+    const CommandEntry *entry = CommandRegistry::Get((unsigned char)data[CMD_ID]);
 
-    return result;
-}
-
-ICommand* CommandFactory::CreateGetTime(char* data) {
-    GetTimeCommand* result = new GetTimeCommand();
-
-    return result;
+    return entry ? entry->create(data, CMD_LENGTH_UNKNOWN, 0) : NULL;
 }
 
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : CreateCommand
+*
+* PURPOSE : Same as above but nothing is allocated, the command is built in
+*           'storage' and its paths/payloads point into 'data'. Both have to
+*           outlive the command. Destroy it with DestroyCommand, not delete.
+*
+*-----------------------------------------------------------------------------*/
+ICommand* CommandFactory::CreateCommand(char *data, size_t length, CommandStorage *storage) {
+    if (!data || length == 0 || !storage) { 
+        fprintf(stderr, "NULL argument passed to CreateCommand() in %s\n", __FILE__); // TODO log 
+        return NULL; 
+    }
 
-ICommand* CommandFactory::CreateReboot(char* data){
-    RebootCommand* result = new RebootCommand();
-
-    return result;
+    return CommandRegistry::Create(data, length, storage);
 }
 
-ICommand* CommandFactory::CreateDecode(char* data) {
-    DecodeCommand* result = 0; 
-    const int PATH_LENGTH = 3;
-    int offset = 2;
-
-    int srcLength = GetLength3(data, offset);
-
-    offset += PATH_LENGTH;
-    char* src = GetPath(data, srcLength, offset);
-
-    offset += srcLength;
-    int destLength = GetLength3(data, offset);
-
-    offset += PATH_LENGTH;
-    char* dest = GetPath(data, destLength, offset);
-
-    offset += destLength;
-    int decodedSize = GetLength10(data, offset);
-
-    int executable = data[1] - '0';
-    result = new DecodeCommand(dest, src, executable, decodedSize);
-
-    return result;
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : DestroyCommand
+*
+* PURPOSE : Destroys a command built in a CommandStorage
+*
+*-----------------------------------------------------------------------------*/
+void CommandFactory::DestroyCommand(ICommand *command) {
+    if (command) {
+        command->~ICommand();
+    }
 }
 
 int CommandFactory::GetLength3(char* data, int offset) {
@@ -158,11 +85,3 @@ int CommandFactory::GetLength10(char* data, int offset) {
 
     return result;
 }
-
-char* CommandFactory::GetPath(char* data, size_t length, int offset) {
-    char* result = (char* )malloc(sizeof(char) * length + 1);
-    memset(result, '\0', length + 1);
-    strncpy(result, data + offset, length);
-
-    return result;
-}
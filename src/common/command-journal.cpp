@@ -0,0 +1,399 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : command-journal.cpp
+*
+* DESCRIPTION : see command-journal.h
+*
+*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/command-journal.h"
+
+CommandJournal::CommandJournal(const char* journal_path)
+{
+    char directory[CS1_PATH_MAX];
+
+    snprintf(this->path, sizeof(this->path), "%s", journal_path);
+    snprintf(this->cursor_path, sizeof(this->cursor_path), "%.*s%s",
+                    (int)(sizeof(this->cursor_path) - sizeof(JOURNAL_CURSOR_EXT)), journal_path, JOURNAL_CURSOR_EXT);
+
+    this->fd = -1;
+    this->generation = 0;
+    this->header_size = 0;
+    this->offset = 0;
+    this->committed = 0;
+    this->start = 0;
+    this->end = 0;
+    this->skipping = false;
+
+    // watched from now on, a command appended before the first Wait wakes it
+    snprintf(directory, sizeof(directory), "%s", journal_path);
+    this->watch_fd = inotify_init();
+
+    if (this->watch_fd >= 0 && inotify_add_watch(this->watch_fd, dirname(directory),
+                                                    IN_MODIFY | IN_CREATE | IN_MOVED_TO) < 0) {
+        close(this->watch_fd);
+        this->watch_fd = -1;
+    }
+}
+
+CommandJournal::~CommandJournal()
+{
+    this->CloseFile();
+
+    if (this->watch_fd >= 0) {
+        close(this->watch_fd);
+        this->watch_fd = -1;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : OpenFile
+*
+* PURPOSE : Opens the journal, reads its generation and the saved cursor
+*
+*-----------------------------------------------------------------------------*/
+bool CommandJournal::OpenFile()
+{
+    char head[64];
+    struct stat stat_buf;
+    unsigned int saved_generation = 0;
+    long long saved_offset = -1;
+
+    this->fd = open(this->path, O_RDONLY);
+
+    if (this->fd < 0 || fstat(this->fd, &stat_buf) != 0) {
+        this->CloseFile();
+        return false;
+    }
+
+    this->generation = 0;
+    this->header_size = 0;
+
+    ssize_t bytes = pread(this->fd, head, sizeof(head) - 1, 0);
+
+    if (bytes > 0) {
+        head[bytes] = '\0';
+        char* newline = strchr(head, '\n');
+
+        if (strncmp(head, JOURNAL_HEADER, strlen(JOURNAL_HEADER)) == 0 && newline) {
+            this->generation = (unsigned int)strtoul(head + strlen(JOURNAL_HEADER), 0, 10);
+            this->header_size = newline - head + 1;
+        }
+    }
+
+    FILE* cursor = fopen(this->cursor_path, "r");
+
+    if (cursor) {
+        if (fscanf(cursor, "%u %lld", &saved_generation, &saved_offset) != 2) {
+            saved_offset = -1;
+        }
+        fclose(cursor);
+    }
+
+    if (saved_generation == this->generation && saved_offset >= this->header_size
+                                             && saved_offset <= (long long)stat_buf.st_size) {
+        this->offset = (off_t)saved_offset;
+    } else {
+        this->offset = this->header_size;       // a new file, the commands consumed are gone
+    }
+
+    this->committed = this->offset;
+    this->start = 0;
+    this->end = 0;
+    this->skipping = false;
+
+    return true;
+}
+
+void CommandJournal::CloseFile()
+{
+    if (this->fd >= 0) {
+        close(this->fd);
+        this->fd = -1;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Next
+*
+* PURPOSE : Reads the next command, without its '\n'
+*
+* RETURN : false if there is none (yet)
+*
+*-----------------------------------------------------------------------------*/
+bool CommandJournal::Next(std::string* command)
+{
+    if (this->fd < 0 && !this->OpenFile()) {
+        return false;
+    }
+
+    for (;;) {
+        char* line = this->buffer + this->start;
+        char* newline = (char*)memchr(line, '\n', this->end - this->start);
+
+        if (newline) {
+            size_t length = newline - line;
+            bool skip = this->skipping || length == 0 || line[0] == '#';
+
+            this->start += length + 1;
+            this->offset += length + 1;
+            this->skipping = false;
+
+            if (!skip) {
+                command->assign(line, length);
+                return true;
+            }
+            continue;
+        }
+
+        if (this->start > 0) {
+            memmove(this->buffer, this->buffer + this->start, this->end - this->start);
+            this->end -= this->start;
+            this->start = 0;
+        }
+
+        if (this->end == sizeof(this->buffer)) {
+            this->offset += this->end;              // too long for a command, dropped up to its '\n'
+            this->end = 0;
+            this->skipping = true;
+        }
+
+        ssize_t bytes = pread(this->fd, this->buffer + this->end, sizeof(this->buffer) - this->end,
+                                                                            this->offset + this->end);
+        if (bytes > 0) {
+            this->end += bytes;
+            continue;
+        }
+
+        // the end, reopened with the next call if the file was replaced
+        struct stat opened, current;
+
+        if (fstat(this->fd, &opened) != 0 || stat(this->path, &current) != 0 || opened.st_ino != current.st_ino) {
+            this->CloseFile();
+        }
+
+        return false;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : SaveCursor
+*
+* PURPOSE : Writes the cursor 'offset' aside then renames it, the saved
+*           cursor is the old one or the new one, never half of each
+*
+*-----------------------------------------------------------------------------*/
+bool CommandJournal::SaveCursor(off_t offset)
+{
+    char temp_path[CS1_PATH_MAX + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", this->cursor_path);
+
+    FILE* cursor = fopen(temp_path, "w");
+
+    if (!cursor) {
+        return false;
+    }
+
+    bool ok = fprintf(cursor, "%u %lld\n", this->generation, (long long)offset) > 0
+                && fflush(cursor) == 0 && fsync(fileno(cursor)) == 0;
+    ok = (fclose(cursor) == 0) && ok;
+
+    if (!ok || rename(temp_path, this->cursor_path) != 0) {
+        unlink(temp_path);
+        return false;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Commit
+*
+* PURPOSE : The commands returned by Next are consumed, compacts the journal
+*           if they are all. With 'offset' (a GetOffset after a Next), only
+*           the commands before it are : the ones after are returned again
+*           after a restart.
+*
+* RETURN : false if the cursor is not saved, or 'offset' was not returned yet
+*
+*-----------------------------------------------------------------------------*/
+bool CommandJournal::Commit()
+{
+    return this->Commit(this->offset);
+}
+
+bool CommandJournal::Commit(off_t offset)
+{
+    struct stat stat_buf;
+
+    if (offset > this->offset) {
+        return false;
+    }
+
+    if (offset > this->committed) {
+        if (!this->SaveCursor(offset)) {
+            return false;
+        }
+        this->committed = offset;
+    }
+
+    if (offset == this->offset && this->fd >= 0 && this->offset >= JOURNAL_COMPACT_SIZE && fstat(this->fd, &stat_buf) == 0 && stat_buf.st_size == this->offset) {
+        this->Compact();
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Compact
+*
+* PURPOSE : Replaces the journal, all consumed, by an empty one of the next
+*           generation. Append holds the same lock and checks that the file
+*           it opened is still the journal, nothing is appended to the old
+*           one once it is replaced.
+*
+*-----------------------------------------------------------------------------*/
+bool CommandJournal::Compact()
+{
+    char new_path[CS1_PATH_MAX + 8];
+    char header[32];
+    struct stat stat_buf;
+
+    if (flock(this->fd, LOCK_EX) != 0) {
+        return false;
+    }
+
+    if (fstat(this->fd, &stat_buf) != 0 || stat_buf.st_size != this->offset) {
+        flock(this->fd, LOCK_UN);               // a command came in
+        return false;
+    }
+
+    snprintf(new_path, sizeof(new_path), "%s.new", this->path);
+    int size = snprintf(header, sizeof(header), "%s%u\n", JOURNAL_HEADER, this->generation + 1);
+    int new_fd = open(new_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    bool ok = (new_fd >= 0) && write(new_fd, header, size) == size && fsync(new_fd) == 0;
+
+    if (new_fd >= 0) {
+        close(new_fd);
+    }
+
+    if (!ok || rename(new_path, this->path) != 0) {
+        unlink(new_path);
+        flock(this->fd, LOCK_UN);
+        return false;
+    }
+
+    this->CloseFile();                          // and its lock
+
+    // the saved cursor is of the old generation : the first command of the new file
+    if (!this->OpenFile()) {
+        return false;
+    }
+
+    return this->SaveCursor(this->offset);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Wait
+*
+* PURPOSE : Sleeps until something changes in the directory of the journal, or
+*           'timeout_ms'
+*
+* RETURN : true if it changed
+*
+*-----------------------------------------------------------------------------*/
+bool CommandJournal::Wait(int timeout_ms)
+{
+    char events[1024];
+
+    if (this->watch_fd < 0) {
+        usleep(timeout_ms * 1000);
+        return false;
+    }
+
+    struct pollfd watch = { this->watch_fd, POLLIN, 0 };
+
+    if (poll(&watch, 1, timeout_ms) <= 0) {
+        return false;
+    }
+
+    while (read(this->watch_fd, events, sizeof(events)) < 0 && errno == EINTR) {
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Append
+*
+* PURPOSE : Appends 'command' to the journal at 'path', created if needed
+*
+* RETURN : false if it is not appended, or is not a single line
+*
+*-----------------------------------------------------------------------------*/
+bool CommandJournal::Append(const char* path, const char* command)
+{
+    size_t length = strlen(command);
+
+    if (length == 0 || length >= JOURNAL_READ_SIZE || memchr(command, '\n', length)) {
+        return false;
+    }
+
+    std::string line(command, length);
+    line += '\n';
+
+    for (int attempt = 0; attempt < 8; attempt++) {
+        struct stat opened, current;
+        int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+
+        if (fd < 0) {
+            return false;
+        }
+
+        if (flock(fd, LOCK_EX) != 0) {
+            close(fd);
+            return false;
+        }
+
+        if (fstat(fd, &opened) != 0 || stat(path, &current) != 0 || opened.st_ino != current.st_ino) {
+            close(fd);                          // compacted since it was opened
+            continue;
+        }
+
+        bool ok = true;
+
+        if (opened.st_size == 0) {
+            char header[32];
+            int size = snprintf(header, sizeof(header), "%s0\n", JOURNAL_HEADER);
+            ok = write(fd, header, size) == size;
+        }
+
+        ok = ok && write(fd, line.data(), line.size()) == (ssize_t)line.size();
+        close(fd);
+
+        return ok;
+    }
+
+    return false;
+}
@@ -0,0 +1,359 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : command-pipeline.cpp
+*
+* DESCRIPTION : see command-pipeline.h
+*
+*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common/command-factory.h"
+#include "common/command-pipeline.h"
+#include "common/commands.h"
+#include "common/crc32.h"
+#include "common/event-log.h"
+#include "common/session-arena.h"
+#include "common/subsystems.h"
+#include "common/wire.h"
+#include "shakespeare.h"
+#include "SpaceDecl.h"
+
+struct PipelineCacheEntry {
+    bool used;
+    unsigned short cid;
+    unsigned char version;
+    unsigned int crc;           // of the command, a cid used again after a restart of the ground
+    size_t size;
+    char reply[PIPELINE_CACHE_MAX_REPLY];
+};
+
+static PipelineCacheEntry cache[PIPELINE_CACHE_SIZE];
+static size_t cache_next = 0;
+
+static void put_cid(char* buffer, unsigned short cid)
+{
+    buffer[PIPELINE_CID] = (char)(cid & 0xFF);
+    buffer[PIPELINE_CID + 1] = (char)(cid >> 8);
+}
+
+static unsigned short get_cid(const char* buffer)
+{
+    return (unsigned short)((unsigned char)buffer[PIPELINE_CID] | ((unsigned char)buffer[PIPELINE_CID + 1] << 8));
+}
+
+CommandPipeline::CommandPipeline(PipelineSendFunction send, PipelineReplyFunction reply, void* context,
+                                                                    size_t window, int timeout_ms)
+{
+    this->send = send;
+    this->reply = reply;
+    this->context = context;
+    this->window = (window == 0) ? 1 : (window > PIPELINE_MAX_WINDOW ? PIPELINE_MAX_WINDOW : window);
+    this->timeout_ms = timeout_ms;
+    this->next_cid = (unsigned short)time(0);      // not the cids of the replies cached before a restart
+    this->number_in_flight = 0;
+
+    for (size_t i = 0; i < PIPELINE_MAX_WINDOW; i++) {
+        this->in_flight[i].used = false;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Now
+*
+* PURPOSE : Monotonic time in ms, the clock of Pump
+*
+*-----------------------------------------------------------------------------*/
+long long CommandPipeline::Now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Submit
+*
+* PURPOSE : Queues the command 'cmd', the buffer built by its GetCmdStr or
+*           Build_* function (copied) in the current wire version. 'tag' is
+*           handed back with its reply.
+*
+* RETURN : false if 'cmd' is empty or not a registered command
+*
+*-----------------------------------------------------------------------------*/
+bool CommandPipeline::Submit(const char* cmd, size_t size, long tag)
+{
+    if (!cmd || size == 0 || !CommandRegistry::Get((unsigned char)cmd[CMD_ID])) {
+        return false;
+    }
+
+    PipelineEntry entry;
+    char head[PIPELINE_HEAD_SIZE];
+
+    head[CMD_ID] = PIPELINE_FRAME;
+    head[PIPELINE_VERSION] = (char)Wire::GetVersion();
+    put_cid(head, this->next_cid);
+
+    entry.used = true;
+    entry.id = (unsigned char)cmd[CMD_ID];
+    entry.tag = tag;
+    entry.cid = this->next_cid++;
+    entry.frame.reserve(PIPELINE_HEAD_SIZE + size);
+    entry.frame.assign(head, PIPELINE_HEAD_SIZE);
+    entry.frame.append(cmd, size);
+    entry.sent_ms = 0;
+    entry.retries = 0;
+
+    this->queue.push_back(entry);
+    this->Pump();
+
+    return true;
+}
+
+void CommandPipeline::Send(PipelineEntry& entry, long long now_ms)
+{
+    entry.sent_ms = now_ms;         // not sent : sent again after the timeout
+    this->send(entry.frame.data(), entry.frame.size(), this->context);
+}
+
+void CommandPipeline::Done(PipelineEntry& entry, InfoBytes* info)
+{
+    entry.used = false;
+    entry.frame.clear();
+    this->number_in_flight--;
+
+    this->reply(entry.id, info, entry.tag, this->context);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : OnReply
+*
+* PURPOSE : Matches a reply to the command in flight with the same cid, then
+*           sends the next frames
+*
+* RETURN : false if it is not a reply, or of no command in flight (a reply
+*          to a frame sent twice, it was already handed over)
+*
+* NOTE : a reply of another version than the frame is the satellite refusing
+*        it : the command is given up, the ground switches to the version of
+*        the satellite
+*
+*-----------------------------------------------------------------------------*/
+bool CommandPipeline::OnReply(char* reply, size_t size)
+{
+    if (!reply || size < PIPELINE_HEAD_SIZE || reply[CMD_ID] != (char)PIPELINE_FRAME) {
+        return false;
+    }
+
+    unsigned short cid = get_cid(reply);
+
+    for (size_t i = 0; i < PIPELINE_MAX_WINDOW; i++) {
+        PipelineEntry& entry = this->in_flight[i];
+
+        if (entry.used && entry.cid == cid) {
+            const CommandEntry* parser = CommandRegistry::Get(entry.id);
+            InfoBytes* info = 0;
+
+            if (reply[PIPELINE_VERSION] != entry.frame[PIPELINE_VERSION]) {
+                char log_buffer[CS1_MAX_LOG_ENTRY];
+
+                snprintf(log_buffer, sizeof(log_buffer), "Command 0x%02X built in wire version %d, the satellite is in %d : given up",
+                                        entry.id, (unsigned char)entry.frame[PIPELINE_VERSION], (unsigned char)reply[PIPELINE_VERSION]);
+                Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buffer);
+
+                Wire::SetVersion((unsigned char)reply[PIPELINE_VERSION]);
+            } else if (size > PIPELINE_HEAD_SIZE && parser) {
+                info = parser->parse(reply + PIPELINE_HEAD_SIZE);
+            }
+
+            this->Done(entry, info);
+            this->Pump();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Pump
+*
+* PURPOSE : Sends again the frames without a reply after the timeout, gives
+*           up on the ones sent PIPELINE_MAX_RETRIES times, then fills the
+*           window from the queue
+*
+*-----------------------------------------------------------------------------*/
+void CommandPipeline::Pump()
+{
+    this->Pump(CommandPipeline::Now());
+}
+
+void CommandPipeline::Pump(long long now_ms)
+{
+    for (size_t i = 0; i < PIPELINE_MAX_WINDOW; i++) {
+        PipelineEntry& entry = this->in_flight[i];
+
+        if (!entry.used || now_ms - entry.sent_ms < this->timeout_ms) {
+            continue;
+        }
+
+        if (entry.retries >= PIPELINE_MAX_RETRIES) {
+            this->Done(entry, 0);
+        } else {
+            entry.retries++;
+            this->Send(entry, now_ms);
+        }
+    }
+
+    for (size_t i = 0; i < PIPELINE_MAX_WINDOW && this->number_in_flight < this->window && !this->queue.empty(); i++) {
+        PipelineEntry& entry = this->in_flight[i];
+
+        if (entry.used) {
+            continue;
+        }
+
+        entry = this->queue.front();
+        this->queue.pop_front();
+        this->number_in_flight++;
+
+        this->Send(entry, now_ms);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+*
+* PURPOSE : Executes the command of 'frame' (built in 'storage') and builds
+*           its reply, or replays the cached reply if the frame was already
+*           executed. The command is recorded in the EventLog when it is
+*           executed.
+*
+* RETURN : false if 'frame' is not a frame, 'reply' is left empty. A frame
+*          of another wire version is not executed, its reply is the header
+*          alone with the version in use.
+*
+*-----------------------------------------------------------------------------*/
+bool PipelineServer::Execute(char* frame, size_t size, CommandStorage* storage, ResultBuffer& reply)
+{
+    reply.Clear();
+
+    if (!frame || size < PIPELINE_HEAD_SIZE || frame[CMD_ID] != (char)PIPELINE_FRAME) {
+        return false;
+    }
+
+    unsigned short cid = get_cid(frame);
+    unsigned char version = (unsigned char)frame[PIPELINE_VERSION];
+    char* data = frame + PIPELINE_HEAD_SIZE;
+    size_t length = size - PIPELINE_HEAD_SIZE;
+    unsigned int crc = Crc32(data, length);
+
+    // before the version : the reply to a VersionCommand sent again
+    for (size_t i = 0; i < PIPELINE_CACHE_SIZE; i++) {
+        if (cache[i].used && cache[i].cid == cid && cache[i].version == version && cache[i].crc == crc) {
+            return reply.Append(cache[i].reply, cache[i].size, false);
+        }
+    }
+
+    ICommand* command = 0;
+
+    if (version != Wire::GetVersion()) {
+        char log_buffer[CS1_MAX_LOG_ENTRY];
+
+        snprintf(log_buffer, sizeof(log_buffer), "Frame in wire version %d refused, in version %d", version, Wire::GetVersion());
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buffer);
+
+        version = Wire::GetVersion();
+    } else if (length > 0) {
+        command = CommandFactory::CreateCommand(data, length, storage);
+    }
+
+    if (command) {
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        command->Execute(reply);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        EventLog::Command((unsigned char)data[CMD_ID], reply,
+                                (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
+
+        CommandFactory::DestroyCommand(command);
+    }
+
+    char* head = (char*)SessionArena::AllocCurrent(PIPELINE_HEAD_SIZE);
+
+    if (!head) {
+        reply.Clear();
+        return false;
+    }
+
+    head[CMD_ID] = PIPELINE_FRAME;
+    head[PIPELINE_VERSION] = (char)version;     // the one it was executed in, a VersionCommand changes it
+    put_cid(head, cid);
+
+    if (!reply.Prepend(head, PIPELINE_HEAD_SIZE, true)) {
+        // RESULT_MAX_SEGMENTS : the result is copied behind the header
+        size_t result_size = reply.GetSize();
+        char* result = reply.GetData();
+        char* flat = result ? (char*)SessionArena::AllocCurrent(PIPELINE_HEAD_SIZE + result_size) : 0;
+
+        if (flat) {
+            memcpy(flat, head, PIPELINE_HEAD_SIZE);
+            memcpy(flat + PIPELINE_HEAD_SIZE, result, result_size);
+        }
+
+        SessionArena::FreeCurrent(head);
+        reply.Clear();
+
+        if (!flat) {
+            return false;
+        }
+
+        reply.Append(flat, PIPELINE_HEAD_SIZE + result_size, true);
+    }
+
+    if (reply.GetSize() <= PIPELINE_CACHE_MAX_REPLY && version == (unsigned char)frame[PIPELINE_VERSION]) {
+        char* bytes = reply.GetData();
+        PipelineCacheEntry& entry = cache[cache_next];
+
+        if (bytes) {
+            entry.used = true;
+            entry.cid = cid;
+            entry.version = version;
+            entry.crc = crc;
+            entry.size = reply.GetSize();
+            memcpy(entry.reply, bytes, entry.size);
+
+            cache_next = (cache_next + 1) % PIPELINE_CACHE_SIZE;
+        }
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Reset
+*
+* PURPOSE : Forgets the cached replies
+*
+*-----------------------------------------------------------------------------*/
+void PipelineServer::Reset()
+{
+    for (size_t i = 0; i < PIPELINE_CACHE_SIZE; i++) {
+        cache[i].used = false;
+    }
+
+    cache_next = 0;
+}
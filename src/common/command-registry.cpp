@@ -0,0 +1,104 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : command-registry.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <stdio.h>
+
+#include "shakespeare.h"
+#include "SpaceDecl.h"
+#include "common/command-registry.h"
+#include "common/wire.h"
+
+CommandEntry CommandRegistry::table[CMD_REGISTRY_SIZE];   // zero initialized, before the registrars run
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Register
+*
+* PURPOSE : Fills the slot 'id', called by the CommandRegistrar
+*
+* RETURN : false if the slot is already taken (two commands with the same id)
+*
+*-----------------------------------------------------------------------------*/
+bool CommandRegistry::Register(unsigned char id, CommandCreateFn create, CommandParseFn parse, 
+                                        size_t min_length, size_t min_length_v2)
+{
+    if (table[id].create) {
+        fprintf(stderr, "[ERROR] %s() - command 0x%02X is already registered\n", __func__, id);
+        return false;
+    }
+
+    table[id].id = id;
+    table[id].create = create;
+    table[id].parse = parse;
+    table[id].min_length = min_length;
+    table[id].min_length_v2 = min_length_v2;
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Creates the command from the buffer received from the ground, in
+*           'storage' if not 0 (see CommandStorage). 'data' has to outlive
+*           the command.
+*
+* RETURN : the ICommand, 0 if the command is unknown, too short, or if its
+*          fields run past 'length'
+*
+*-----------------------------------------------------------------------------*/
+ICommand* CommandRegistry::Create(const char *data, size_t length, void *storage)
+{
+    char log_buffer[CS1_MAX_LOG_ENTRY] = {0};
+    const CommandEntry *entry = CommandRegistry::Get((unsigned char)data[CMD_ID]);
+
+    if (!entry) {
+        snprintf(log_buffer, CS1_MAX_LOG_ENTRY, "Unknown command 0x%02X", (unsigned char)data[CMD_ID]);
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buffer);
+        return 0;
+    }
+
+    size_t min_length = (Wire::GetVersion() >= WIRE_V2) ? entry->min_length_v2 : entry->min_length;
+
+    if (length < min_length) {
+        snprintf(log_buffer, CS1_MAX_LOG_ENTRY, "Command 0x%02X is too short : %u bytes, %u expected", 
+                                    entry->id, (unsigned int)length, (unsigned int)min_length);
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buffer);
+        return 0;
+    }
+
+    ICommand *command = entry->create((char*)data, length, storage);
+
+    if (!command) {
+        snprintf(log_buffer, CS1_MAX_LOG_ENTRY, "Command 0x%02X is malformed : %u bytes", 
+                                    entry->id, (unsigned int)length);
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buffer);
+    }
+
+    return command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Parse
+*
+* PURPOSE : Parses the result buffer received from the satellite
+*
+* RETURN : InfoBytes* to STATIC memory, 0 if the command is unknown
+*
+*-----------------------------------------------------------------------------*/
+InfoBytes* CommandRegistry::Parse(char *result)
+{
+    const CommandEntry *entry = CommandRegistry::Get((unsigned char)result[CMD_ID]);
+
+    if (!entry) {
+        return 0;
+    }
+
+    return entry->parse(result);
+}
@@ -0,0 +1,91 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : crc32.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <unistd.h>
+
+#include "common/crc32.h"
+
+#define CRC32_POLYNOMIAL 0xEDB88320
+#define CRC32_READ_SIZE 4096
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetTable
+*
+* PURPOSE : Returns the byte-wise lookup table, built on the first call.
+*
+*-----------------------------------------------------------------------------*/
+static const unsigned int* GetTable()
+{
+    static unsigned int table[256];
+    static bool initialized = false;
+
+    if (!initialized) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int c = i;
+
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (CRC32_POLYNOMIAL ^ (c >> 1)) : (c >> 1);
+            }
+
+            table[i] = c;
+        }
+
+        initialized = true;
+    }
+
+    return table;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Crc32
+*
+* ARGUMENTS : data  - buffer
+*             size  - number of bytes of 'data'
+*             crc   - result of the previous call when the data is split
+*                     over several buffers, 0 otherwise
+*
+*-----------------------------------------------------------------------------*/
+unsigned int Crc32(const void *data, size_t size, unsigned int crc)
+{
+    const unsigned int *table = GetTable();
+    const unsigned char *bytes = (const unsigned char*)data;
+
+    crc = ~crc;
+
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Crc32_File
+*
+* PURPOSE : Computes the CRC of the file open on 'fd', from its start.
+*
+* RETURN : false if the file could not be read
+*
+*-----------------------------------------------------------------------------*/
+bool Crc32_File(int fd, unsigned int *crc)
+{
+    char buffer[CRC32_READ_SIZE];
+    off_t offset = 0;
+    ssize_t bytes = 0;
+
+    *crc = 0;
+
+    while ((bytes = pread(fd, buffer, CRC32_READ_SIZE, offset)) > 0) {
+        *crc = Crc32(buffer, bytes, *crc);
+        offset += bytes;
+    }
+
+    return bytes == 0;
+}
@@ -1,98 +1,508 @@
 #include <stdio.h>
 #include "space-commander/base64.h"
 #include <cstring>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include "common/decode-command.h"
 #include "shakespeare.h"
 #include "SpaceDecl.h"
 #include "SpaceString.h"
 #include "common/commands.h"
 #include "common/subsystems.h"
+#include "common/command-registry.h"
+#include "common/command-factory.h"
+#include "common/wire.h"
+#include "common/gunzip.h"
+#include "common/tar-extract.h"
 
+static CommandRegistrar<DecodeCommand> registrar(DECODE_CMD, DECODE_CMD_MIN_SIZE,
+                                                                    DECODE_CMD_MIN_SIZE_V2);
 
-void* DecodeCommand::Execute() {
-    FILE* fpDestFile = NULL;
-    FILE* fpSrcFile = NULL;
-    char* result = NULL;
-    int retry    = 10000;
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground, in
+*           the wire format of the session (see decode-command.h)
+*
+*-----------------------------------------------------------------------------*/
+ICommand* DecodeCommand::Create(char* data, size_t length, void* storage) {
+    DecodeCommand* result = 0; 
+    const int PATH_LENGTH = 3;
+    const int SIZE_LENGTH = 10;
+    size_t offset = 2;
+    unsigned int srcLength = 0;
+    unsigned int destLength = 0;
+    unsigned int decodedSize = 0;
 
-    while(retry > 0 && fpSrcFile == NULL){
-        fpSrcFile = fopen(this->GetSrcPath(), "rb");
-        retry =- 1;
+    if (Wire::GetVersion() >= WIRE_V2) {
+        size_t read = Wire::GetVarint(data + offset, length - offset, &srcLength);
+
+        offset += read;
+        if (read == 0 || !Wire::Fits(offset, srcLength, length)) {
+            return 0;
+        }
+
+        WireView src(data + offset, srcLength);
+
+        offset += srcLength;
+        read = Wire::GetVarint(data + offset, length - offset, &destLength);
+
+        offset += read;
+        if (read == 0 || !Wire::Fits(offset, destLength, length)) {
+            return 0;
+        }
+
+        WireView dest(data + offset, destLength);
+
+        offset += destLength;
+        if (Wire::GetVarint(data + offset, length - offset, &decodedSize) == 0) {
+            return 0;
+        }
+
+        int mode = (data[1] == DECODE_MODE_UNPACK) ? DECODE_MODE_UNPACK : (int)(data[1] != 0);
+        return ConstructCommand<DecodeCommand>(storage, dest, src, mode, (int)decodedSize);
+    }
+
+    srcLength = CommandFactory::GetLength3(data, offset);
+
+    offset += PATH_LENGTH;
+    if (!Wire::Fits(offset, srcLength + PATH_LENGTH, length)) {
+        return 0;
+    }
+
+    WireView src(data + offset, srcLength);
+
+    offset += srcLength;
+    destLength = CommandFactory::GetLength3(data, offset);
+
+    offset += PATH_LENGTH;
+    if (!Wire::Fits(offset, destLength + SIZE_LENGTH, length)) {
+        return 0;
     }
 
-    printf("  GetSrcPath:   %s\n", this->GetSrcPath());
-    printf("  GetDestPath:  %s\n", this->GetDestPath());
-    printf("  IsExecutable: %d\n", this->IsExecutable());
-    fflush(stdout);
+    WireView dest(data + offset, destLength);
+
+    offset += destLength;
+    decodedSize = CommandFactory::GetLength10(data, offset);
+
+    int executable = data[1] - '0';
+    result = ConstructCommand<DecodeCommand>(storage, dest, src, executable, (int)decodedSize);
 
-    if(fpSrcFile != NULL) {
-        fseek(fpSrcFile, 0L, SEEK_END);
-        long s = ftell(fpSrcFile);
-        rewind(fpSrcFile);
+    return result;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdSize
+*
+* RETURN : the size of the command in the wire format of the session, 0 if
+*          it can not be encoded (WIRE_V1 and a path > DECODE_V1_MAX_LENGTH)
+*
+*-----------------------------------------------------------------------------*/
+size_t DecodeCommand::GetCmdSize(size_t src_length, size_t dest_length, unsigned int size)
+{
+    if (Wire::GetVersion() >= WIRE_V2) {
+        return CMD_HEAD_SIZE + 1 + Wire::VarintSize(src_length) + src_length
+                                 + Wire::VarintSize(dest_length) + dest_length
+                                 + Wire::VarintSize(size);
+    }
 
-        char* buffer = (char* )malloc(sizeof(char) * s);
-        if (buffer != NULL) {
-            fread(buffer, s, 1, fpSrcFile);
-            fclose(fpSrcFile);
-            fpSrcFile = NULL;
+    if (src_length > DECODE_V1_MAX_LENGTH || dest_length > DECODE_V1_MAX_LENGTH) {
+        return 0;
+    }
+
+    return CMD_HEAD_SIZE + 1 + 3 + src_length + 3 + dest_length + 10;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Build_DecodeCommand
+*
+* PURPOSE : Builds a DecodeCommand into 'cmd_buf' (at least GetCmdSize bytes)
+*
+* RETURN : the number of bytes written, 0 if the command can not be encoded
+*
+*-----------------------------------------------------------------------------*/
+size_t DecodeCommand::Build_DecodeCommand(char* cmd_buf, WireView src, WireView dest, 
+                                                            int executable, unsigned int size)
+{
+    char digits[11] = {'\0'};
+    size_t cmd_size = DecodeCommand::GetCmdSize(src.length, dest.length, size);
+    size_t offset = CMD_HEAD_SIZE + 1;
+    bool v2 = (Wire::GetVersion() >= WIRE_V2);
+    int mode = (executable == DECODE_MODE_UNPACK) ? DECODE_MODE_UNPACK : (executable != 0);
+
+    if (cmd_size == 0) {
+        return 0;
+    }
+
+    cmd_buf[CMD_ID] = DECODE_CMD;
+    cmd_buf[1] = v2 ? (char)mode : (char)('0' + mode);
+
+    if (v2) {
+        offset += Wire::PutVarint(cmd_buf + offset, src.length);
+    } else {
+        snprintf(digits, sizeof(digits), "%03u", (unsigned int)src.length);
+        memcpy(cmd_buf + offset, digits, 3);
+        offset += 3;
+    }
+
+    memcpy(cmd_buf + offset, src.data, src.length);
+    offset += src.length;
+
+    if (v2) {
+        offset += Wire::PutVarint(cmd_buf + offset, dest.length);
+    } else {
+        snprintf(digits, sizeof(digits), "%03u", (unsigned int)dest.length);
+        memcpy(cmd_buf + offset, digits, 3);
+        offset += 3;
+    }
+
+    memcpy(cmd_buf + offset, dest.data, dest.length);
+    offset += dest.length;
+
+    if (v2) {
+        Wire::PutVarint(cmd_buf + offset, size);
+    } else {
+        snprintf(digits, sizeof(digits), "%010u", size);
+        memcpy(cmd_buf + offset, digits, 10);
+    }
+
+    return cmd_size;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdStr / GetCmdSize
+*
+* PURPOSE : Same as above, with the members of the command
+*
+*-----------------------------------------------------------------------------*/
+char* DecodeCommand::GetCmdStr(char* cmd_buf)
+{
+    if (DecodeCommand::Build_DecodeCommand(cmd_buf, this->srcPath, this->destPath, 
+                                           this->isExecutable, this->totalSize) == 0) {
+        return 0;
+    }
+
+    return cmd_buf;
+}
+
+size_t DecodeCommand::GetCmdSize()
+{
+    return DecodeCommand::GetCmdSize(this->srcPath.length, this->destPath.length, this->totalSize);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : WriteAll
+*
+* PURPOSE : write(2) until 'size' bytes are written
+*
+*-----------------------------------------------------------------------------*/
+static bool WriteAll(int fd, const unsigned char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
         }
 
-        retry = 10000;
-        while(retry > 0 && fpDestFile == NULL){
-            fpDestFile = fopen(this->GetDestPath(), "wb");
-            retry =- 1;
+        data += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : DecodeFile
+*
+* PURPOSE : Decodes 'src_fd' into 'dest_fd', DECODE_CHUNK_SIZE characters at a
+*           time, and logs the progress every DECODE_PROGRESS_STEP bytes
+*
+* RETURN : the number of bytes written, -1 on failure
+*
+*-----------------------------------------------------------------------------*/
+ssize_t DecodeCommand::DecodeFile(int src_fd, int dest_fd, const char* destPath)
+{
+    char in[DECODE_CHUNK_SIZE];
+    unsigned char out[BASE64_STREAM_MAX_SIZE(DECODE_CHUNK_SIZE)];
+    char log_buf[CS1_MAX_LOG_ENTRY] = {'\0'};
+    Base64Stream stream;
+    size_t bytes_written = 0;
+    size_t next_progress = DECODE_PROGRESS_STEP;
+    size_t decoded = 0;
+    ssize_t n = 0;
+
+    base64_stream_init(&stream);
+
+    while (!stream.done && (n = read(src_fd, in, DECODE_CHUNK_SIZE)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
         }
 
+        decoded = base64_stream_decode(&stream, in, n, out);
 
-        std::string std_buffer = buffer;
-        string decoded_data = base64_decode(std_buffer);
+        if (!WriteAll(dest_fd, out, decoded)) {
+            return -1;
+        }
+
+        bytes_written += decoded;
+
+        if (bytes_written >= next_progress) {
+            snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode: %lu/%d bytes written to %s",
+                                            (unsigned long)bytes_written, this->totalSize, destPath);
+            Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], log_buf);
+            next_progress = bytes_written - bytes_written % DECODE_PROGRESS_STEP + DECODE_PROGRESS_STEP;
+        }
+    }
+
+    decoded = base64_stream_finish(&stream, out);
+
+    if (!WriteAll(dest_fd, out, decoded)) {
+        return -1;
+    }
+
+    return bytes_written + decoded;
+}
+
+/*
+ * DECODE_MODE_UNPACK : base64 -> gunzip -> tar, a chunk at a time
+ */
+struct DecodeUnpack
+{
+    int src_fd;
+    Base64Stream stream;
+    bool finished;
+    size_t decoded;                 // size of the tgz
+    char in[DECODE_CHUNK_SIZE];
+    unsigned char out[BASE64_STREAM_MAX_SIZE(DECODE_CHUNK_SIZE)];
+    Gunzip gunzip;
+    TarExtract tar;
+};
+
+static ssize_t ReadDecoded(void* context, const unsigned char** data)
+{
+    DecodeUnpack* unpack = (DecodeUnpack*)context;
+    size_t decoded = 0;
+
+    while (!unpack->finished) {
+        ssize_t n = unpack->stream.done ? 0 : read(unpack->src_fd, unpack->in, DECODE_CHUNK_SIZE);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        if (n == 0) {
+            decoded = base64_stream_finish(&unpack->stream, unpack->out);
+            unpack->finished = true;
+        } else {
+            decoded = base64_stream_decode(&unpack->stream, unpack->in, n, unpack->out);
+        }
+
+        if (decoded > 0) {
+            unpack->decoded += decoded;
+            *data = unpack->out;
+            return decoded;
+        }
+    }
+
+    return 0;
+}
+
+static bool WriteTar(void* context, const unsigned char* data, size_t size)
+{
+    return TarExtract_Write(&((DecodeUnpack*)context)->tar, data, size);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : UnpackFile
+*
+* PURPOSE : Extracts the base64 tgz 'src_fd' into the directory destPath,
+*           the tgz and the tar are never written. 'manifest' lists the files
+*           extracted, even on failure.
+*
+* RETURN : the number of bytes extracted, -1 on failure
+*
+*-----------------------------------------------------------------------------*/
+ssize_t DecodeCommand::UnpackFile(int src_fd, const char* destPath, string* manifest)
+{
+    char log_buf[CS1_MAX_LOG_ENTRY] = {'\0'};
+    DecodeUnpack* unpack = new DecodeUnpack;    // ~50 KB, the gunzip window
+    ssize_t bytes_extracted = -1;
 
-        retry = 10000;
-        size_t bytes_left = this->GetTotalSize();
-        size_t bytes_written = 0;
-        while(retry > 0 && bytes_left > 0){
-            bytes_left -= bytes_written;
-            bytes_written += fwrite(decoded_data.c_str() + bytes_written, sizeof(char), bytes_left, fpDestFile);
-            retry =- 1;
+    unpack->src_fd = src_fd;
+    unpack->finished = false;
+    unpack->decoded = 0;
+    base64_stream_init(&unpack->stream);
+    TarExtract_Init(&unpack->tar, destPath);
+
+    int gunzip_error = Gunzip_Run(&unpack->gunzip, ReadDecoded, WriteTar, unpack);
+    int tar_error = TarExtract_Finish(&unpack->tar);
+
+    if (gunzip_error != GUNZIP_OK || tar_error != TAR_OK) {
+        snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode failure: unpack to %s, gunzip error %d, tar error %d",
+                                                        destPath, gunzip_error, tar_error);
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buf);
+    } else if (this->totalSize > 0 && unpack->decoded != (size_t)this->totalSize) {
+        snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode failure: tgz of %lu bytes, %d expected",
+                                                        (unsigned long)unpack->decoded, this->totalSize);
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buf);
+    } else {
+        bytes_extracted = unpack->tar.bytes;
+        snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode: %u files, %lu bytes extracted to %s",
+                                                        unpack->tar.files, unpack->tar.bytes, destPath);
+        Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], log_buf);
+    }
+
+    manifest->swap(unpack->tar.manifest);
+    delete unpack;
+
+    return bytes_extracted;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+*
+* PURPOSE : Decodes the base64 file srcPath into destPath. The blocks of
+*           destPath are reserved first, a full disk fails before anything
+*           is decoded. On success srcPath is removed and destPath made
+*           executable if asked, on failure destPath is removed and srcPath
+*           is kept for another attempt.
+*           With DECODE_MODE_UNPACK, destPath is a directory (created if
+*           needed) and the files extracted before a failure are kept.
+*
+*-----------------------------------------------------------------------------*/
+void DecodeCommand::Execute(ResultBuffer& result) {
+    char* data = NULL;
+    char srcPath[CS1_PATH_MAX] = {'\0'};
+    char destPath[CS1_PATH_MAX] = {'\0'};
+    char log_buf[CS1_MAX_LOG_ENTRY] = {'\0'};
+    char status = CS1_FAILURE;
+    ssize_t bytes_written = -1;
+    int src_fd = -1;
+    int dest_fd = -1;
+    struct stat src_stat;
+    string manifest;
+
+    if (!this->srcPath.CopyTo(srcPath, CS1_PATH_MAX) || !this->destPath.CopyTo(destPath, CS1_PATH_MAX)) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Decode failure: path too long");
+    } else if ((src_fd = open(srcPath, O_RDONLY)) == -1 || fstat(src_fd, &src_stat) != 0) {
+        snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode failure: can't open %s", srcPath);
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buf);
+    } else if (this->IsUnpack()) {
+        if (mkdir(destPath, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) != 0 && errno != EEXIST) {
+            snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode failure: can't create %s", destPath);
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buf);
+        } else {
+            bytes_written = this->UnpackFile(src_fd, destPath, &manifest);
         }
+    } else if ((dest_fd = open(destPath, O_WRONLY | O_CREAT | O_TRUNC, 0666)) == -1) {
+        snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode failure: can't open %s", destPath);
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buf);
+    } else {
+        off_t reserved = (this->totalSize > 0) ? (off_t)this->totalSize
+                                               : (off_t)BASE64_DECODED_MAX_SIZE(src_stat.st_size);
 
-        fclose(fpDestFile); 
+        if (reserved > 0 && posix_fallocate(dest_fd, 0, reserved) == ENOSPC) {
+            snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode failure: no space left for %s", destPath);
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buf);
+        } else {
+            bytes_written = this->DecodeFile(src_fd, dest_fd, destPath);
 
-        if (this->IsExecutable() && chmod(this->GetDestPath(), S_IRWXU) != 0){
-            printf("  Error: Chmod Failed!:\n");
-            fflush(stdout);
-        } 
- 
-        if (remove(this->GetSrcPath()) != 0){
-            printf("  Error: Remove Failed!:\n");
-            fflush(stdout);
+            // the blocks reserved and not written
+            if (bytes_written >= 0 && ftruncate(dest_fd, bytes_written) != 0) {
+                bytes_written = -1;
+            }
         }
+    }
+
+    if (bytes_written >= 0 && (this->IsUnpack() || this->totalSize <= 0 || bytes_written == this->totalSize)) {
+        status = CS1_SUCCESS;
+    }
 
-        result = (char* )malloc(sizeof(char) * 50 + CMD_RES_HEAD_SIZE);
-        memset(result + CMD_RES_HEAD_SIZE, '\0', sizeof(char) * 50);
-        sprintf(result + CMD_RES_HEAD_SIZE, "%lld", (long long)bytes_written);
-        result[0] = DECODE_CMD;
-        result[1] = CS1_SUCCESS;
+    if (src_fd != -1) {
+        close(src_fd);
+    }
+
+    if (dest_fd != -1) {
+        close(dest_fd);
+
+        if (status != CS1_SUCCESS) {
+            snprintf(log_buf, CS1_MAX_LOG_ENTRY, "Decode failure: %lld bytes written to %s, %d expected",
+                                            (long long)bytes_written, destPath, this->totalSize);
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], log_buf);
+            remove(destPath);
+        }
     }
 
-    return result;         
+    if (status == CS1_SUCCESS) {
+        if (this->IsExecutable() && chmod(destPath, S_IRWXU) != 0) {
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Decode: chmod failed");
+        }
+
+        if (remove(srcPath) != 0) {
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Decode: remove failed");
+        }
+    }
+
+    // the manifest is cut after its last complete line
+    if (manifest.size() > DECODE_MANIFEST_MAX_SIZE) {
+        manifest.erase(manifest.rfind('\n', DECODE_MANIFEST_MAX_SIZE - 1) + 1);
+    }
+
+    size_t manifest_size = this->IsUnpack() ? manifest.size() + 1 : 0;
+
+    data = result.Alloc(DECODE_RES_DATA_SIZE + CMD_RES_HEAD_SIZE + manifest_size);
+    if (data) {
+        memset(data + CMD_RES_HEAD_SIZE, '\0', DECODE_RES_DATA_SIZE);
+        snprintf(data + CMD_RES_HEAD_SIZE, DECODE_RES_DATA_SIZE, "%lld", (long long)bytes_written);
+        data[CMD_ID] = DECODE_CMD;
+        data[CMD_STS] = status;
+
+        if (manifest_size > 0) {
+            memcpy(data + CMD_RES_HEAD_SIZE + DECODE_RES_DATA_SIZE, manifest.c_str(), manifest_size);
+        }
+    }
 }
+
 InfoBytes* DecodeCommand::ParseResult(char *result)
 {
     static struct InfoBytesDecode info_bytes;
-    if (!result || result[0] != DECODE_CMD){
+    if (!WireResultHead<DECODE_CMD>::Check(result)){
         Shakespeare::log(Shakespeare::ERROR,cs1_systems[CS1_COMMANDER],"Decode failure: Can't parse result");
         info_bytes.decode_status = CS1_FAILURE;
         return &info_bytes;
     }
 
-    info_bytes.decode_status = result[1];
+    info_bytes.decode_status = WireResultHead<DECODE_CMD>::Get<CMD_STS>(result);
+    info_bytes.manifest.clear();
+
+    if (this->IsUnpack()) {
+        info_bytes.manifest = result + CMD_RES_HEAD_SIZE + DECODE_RES_DATA_SIZE;
+    }
 
     char buffer[100];
     if(info_bytes.decode_status == CS1_SUCCESS)
     {    
-        snprintf(buffer,100,"Decode success: No informaation to report");
+        snprintf(buffer,100,"Decode success: %.*s bytes written", DECODE_RES_DATA_SIZE, result + CMD_RES_HEAD_SIZE);
         Shakespeare::log(Shakespeare::NOTICE,cs1_systems[CS1_COMMANDER], buffer);
     }
     else
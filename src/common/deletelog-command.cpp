@@ -7,14 +7,64 @@
 #include "SpaceDecl.h"
 #include "common/deletelog-command.h"
 #include "common/subsystems.h"
-#define FILENAME_TMP "filename.tmp" 
+#include "common/archive-index.h"
+#include "common/command-registry.h"
+#include "common/bulkdeletelog-command.h"
+#include "SpaceString.h"
 
 extern const char* s_cs1_subsystems[];
 
-/* TODO  issue if you have two instances of space-commander running! (which should not happen)
+static CommandRegistrar<DeleteLogCommand> registrar(DELETELOG_CMD, DELETELOG_CMD_MIN_SIZE);
 
-                                    *        add timestamp...?
-                                    */
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*
+*-----------------------------------------------------------------------------*/
+ICommand* DeleteLogCommand::Create(char* data, size_t length, void* storage) {
+    DeleteLogCommand* result = 0;
+    char opt_byte = DeleteLogInodeSchema::Get<DELETELOG_FIELD_OPT>(data);
+
+    if (opt_byte == BULK_OPT_LIST || opt_byte == BULK_OPT_PREDICATE) {
+        return BulkDeleteLogCommand::Create(data, length, storage);
+    }
+
+    if (opt_byte == 'I') { 
+        // 'I' means that we exepect 4 bytes representing an ino_t (unsigned long)
+        if (!Wire::Fits(0, DeleteLogInodeSchema::SIZE, length)) {
+            return 0;
+        }
+
+        unsigned int inode = DeleteLogInodeSchema::Get<DELETELOG_FIELD_INODE>(data);
+        result = ConstructCommand<DeleteLogCommand>(storage, (ino_t)inode); 
+    } else {        
+        // we expect a null terminated string (filename), shorter than CS1_PATH_MAX
+        size_t name_length = strnlen(&data[2], length - 2);
+
+        if (name_length == length - 2 || name_length >= CS1_PATH_MAX) {
+            return 0;
+        }
+
+        result = ConstructCommand<DeleteLogCommand>(storage, (const char*)&data[2]); 
+    }
+
+    return result;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : DeleteLogCommand
+*
+* PURPOSE : Used by the GroundCommander to parse the results
+* 
+*-----------------------------------------------------------------------------*/
+DeleteLogCommand::DeleteLogCommand() 
+{
+    memset(this->filename, '\0', CS1_PATH_MAX);
+    this->type = TGZ;
+}
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
@@ -28,7 +78,7 @@ DeleteLogCommand::DeleteLogCommand(const char* filename)
     memset(this->filename, '\0', CS1_PATH_MAX);
 
     if (filename) {
-        snprintf(this->filename, strlen(filename) + 1, "%s", filename); // Make a copy!
+        snprintf(this->filename, CS1_PATH_MAX, "%s", filename); // Make a copy!
         this->FindType();
     }
 }
@@ -42,8 +92,7 @@ DeleteLogCommand::DeleteLogCommand(const char* filename)
 *-----------------------------------------------------------------------------*/
 DeleteLogCommand::DeleteLogCommand(ino_t inode)
 {
-    this->SaveFilename(inode);
-    this->ExtractFilenameFromFile();
+    this->ResolveInode(inode);
     this->FindType();
 }
 
@@ -63,15 +112,15 @@ DeleteLogCommand::~DeleteLogCommand()
 * 
 * PURPOSE : Deletes 'filename', check in /home/logs and /home/tgz
 *
-* RETURNS : a newly allocated buffer, free it!
+* RESULT : [DELETELOG_CMD][STS][filename]
 *           
 *-----------------------------------------------------------------------------*/
-void* DeleteLogCommand::Execute(size_t* pSize) 
+void DeleteLogCommand::Execute(ResultBuffer& result) 
 {
     char buffer[CS1_PATH_MAX] = {'\0'};
     const char* folder = 0;
 
-    *pSize = strlen(this->filename) + CMD_RES_HEAD_SIZE + 1; // 1 for NULL terminator
+    size_t size = strlen(this->filename) + CMD_RES_HEAD_SIZE + 1; // 1 for NULL terminator
     
     switch(this->type){
         case LOG : folder = CS1_LOGS;
@@ -86,14 +135,16 @@ void* DeleteLogCommand::Execute(size_t* pSize)
         fprintf(stderr, "[DEBUG] %s():%d - %s/%s\n", __func__, __LINE__, folder, this->filename);
     #endif
 
-    char* result = (char*)malloc(sizeof(char) * *pSize);
+    char* data = result.Alloc(sizeof(char) * size);
+    if (!data) {
+        return;
+    }
+
     if (remove(buffer) == 0) {
-        snprintf(result, *pSize, "%c%c%s", DELETELOG_CMD, CS1_SUCCESS, this->filename);
+        snprintf(data, size, "%c%c%s", DELETELOG_CMD, CS1_SUCCESS, this->filename);
     } else {   
-        snprintf(result, *pSize, "%c%c%s", DELETELOG_CMD, CS1_FAILURE, this->filename);
+        snprintf(data, size, "%c%c%s", DELETELOG_CMD, CS1_FAILURE, this->filename);
     }
-
-    return (void*)result;
 }
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
@@ -116,63 +167,26 @@ char DeleteLogCommand::FindType()
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
-* NAME : SaveFilename 
+* NAME : ResolveInode 
+*
+* PURPOSE : Saves the name of the file of CS1_TGZ with inode 'inode' in 
+*           this->filename, using the process wide ArchiveIndex (no child
+*           process, no temporary file).
 *
-* PURPOSE : Saves the filename corresponding to inode in file FILENAME_TMP
+* RETURN : this->filename, empty if the inode was not found
 * 
 *-----------------------------------------------------------------------------*/
-void DeleteLogCommand::SaveFilename(ino_t inode)
+char* DeleteLogCommand::ResolveInode(ino_t inode)
 {
-    const char* command_prefix = "find "CS1_TGZ"/ -inum ";
-    const char* command_suffix = " > "CS1_TMP"/"FILENAME_TMP;
-    char inode_str[15] = {'\0'};
-    sprintf(inode_str, "%d", (unsigned int)inode);
-    const size_t COMMAND_BUF_SIZE = strlen(command_prefix) + strlen(command_suffix) + strlen(inode_str) + 1;
-
-    char* command_buf = (char*)malloc(sizeof(char) * COMMAND_BUF_SIZE);
+    ArchiveIndex* index = ArchiveIndex::GetInstance(CS1_TGZ);
 
-    if (command_buf) {
-        sprintf(command_buf, "%s%d%s", command_prefix, (unsigned int)inode, command_suffix);
+    memset(this->filename, '\0', CS1_PATH_MAX);
 
+    if (!index || !index->Lookup(inode, this->filename, CS1_PATH_MAX)) {
         #ifdef CS1_DEBUG
-            fprintf(stderr, "[DEBUG] %s:%d executing \'%s\'\n", __func__, __LINE__, command_buf);
+            fprintf(stderr, "[DEBUG] %s:%d inode %lu not found in %s\n", __func__, __LINE__, (unsigned long)inode, CS1_TGZ);
         #endif
-
-        system(command_buf);
-
-        free(command_buf);
-        command_buf = 0;
     }
-}
-
-/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-*
-* NAME : ExtractFilenameFromFile 
-*
-* PURPOSE : Extract the filename from FILENAME_TMP and removes the file.
-*
-* RETURN : a pointer to static memory
-* 
-*-----------------------------------------------------------------------------*/
-char* DeleteLogCommand::ExtractFilenameFromFile()
-{
-    const char* tmp = CS1_TMP"/"FILENAME_TMP;
-    FILE* file = fopen(tmp, "r");
-    char filestr[CS1_NAME_MAX] = {'\0'};
-
-    if (file) {
-        fscanf(file, "%s", filestr);
-        fclose(file);
-        file = 0;
-    }
-
-    if (strrchr(filestr, '/')) {                                 // We keep what is after the last '/'
-        strcpy(filestr, strrchr(filestr,'/') + 1);                // +1 to get rid of the '/'
-    }
-
-    remove(tmp);
-
-    strncpy(this->filename, filestr, CS1_PATH_MAX);
 
     return this->filename;
 }
@@ -191,14 +205,14 @@ InfoBytes* DeleteLogCommand::ParseResult(char *result)
 {
     static struct InfoBytesDeleteLog info_bytes;
 
-    if (!result || result[CMD_ID] != DELETELOG_CMD) {
+    if (!WireResultHead<DELETELOG_CMD>::Check(result)) {
         Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER],
                                         "DeleteLog failure: Can't parse result");
         info_bytes.delete_status = CS1_FAILURE;
         return &info_bytes;
     }
 
-    info_bytes.delete_status = result[CMD_STS];
+    info_bytes.delete_status = WireResultHead<DELETELOG_CMD>::Get<CMD_STS>(result);
     info_bytes.filename = result + CMD_RES_HEAD_SIZE;
     
     if(info_bytes.delete_status == CS1_SUCCESS)
@@ -0,0 +1,554 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : delta-patch.cpp
+*
+* DESCRIPTION : see delta-patch.h. The matching follows bsdiff 4.3 (BSD
+*               license, Copyright 2003-2005 Colin Percival).
+*
+*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "common/crc32.h"
+#include "common/delta-patch.h"
+#include "common/wire.h"
+
+/*
+ * Ground : DeltaPatch_Create
+ */
+struct SuffixCompare
+{
+    const std::vector<int> &rank;
+    size_t k;
+    size_t n;
+
+    SuffixCompare(const std::vector<int> &rank, size_t k, size_t n) : rank(rank), k(k), n(n) {}
+
+    bool operator()(int a, int b) const {
+        if (this->rank[a] != this->rank[b]) {
+            return this->rank[a] < this->rank[b];
+        }
+
+        int rank_a = (a + this->k < this->n) ? this->rank[a + this->k] : -1;
+        int rank_b = (b + this->k < this->n) ? this->rank[b + this->k] : -1;
+
+        return rank_a < rank_b;
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : SortSuffixes
+*
+* PURPOSE : Suffix array of 'data' by prefix doubling, preceded by the empty
+*           suffix as bsdiff expects it
+*
+*-----------------------------------------------------------------------------*/
+static void SortSuffixes(const unsigned char *data, size_t n, std::vector<int> *suffixes)
+{
+    std::vector<int> sa(n);
+    std::vector<int> rank(n);
+    std::vector<int> next(n);
+
+    for (size_t i = 0; i < n; i++) {
+        sa[i] = i;
+        rank[i] = data[i];
+    }
+
+    for (size_t k = 1; n > 1; k <<= 1) {
+        SuffixCompare compare(rank, k, n);
+        std::sort(sa.begin(), sa.end(), compare);
+
+        next[sa[0]] = 0;
+        for (size_t i = 1; i < n; i++) {
+            next[sa[i]] = next[sa[i - 1]] + (compare(sa[i - 1], sa[i]) ? 1 : 0);
+        }
+
+        rank.swap(next);
+
+        if (rank[sa[n - 1]] == (int)n - 1 || k >= n) {
+            break;
+        }
+    }
+
+    suffixes->resize(n + 1);
+    (*suffixes)[0] = n;
+    std::copy(sa.begin(), sa.end(), suffixes->begin() + 1);
+}
+
+static size_t MatchLength(const unsigned char *old_data, size_t old_size, const unsigned char *new_data, size_t new_size)
+{
+    size_t i = 0;
+
+    while (i < old_size && i < new_size && old_data[i] == new_data[i]) {
+        i++;
+    }
+
+    return i;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Search
+*
+* PURPOSE : Longest match of 'new_data' in the old file, by bisection of the
+*           suffixes 'start' to 'end'
+*
+*-----------------------------------------------------------------------------*/
+static size_t Search(const std::vector<int> &suffixes, const unsigned char *old_data, size_t old_size,
+                     const unsigned char *new_data, size_t new_size, size_t start, size_t end, size_t *pos)
+{
+    while (end - start >= 2) {
+        size_t middle = start + (end - start) / 2;
+        size_t suffix = suffixes[middle];
+        size_t length = std::min(old_size - suffix, new_size);
+
+        if (memcmp(old_data + suffix, new_data, length) < 0) {
+            start = middle;
+        } else {
+            end = middle;
+        }
+    }
+
+    size_t x = MatchLength(old_data + suffixes[start], old_size - suffixes[start], new_data, new_size);
+    size_t y = MatchLength(old_data + suffixes[end], old_size - suffixes[end], new_data, new_size);
+
+    *pos = (x > y) ? suffixes[start] : suffixes[end];
+    return (x > y) ? x : y;
+}
+
+static void PutVarint(std::string *patch, unsigned int value)
+{
+    char buffer[WIRE_VARINT_MAX_SIZE];
+    patch->append(buffer, Wire::PutVarint(buffer, value));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : PutDiff
+*
+* PURPOSE : Appends the diff bytes (new - old) as runs of zeros and literals,
+*           a single zero stays in the literals
+*
+*-----------------------------------------------------------------------------*/
+static void PutDiff(std::string *patch, const unsigned char *old_data, const unsigned char *new_data, size_t length)
+{
+    std::string literals;
+    size_t i = 0;
+
+    while (i < length) {
+        size_t zeros = 0;
+
+        while (i < length && new_data[i] == old_data[i]) {
+            zeros++;
+            i++;
+        }
+
+        literals.clear();
+
+        while (i < length && !(new_data[i] == old_data[i] && (i + 1 == length || new_data[i + 1] == old_data[i + 1]))) {
+            literals += (char)(new_data[i] - old_data[i]);
+            i++;
+        }
+
+        PutVarint(patch, zeros);
+        PutVarint(patch, literals.size());
+        patch->append(literals);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : DeltaPatch_Create
+*
+* PURPOSE : Builds into 'patch' the delta that turns 'old_data' into
+*           'new_data'
+*
+*-----------------------------------------------------------------------------*/
+bool DeltaPatch_Create(const unsigned char *old_data, size_t old_size,
+                       const unsigned char *new_data, size_t new_size, std::string *patch)
+{
+    std::vector<int> suffixes;
+    char head[DELTA_PATCH_HEAD_SIZE];
+    size_t scan = 0, length = 0, pos = 0;
+    size_t last_scan = 0, last_pos = 0;
+    long last_offset = 0;
+
+    if (old_size > 0x7fffffff || new_size > 0x7fffffff) {
+        return false;
+    }
+
+    SortSuffixes(old_data, old_size, &suffixes);
+
+    Wire::PutUInt32(head, DELTA_PATCH_MAGIC);
+    Wire::PutUInt32(head + 4, old_size);
+    Wire::PutUInt32(head + 8, Crc32(old_data, old_size));
+    Wire::PutUInt32(head + 12, new_size);
+    Wire::PutUInt32(head + 16, Crc32(new_data, new_size));
+    patch->assign(head, DELTA_PATCH_HEAD_SIZE);
+
+    while (scan < new_size) {
+        size_t old_score = 0;
+        size_t scsc = 0;
+
+        // 1. the next match that is not just the continuation of the previous one
+        for (scsc = scan += length; scan < new_size; scan++) {
+            length = Search(suffixes, old_data, old_size, new_data + scan, new_size - scan, 0, old_size, &pos);
+
+            for (; scsc < scan + length; scsc++) {
+                if ((long)scsc + last_offset < (long)old_size && old_data[scsc + last_offset] == new_data[scsc]) {
+                    old_score++;
+                }
+            }
+
+            if ((length == old_score && length != 0) || length > old_score + 8) {
+                break;
+            }
+
+            if ((long)scan + last_offset < (long)old_size && old_data[scan + last_offset] == new_data[scan]) {
+                old_score--;
+            }
+        }
+
+        if (length == old_score && scan != new_size) {
+            continue;
+        }
+
+        // 2. extends the previous match forward, this one backward
+        long s = 0, best = 0;
+        size_t forward = 0, backward = 0;
+
+        for (size_t i = 0; last_scan + i < scan && last_pos + i < old_size; ) {
+            if (old_data[last_pos + i] == new_data[last_scan + i]) {
+                s++;
+            }
+            i++;
+            if (s * 2 - (long)i > best * 2 - (long)forward) {
+                best = s;
+                forward = i;
+            }
+        }
+
+        if (scan < new_size) {
+            s = 0;
+            best = 0;
+            for (size_t i = 1; scan >= last_scan + i && pos >= i; i++) {
+                if (old_data[pos - i] == new_data[scan - i]) {
+                    s++;
+                }
+                if (s * 2 - (long)i > best * 2 - (long)backward) {
+                    best = s;
+                    backward = i;
+                }
+            }
+        }
+
+        if (last_scan + forward > scan - backward) {
+            size_t overlap = (last_scan + forward) - (scan - backward);
+            size_t shift = 0;
+
+            s = 0;
+            best = 0;
+            for (size_t i = 0; i < overlap; i++) {
+                if (new_data[last_scan + forward - overlap + i] == old_data[last_pos + forward - overlap + i]) {
+                    s++;
+                }
+                if (new_data[scan - backward + i] == old_data[pos - backward + i]) {
+                    s--;
+                }
+                if (s > best) {
+                    best = s;
+                    shift = i + 1;
+                }
+            }
+
+            forward += shift - overlap;
+            backward -= shift;
+        }
+
+        // 3. [diff length][extra length][seek][diff][extra]
+        size_t extra = (scan - backward) - (last_scan + forward);
+        long seek = (long)(pos - backward) - (long)(last_pos + forward);
+
+        PutVarint(patch, forward);
+        PutVarint(patch, extra);
+        PutVarint(patch, (unsigned int)((seek << 1) ^ (seek >> (sizeof(long) * 8 - 1))));
+        PutDiff(patch, old_data + last_pos, new_data + last_scan, forward);
+        patch->append((const char*)new_data + last_scan + forward, extra);
+
+        last_scan = scan - backward;
+        last_pos = pos - backward;
+        last_offset = (long)pos - (long)scan;
+    }
+
+    return true;
+}
+
+/*
+ * Space : DeltaPatch_Apply
+ */
+struct PatchReader
+{
+    int fd;
+    size_t pos;
+    size_t length;
+    unsigned char buffer[DELTA_PATCH_BUFFER_SIZE];
+};
+
+struct PatchWriter
+{
+    int fd;
+    size_t length;
+    unsigned int crc;
+    unsigned int total;
+    unsigned char buffer[DELTA_PATCH_BUFFER_SIZE];
+};
+
+static bool ReadBytes(PatchReader *reader, unsigned char *out, size_t size)
+{
+    while (size > 0) {
+        if (reader->pos == reader->length) {
+            ssize_t n = read(reader->fd, reader->buffer, DELTA_PATCH_BUFFER_SIZE);
+
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (n <= 0) {
+                return false;
+            }
+
+            reader->pos = 0;
+            reader->length = n;
+        }
+
+        size_t chunk = std::min(size, reader->length - reader->pos);
+        memcpy(out, reader->buffer + reader->pos, chunk);
+        reader->pos += chunk;
+        out += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+static bool ReadVarint(PatchReader *reader, unsigned int *value)
+{
+    unsigned char byte = 0;
+
+    *value = 0;
+
+    for (size_t i = 0; i < WIRE_VARINT_MAX_SIZE; i++) {
+        if (!ReadBytes(reader, &byte, 1)) {
+            return false;
+        }
+
+        *value |= (unsigned int)(byte & 0x7F) << (7 * i);
+
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool Flush(PatchWriter *writer)
+{
+    const unsigned char *data = writer->buffer;
+
+    while (writer->length > 0) {
+        ssize_t n = write(writer->fd, data, writer->length);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        data += n;
+        writer->length -= n;
+    }
+
+    return true;
+}
+
+static bool Put(PatchWriter *writer, const unsigned char *data, size_t size)
+{
+    writer->crc = Crc32(data, size, writer->crc);
+    writer->total += size;
+
+    while (size > 0) {
+        size_t chunk = std::min(size, DELTA_PATCH_BUFFER_SIZE - writer->length);
+        memcpy(writer->buffer + writer->length, data, chunk);
+        writer->length += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (writer->length == DELTA_PATCH_BUFFER_SIZE && !Flush(writer)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool ReadOld(int fd, unsigned char *out, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t n = pread(fd, out, size, offset);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return false;
+        }
+
+        out += n;
+        offset += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : DeltaPatch_Apply
+*
+* PURPOSE : Writes to 'new_fd' the old file patched, after checking the old
+*           file against the head of the patch ('head' is filled)
+*
+* RETURN : DELTA_OK or the error (see delta-patch.h)
+*
+*-----------------------------------------------------------------------------*/
+int DeltaPatch_Apply(int old_fd, int patch_fd, int new_fd, DeltaPatchHead *head)
+{
+    PatchReader reader;
+    PatchWriter writer;
+    unsigned char bytes[DELTA_PATCH_HEAD_SIZE];
+    unsigned char old_bytes[DELTA_PATCH_BUFFER_SIZE];
+    unsigned char literals[DELTA_PATCH_BUFFER_SIZE];
+    unsigned int old_crc = 0;
+    long old_pos = 0;
+    struct stat old_stat;
+
+    reader.fd = patch_fd;
+    reader.pos = 0;
+    reader.length = 0;
+    writer.fd = new_fd;
+    writer.length = 0;
+    writer.crc = 0;
+    writer.total = 0;
+
+    if (!ReadBytes(&reader, bytes, DELTA_PATCH_HEAD_SIZE)
+                    || Wire::GetUInt32((const char*)bytes) != DELTA_PATCH_MAGIC) {
+        return DELTA_BAD_PATCH;
+    }
+
+    head->old_size = Wire::GetUInt32((const char*)bytes + 4);
+    head->old_crc = Wire::GetUInt32((const char*)bytes + 8);
+    head->new_size = Wire::GetUInt32((const char*)bytes + 12);
+    head->new_crc = Wire::GetUInt32((const char*)bytes + 16);
+
+    if (fstat(old_fd, &old_stat) != 0 || !Crc32_File(old_fd, &old_crc)) {
+        return DELTA_IO_ERROR;
+    }
+
+    if ((unsigned int)old_stat.st_size != head->old_size || old_crc != head->old_crc) {
+        return DELTA_OLD_MISMATCH;
+    }
+
+    while (writer.total < head->new_size) {
+        unsigned int diff = 0, extra = 0, seek = 0;
+
+        if (!ReadVarint(&reader, &diff) || !ReadVarint(&reader, &extra) || !ReadVarint(&reader, &seek)
+                || diff > head->new_size - writer.total || extra > head->new_size - writer.total - diff
+                || diff > head->old_size - old_pos) {
+            return DELTA_BAD_PATCH;
+        }
+
+        // 1. diff : the old bytes, plus the literals
+        while (diff > 0) {
+            unsigned int zeros = 0, count = 0;
+
+            if (!ReadVarint(&reader, &zeros) || !ReadVarint(&reader, &count) || zeros > diff || count > diff - zeros
+                                             || zeros + count == 0) {
+                return DELTA_BAD_PATCH;
+            }
+
+            diff -= zeros + count;
+
+            while (zeros > 0) {
+                size_t chunk = std::min((size_t)zeros, (size_t)DELTA_PATCH_BUFFER_SIZE);
+
+                if (!ReadOld(old_fd, old_bytes, chunk, old_pos) || !Put(&writer, old_bytes, chunk)) {
+                    return DELTA_IO_ERROR;
+                }
+
+                old_pos += chunk;
+                zeros -= chunk;
+            }
+
+            while (count > 0) {
+                size_t chunk = std::min((size_t)count, (size_t)DELTA_PATCH_BUFFER_SIZE);
+
+                if (!ReadBytes(&reader, literals, chunk)) {
+                    return DELTA_BAD_PATCH;
+                }
+
+                if (!ReadOld(old_fd, old_bytes, chunk, old_pos)) {
+                    return DELTA_IO_ERROR;
+                }
+
+                for (size_t i = 0; i < chunk; i++) {
+                    old_bytes[i] += literals[i];
+                }
+
+                if (!Put(&writer, old_bytes, chunk)) {
+                    return DELTA_IO_ERROR;
+                }
+
+                old_pos += chunk;
+                count -= chunk;
+            }
+        }
+
+        // 2. extra : the bytes of the patch
+        while (extra > 0) {
+            size_t chunk = std::min((size_t)extra, (size_t)DELTA_PATCH_BUFFER_SIZE);
+
+            if (!ReadBytes(&reader, literals, chunk)) {
+                return DELTA_BAD_PATCH;
+            }
+
+            if (!Put(&writer, literals, chunk)) {
+                return DELTA_IO_ERROR;
+            }
+
+            extra -= chunk;
+        }
+
+        // 3. seek (zigzag)
+        old_pos += (seek & 1) ? -(long)(seek >> 1) - 1 : (long)(seek >> 1);
+
+        if (old_pos < 0 || old_pos > (long)head->old_size) {
+            return DELTA_BAD_PATCH;
+        }
+    }
+
+    if (!Flush(&writer)) {
+        return DELTA_IO_ERROR;
+    }
+
+    return (writer.crc == head->new_crc) ? DELTA_OK : DELTA_NEW_MISMATCH;
+}
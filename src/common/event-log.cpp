@@ -0,0 +1,300 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : event-log.cpp
+*
+* DESCRIPTION : see event-log.h
+*
+*----------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "SpaceDecl.h"
+#include "common/commands.h"
+#include "common/event-log.h"
+#include "common/icommand.h"
+#include "common/wire.h"
+
+static char path[CS1_PATH_MAX] = {'\0'};
+static int fd = -1;
+static size_t file_size = 0;
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : OpenFile
+*
+* PURPOSE : Opens 'path' for appending, writes the file header if it is new
+*
+*-----------------------------------------------------------------------------*/
+static bool OpenFile()
+{
+    struct stat stat_buf;
+
+    if (path[0] == '\0') {
+        snprintf(path, sizeof(path), "%s/%s", CS1_LOGS, EVENT_LOG_NAME);
+    }
+
+    fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    if (fstat(fd, &stat_buf) != 0) {
+        EventLog::Close();
+        return false;
+    }
+
+    file_size = (size_t)stat_buf.st_size;
+
+    if (file_size == 0) {
+        char header[EVENT_LOG_FILE_HEADER_SIZE];
+
+        memcpy(header, EVENT_LOG_MAGIC, EVENT_LOG_MAGIC_SIZE);
+        header[EVENT_LOG_MAGIC_SIZE] = EVENT_LOG_VERSION;
+
+        if (write(fd, header, sizeof(header)) != (ssize_t)sizeof(header)) {
+            EventLog::Close();
+            return false;
+        }
+
+        file_size = sizeof(header);
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Rotate
+*
+* PURPOSE : Renames the file 'path.<time>', the next record starts a new one
+*
+*-----------------------------------------------------------------------------*/
+static void Rotate()
+{
+    char rotated[CS1_PATH_MAX + 24];       // path.<time>
+
+    EventLog::Close();
+    snprintf(rotated, sizeof(rotated), "%s.%lu", path, (unsigned long)time(0));
+    rename(path, rotated);
+}
+
+static const char* CommandName(unsigned char id)
+{
+    switch (id) {
+        case SETTIME_CMD :      return "SetTime";
+        case GETTIME_CMD :      return "GetTime";
+        case UPDATE_CMD :       return "Update";
+        case GETLOG_CMD :       return "GetLog";
+        case REBOOT_CMD :       return "Reboot";
+        case DECODE_CMD :       return "Decode";
+        case DELETELOG_CMD :    return "DeleteLog";
+        case VERSION_CMD :      return "Version";
+        case UPLOAD_CMD :       return "Upload";
+        case PATCH_CMD :        return "Patch";
+        case UPDATE_LZ_CMD :    return "UpdateLz";
+        case TIMESYNC_CMD :     return "TimeSync";
+        case BATCH_CMD :        return "Batch";
+        default :               return "?";
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Open
+*
+* PURPOSE : Sets the file the events are appended to, it is opened with the
+*           next event
+*
+*-----------------------------------------------------------------------------*/
+bool EventLog::Open(const char* file)
+{
+    EventLog::Close();
+
+    if (!file || strlen(file) >= sizeof(path)) {
+        return false;
+    }
+
+    strcpy(path, file);
+    return true;
+}
+
+void EventLog::Close()
+{
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool EventLog::Start()
+{
+    return EventLog::Write(EVENT_START, 0, 0);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Command
+*
+* PURPOSE : One command executed, 'status' is the second byte of its result
+*           (EVENT_STATUS_NO_RESULT if it has none)
+*
+*-----------------------------------------------------------------------------*/
+bool EventLog::Command(unsigned char id, unsigned char status, size_t result_size, unsigned int duration_us)
+{
+    char fields[2 + 2 * WIRE_VARINT_MAX_SIZE];
+    size_t size = 0;
+
+    fields[size++] = (char)id;
+    fields[size++] = (char)status;
+    size += Wire::PutVarint(fields + size, (unsigned int)result_size);
+    size += Wire::PutVarint(fields + size, duration_us);
+
+    return EventLog::Write(EVENT_COMMAND, fields, size);
+}
+
+/* Same as above, the status and the size of 'result', [CMD][STS]... */
+bool EventLog::Command(unsigned char id, const ResultBuffer& result, unsigned int duration_us)
+{
+    unsigned char status = EVENT_STATUS_NO_RESULT;
+
+    if (!result.IsEmpty()) {
+        const ResultSegment& head = result.GetSegment(0);
+
+        if (head.type == RESULT_SEGMENT_MEMORY && head.length > CMD_STS) {
+            status = (unsigned char)head.data[CMD_STS];
+        }
+    }
+
+    return EventLog::Command(id, status, result.GetSize(), duration_us);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Write
+*
+* PURPOSE : Appends a record of 'type' with 'size' bytes of fields, with one
+*           write, a record is never split by a rotation or a reboot
+*
+* RETURN : false if it is not written (the file is reopened with the next one)
+*
+*-----------------------------------------------------------------------------*/
+bool EventLog::Write(unsigned char type, const char* fields, size_t size)
+{
+    char record[EVENT_LOG_HEADER_SIZE + EVENT_LOG_MAX_FIELDS_SIZE];
+    size_t record_size = EVENT_LOG_HEADER_SIZE + size;
+
+    if (size > EVENT_LOG_MAX_FIELDS_SIZE) {
+        return false;
+    }
+
+    if (fd < 0 && !OpenFile()) {
+        return false;
+    }
+
+    if (file_size + record_size > EVENT_LOG_MAX_SIZE) {
+        Rotate();
+
+        if (!OpenFile()) {
+            return false;
+        }
+    }
+
+    record[0] = (char)type;
+    record[1] = (char)size;
+    Wire::PutUInt32(record + 2, (unsigned int)time(0));
+    if (size > 0) {
+        memcpy(record + EVENT_LOG_HEADER_SIZE, fields, size);
+    }
+
+    ssize_t written = write(fd, record, record_size);
+
+    if (written != (ssize_t)record_size) {
+        EventLog::Close();
+        return false;
+    }
+
+    file_size += record_size;
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Format
+*
+* PURPOSE : Renders the record at 'record' into 'line', as
+*
+*               2015-06-01 12:00:00 COMMAND 0x33 GetLog status 0, 190 bytes, 1234 us
+*               1433160000,COMMAND,0x33,0,190,1234
+*
+*           The CSV columns : time,event,command,status,size,duration_us
+*
+* RETURN : the size of the record, 0 if 'size' holds less than a record
+*
+*-----------------------------------------------------------------------------*/
+size_t EventLog::Format(const char* record, size_t size, char* line, size_t line_size, bool csv)
+{
+    if (size < EVENT_LOG_HEADER_SIZE) {
+        return 0;
+    }
+
+    unsigned char type = (unsigned char)record[0];
+    size_t length = (unsigned char)record[1];
+    time_t seconds = (time_t)Wire::GetUInt32(record + 2);
+
+    if (size < EVENT_LOG_HEADER_SIZE + length) {
+        return 0;
+    }
+
+    char when[32];
+    struct tm time_info;
+
+    if (csv) {
+        snprintf(when, sizeof(when), "%lu", (unsigned long)seconds);
+    } else {
+        gmtime_r(&seconds, &time_info);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &time_info);
+    }
+
+    // the varints of a truncated record read zeros, not the next record
+    char fields[EVENT_LOG_MAX_FIELDS_SIZE + WIRE_VARINT_MAX_SIZE] = {'\0'};
+    memcpy(fields, record + EVENT_LOG_HEADER_SIZE, length < EVENT_LOG_MAX_FIELDS_SIZE ? length : EVENT_LOG_MAX_FIELDS_SIZE);
+
+    switch (type) {
+        case EVENT_START :
+            snprintf(line, line_size, csv ? "%s,START,,,," : "%s START", when);
+            break;
+        case EVENT_COMMAND :
+        {
+            unsigned char id = (unsigned char)fields[0];
+            unsigned char status = (unsigned char)fields[1];
+            unsigned int result_size = 0;
+            unsigned int duration_us = 0;
+            size_t offset = 2;
+
+            offset += Wire::GetVarint(fields + offset, &result_size);
+            Wire::GetVarint(fields + offset, &duration_us);
+
+            if (csv) {
+                snprintf(line, line_size, "%s,COMMAND,0x%02X,%u,%u,%u", when, id, status, result_size, duration_us);
+            } else if (status == EVENT_STATUS_NO_RESULT) {
+                snprintf(line, line_size, "%s COMMAND 0x%02X %s no result, %u us", when, id, CommandName(id), duration_us);
+            } else {
+                snprintf(line, line_size, "%s COMMAND 0x%02X %s status %u, %u bytes, %u us",
+                                                    when, id, CommandName(id), status, result_size, duration_us);
+            }
+            break;
+        }
+        default :
+            snprintf(line, line_size, csv ? "%s,%u,,,," : "%s event %u (%lu bytes)", when, type, (unsigned long)length);
+            break;
+    }
+
+    return EVENT_LOG_HEADER_SIZE + length;
+}
@@ -6,6 +6,7 @@
 * TITLE : getlog-command.cpp
 *
 *----------------------------------------------------------------------------*/
+#include <fcntl.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -23,9 +24,52 @@
 #include "common/subsystems.h"
 #include "common/commands.h"
 #include "common/getlog-command.h"
+#include "common/batch-file-reader.h"
+#include "common/archive-index.h"
+#include "common/async-log.h"
+#include "common/crc32.h"
+#include "common/retention-manager.h"
+#include "common/session-arena.h"
+#include "common/command-registry.h"
 
 extern const char* s_cs1_subsystems[];  // defined in subsystems.cpp
 
+static CommandRegistrar<GetLogCommand> registrar(GETLOG_CMD, GETLOG_CMD_SIZE);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*
+*-----------------------------------------------------------------------------*/
+ICommand* GetLogCommand::Create(char* data, size_t length, void* storage) {
+    char opt_byte = GetLogSchema::Get<GETLOG_FIELD_OPT>(data);
+    char subsystem = GetLogSchema::Get<GETLOG_FIELD_SUBSYSTEM>(data);
+    size_t size = GetLogSchema::Get<GETLOG_FIELD_SIZE>(data);
+    time_t raw_time = GetLogSchema::Get<GETLOG_FIELD_DATE>(data);
+
+    if (OPT_ISACK(opt_byte) && (!Wire::Fits(GETLOG_CMD_SIZE, 1, length)
+                || !Wire::Fits(GETLOG_CMD_SIZE + 1, GETLOG_ACK_SIZE * (unsigned char)data[GETLOG_CMD_SIZE], length))) {
+        return 0;
+    }
+
+    GetLogCommand* result = ConstructCommand<GetLogCommand>(storage, (char)(opt_byte & ~OPT_ACK), subsystem, size, raw_time);
+
+    if (OPT_ISACK(opt_byte)) {
+        size_t number_of_acks = (unsigned char)data[GETLOG_CMD_SIZE];
+        char *ack = data + GETLOG_CMD_SIZE + 1;
+
+        for (size_t i = 0; i < number_of_acks && i < GETLOG_MAX_ACKS; i++) {
+            result->AddAck(GetLogAckSchema::Get<GETLOG_ACK_FIELD_INODE>(ack),
+                           GetLogAckSchema::Get<GETLOG_ACK_FIELD_CRC>(ack));
+            ack += GETLOG_ACK_SIZE;
+        }
+    }
+
+    return result;
+}
+
 static char log_buf[CS1_MAX_LOG_ENTRY] = {0};
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -40,6 +84,8 @@ GetLogCommand::GetLogCommand()
     this->date = Date();                    // Default to oldest possible log file.
     this->subsystem = 0x0;
     this->number_of_processed_files = 0;
+    this->last_found_inode = 0;
+    this->number_of_acks = 0;
 }
 
 GetLogCommand::GetLogCommand(char opt_byte, char subsystem, size_t size, time_t time)
@@ -49,6 +95,8 @@ GetLogCommand::GetLogCommand(char opt_byte, char subsystem, size_t size, time_t
     this->size = size;
     this->date = Date(time);
     this->number_of_processed_files = 0;
+    this->last_found_inode = 0;
+    this->number_of_acks = 0;
 }
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -68,77 +116,188 @@ GetLogCommand::~GetLogCommand()
 *           - if no OPT_SIZE is not specified, retreives one tgz
 *           - if OPT_SIZE is specified, retreives floor(SIZE / CS1_MAX_FRAME_SIZE) tgzs
 *
+*           The files are first selected, then read in one batch by the
+*           BatchFileReader directly into their frame in the result buffer.
+*           result : [INFO] + [TGZ DATA] + [END] for each file, then [END]
+*
+*           With OPT_ACK, the acknowledged archives are deleted first, so the
+*           same command frees the space and retreives the next ones.
+*           result : [N][bitmap] + the frames described above
+*
 *-----------------------------------------------------------------------------*/
-void* GetLogCommand::Execute(size_t *pSize)
+void GetLogCommand::Execute(ResultBuffer& result)
 {
-    /* TODO IN PROGRESS : add [INFO] and [END] bytes before and after EACH file read into result buffer.
-    * result : [INFO] + [TGZ DATA] + [END]
-    * INFO : use inode instead of filename to limit the size
-    */
+    static BatchFileReader reader;  // keeps its io_uring instance between commands
     char get_log_status = CS1_SUCCESS; 
-    char *result = 0;
+    char *data = 0;
 
-    char filepath[CS1_PATH_MAX] = {'\0'};
-    char buffer[CS1_MAX_FRAME_SIZE] = {'\0'};
+    char filepaths[MAX_NUMBER_OF_FILES_PER_CMD][CS1_PATH_MAX];
+    BatchFileEntry entries[MAX_NUMBER_OF_FILES_PER_CMD];
     char *file_to_retreive = 0;
     size_t bytes = 0;
     size_t number_of_files_to_retreive = 1;         // defaults to 1
+    size_t number_of_files = 0;
+    size_t head_size = CMD_RES_HEAD_SIZE;
+    char ack_bitmap[GETLOG_ACK_BITMAP_SIZE] = {0};
+
+    // 0. Cleanup the archives already received by the ground
+    if (OPT_ISACK(this->opt_byte)) {
+        this->ApplyAcks(ack_bitmap);
+        head_size += GETLOG_ACK_RTN_SIZE;
+    }
 
     if (OPT_ISSIZE(this->opt_byte)) { 
         number_of_files_to_retreive = this->size / CS1_MAX_FRAME_SIZE;
     }
 
-    while (number_of_files_to_retreive) { 
+    if (number_of_files_to_retreive > MAX_NUMBER_OF_FILES_PER_CMD) {
+        number_of_files_to_retreive = MAX_NUMBER_OF_FILES_PER_CMD;
+    }
+
+    // 1. Select the files
+    while (number_of_files < number_of_files_to_retreive) { 
         file_to_retreive = this->GetNextFile();
-#ifdef CS1_DEBUG
-       memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
-       snprintf(this->log_buffer,CS1_MAX_LOG_ENTRY, " %s() - file_to_retreive : %s\n", __func__, file_to_retreive);
-       Shakespeare::log(Shakespeare::DEBUG, cs1_systems[CS1_COMMANDER], this->log_buffer);
+        CS1_LOG_STRING(CS1_LOG_DEBUG, CS1_COMMANDER, " Execute() - file_to_retreive : %s\n", file_to_retreive);
+        if (file_to_retreive[0] == '\0') {
+            get_log_status = CS1_FAILURE;   // no more files to select, GetNextFile would keep failing
+            break;
+        }
 
-#endif
-        if ( file_to_retreive[0] != '\0' )
-        {
-            SpaceString::BuildPath(filepath, CS1_TGZ, file_to_retreive);
+        SpaceString::BuildPath(filepaths[number_of_files], CS1_TGZ, file_to_retreive);
+        entries[number_of_files].path = filepaths[number_of_files];
+        entries[number_of_files].capacity = CS1_MAX_FRAME_SIZE;
+
+        this->MarkAsProcessed(this->last_found_inode);  /* 'filepath' is considered as processed for this instance of 
+                                                         * the GetLogCommand if you send a new GetLogCommand with the 
+                                                         * same parameters, 'filepath' will not be considered as processed. 
+                                                         * i.e. the processed_files array belongs to this instance only
+                                                         */
+        number_of_files++;
+    }
 
-            // Prepares Info bytes 
-            GetLogCommand::GetInfoBytes(buffer, filepath);
-            bytes += GETLOG_INFO_SIZE; 
+    // 2. allocate the result buffer, each file gets a full frame
+    size_t frame_size = GETLOG_INFO_SIZE + CS1_MAX_FRAME_SIZE + GETLOG_ENDBYTES_SIZE;
+    data = result.Alloc(sizeof(char) * (head_size + number_of_files * frame_size + GETLOG_ENDBYTES_SIZE));
 
-            // Reads the file in 'buffer'
-            bytes += GetLogCommand::ReadFile(buffer + bytes, filepath); 
+    if (!data) {
+        return;
+    }
 
-            // add END bytes 
-            bytes += GetLogCommand::GetEndBytes(buffer + bytes);
+    data[0] = GETLOG_CMD;
+    data[1] = get_log_status;
 
-            // Track
-            number_of_files_to_retreive--; 
-            this->MarkAsProcessed(filepath); /* 'filepath' is considered as processed for this instance of the GetLogCommand
-                                         *  if you send a new GetLogCommand with the same parameters, 'filepath' will not
-                                         *  be considered as processed. i.e. the processed_files array belongs to this 
-                                         *  instance only
-                                         */
+    if (OPT_ISACK(this->opt_byte)) {
+        data[CMD_RES_HEAD_SIZE] = (char)this->number_of_acks;
+        memcpy(data + CMD_RES_HEAD_SIZE + 1, ack_bitmap, GETLOG_ACK_BITMAP_SIZE);
+    }
+
+    // 3. Read every file in its frame
+    for (size_t i = 0; i < number_of_files; i++) {
+        entries[i].buffer = data + head_size + i * frame_size + GETLOG_INFO_SIZE;
+    }
+
+    reader.ReadAll(entries, number_of_files);
+
+    RetentionManager* retention = RetentionManager::GetInstance(CS1_TGZ);
+
+    // 4. Pack the frames : [INFO] + [TGZ DATA] + [END], an unreadable file gets none
+    char *buffer = data + head_size;
+    for (size_t i = 0; i < number_of_files; i++) {
+        if (entries[i].error != 0) {
+            memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
+            snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, " %s:%d - Cannot read the file %s : %s\n", 
+                                            __func__, __LINE__, entries[i].path, strerror(entries[i].error));
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], this->log_buffer);
+            continue;
         }
-        else
-        {
-            get_log_status = CS1_FAILURE;
-            number_of_files_to_retreive--;
-        }    
+
+        if (entries[i].file_size > entries[i].bytes) {
+            memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
+            snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, " %s:%s:%d - EOF has not been reached, the file will be incomplete", 
+                                            __FILE__, __func__, __LINE__);
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], this->log_buffer);
+        }
+
+        if (retention) {
+            retention->MarkDelivered(entries[i].inode);    // first to go if CS1_TGZ is over budget
+        }
+
+        GetLogCommand::GetInfoBytes(buffer + bytes, entries[i].inode);
+        bytes += GETLOG_INFO_SIZE;
+
+        if (buffer + bytes != entries[i].buffer) {
+            memmove(buffer + bytes, entries[i].buffer, entries[i].bytes);
+        }
+        bytes += entries[i].bytes;
+
+        bytes += GetLogCommand::GetEndBytes(buffer + bytes);
     }
+
     // add END bytes
     bytes += GetLogCommand::GetEndBytes(buffer + bytes);
 
-    // allocate the result buffer
-    result = (char*)malloc(sizeof(char) * (bytes + CMD_RES_HEAD_SIZE));
-    
-    result[0] = GETLOG_CMD;
-    result[1] = get_log_status;
-    if (result) {
-        // Saves the tgz data in th result buffer
-        memcpy(result + CMD_RES_HEAD_SIZE, buffer, bytes);
+    result.Truncate(bytes + head_size);     // the frames were allocated full
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ApplyAcks
+* 
+* PURPOSE : Deletes the acknowledged archives of CS1_TGZ. An archive is only
+*           deleted if it still has the CRC-32 computed by the ground, i.e.
+*           it was received intact and it is still the same file.
+*
+* RETURN : the number of archives deleted, bit i of 'bitmap' is set if
+*          acknowledgement i was applied
+*
+*-----------------------------------------------------------------------------*/
+size_t GetLogCommand::ApplyAcks(char *bitmap)
+{
+    ArchiveIndex* index = ArchiveIndex::GetInstance(CS1_TGZ);
+    char filename[CS1_NAME_MAX] = {'\0'};
+    size_t deleted = 0;
+    unsigned int crc = 0;
+
+    int dir_fd = open(CS1_TGZ, O_RDONLY | O_DIRECTORY);
+
+    if (dir_fd < 0 || !index) {
+        if (dir_fd >= 0) {
+            close(dir_fd);
+        }
+        return 0;
     }
 
-    *pSize = bytes + CMD_RES_HEAD_SIZE;
-    return (void*)result;
+    for (size_t i = 0; i < this->number_of_acks; i++) {
+        if (!index->Lookup(this->acked_inodes[i], filename, CS1_NAME_MAX)) {
+            continue;   // already deleted, the ground will not ack it again
+        }
+
+        int fd = openat(dir_fd, filename, O_RDONLY);
+
+        if (fd < 0) {
+            continue;
+        }
+
+        bool crc_ok = Crc32_File(fd, &crc) && crc == this->acked_crcs[i];
+        close(fd);
+
+        if (!crc_ok) {
+            memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
+            snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, " %s() - CRC mismatch for %s, not deleted", 
+                                                                                __func__, filename);
+            Shakespeare::log(Shakespeare::WARNING, cs1_systems[CS1_COMMANDER], this->log_buffer);
+            continue;
+        }
+
+        if (unlinkat(dir_fd, filename, 0) == 0) {
+            bitmap[i / 8] |= (1 << (i % 8));
+            deleted++;
+        }
+    }
+
+    close(dir_fd);
+
+    return deleted;
 }
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
@@ -187,11 +346,7 @@ size_t GetLogCommand::ReadFile_FromStartToEnd(char *buffer, const char *filename
     bytes = fread(buffer, 1, size, pFile);
 
     if (feof(pFile)) {
-        #ifdef CS1_DEBUG
-	memset(log_buf, 0, CS1_MAX_LOG_ENTRY);
-        snprintf(log_buf,CS1_MAX_LOG_ENTRY, "%s EOF reached \n", __func__);
-	Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], log_buf);
-        #endif
+        CS1_LOG(CS1_LOG_NOTICE, CS1_COMMANDER, "ReadFile_FromStartToEnd EOF reached \n");
     } else {
 	memset(log_buf, 0, CS1_MAX_LOG_ENTRY);
         snprintf(log_buf,CS1_MAX_LOG_ENTRY, " %s:%s:%d - EOF has not been reached, the file will be incomplete", __FILE__, __func__, __LINE__);
@@ -226,31 +381,23 @@ char* GetLogCommand::GetNextFile(void)
     if (OPT_ISNOOPT(this->opt_byte)) 
     { 
         // 1. No Options are specified, retreive the oldest package.
-	memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
-        snprintf(this->log_buffer,CS1_MAX_LOG_ENTRY, " Execute GetLogCommand with OPT_NOOPT : Finding oldest tgz...\n");
-	Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], this->log_buffer);
+        CS1_LOG(CS1_LOG_NOTICE, CS1_COMMANDER, " Execute GetLogCommand with OPT_NOOPT : Finding oldest tgz...\n");
         buf = GetLogCommand::FindOldestFile(CS1_TGZ, NULL);     // Pass NULL to match ANY Sub
     } 
     else if (OPT_ISSUB(this->opt_byte) && !OPT_ISDATE(this->opt_byte)) 
     {
         // 2. The Subsystem is defined, retreive the oldest package that belongs to that subsystem.
-	memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
-        snprintf(this->log_buffer,CS1_MAX_LOG_ENTRY, " Execute GetLogCommand with OPT_SUB : Finding oldest tgz that matches SUB...\n");
-	Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], this->log_buffer);
+        CS1_LOG(CS1_LOG_NOTICE, CS1_COMMANDER, " Execute GetLogCommand with OPT_SUB : Finding oldest tgz that matches SUB...\n");
         buf = GetLogCommand::FindOldestFile(CS1_TGZ, s_cs1_subsystems[(size_t)this->subsystem]);
     } 
     else if (OPT_ISSUB(this->opt_byte) && OPT_ISDATE(this->opt_byte)) 
     {
         // Assuming there is only one file with this SUB and this DATE <- NOT TRUE!
-	memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
-        snprintf(this->log_buffer,CS1_MAX_LOG_ENTRY, " %s():%d OPT_SUB | OPT_DATE\n", __func__, __LINE__);
-	Shakespeare::log(Shakespeare::DEBUG, cs1_systems[CS1_COMMANDER], this->log_buffer);
+        CS1_LOG(CS1_LOG_DEBUG, CS1_COMMANDER, " GetNextFile():%ld OPT_SUB | OPT_DATE\n", (long)__LINE__);
         char pattern[CS1_NAME_MAX];
         strcpy(pattern, s_cs1_subsystems[(size_t)this->subsystem]);
         strcat(pattern, this->date.GetString());
-	memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
-        snprintf(this->log_buffer,CS1_MAX_LOG_ENTRY, " %s():%d OPT_DATE | OPT_DATE : pattern is %s\n", __func__, __LINE__, pattern);
-	Shakespeare::log(Shakespeare::DEBUG, cs1_systems[CS1_COMMANDER], this->log_buffer);
+        CS1_LOG_STRING(CS1_LOG_DEBUG, CS1_COMMANDER, " GetNextFile() OPT_DATE | OPT_DATE : pattern is %s\n", pattern);
 
         buf = GetLogCommand::FindOldestFile(CS1_TGZ, pattern);
     }
@@ -259,7 +406,7 @@ char* GetLogCommand::GetNextFile(void)
         assert(strlen(buf) < CS1_NAME_MAX);
         strcpy(filename, buf);
 
-        free (buf);
+        SessionArena::FreeCurrent(buf);
         buf = 0;
     } else {
         memset(filename, '\0', CS1_NAME_MAX); // if but is null, clear the static char buffer!
@@ -274,17 +421,19 @@ char* GetLogCommand::GetNextFile(void)
 * 
 * PURPOSE : Returns the name of the oldest file present in the specified 
 *           directory and that matches 'pattern' (if not NULL)
-*           N.B. returns a newly allocated char*  FREE IT
+*           N.B. returns a newly allocated char*  FREE IT with
+*           SessionArena::FreeCurrent (it is in the SessionArena if there is one)
 *
 *-----------------------------------------------------------------------------*/
 char* GetLogCommand::FindOldestFile(const char* directory_path, const char* pattern) 
 {
     struct dirent* dir_entry = 0;
     DIR* dir = 0;
+    this->last_found_inode = 0;
     time_t oldest_timeT = INT_MAX - 1;
     time_t current_timeT = 0;
     char buffer[CS1_PATH_MAX] = {'\0'};
-    char* oldest_filename = (char*)malloc(sizeof(char) * CS1_NAME_MAX);
+    char* oldest_filename = (char*)SessionArena::AllocCurrent(sizeof(char) * CS1_NAME_MAX);
 
     if (!oldest_filename) {
         return 0;
@@ -305,6 +454,7 @@ char* GetLogCommand::FindOldestFile(const char* directory_path, const char* patt
 
             if (current_timeT < oldest_timeT) {
                 oldest_timeT = current_timeT;
+                this->last_found_inode = dir_entry->d_ino;
                 strncpy(oldest_filename, dir_entry->d_name, strlen(dir_entry->d_name) + 1);
             }
         }
@@ -327,15 +477,18 @@ char* GetLogCommand::FindOldestFile(const char* directory_path, const char* patt
 *-----------------------------------------------------------------------------*/
 void GetLogCommand::MarkAsProcessed(const char *filepath) 
 {
-    struct stat attr;
-    stat(filepath, &attr);
+    this->MarkAsProcessed(GetLogCommand::GetInoT(filepath));
+}
+
+/* Same as above, when the inode is already known (i.e. from readdir) */
+void GetLogCommand::MarkAsProcessed(unsigned long inode) 
+{
+    if (this->number_of_processed_files >= MAX_NUMBER_OF_FILES_PER_CMD) {
+        return;
+    }
 
-#ifdef CS1_DEBUG
-    memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
-    snprintf(this->log_buffer,CS1_MAX_LOG_ENTRY, " %s() - inode %d\n", __func__, (unsigned int)attr.st_ino);
-    Shakespeare::log(Shakespeare::DEBUG, cs1_systems[CS1_COMMANDER], this->log_buffer);
-#endif
-    this->processed_files[this->number_of_processed_files] = attr.st_ino;
+    CS1_LOG(CS1_LOG_DEBUG, CS1_COMMANDER, " MarkAsProcessed() - inode %lu\n", inode);
+    this->processed_files[this->number_of_processed_files] = inode;
     this->number_of_processed_files++;
 }
 
@@ -350,11 +503,7 @@ bool GetLogCommand::isFileProcessed(unsigned long inode)
 {
     for (size_t i = 0; i < this->number_of_processed_files; i++) {
         if (inode == this->processed_files[i]) {
-#ifdef CS1_DEBUG
-	    memset(this->log_buffer, 0, CS1_MAX_LOG_ENTRY);
-            snprintf(this->log_buffer,CS1_MAX_LOG_ENTRY, " %s() - inode %d\n", __func__, (unsigned int)inode);
-	    Shakespeare::log(Shakespeare::DEBUG, cs1_systems[CS1_COMMANDER], this->log_buffer);
-#endif
+            CS1_LOG(CS1_LOG_DEBUG, CS1_COMMANDER, " isFileProcessed() - inode %lu\n", inode);
             return true;
         }
     }
@@ -416,11 +565,11 @@ bool GetLogCommand::prefixMatches(const char* filename, const char* pattern)
 *-----------------------------------------------------------------------------*/
 char* GetLogCommand::Build_GetLogCommand(char command_buf[GETLOG_CMD_SIZE], char opt_byte, char subsystem, size_t size, time_t date) 
 {
-   command_buf[0] = GETLOG_CMD;
-   command_buf[1] = opt_byte;
-   command_buf[2] = subsystem;
-   SpaceString::get4Char(command_buf + 3, size);
-   SpaceString::get4Char(command_buf + 7, date);
+   GetLogSchema::Init(command_buf);
+   GetLogSchema::Put<GETLOG_FIELD_OPT>(command_buf, opt_byte);
+   GetLogSchema::Put<GETLOG_FIELD_SUBSYSTEM>(command_buf, subsystem);
+   GetLogSchema::Put<GETLOG_FIELD_SIZE>(command_buf, size);
+   GetLogSchema::Put<GETLOG_FIELD_DATE>(command_buf, date);
 
    return command_buf;
 }
@@ -448,6 +597,13 @@ char* GetLogCommand::GetInfoBytes(char *buffer, const char *filepath)
     return buffer;
 }
 
+/* Same as above, when the inode is already known (i.e. from the BatchFileReader) */
+char* GetLogCommand::GetInfoBytes(char *buffer, ino_t inode) 
+{
+    SpaceString::get4Char(buffer, inode);
+    return buffer;
+}
+
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
 * NAME : GetEndBytes
@@ -510,10 +666,62 @@ char* GetLogCommand::GetCmdStr(char* cmd_buf)
                                        this->subsystem,
                                        this->size,
                                        this->date.GetTimeT());
+
+    if (OPT_ISACK(this->opt_byte)) {
+        char *ack = cmd_buf + GETLOG_CMD_SIZE + 1;
+        cmd_buf[GETLOG_CMD_SIZE] = (char)this->number_of_acks;
+
+        for (size_t i = 0; i < this->number_of_acks; i++) {
+            GetLogAckSchema::Put<GETLOG_ACK_FIELD_INODE>(ack, this->acked_inodes[i]);
+            GetLogAckSchema::Put<GETLOG_ACK_FIELD_CRC>(ack, this->acked_crcs[i]);
+            ack += GETLOG_ACK_SIZE;
+        }
+    }
     
     return cmd_buf;
 }
 
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdSize
+* 
+* PURPOSE : Number of bytes written by GetCmdStr
+*
+*-----------------------------------------------------------------------------*/
+size_t GetLogCommand::GetCmdSize()
+{
+    if (OPT_ISACK(this->opt_byte)) {
+        return GETLOG_CMD_SIZE_WITH_ACKS(this->number_of_acks);
+    }
+
+    return GETLOG_CMD_SIZE;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : AddAck
+* 
+* PURPOSE : Acknowledges the archive 'inode', received with the CRC-32 'crc'.
+*           Sets OPT_ACK, the satellite will delete the archive when it
+*           executes the command. Meant to be used by the GroundCommander.
+*
+* RETURN : false if GETLOG_MAX_ACKS acknowledgements were already added
+*
+*-----------------------------------------------------------------------------*/
+bool GetLogCommand::AddAck(ino_t inode, unsigned int crc)
+{
+    if (this->number_of_acks >= GETLOG_MAX_ACKS) {
+        return false;
+    }
+
+    this->acked_inodes[this->number_of_acks] = inode;
+    this->acked_crcs[this->number_of_acks] = crc;
+    this->number_of_acks++;
+    this->opt_byte |= OPT_ACK;
+
+    return true;
+}
+
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
 * NAME : ParseResult                                                        TODO UnitTest me
@@ -532,13 +740,23 @@ InfoBytes* GetLogCommand::ParseResult(char *result, const char *filename)
     static struct GetLogInfoBytes info_bytes;
     FILE* pFile = 0;
 
-    if (!result || result[CMD_ID] != GETLOG_CMD) {
+    if (!WireResultHead<GETLOG_CMD>::Check(result)) {
         Shakespeare::log(Shakespeare::ERROR,cs1_systems[CS1_COMMANDER],"GetLog failure: Can't parse result");
         info_bytes.getlog_status = CS1_FAILURE;
         return &info_bytes;
     }
 
-    info_bytes.getlog_status = result[CMD_STS];
+    info_bytes.getlog_status = WireResultHead<GETLOG_CMD>::Get<CMD_STS>(result);
+    info_bytes.number_of_acks = 0;
+    memset(info_bytes.ack_bitmap, 0, GETLOG_ACK_BITMAP_SIZE);
+
+    if (OPT_ISACK(this->opt_byte)) 
+    {
+        info_bytes.number_of_acks = (unsigned char)result[CMD_RES_HEAD_SIZE];
+        memcpy(info_bytes.ack_bitmap, result + CMD_RES_HEAD_SIZE + 1, GETLOG_ACK_BITMAP_SIZE);
+        result += GETLOG_ACK_RTN_SIZE;
+    }
+
     if (info_bytes.getlog_status == CS1_SUCCESS)
     {
         result += CMD_RES_HEAD_SIZE;
@@ -12,30 +12,46 @@
 #include "shakespeare.h"
 #include "common/gettime-command.h"
 #include "common/commands.h"
+#include "common/command-registry.h"
+#include "common/rtc-writer.h"
+
+static CommandRegistrar<GetTimeCommand> registrar(GETTIME_CMD, GETTIME_CMD_SIZE);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*
+*-----------------------------------------------------------------------------*/
+ICommand* GetTimeCommand::Create(char* data, size_t length, void* storage) {
+    GetTimeCommand* result = ConstructCommand<GetTimeCommand>(storage);
+
+    return result;
+}
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
  *
  * NAME : Execute
  *
- * ARGUMENTS : pSize - OUT size of the returned buffer
- *
- * RETURNS : char* dynamically allocated
+ * ARGUMENTS : result - OUT [GETTIME_CMD][STS][time_t]
  * 
  *-----------------------------------------------------------------------------*/
-void* GetTimeCommand::Execute(size_t * pSize){
+void GetTimeCommand::Execute(ResultBuffer& result){
     struct timeval tv;
-    char* result; 
-    result = (char*)malloc(sizeof(char) * GETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE);
-    *pSize = GETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE;
+    char* data = result.Alloc(sizeof(char) * GETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE);
+    if (!data) {
+        return;
+    }
     
-    result[0] = GETTIME_CMD;
-    result[1] = CS1_SUCCESS;
+    GetTimeResultSchema::Init(data);
+    GetTimeResultSchema::Put<CMD_STS>(data, CS1_SUCCESS);
+    GetTimeResultSchema::Put<GETTIME_FIELD_RTC_STATUS>(data, RtcWriter::GetStatus());
     if(gettimeofday(&tv, 0) == -1){
-        result[1] = CS1_FAILURE;
-        return (void*)result;
+        GetTimeResultSchema::Put<CMD_STS>(data, CS1_FAILURE);
+        return;
     }
-    memcpy(result+CMD_RES_HEAD_SIZE, &tv.tv_sec, sizeof(time_t));
-    return (void*)result;
+    GetTimeResultSchema::Put<GETTIME_FIELD_TIME>(data, tv.tv_sec);
 }
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -52,14 +68,15 @@ void* GetTimeCommand::Execute(size_t * pSize){
 InfoBytes* GetTimeCommand::ParseResult(char *result) {
     static struct InfoBytesGetTime info_bytes;
 
-    if (!result || result[0] != GETTIME_CMD) {
+    if (!GetTimeResultSchema::Check(result)) {
         Shakespeare::log(Shakespeare::ERROR,cs1_systems[CS1_COMMANDER],"GetTime failure: Can't parse result");
         info_bytes.time_status = CS1_FAILURE;
         return &info_bytes;
     }
 
-    info_bytes.time_status = result[1];
-    info_bytes.time_set = SpaceString::getTimet(result+CMD_RES_HEAD_SIZE);
+    info_bytes.time_status = GetTimeResultSchema::Get<CMD_STS>(result);
+    info_bytes.time_set = GetTimeResultSchema::Get<GETTIME_FIELD_TIME>(result);
+    info_bytes.rtc_status = GetTimeResultSchema::Get<GETTIME_FIELD_RTC_STATUS>(result);
 
     char buffer[100];
     struct tm *time_info = localtime(&info_bytes.time_set); 
@@ -74,6 +91,10 @@ InfoBytes* GetTimeCommand::ParseResult(char *result) {
                     time_info->tm_min,
                     time_info->tm_sec);
         Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], buffer);    
+
+        if (info_bytes.rtc_status == RTC_STATUS_FAILED) {
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "GetTime: the last RTC write failed");
+        }
     } else {
         snprintf(buffer,100,"GetTime failure: Unknown");
         Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], buffer);
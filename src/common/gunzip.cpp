@@ -0,0 +1,573 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : gunzip.cpp
+*
+* DESCRIPTION : see gunzip.h. The decoding of the Huffman codes follows puff.c
+*               (zlib license, Copyright 2002-2013 Mark Adler) : canonical
+*               codes decoded a bit at a time, small tables and no allocation.
+*
+*----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "common/crc32.h"
+#include "common/gunzip.h"
+
+#define GUNZIP_MAX_BITS 15
+#define GUNZIP_MAX_LENGTH_CODES 286
+#define GUNZIP_MAX_DISTANCE_CODES 30
+#define GUNZIP_FIXED_LENGTH_CODES 288
+
+#define GZIP_ID1 0x1f
+#define GZIP_ID2 0x8b
+#define GZIP_DEFLATE 8
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+static const short LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const short LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const short DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const short DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const short CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : NextByte
+*
+* RETURN : the next compressed byte, -1 at the end of the input
+*
+*-----------------------------------------------------------------------------*/
+static int NextByte(Gunzip *state)
+{
+    if (state->in_length == 0) {
+        ssize_t n = state->read(state->context, &state->in);
+
+        if (n <= 0) {
+            state->in_error = (n < 0);
+            return -1;
+        }
+
+        state->in_length = n;
+    }
+
+    state->in_length--;
+    return *state->in++;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Bits
+*
+* RETURN : the next 'need' bits (at most 16), least significant first, -1 at
+*          the end of the input
+*
+*-----------------------------------------------------------------------------*/
+static int Bits(Gunzip *state, int need)
+{
+    while (state->bit_count < need) {
+        int byte = NextByte(state);
+
+        if (byte < 0) {
+            return -1;
+        }
+
+        state->bits |= (unsigned int)byte << state->bit_count;
+        state->bit_count += 8;
+    }
+
+    int value = state->bits & ((1U << need) - 1);
+    state->bits >>= need;
+    state->bit_count -= need;
+
+    return value;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Flush / Put
+*
+* PURPOSE : The window is written out when it is full, and at the end of a
+*           member
+*
+*-----------------------------------------------------------------------------*/
+static void Flush(Gunzip *state)
+{
+    if (state->window_pos == 0) {
+        return;
+    }
+
+    state->out_crc = Crc32(state->window, state->window_pos, state->out_crc);
+    state->out_size += state->window_pos;
+
+    if (!state->out_error && !state->write(state->context, state->window, state->window_pos)) {
+        state->out_error = true;
+    }
+
+    if (state->window_pos == GUNZIP_WINDOW_SIZE) {
+        state->out_full = true;
+    }
+
+    state->window_pos = 0;
+}
+
+static inline void Put(Gunzip *state, unsigned char byte)
+{
+    state->window[state->window_pos++] = byte;
+
+    if (state->window_pos == GUNZIP_WINDOW_SIZE) {
+        Flush(state);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Construct
+*
+* PURPOSE : Builds the canonical code of the 'n' code lengths
+*
+* RETURN : 0 if the code is complete, > 0 if incomplete, < 0 if it has too
+*          many codes of a length
+*
+*-----------------------------------------------------------------------------*/
+static int Construct(GunzipHuffman *h, const short *length, int n)
+{
+    short offsets[GUNZIP_MAX_BITS + 1];
+    int left = 1;
+
+    memset(h->count, 0, sizeof(h->count));
+
+    for (int symbol = 0; symbol < n; symbol++) {
+        h->count[length[symbol]]++;
+    }
+
+    if (h->count[0] == n) {
+        return 0;
+    }
+
+    for (int len = 1; len <= GUNZIP_MAX_BITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+
+        if (left < 0) {
+            return left;
+        }
+    }
+
+    offsets[1] = 0;
+    for (int len = 1; len < GUNZIP_MAX_BITS; len++) {
+        offsets[len + 1] = offsets[len] + h->count[len];
+    }
+
+    for (int symbol = 0; symbol < n; symbol++) {
+        if (length[symbol] != 0) {
+            h->symbol[offsets[length[symbol]]++] = symbol;
+        }
+    }
+
+    return left;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Decode
+*
+* RETURN : the next symbol of the code 'h', -1 at the end of the input, -2 if
+*          the bits are not a code
+*
+*-----------------------------------------------------------------------------*/
+static int Decode(Gunzip *state, const GunzipHuffman *h)
+{
+    int code = 0, first = 0, index = 0;
+
+    for (int len = 1; len <= GUNZIP_MAX_BITS; len++) {
+        int bit = Bits(state, 1);
+
+        if (bit < 0) {
+            return -1;
+        }
+
+        code |= bit;
+        int count = h->count[len];
+
+        if (code - count < first) {
+            return h->symbol[index + (code - first)];
+        }
+
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    return -2;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Codes
+*
+* PURPOSE : Decodes the literals and the (length, distance) pairs of a block
+*           until its end
+*
+*-----------------------------------------------------------------------------*/
+static int Codes(Gunzip *state)
+{
+    for (;;) {
+        int symbol = Decode(state, &state->length_codes);
+
+        if (symbol < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        if (symbol < 256) {
+            Put(state, (unsigned char)symbol);
+            continue;
+        }
+
+        if (symbol == 256) {
+            return GUNZIP_OK;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        int extra = Bits(state, LENGTH_EXTRA[symbol]);
+        int length = LENGTH_BASE[symbol] + extra;
+
+        symbol = Decode(state, &state->distance_codes);
+        if (extra < 0 || symbol < 0 || symbol >= 30) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        extra = Bits(state, DISTANCE_EXTRA[symbol]);
+        size_t distance = DISTANCE_BASE[symbol] + extra;
+
+        if (extra < 0 || (!state->out_full && distance > state->window_pos)) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        while (length-- > 0) {
+            Put(state, state->window[(state->window_pos - distance) & (GUNZIP_WINDOW_SIZE - 1)]);
+        }
+    }
+}
+
+static int Stored(Gunzip *state)
+{
+    int bytes[4];
+
+    state->bits = 0;
+    state->bit_count = 0;
+
+    for (int i = 0; i < 4; i++) {
+        if ((bytes[i] = NextByte(state)) < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+    }
+
+    unsigned int length = bytes[0] | (bytes[1] << 8);
+
+    if (length != (~(bytes[2] | (bytes[3] << 8)) & 0xffff)) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    while (length-- > 0) {
+        int byte = NextByte(state);
+
+        if (byte < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        Put(state, (unsigned char)byte);
+    }
+
+    return GUNZIP_OK;
+}
+
+static int Fixed(Gunzip *state)
+{
+    short lengths[GUNZIP_FIXED_LENGTH_CODES];
+    int symbol = 0;
+
+    for (; symbol < 144; symbol++) {
+        lengths[symbol] = 8;
+    }
+    for (; symbol < 256; symbol++) {
+        lengths[symbol] = 9;
+    }
+    for (; symbol < 280; symbol++) {
+        lengths[symbol] = 7;
+    }
+    for (; symbol < GUNZIP_FIXED_LENGTH_CODES; symbol++) {
+        lengths[symbol] = 8;
+    }
+    Construct(&state->length_codes, lengths, GUNZIP_FIXED_LENGTH_CODES);
+
+    for (symbol = 0; symbol < GUNZIP_MAX_DISTANCE_CODES; symbol++) {
+        lengths[symbol] = 5;
+    }
+    Construct(&state->distance_codes, lengths, GUNZIP_MAX_DISTANCE_CODES);
+
+    return Codes(state);
+}
+
+static int Dynamic(Gunzip *state)
+{
+    short lengths[GUNZIP_MAX_LENGTH_CODES + GUNZIP_MAX_DISTANCE_CODES];
+    int nlen = Bits(state, 5) + 257;
+    int ndist = Bits(state, 5) + 1;
+    int ncode = Bits(state, 4) + 4;
+    int index = 0;
+
+    if (nlen < 257 || nlen > GUNZIP_MAX_LENGTH_CODES || ndist < 1 || ndist > GUNZIP_MAX_DISTANCE_CODES || ncode < 4) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    // 1. the code of the code lengths
+    for (; index < ncode; index++) {
+        if ((lengths[CODE_LENGTH_ORDER[index]] = Bits(state, 3)) < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+    }
+    for (; index < 19; index++) {
+        lengths[CODE_LENGTH_ORDER[index]] = 0;
+    }
+
+    if (Construct(&state->length_codes, lengths, 19) != 0) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    // 2. the code lengths of the literal/length and distance codes
+    for (index = 0; index < nlen + ndist; ) {
+        int symbol = Decode(state, &state->length_codes);
+        int repeat = 0, extra = 0;
+        short length = 0;
+
+        if (symbol < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        if (symbol < 16) {
+            lengths[index++] = symbol;
+            continue;
+        }
+
+        if (symbol == 16) {
+            if (index == 0) {
+                return GUNZIP_BAD_DATA;
+            }
+            length = lengths[index - 1];
+            extra = Bits(state, 2);
+            repeat = 3 + extra;
+        } else if (symbol == 17) {
+            extra = Bits(state, 3);
+            repeat = 3 + extra;
+        } else {
+            extra = Bits(state, 7);
+            repeat = 11 + extra;
+        }
+
+        if (extra < 0 || index + repeat > nlen + ndist) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        while (repeat-- > 0) {
+            lengths[index++] = length;
+        }
+    }
+
+    if (lengths[256] == 0) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    // an incomplete code only if it has a single symbol
+    int error = Construct(&state->length_codes, lengths, nlen);
+    if (error < 0 || (error > 0 && nlen - state->length_codes.count[0] != 1)) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    error = Construct(&state->distance_codes, lengths + nlen, ndist);
+    if (error < 0 || (error > 0 && ndist - state->distance_codes.count[0] != 1)) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    return Codes(state);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Header
+*
+* PURPOSE : Skips the gzip header of a member, 'first' is its first byte
+*
+*-----------------------------------------------------------------------------*/
+static int Header(Gunzip *state, int first)
+{
+    int bytes[10];
+
+    bytes[0] = first;
+    for (int i = 1; i < 10; i++) {
+        if ((bytes[i] = NextByte(state)) < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+    }
+
+    if (bytes[0] != GZIP_ID1 || bytes[1] != GZIP_ID2 || bytes[2] != GZIP_DEFLATE) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    int flags = bytes[3];
+
+    if (flags & GZIP_FEXTRA) {
+        int low = NextByte(state);
+        int high = NextByte(state);
+
+        if (low < 0 || high < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        for (int length = low | (high << 8); length > 0; length--) {
+            if (NextByte(state) < 0) {
+                return GUNZIP_BAD_DATA;
+            }
+        }
+    }
+
+    // the name and the comment end with a '\0'
+    for (int field = GZIP_FNAME; field <= GZIP_FCOMMENT; field <<= 1) {
+        if (flags & field) {
+            int byte = 0;
+
+            while ((byte = NextByte(state)) > 0) {
+            }
+
+            if (byte < 0) {
+                return GUNZIP_BAD_DATA;
+            }
+        }
+    }
+
+    if ((flags & GZIP_FHCRC) && (NextByte(state) < 0 || NextByte(state) < 0)) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    return GUNZIP_OK;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Member
+*
+* PURPOSE : Decompresses a member : the deflate blocks, then the CRC-32 and
+*           the size of the trailer are checked
+*
+*-----------------------------------------------------------------------------*/
+static int Member(Gunzip *state, int first)
+{
+    int error = Header(state, first);
+    int last = 0;
+
+    state->bits = 0;
+    state->bit_count = 0;
+    state->window_pos = 0;
+    state->out_crc = 0;
+    state->out_size = 0;
+    state->out_full = false;
+
+    while (error == GUNZIP_OK && last == 0) {
+        last = Bits(state, 1);
+        int type = Bits(state, 2);
+
+        if (last < 0 || type < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        switch (type) {
+            case 0  : error = Stored(state);    break;
+            case 1  : error = Fixed(state);     break;
+            case 2  : error = Dynamic(state);   break;
+            default : error = GUNZIP_BAD_DATA;  break;
+        }
+
+        if (state->out_error) {
+            return GUNZIP_IO_ERROR;
+        }
+    }
+
+    if (error != GUNZIP_OK) {
+        return error;
+    }
+
+    Flush(state);
+
+    if (state->out_error) {
+        return GUNZIP_IO_ERROR;
+    }
+
+    // the trailer starts on a byte boundary
+    unsigned int trailer[2] = {0, 0};
+    for (int i = 0; i < 8; i++) {
+        int byte = NextByte(state);
+
+        if (byte < 0) {
+            return GUNZIP_BAD_DATA;
+        }
+
+        trailer[i / 4] |= (unsigned int)byte << (8 * (i % 4));
+    }
+
+    if (trailer[0] != state->out_crc || trailer[1] != state->out_size) {
+        return GUNZIP_BAD_DATA;
+    }
+
+    return GUNZIP_OK;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Gunzip_Run
+*
+* PURPOSE : Decompresses the members of the gzip stream, see gunzip.h
+*
+* RETURN : GUNZIP_OK, GUNZIP_IO_ERROR or GUNZIP_BAD_DATA
+*
+*-----------------------------------------------------------------------------*/
+int Gunzip_Run(Gunzip *state, GunzipRead read, GunzipWrite write, void *context)
+{
+    int error = GUNZIP_OK;
+    int first = 0;
+
+    state->read = read;
+    state->write = write;
+    state->context = context;
+    state->in = 0;
+    state->in_length = 0;
+    state->in_error = false;
+    state->out_error = false;
+
+    if ((first = NextByte(state)) < 0) {
+        return state->in_error ? GUNZIP_IO_ERROR : GUNZIP_BAD_DATA;
+    }
+
+    do {
+        error = Member(state, first);
+    } while (error == GUNZIP_OK && (first = NextByte(state)) >= 0);
+
+    if (state->in_error) {
+        return GUNZIP_IO_ERROR;
+    }
+
+    return error;
+}
@@ -0,0 +1,200 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : lzss.cpp
+*
+* DESCRIPTION : see lzss.h
+*
+*----------------------------------------------------------------------------*/
+#include <string.h>
+#include <vector>
+
+#include "common/lzss.h"
+
+#define LZSS_HASH_SIZE 4096
+#define LZSS_MAX_CHAIN 256          // candidates tried per position (ground only)
+
+static inline size_t Hash(const unsigned char *p)
+{
+    return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & (LZSS_HASH_SIZE - 1);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Lzss_Compress
+*
+* PURPOSE : Compresses as much of 'in' as fits in 'out_size' bytes, the
+*           matches may reach into the last LZSS_WINDOW_SIZE bytes of 'dict'
+*
+* RETURN : the number of bytes written to 'out'. 'consumed' is the number of
+*          bytes of 'in' compressed, 'dict_used' how far back in 'dict' the
+*          matches reach (0 if none).
+*
+*-----------------------------------------------------------------------------*/
+size_t Lzss_Compress(const unsigned char *dict, size_t dict_size, const unsigned char *in, size_t in_size,
+                     unsigned char *out, size_t out_size, size_t *consumed, size_t *dict_used)
+{
+    // the tail of the dictionary and the input, as a single buffer
+    size_t start = (dict_size > LZSS_WINDOW_SIZE) ? dict_size - LZSS_WINDOW_SIZE : 0;
+    size_t base = dict_size - start;
+    std::vector<unsigned char> buffer(base + in_size);
+    std::vector<long> head(LZSS_HASH_SIZE, -1);
+    std::vector<long> chain(base + in_size, -1);
+    size_t pos = 0, written = 0, flags = 0;
+    int item = 8;
+
+    if (base > 0) {
+        memcpy(&buffer[0], dict + start, base);
+    }
+    if (in_size > 0) {
+        memcpy(&buffer[base], in, in_size);
+    }
+
+    *dict_used = 0;
+
+    for (; pos + LZSS_MIN_MATCH <= base; pos++) {
+        size_t h = Hash(&buffer[pos]);
+        chain[pos] = head[h];
+        head[h] = pos;
+    }
+
+    pos = base;
+
+    while (pos < buffer.size()) {
+        size_t best_length = 0, best_offset = 0;
+
+        if (item == 8) {
+            if (written + 1 > out_size) {
+                break;
+            }
+            flags = written++;
+            out[flags] = 0;
+            item = 0;
+        }
+
+        if (pos + LZSS_MIN_MATCH <= buffer.size()) {
+            size_t max = buffer.size() - pos;
+            int tries = LZSS_MAX_CHAIN;
+
+            if (max > LZSS_MAX_MATCH) {
+                max = LZSS_MAX_MATCH;
+            }
+
+            for (long candidate = head[Hash(&buffer[pos])]; candidate >= 0 && tries-- > 0;
+                                                            candidate = chain[candidate]) {
+                if (pos - candidate > LZSS_WINDOW_SIZE) {
+                    break;
+                }
+
+                size_t length = 0;
+                while (length < max && buffer[candidate + length] == buffer[pos + length]) {
+                    length++;
+                }
+
+                if (length > best_length) {
+                    best_length = length;
+                    best_offset = pos - candidate;
+
+                    if (length == max) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        size_t step = 1;
+
+        if (best_length >= LZSS_MIN_MATCH) {
+            if (written + 2 > out_size) {
+                break;
+            }
+
+            out[written++] = (best_offset - 1) & 0xff;
+            out[written++] = (((best_offset - 1) >> 8) << 4) | (best_length - LZSS_MIN_MATCH);
+            out[flags] |= 1 << item;
+            step = best_length;
+
+            if (best_offset > pos - base && best_offset - (pos - base) > *dict_used) {
+                *dict_used = best_offset - (pos - base);
+            }
+        } else {
+            if (written + 1 > out_size) {
+                break;
+            }
+
+            out[written++] = buffer[pos];
+        }
+
+        item++;
+
+        for (size_t end = pos + step; pos < end; pos++) {
+            if (pos + LZSS_MIN_MATCH <= buffer.size()) {
+                size_t h = Hash(&buffer[pos]);
+                chain[pos] = head[h];
+                head[h] = pos;
+            }
+        }
+    }
+
+    // a flags byte without items
+    if (item == 0) {
+        written--;
+    }
+
+    *consumed = pos - base;
+    return written;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Lzss_Decompress
+*
+* PURPOSE : Decompresses 'in' into exactly 'out_size' bytes
+*
+* RETURN : false if 'in' is corrupt, too short, or reaches before 'dict'
+*
+*-----------------------------------------------------------------------------*/
+bool Lzss_Decompress(const unsigned char *dict, size_t dict_size, const unsigned char *in, size_t in_size,
+                     unsigned char *out, size_t out_size)
+{
+    size_t read = 0, written = 0;
+    unsigned int flags = 0;
+    int item = 8;
+
+    while (written < out_size) {
+        if (item == 8) {
+            if (read >= in_size) {
+                return false;
+            }
+            flags = in[read++];
+            item = 0;
+        }
+
+        if (!(flags & (1 << item++))) {
+            if (read >= in_size) {
+                return false;
+            }
+            out[written++] = in[read++];
+            continue;
+        }
+
+        if (read + 2 > in_size) {
+            return false;
+        }
+
+        size_t offset = (in[read] | ((in[read + 1] >> 4) << 8)) + 1;
+        size_t length = (in[read + 1] & 0x0f) + LZSS_MIN_MATCH;
+        read += 2;
+
+        if (offset > written + dict_size || length > out_size - written) {
+            return false;
+        }
+
+        for (; length > 0; length--, written++) {
+            out[written] = (offset <= written) ? out[written - offset] : dict[dict_size - (offset - written)];
+        }
+    }
+
+    return read == in_size;
+}
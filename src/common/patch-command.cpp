@@ -0,0 +1,203 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common/patch-command.h"
+#include "common/commands.h"
+#include "common/subsystems.h"
+#include "common/command-registry.h"
+#include "shakespeare.h"
+#include "SpaceDecl.h"
+
+static CommandRegistrar<PatchCommand> registrar(PATCH_CMD, PATCH_CMD_MIN_SIZE);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*           (see patch-command.h)
+*
+*-----------------------------------------------------------------------------*/
+ICommand* PatchCommand::Create(char* data, size_t length, void* storage)
+{
+    size_t offset = PatchSchema::SIZE;
+    WireView target(data + offset, (unsigned char)PatchSchema::Get<PATCH_FIELD_TARGET_LENGTH>(data));
+
+    offset += target.length;
+
+    if (!Wire::Fits(offset, 1, length) || !Wire::Fits(offset + 1, (unsigned char)data[offset], length)) {
+        return 0;
+    }
+
+    WireView patch(data + offset + 1, (unsigned char)data[offset]);
+
+    return ConstructCommand<PatchCommand>(storage, target, patch);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Build_PatchCommand
+*
+* PURPOSE : Builds a PatchCommand into 'cmd_buf'
+*
+* RETURN : the number of bytes written, 0 if a path is too long
+*
+*-----------------------------------------------------------------------------*/
+size_t PatchCommand::Build_PatchCommand(char* cmd_buf, WireView target, WireView patch)
+{
+    size_t offset = PatchSchema::SIZE;
+
+    if (target.length > PATCH_MAX_PATH_LENGTH || patch.length > PATCH_MAX_PATH_LENGTH) {
+        return 0;
+    }
+
+    PatchSchema::Init(cmd_buf);
+    PatchSchema::Put<PATCH_FIELD_TARGET_LENGTH>(cmd_buf, (char)target.length);
+    memcpy(cmd_buf + offset, target.data, target.length);
+    offset += target.length;
+
+    cmd_buf[offset++] = (char)patch.length;
+    memcpy(cmd_buf + offset, patch.data, patch.length);
+
+    return offset + patch.length;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdStr / GetCmdSize
+*
+* PURPOSE : Same as above, with the members of the command
+*
+*-----------------------------------------------------------------------------*/
+char* PatchCommand::GetCmdStr(char* cmd_buf)
+{
+    return PatchCommand::Build_PatchCommand(cmd_buf, this->target, this->patch) ? cmd_buf : 0;
+}
+
+size_t PatchCommand::GetCmdSize()
+{
+    return PatchSchema::SIZE + this->target.length + 1 + this->patch.length;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Apply
+*
+* PURPOSE : Patches 'target' into 'target.new' and renames it to 'target'
+*
+* RETURN : DELTA_OK or the error (see delta-patch.h)
+*
+*-----------------------------------------------------------------------------*/
+int PatchCommand::Apply(const char* target, const char* patch, unsigned int* crc)
+{
+    char new_path[CS1_PATH_MAX] = {'\0'};
+    DeltaPatchHead head = {0, 0, 0, 0};
+    struct stat target_stat;
+    int error = DELTA_IO_ERROR;
+
+    if (snprintf(new_path, CS1_PATH_MAX, "%s%s", target, PATCH_NEW_EXT) >= CS1_PATH_MAX) {
+        return DELTA_IO_ERROR;
+    }
+
+    int target_fd = open(target, O_RDONLY);
+    int patch_fd = open(patch, O_RDONLY);
+    int new_fd = open(new_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (target_fd != -1 && patch_fd != -1 && new_fd != -1 && fstat(target_fd, &target_stat) == 0) {
+        error = DeltaPatch_Apply(target_fd, patch_fd, new_fd, &head);
+
+        if (error == DELTA_OK && (fchmod(new_fd, target_stat.st_mode & 07777) != 0 || fsync(new_fd) != 0)) {
+            error = DELTA_IO_ERROR;
+        }
+    }
+
+    if (target_fd != -1) {
+        close(target_fd);
+    }
+
+    if (patch_fd != -1) {
+        close(patch_fd);
+    }
+
+    if (new_fd != -1) {
+        close(new_fd);
+    }
+
+    if (error == DELTA_OK && rename(new_path, target) != 0) {
+        error = DELTA_IO_ERROR;
+    }
+
+    if (error != DELTA_OK) {
+        remove(new_path);
+    }
+
+    *crc = head.new_crc;
+    return error;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+*
+* RESULT : [PATCH_CMD][STS][error][crc]
+*
+*-----------------------------------------------------------------------------*/
+void PatchCommand::Execute(ResultBuffer& result)
+{
+    char target[CS1_PATH_MAX] = {'\0'};
+    char patch[CS1_PATH_MAX] = {'\0'};
+    unsigned int crc = 0;
+    int error = DELTA_IO_ERROR;
+
+    if (this->target.CopyTo(target, CS1_PATH_MAX) && this->patch.CopyTo(patch, CS1_PATH_MAX)) {
+        error = this->Apply(target, patch, &crc);
+    }
+
+    if (error == DELTA_OK) {
+        remove(patch);
+        snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Patch success: %s, crc %08x", target, crc);
+        Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], this->log_buffer);
+    } else {
+        snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Patch failure: %s, error %d", target, error);
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], this->log_buffer);
+    }
+
+    char* data = result.Alloc(PatchResultSchema::SIZE);
+    if (data) {
+        PatchResultSchema::Init(data);
+        PatchResultSchema::Put<CMD_STS>(data, (error == DELTA_OK) ? CS1_SUCCESS : CS1_FAILURE);
+        PatchResultSchema::Put<PATCH_RES_FIELD_ERROR>(data, (char)error);
+        PatchResultSchema::Put<PATCH_RES_FIELD_CRC>(data, crc);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ParseResult
+*
+*-----------------------------------------------------------------------------*/
+InfoBytes* PatchCommand::ParseResult(char* result)
+{
+    static InfoBytesPatch info_bytes;
+
+    if (!PatchResultSchema::Check(result)) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Patch failure: Can't parse result");
+        info_bytes.patch_status = CS1_FAILURE;
+        info_bytes.error = DELTA_IO_ERROR;
+        info_bytes.crc = 0;
+        return &info_bytes;
+    }
+
+    info_bytes.patch_status = PatchResultSchema::Get<CMD_STS>(result);
+    info_bytes.error = PatchResultSchema::Get<PATCH_RES_FIELD_ERROR>(result);
+    info_bytes.crc = PatchResultSchema::Get<PATCH_RES_FIELD_CRC>(result);
+
+    snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Patch %s: error %d, crc %08x",
+                    (info_bytes.patch_status == CS1_SUCCESS) ? "success" : "failure", info_bytes.error, info_bytes.crc);
+    Shakespeare::log(info_bytes.patch_status == CS1_SUCCESS ? Shakespeare::NOTICE : Shakespeare::ERROR,
+                                                    cs1_systems[CS1_COMMANDER], this->log_buffer);
+
+    return &info_bytes;
+}
@@ -7,24 +7,45 @@
 #include "shakespeare.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include "common/async-log.h"
+#include "common/command-registry.h"
+#include "common/rtc-writer.h"
 extern const char* s_cs1_subsystems[];
 
+static CommandRegistrar<RebootCommand> registrar(REBOOT_CMD, CMD_HEAD_SIZE);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*
+*-----------------------------------------------------------------------------*/
+ICommand* RebootCommand::Create(char* data, size_t length, void* storage){
+    RebootCommand* result = ConstructCommand<RebootCommand>(storage);
+
+    return result;
+}
+
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
 * NAME : Execute
 *
 * PURPOSE : Reboots the device
 *
-* RETURNS : A buffer contaning the cmd number and cmd status
+* RESULT : A buffer contaning the cmd number and cmd status
 * 
 *-----------------------------------------------------------------------------*/
-void* RebootCommand::Execute(size_t* pSize){
-    char* result = (char*)malloc(sizeof(char) * CMD_RES_HEAD_SIZE);
-    *pSize = CMD_RES_HEAD_SIZE; 
+void RebootCommand::Execute(ResultBuffer& result){
+    char* data = result.Alloc(sizeof(char) * CMD_RES_HEAD_SIZE);
+    if (!data) {
+        return;
+    }
+    RtcWriter::Flush(RTC_FLUSH_TIMEOUT_MS);     // a SetTime just before
+    AsyncLog::Flush(ASYNC_LOG_FLUSH_TIMEOUT_MS);
     reboot(CMD_RES_HEAD_SIZE);
-    result[0] = REBOOT_CMD;
-    result[1] = CS1_SUCCESS;
-    return result;
+    data[0] = REBOOT_CMD;
+    data[1] = CS1_SUCCESS;
 }
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
@@ -40,12 +61,12 @@ void* RebootCommand::Execute(size_t* pSize){
 InfoBytes* RebootCommand::ParseResult(char* result)
 {
     static struct InfoBytesReboot info_bytes;
-    if (!result || result[0] != REBOOT_CMD ){
+    if (!WireResultHead<REBOOT_CMD>::Check(result)){
         Shakespeare::log(Shakespeare::ERROR,cs1_systems[CS1_COMMANDER],"Reboot failure: Can't parse result");
         info_bytes.reboot_status = CS1_FAILURE;
         return &info_bytes;
     }
-    info_bytes.reboot_status = result[1];
+    info_bytes.reboot_status = WireResultHead<REBOOT_CMD>::Get<CMD_STS>(result);
     char buffer[60];
     
     if(info_bytes.reboot_status == CS1_SUCCESS)
@@ -0,0 +1,477 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : result-buffer.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>      // splice
+#include <poll.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "common/result-buffer.h"
+#include "common/session-arena.h"
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : wait_writable
+*
+* PURPOSE : Waits until the non-blocking 'fd' (the data pipe) can be written
+*
+*-----------------------------------------------------------------------------*/
+static bool wait_writable(int fd)
+{
+    struct pollfd fds;
+    fds.fd = fd;
+    fds.events = POLLOUT;
+
+    return poll(&fds, 1, RESULT_WRITE_TIMEOUT) > 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : write_vector
+*
+* PURPOSE : writev of the whole 'iov', whatever the partial writes
+*
+*-----------------------------------------------------------------------------*/
+static bool write_vector(int fd, struct iovec *iov, int count)
+{
+    while (count > 0) {
+        ssize_t bytes = writev(fd, iov, count);
+
+        if (bytes < 0) {
+            if (errno == EINTR || (errno == EAGAIN && wait_writable(fd))) {
+                continue;
+            }
+
+            return false;
+        }
+
+        // skip what has been written
+        while (count > 0 && (size_t)bytes >= iov->iov_len) {
+            bytes -= iov->iov_len;
+            iov++;
+            count--;
+        }
+
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + bytes;
+            iov->iov_len -= bytes;
+        }
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : send_file
+*
+* PURPOSE : Sends a file segment. splice moves the pages straight from the
+*           page cache to the pipe, if 'fd' is not a pipe (or splice is not
+*           supported) the segment is copied with pread + write.
+*
+*-----------------------------------------------------------------------------*/
+static bool send_file(int fd, const ResultSegment &segment)
+{
+    loff_t offset = segment.offset;
+    size_t left = segment.length;
+
+    while (left > 0) {
+        ssize_t bytes = splice(segment.fd, &offset, fd, 0, left, SPLICE_F_MOVE);
+
+        if (bytes > 0) {
+            left -= bytes;
+        } else if (bytes < 0 && (errno == EINTR || (errno == EAGAIN && wait_writable(fd)))) {
+            continue;
+        } else if (bytes < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            break;      // copy the rest
+        } else {
+            return false;   // error, or the file is shorter than the segment
+        }
+    }
+
+    char buffer[RESULT_COPY_SIZE];
+
+    while (left > 0) {
+        ssize_t bytes = pread(segment.fd, buffer, left < RESULT_COPY_SIZE ? left : RESULT_COPY_SIZE, offset);
+
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytes <= 0) {
+            return false;
+        }
+
+        struct iovec iov = { buffer, (size_t)bytes };
+
+        if (!write_vector(fd, &iov, 1)) {
+            return false;
+        }
+
+        offset += bytes;
+        left -= bytes;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ResultBuffer
+*
+*-----------------------------------------------------------------------------*/
+ResultBuffer::ResultBuffer()
+{
+    this->number_of_segments = 0;
+    this->size = 0;
+    this->flat = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ~ResultBuffer
+*
+*-----------------------------------------------------------------------------*/
+ResultBuffer::~ResultBuffer()
+{
+    this->Clear();
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Alloc
+*
+* PURPOSE : Appends a memory segment of 'size' bytes owned by the result, for
+*           the command to fill.
+*
+* RETURN : the segment, 0 if there is no segment or no memory left
+*
+*-----------------------------------------------------------------------------*/
+char* ResultBuffer::Alloc(size_t size)
+{
+    if (this->number_of_segments == RESULT_MAX_SEGMENTS) {
+        return 0;
+    }
+
+    char *data = (char*)SessionArena::AllocCurrent(size);
+
+    if (!data) {
+        return 0;
+    }
+
+    this->Append(data, size, true);
+
+    return data;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Append
+*
+* PURPOSE : Appends 'length' bytes at 'data'. If 'owned', 'data' comes from
+*           SessionArena::AllocCurrent and is released with the result,
+*           otherwise it has to outlive the result.
+*
+* RETURN : false if there are already RESULT_MAX_SEGMENTS segments
+*
+*-----------------------------------------------------------------------------*/
+bool ResultBuffer::Append(const char *data, size_t length, bool owned)
+{
+    if (this->number_of_segments == RESULT_MAX_SEGMENTS) {
+        return false;
+    }
+
+    ResultSegment &segment = this->segments[this->number_of_segments++];
+    segment.type = RESULT_SEGMENT_MEMORY;
+    segment.data = data;
+    segment.fd = -1;
+    segment.offset = 0;
+    segment.length = length;
+    segment.owned = owned;
+
+    this->size += length;
+    SessionArena::FreeCurrent(this->flat);      // out of date
+    this->flat = 0;
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : AppendFile
+*
+* PURPOSE : Appends 'length' bytes of the file 'fd' from 'offset', they are
+*           read only when the result is sent. If 'owned', 'fd' is closed
+*           with the result.
+*
+* RETURN : false if there are already RESULT_MAX_SEGMENTS segments
+*
+*-----------------------------------------------------------------------------*/
+bool ResultBuffer::AppendFile(int fd, off_t offset, size_t length, bool owned)
+{
+    if (this->number_of_segments == RESULT_MAX_SEGMENTS || fd < 0) {
+        return false;
+    }
+
+    ResultSegment &segment = this->segments[this->number_of_segments++];
+    segment.type = RESULT_SEGMENT_FILE;
+    segment.data = 0;
+    segment.fd = fd;
+    segment.offset = offset;
+    segment.length = length;
+    segment.owned = owned;
+
+    this->size += length;
+    SessionArena::FreeCurrent(this->flat);
+    this->flat = 0;
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Prepend
+*
+* PURPOSE : Same as Append, in front of the other segments, i.e. a header
+*           around a result already built
+*
+* RETURN : false if there are already RESULT_MAX_SEGMENTS segments
+*
+*-----------------------------------------------------------------------------*/
+bool ResultBuffer::Prepend(const char *data, size_t length, bool owned)
+{
+    if (!this->Append(data, length, owned)) {
+        return false;
+    }
+
+    ResultSegment segment = this->segments[this->number_of_segments - 1];
+    memmove(&this->segments[1], &this->segments[0], (this->number_of_segments - 1) * sizeof(ResultSegment));
+    this->segments[0] = segment;
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : AppendResult
+*
+* PURPOSE : Moves the segments of 'other' (and their ownership) at the end,
+*           'other' is left empty. If there is not enough segments left they
+*           are flattened in one, see GetData.
+*
+* RETURN : false if there is no segment left or 'other' cannot be flattened,
+*          'other' is left as it is
+*
+*-----------------------------------------------------------------------------*/
+bool ResultBuffer::AppendResult(ResultBuffer &other)
+{
+    if (other.number_of_segments == 0) {
+        return true;
+    }
+
+    if (this->number_of_segments + other.number_of_segments <= RESULT_MAX_SEGMENTS) {
+        memcpy(&this->segments[this->number_of_segments], other.segments, other.number_of_segments * sizeof(ResultSegment));
+        this->number_of_segments += other.number_of_segments;
+        this->size += other.size;
+        SessionArena::FreeCurrent(this->flat);
+        this->flat = 0;
+
+        other.number_of_segments = 0;       // moved, not released
+        other.Clear();
+
+        return true;
+    }
+
+    if (this->number_of_segments == RESULT_MAX_SEGMENTS || !other.GetData()) {
+        return false;
+    }
+
+    // more than one segment : GetData built 'flat', it changes hands
+    char *flat = other.flat;
+    size_t size = other.size;
+
+    other.flat = 0;
+    other.Clear();
+
+    return this->Append(flat, size, true);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Truncate
+*
+* PURPOSE : Drops the bytes after 'size', i.e. when a command allocates for
+*           the worst case. The segments are kept (and released) as usual.
+*
+*-----------------------------------------------------------------------------*/
+void ResultBuffer::Truncate(size_t size)
+{
+    size_t excess = this->size > size ? this->size - size : 0;
+
+    for (size_t i = this->number_of_segments; i > 0 && excess > 0; i--) {
+        size_t cut = excess < this->segments[i - 1].length ? excess : this->segments[i - 1].length;
+        this->segments[i - 1].length -= cut;
+        this->size -= cut;
+        excess -= cut;
+    }
+
+    SessionArena::FreeCurrent(this->flat);
+    this->flat = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Clear
+*
+* PURPOSE : Releases the owned segments, the result is empty
+*
+*-----------------------------------------------------------------------------*/
+void ResultBuffer::Clear()
+{
+    for (size_t i = 0; i < this->number_of_segments; i++) {
+        ResultSegment &segment = this->segments[i];
+
+        if (!segment.owned) {
+            continue;
+        }
+
+        if (segment.type == RESULT_SEGMENT_MEMORY) {
+            SessionArena::FreeCurrent((void*)segment.data);
+        } else {
+            close(segment.fd);
+        }
+    }
+
+    SessionArena::FreeCurrent(this->flat);
+    this->flat = 0;
+    this->number_of_segments = 0;
+    this->size = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Swap
+*
+* PURPOSE : Exchanges the content (and the ownership) of the two results
+*
+*-----------------------------------------------------------------------------*/
+void ResultBuffer::Swap(ResultBuffer &other)
+{
+    ResultSegment segments[RESULT_MAX_SEGMENTS];
+    size_t number_of_segments = this->number_of_segments;
+    size_t size = this->size;
+    char *flat = this->flat;
+
+    memcpy(segments, this->segments, sizeof(segments));
+    memcpy(this->segments, other.segments, sizeof(segments));
+    memcpy(other.segments, segments, sizeof(segments));
+
+    this->number_of_segments = other.number_of_segments;
+    this->size = other.size;
+    this->flat = other.flat;
+
+    other.number_of_segments = number_of_segments;
+    other.size = size;
+    other.flat = flat;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetData
+*
+* PURPOSE : Returns the result as one buffer of GetSize() bytes. A single
+*           memory segment is returned as is, otherwise the segments are
+*           copied once in a buffer owned by the result.
+*
+* RETURN : 0 if the result is empty, or a file segment cannot be read
+*
+*-----------------------------------------------------------------------------*/
+char* ResultBuffer::GetData()
+{
+    if (this->number_of_segments == 0) {
+        return 0;
+    }
+
+    if (this->number_of_segments == 1 && this->segments[0].type == RESULT_SEGMENT_MEMORY) {
+        return (char*)this->segments[0].data;
+    }
+
+    if (this->flat) {
+        return this->flat;
+    }
+
+    char *flat = (char*)SessionArena::AllocCurrent(this->size ? this->size : 1);
+    size_t bytes = 0;
+
+    if (!flat) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < this->number_of_segments; i++) {
+        const ResultSegment &segment = this->segments[i];
+
+        if (segment.type == RESULT_SEGMENT_MEMORY) {
+            memcpy(flat + bytes, segment.data, segment.length);
+        } else if (pread(segment.fd, flat + bytes, segment.length, segment.offset) != (ssize_t)segment.length) {
+            SessionArena::FreeCurrent(flat);
+            return 0;
+        }
+
+        bytes += segment.length;
+    }
+
+    this->flat = flat;
+
+    return flat;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : WriteTo
+*
+* PURPOSE : Writes the whole result to 'fd' without flattening it : the
+*           consecutive memory segments with one writev, the file segments
+*           with splice. Waits up to RESULT_WRITE_TIMEOUT ms each time a
+*           non-blocking 'fd' is full.
+*
+* RETURN : GetSize(), -1 if the result could not be written entirely
+*
+*-----------------------------------------------------------------------------*/
+ssize_t ResultBuffer::WriteTo(int fd) const
+{
+    size_t i = 0;
+
+    while (i < this->number_of_segments) {
+        if (this->segments[i].type == RESULT_SEGMENT_FILE) {
+            if (!send_file(fd, this->segments[i])) {
+                return -1;
+            }
+
+            i++;
+            continue;
+        }
+
+        struct iovec iov[RESULT_MAX_SEGMENTS];
+        int count = 0;
+
+        for (; i < this->number_of_segments && this->segments[i].type == RESULT_SEGMENT_MEMORY; i++) {
+            if (this->segments[i].length > 0) {
+                iov[count].iov_base = (void*)this->segments[i].data;
+                iov[count].iov_len = this->segments[i].length;
+                count++;
+            }
+        }
+
+        if (!write_vector(fd, iov, count)) {
+            return -1;
+        }
+    }
+
+    return (ssize_t)this->size;
+}
@@ -0,0 +1,299 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : retention-manager.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <fcntl.h>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "shakespeare.h"
+#include "common/archive-index.h"
+#include "common/retention-manager.h"
+
+extern const char* s_cs1_subsystems[];  // defined in subsystems.cpp
+
+struct EvictionCandidate {
+    ino_t inode;
+    const ArchiveEntry *entry;
+    bool delivered;
+    int subsystem;
+};
+
+/* delivered files first, then the oldest */
+static bool EvictsBefore(const EvictionCandidate& a, const EvictionCandidate& b)
+{
+    if (a.delivered != b.delivered) {
+        return a.delivered;
+    }
+
+    return a.entry->mtime < b.entry->mtime;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : RetentionManager
+*
+*-----------------------------------------------------------------------------*/
+RetentionManager::RetentionManager()
+{
+    this->index = 0;
+    this->budget = 0;
+    memset(this->directory, '\0', CS1_PATH_MAX);
+
+    for (int i = 0; i < RETENTION_NUMBER_OF_SUBSYSTEMS; i++) {
+        this->floors[i] = 0;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ~RetentionManager
+*
+*-----------------------------------------------------------------------------*/
+RetentionManager::~RetentionManager()
+{
+    // the ArchiveIndex is shared, do not delete it
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Open
+*
+* ARGUMENTS : directory - directory to keep under 'budget'
+*             budget    - in bytes, 0 means no budget
+*
+*-----------------------------------------------------------------------------*/
+void RetentionManager::Open(const char *directory, size_t budget)
+{
+    strncpy(this->directory, directory, CS1_PATH_MAX - 1);
+    this->index = ArchiveIndex::GetInstance(directory);
+    this->budget = budget;
+
+    if (this->index) {
+        this->index->SetRemovedFunction(RetentionManager::Forget, this);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetInstance
+*
+* PURPOSE : Returns the process wide manager of 'directory', opened with
+*           the default budget of the directory (CS1_TGZ_BUDGET, 
+*           CS1_LOGS_BUDGET), no budget (0) for the other directories.
+*
+*-----------------------------------------------------------------------------*/
+RetentionManager* RetentionManager::GetInstance(const char *directory)
+{
+    static RetentionManager instances[RETENTION_MAX_DIRS];
+
+    for (int i = 0; i < RETENTION_MAX_DIRS; i++) {
+        if (instances[i].GetDirectory()[0] == '\0') {
+            size_t budget = 0;
+
+            if (strcmp(directory, CS1_TGZ) == 0) {
+                budget = CS1_TGZ_BUDGET;
+            } else if (strcmp(directory, CS1_LOGS) == 0) {
+                budget = CS1_LOGS_BUDGET;
+            }
+
+            instances[i].Open(directory, budget);
+            return &instances[i];
+        }
+
+        if (strcmp(instances[i].GetDirectory(), directory) == 0) {
+            return &instances[i];
+        }
+    }
+
+    return 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Clear
+*
+* PURPOSE : Forgets the delivered marks
+*
+*-----------------------------------------------------------------------------*/
+void RetentionManager::Clear()
+{
+    this->delivered.clear();
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : SetFloor
+*
+* PURPOSE : The newest 'min_files' files of 'subsystem' are never evicted.
+*
+*-----------------------------------------------------------------------------*/
+void RetentionManager::SetFloor(int subsystem, size_t min_files)
+{
+    if (subsystem >= 0 && subsystem < RETENTION_NUMBER_OF_SUBSYSTEMS) {
+        this->floors[subsystem] = min_files;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : MarkDelivered
+*
+* PURPOSE : The file 'inode' was sent to the ground, it will be evicted first.
+*
+*-----------------------------------------------------------------------------*/
+void RetentionManager::MarkDelivered(ino_t inode)
+{
+    this->delivered.insert(inode);
+}
+
+bool RetentionManager::IsDelivered(ino_t inode)
+{
+    return this->delivered.find(inode) != this->delivered.end();
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Forget
+*
+* PURPOSE : The ArchiveRemovedFunction of the index : a file evicted or
+*           unlinked is not delivered any more, its inode may be reused by
+*           a file that was never sent
+*
+*-----------------------------------------------------------------------------*/
+void RetentionManager::Forget(ino_t inode, void *context)
+{
+    ((RetentionManager*)context)->delivered.erase(inode);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetUsage
+*
+* PURPOSE : Returns the number of bytes used by the files of the directory
+*
+*-----------------------------------------------------------------------------*/
+size_t RetentionManager::GetUsage()
+{
+    if (!this->index) {
+        return 0;
+    }
+
+    return this->index->GetTotalSize();
+}
+
+bool RetentionManager::IsOverBudget()
+{
+    return this->budget > 0 && this->GetUsage() > this->budget;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : RunOnce
+*
+* PURPOSE : If the directory is over budget, evicts files in the policy order
+*           until it is back under budget, at most 'max_evictions' files.
+*
+* RETURN : the number of files evicted
+*
+*-----------------------------------------------------------------------------*/
+size_t RetentionManager::RunOnce(size_t max_evictions)
+{
+    char log_buffer[CS1_MAX_LOG_ENTRY] = {0};
+    size_t usage = this->GetUsage();
+    size_t evicted = 0;
+
+    if (!this->index || this->budget == 0 || usage <= this->budget) {
+        return 0;
+    }
+
+    const std::map<ino_t, ArchiveEntry>& entries = this->index->GetEntries();
+    std::vector<EvictionCandidate> candidates;
+    size_t remaining[RETENTION_NUMBER_OF_SUBSYSTEMS] = {0};
+
+    candidates.reserve(entries.size());
+
+    for (std::map<ino_t, ArchiveEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        EvictionCandidate candidate;
+        candidate.inode = it->first;
+        candidate.entry = &it->second;
+        candidate.delivered = this->IsDelivered(it->first);
+        candidate.subsystem = RetentionManager::GetSubsystem(it->second.name.c_str());
+
+        if (candidate.subsystem != RETENTION_NO_SUBSYSTEM) {
+            remaining[candidate.subsystem]++;
+        }
+
+        candidates.push_back(candidate);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), EvictsBefore);
+
+    int dir_fd = open(this->index->GetDirectory(), O_RDONLY | O_DIRECTORY);
+
+    if (dir_fd < 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < candidates.size() && evicted < max_evictions && usage > this->budget; i++) {
+        int subsystem = candidates[i].subsystem;
+
+        if (subsystem != RETENTION_NO_SUBSYSTEM && remaining[subsystem] <= this->floors[subsystem]) {
+            continue;
+        }
+
+        if (unlinkat(dir_fd, candidates[i].entry->name.c_str(), 0) != 0) {
+            continue;
+        }
+
+        snprintf(log_buffer, CS1_MAX_LOG_ENTRY, "Retention : evicted %s/%s (%u bytes%s)", 
+                                    this->index->GetDirectory(), candidates[i].entry->name.c_str(), 
+                                    (unsigned int)candidates[i].entry->size, 
+                                    candidates[i].delivered ? ", delivered" : "");
+        Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], log_buffer);
+
+        if (subsystem != RETENTION_NO_SUBSYSTEM) {
+            remaining[subsystem]--;
+        }
+
+        usage -= candidates[i].entry->size;
+        this->delivered.erase(candidates[i].inode);
+        evicted++;
+    }
+
+    close(dir_fd);
+
+    return evicted;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetSubsystem
+*
+* PURPOSE : Returns the subsystem (see subsystems.h) that 'filename' belongs 
+*           to, from the prefix of the name, RETENTION_NO_SUBSYSTEM if none.
+*
+*-----------------------------------------------------------------------------*/
+int RetentionManager::GetSubsystem(const char *filename)
+{
+    int subsystem = RETENTION_NO_SUBSYSTEM;
+    size_t longest = 0;
+
+    for (int i = 0; i < RETENTION_NUMBER_OF_SUBSYSTEMS; i++) {
+        size_t length = strlen(s_cs1_subsystems[i]);
+
+        if (length > longest && strncmp(filename, s_cs1_subsystems[i], length) == 0) {
+            subsystem = i;
+            longest = length;
+        }
+    }
+
+    return subsystem;
+}
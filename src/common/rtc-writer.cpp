@@ -0,0 +1,196 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : rtc-writer.cpp
+*
+* DESCRIPTION : see rtc-writer.h
+*
+*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "i2c-device.h"
+#include "common/rtc-writer.h"
+
+static int WriteToRtc(struct rtc_time rt, int bus)
+{
+    return I2CDevice::I2CWriteToRTC(rt, bus);
+}
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;     // a request is pending
+static pthread_cond_t idle = PTHREAD_COND_INITIALIZER;     // nothing pending nor being written
+
+static RtcWriter::WriteFunction write_function = WriteToRtc;
+static bool started = false;
+static bool pending = false;
+static bool busy = false;
+static int pending_bus = 0;
+static char status = RTC_STATUS_NONE;
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : WriteNow
+*
+* PURPOSE : Writes the current system time to the RTC on 'bus'
+*
+*-----------------------------------------------------------------------------*/
+static int WriteNow(RtcWriter::WriteFunction write, int bus)
+{
+    struct timeval tv = {0, 0};
+    struct tm time_info;
+
+    if (gettimeofday(&tv, 0) != 0) {
+        return -1;
+    }
+
+    time_t seconds = tv.tv_sec;
+    localtime_r(&seconds, &time_info);
+
+    struct rtc_time rt = {  time_info.tm_sec,
+                            time_info.tm_min,
+                            time_info.tm_hour,
+                            time_info.tm_mday,
+                            time_info.tm_mon,
+                            time_info.tm_year,
+                            time_info.tm_wday,
+                            time_info.tm_yday,
+                            time_info.tm_isdst
+                         };
+
+    return write(rt, bus);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Run
+*
+* PURPOSE : The worker : writes the pending request, the status only changes
+*           if no other request came in the meantime
+*
+*-----------------------------------------------------------------------------*/
+static void* Run(void*)
+{
+    pthread_mutex_lock(&mutex);
+
+    for (;;) {
+        while (!pending) {
+            pthread_cond_wait(&work, &mutex);
+        }
+
+        RtcWriter::WriteFunction write = write_function;
+        int bus = pending_bus;
+        pending = false;
+        busy = true;
+
+        pthread_mutex_unlock(&mutex);
+        int written = WriteNow(write, bus);
+        pthread_mutex_lock(&mutex);
+
+        busy = false;
+
+        if (!pending) {
+            status = (written == -1) ? RTC_STATUS_FAILED : RTC_STATUS_OK;
+            pthread_cond_broadcast(&idle);
+        }
+    }
+
+    return 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Submit
+*
+* PURPOSE : Requests a write of the system time to the RTC on 'bus', starts the
+*           worker on the first call. Without a worker (pthread_create failed)
+*           the write is done before returning, as it used to be.
+*
+*-----------------------------------------------------------------------------*/
+void RtcWriter::Submit(int bus)
+{
+    pthread_t thread;
+
+    pthread_mutex_lock(&mutex);
+
+    if (!started && pthread_create(&thread, 0, Run, 0) == 0) {
+        pthread_detach(thread);
+        started = true;
+    }
+
+    if (!started) {
+        status = (WriteNow(write_function, bus) == -1) ? RTC_STATUS_FAILED : RTC_STATUS_OK;
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+
+    pending = true;
+    pending_bus = bus;
+    status = RTC_STATUS_PENDING;
+    pthread_cond_signal(&work);
+
+    pthread_mutex_unlock(&mutex);
+}
+
+char RtcWriter::GetStatus()
+{
+    pthread_mutex_lock(&mutex);
+    char current = status;
+    pthread_mutex_unlock(&mutex);
+
+    return current;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Flush
+*
+* PURPOSE : Waits for the pending write, before a reboot
+*
+* RETURN : false if it is still pending after 'timeout_ms'
+*
+*-----------------------------------------------------------------------------*/
+bool RtcWriter::Flush(int timeout_ms)
+{
+    struct timeval now = {0, 0};
+    struct timespec deadline;
+
+    gettimeofday(&now, 0);
+    deadline.tv_sec = now.tv_sec + timeout_ms / 1000;
+    deadline.tv_nsec = now.tv_usec * 1000L + (timeout_ms % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&mutex);
+
+    while ((pending || busy) && pthread_cond_timedwait(&idle, &mutex, &deadline) != ETIMEDOUT) {
+    }
+
+    bool flushed = !pending && !busy;
+    pthread_mutex_unlock(&mutex);
+
+    return flushed;
+}
+
+void RtcWriter::SetWriteFunction(WriteFunction write)
+{
+    pthread_mutex_lock(&mutex);
+    write_function = write ? write : WriteToRtc;
+    pthread_mutex_unlock(&mutex);
+}
+
+void RtcWriter::Reset()
+{
+    Flush(RTC_FLUSH_TIMEOUT_MS);
+
+    pthread_mutex_lock(&mutex);
+    write_function = WriteToRtc;
+    status = RTC_STATUS_NONE;
+    pthread_mutex_unlock(&mutex);
+}
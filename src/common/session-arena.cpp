@@ -0,0 +1,153 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : session-arena.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <stdlib.h>
+
+#include "common/session-arena.h"
+
+SessionArena* SessionArena::current = 0;
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : SessionArena
+*
+*-----------------------------------------------------------------------------*/
+SessionArena::SessionArena()
+{
+    this->used = 0;
+    this->high_water = 0;
+    this->fallbacks = 0;
+    this->number_of_fallbacks = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ~SessionArena
+*
+*-----------------------------------------------------------------------------*/
+SessionArena::~SessionArena()
+{
+    this->Reset();
+
+    if (SessionArena::current == this) {
+        SessionArena::current = 0;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Alloc
+*
+* PURPOSE : Returns 'size' bytes aligned on SESSION_ARENA_ALIGN, valid until
+*           the next Reset. Do not free() them.
+*
+* RETURN : 0 only if the arena is full AND malloc fails
+*
+*-----------------------------------------------------------------------------*/
+void* SessionArena::Alloc(size_t size)
+{
+    size_t aligned = (size + SESSION_ARENA_ALIGN - 1) & ~((size_t)SESSION_ARENA_ALIGN - 1);
+
+    if (aligned >= size && aligned <= SESSION_ARENA_SIZE - this->used) {
+        void *pointer = this->storage.bytes + this->used;
+        this->used += aligned;
+
+        if (this->used > this->high_water) {
+            this->high_water = this->used;
+        }
+
+        return pointer;
+    }
+
+    // full, fall back to the heap until the next Reset
+    FallbackBlock *block = (FallbackBlock*)malloc(sizeof(FallbackBlock) + size);
+
+    if (!block) {
+        return 0;
+    }
+
+    block->next = this->fallbacks;
+    this->fallbacks = block;
+    this->number_of_fallbacks++;
+
+    return block + 1;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Reset
+*
+* PURPOSE : Releases everything allocated since the last Reset, O(1) unless
+*           the arena had to fall back to the heap.
+*
+*-----------------------------------------------------------------------------*/
+void SessionArena::Reset()
+{
+    this->used = 0;
+
+    while (this->fallbacks) {
+        FallbackBlock *next = this->fallbacks->next;
+        free(this->fallbacks);
+        this->fallbacks = next;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Owns
+*
+* RETURN : true if 'pointer' was returned by Alloc since the last Reset (or
+*          points inside the arena)
+*
+*-----------------------------------------------------------------------------*/
+bool SessionArena::Owns(const void *pointer) const
+{
+    const char *p = (const char*)pointer;
+
+    if (p >= this->storage.bytes && p < this->storage.bytes + SESSION_ARENA_SIZE) {
+        return true;
+    }
+
+    for (const FallbackBlock *block = this->fallbacks; block; block = block->next) {
+        if (p == (const char*)(block + 1)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : AllocCurrent
+*
+* PURPOSE : Alloc from the current arena, malloc if there is none
+*
+*-----------------------------------------------------------------------------*/
+void* SessionArena::AllocCurrent(size_t size)
+{
+    SessionArena *arena = SessionArena::current;
+
+    return arena ? arena->Alloc(size) : malloc(size);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : FreeCurrent
+*
+* PURPOSE : Releases what AllocCurrent returned : nothing to do if it is in
+*           the current arena (see Reset), free() otherwise.
+*
+*-----------------------------------------------------------------------------*/
+void SessionArena::FreeCurrent(void *pointer)
+{
+    SessionArena *arena = SessionArena::current;
+
+    if (!arena || !arena->Owns(pointer)) {
+        free(pointer);
+    }
+}
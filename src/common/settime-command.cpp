@@ -1,5 +1,4 @@
 #include <cerrno>
-#include <linux/rtc.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,8 +11,89 @@
 #include "common/commands.h"
 #include "common/settime-command.h"
 #include "common/subsystems.h"
-#include "i2c-device.h"
 #include "SpaceDecl.h"
+#include "common/command-registry.h"
+#include "common/rtc-writer.h"
+#include "common/wire.h"
+
+static CommandRegistrar<SetTimeCommand> registrar(SETTIME_CMD, SETTIME_CMD_SIZE,
+                                                                        SETTIME_CMD_SIZE_V2);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*
+*-----------------------------------------------------------------------------*/
+ICommand* SetTimeCommand::Create(char* data, size_t length, void* storage) {
+    time_t timeRecieved;
+
+    if (Wire::GetVersion() >= WIRE_V2) {
+        timeRecieved = (time_t)SetTimeSchemaV2::Get<SETTIME_FIELD_TIME>(data);
+        return ConstructCommand<SetTimeCommand>(storage, timeRecieved, SetTimeSchemaV2::Get<SETTIME_FIELD_RTC>(data));
+    }
+
+    timeRecieved = SetTimeSchema::Get<SETTIME_FIELD_TIME>(data);
+    
+    SetTimeCommand* result = ConstructCommand<SetTimeCommand>(storage, timeRecieved, SetTimeSchema::Get<SETTIME_FIELD_RTC>(data));
+
+    return result;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Build_SetTimeCommand
+*
+* PURPOSE : Builds a SetTimeCommand into 'cmd_buf' (at least SETTIME_CMD_SIZE 
+*           bytes), in the wire format of the session
+*
+* RETURN : the number of bytes written
+*
+*-----------------------------------------------------------------------------*/
+size_t SetTimeCommand::Build_SetTimeCommand(char* cmd_buf, time_t time, char rtc_bus_number)
+{
+    if (Wire::GetVersion() >= WIRE_V2) {
+        SetTimeSchemaV2::Init(cmd_buf);
+        SetTimeSchemaV2::Put<SETTIME_FIELD_TIME>(cmd_buf, (unsigned int)time);
+        SetTimeSchemaV2::Put<SETTIME_FIELD_RTC>(cmd_buf, rtc_bus_number);
+        return SETTIME_CMD_SIZE_V2;
+    }
+
+    SetTimeSchema::Init(cmd_buf);
+    SetTimeSchema::Put<SETTIME_FIELD_TIME>(cmd_buf, time);
+    SetTimeSchema::Put<SETTIME_FIELD_RTC>(cmd_buf, rtc_bus_number);
+
+    return SETTIME_CMD_SIZE;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdStr / GetCmdSize
+*
+*-----------------------------------------------------------------------------*/
+char* SetTimeCommand::GetCmdStr(char* cmd_buf)
+{
+    SetTimeCommand::Build_SetTimeCommand(cmd_buf, this->seconds, this->rtc_bus_number);
+    return cmd_buf;
+}
+
+size_t SetTimeCommand::GetCmdSize()
+{
+    return (Wire::GetVersion() >= WIRE_V2) ? SETTIME_CMD_SIZE_V2 : SETTIME_CMD_SIZE;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : SetTimeCommand
+ *
+ * PURPOSE : Used by the GroundCommander to parse the results
+ * 
+ *-----------------------------------------------------------------------------*/
+SetTimeCommand::SetTimeCommand() {
+    this->seconds = 0;
+    this->rtc_bus_number = -1;
+}
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
  *
@@ -43,47 +123,36 @@ SetTimeCommand::SetTimeCommand(time_t time, char rtc_bus_number) {
  *
  * NAME : Execute
  *
- * PURPOSE : Sets the time of the device to 'time'
+ * PURPOSE : Sets the time of the device to 'time', the RTC is written by the
+ *           RtcWriter after the reply
  *
- * RETURNS : A buffer contaning the cmd number, cmd status, and time set
+ * RESULT : A buffer contaning the cmd number, cmd status, time set and RTC status
  * 
  *-----------------------------------------------------------------------------*/
-void* SetTimeCommand::Execute(size_t* pSize){
+void SetTimeCommand::Execute(ResultBuffer& result){
     struct timeval tv = {0};
-    char *result = 0;
-    *pSize = SETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE;
+    char *data = result.Alloc(sizeof(char) * (SETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE));
 
-    result = (char*)malloc(sizeof(char) * (*pSize));
-    result[CMD_ID] = SETTIME_CMD;
-    result[CMD_STS] = CS1_SUCCESS;
+    if (!data) {
+        return;
+    }
+
+    SetTimeResultSchema::Init(data);
+    SetTimeResultSchema::Put<CMD_STS>(data, CS1_SUCCESS);
+    SetTimeResultSchema::Put<SETTIME_FIELD_RTC_STATUS>(data, RTC_STATUS_NONE);
     tv.tv_sec = this->GetSeconds();   
     tv.tv_usec = 0;
-    memcpy(result + CMD_RES_HEAD_SIZE, &tv.tv_sec, sizeof(time_t)); 
+    SetTimeResultSchema::Put<SETTIME_FIELD_TIME_SET>(data, tv.tv_sec);
 
     if (settimeofday(&tv, 0) != 0) {
-        result[CMD_STS] = CS1_FAILURE;
-        return (void*)result;        
+        SetTimeResultSchema::Put<CMD_STS>(data, CS1_FAILURE);
+        return;
     }
 
     if (rtc_bus_number != EOF) {
-        int rtc_bus_number_convert = (int)rtc_bus_number;
-        struct tm * time_info = localtime(&tv.tv_sec);
-        struct rtc_time rt = {  time_info->tm_sec, 
-                                time_info->tm_min, 
-                                time_info->tm_hour, 
-                                time_info->tm_mday, 
-                                time_info->tm_mon, 
-                                time_info->tm_year, 
-                                time_info->tm_wday,
-                                time_info->tm_yday,
-                                time_info->tm_isdst
-                              };
-        if (I2CDevice::I2CWriteToRTC(rt,rtc_bus_number_convert) == -1) {
-            result[CMD_STS] = CS1_FAILURE; 
-        }
+        RtcWriter::Submit((int)rtc_bus_number);
+        SetTimeResultSchema::Put<SETTIME_FIELD_RTC_STATUS>(data, RtcWriter::GetStatus());
     }
-
-    return (void*)result;
 }
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -100,15 +169,16 @@ void* SetTimeCommand::Execute(size_t* pSize){
 InfoBytes* SetTimeCommand::ParseResult(char *result) {
     static struct InfoBytesSetTime info_bytes;
 
-    if (!result || result[CMD_ID] != SETTIME_CMD) {
+    if (!SetTimeResultSchema::Check(result)) {
         Shakespeare::log(Shakespeare::ERROR,cs1_systems[CS1_COMMANDER],"Possible SetTime failure: Can't parse result");
         info_bytes.time_status = CS1_FAILURE;
 
         return &info_bytes;
     }
 
-    info_bytes.time_status = result[CMD_STS];
-    info_bytes.time_set = SpaceString::getTimet(result + CMD_RES_HEAD_SIZE);
+    info_bytes.time_status = SetTimeResultSchema::Get<CMD_STS>(result);
+    info_bytes.time_set = SetTimeResultSchema::Get<SETTIME_FIELD_TIME_SET>(result);
+    info_bytes.rtc_status = SetTimeResultSchema::Get<SETTIME_FIELD_RTC_STATUS>(result);
 
     char buffer[CS1_MAX_LOG_ENTRY];
    
@@ -0,0 +1,370 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : tar-extract.cpp
+*
+* DESCRIPTION : see tar-extract.h
+*
+*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/tar-extract.h"
+
+// ustar header
+#define TAR_NAME 0
+#define TAR_NAME_SIZE 100
+#define TAR_MODE 100
+#define TAR_MODE_SIZE 8
+#define TAR_SIZE 124
+#define TAR_SIZE_SIZE 12
+#define TAR_CHECKSUM 148
+#define TAR_CHECKSUM_SIZE 8
+#define TAR_TYPE 156
+#define TAR_MAGIC 257
+#define TAR_PREFIX 345
+#define TAR_PREFIX_SIZE 155
+
+#define TAR_TYPE_FILE '0'
+#define TAR_TYPE_OLD_FILE '\0'
+#define TAR_TYPE_CONTIGUOUS '7'
+#define TAR_TYPE_DIRECTORY '5'
+#define TAR_TYPE_LONG_NAME 'L'
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetNumber
+*
+* PURPOSE : Octal field of the header, or base-256 if its first bit is set
+*           (GNU, sizes >= 8 GB)
+*
+*-----------------------------------------------------------------------------*/
+static unsigned long GetNumber(const char *field, size_t size)
+{
+    unsigned long value = 0;
+    size_t i = 0;
+
+    if (field[0] & 0x80) {
+        value = field[0] & 0x7f;
+        for (i = 1; i < size; i++) {
+            value = (value << 8) | (unsigned char)field[i];
+        }
+        return value;
+    }
+
+    while (i < size && field[i] == ' ') {
+        i++;
+    }
+
+    for (; i < size && field[i] >= '0' && field[i] <= '7'; i++) {
+        value = (value << 3) | (field[i] - '0');
+    }
+
+    return value;
+}
+
+static bool IsZeroBlock(const char *block)
+{
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        if (block[i] != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool ChecksumMatches(const char *header)
+{
+    unsigned long sum = 0;
+
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        bool in_checksum = (i >= TAR_CHECKSUM && i < TAR_CHECKSUM + TAR_CHECKSUM_SIZE);
+        sum += in_checksum ? ' ' : (unsigned char)header[i];
+    }
+
+    return sum == GetNumber(header + TAR_CHECKSUM, TAR_CHECKSUM_SIZE);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : IsSafeName
+*
+* PURPOSE : A name stays in the directory : not absolute, no ".." component
+*
+*-----------------------------------------------------------------------------*/
+static bool IsSafeName(const char *name)
+{
+    if (name[0] == '\0' || name[0] == '/') {
+        return false;
+    }
+
+    for (const char *component = name; component; ) {
+        const char *slash = strchr(component, '/');
+        size_t length = slash ? (size_t)(slash - component) : strlen(component);
+
+        if (length == 2 && component[0] == '.' && component[1] == '.') {
+            return false;
+        }
+
+        component = slash ? slash + 1 : 0;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : MakeParents
+*
+* PURPOSE : Creates the directories of 'path' after the first 'start' bytes
+*           (the extraction directory), as 'mkdir -p'
+*
+*-----------------------------------------------------------------------------*/
+static bool MakeParents(char *path, size_t start)
+{
+    for (char *slash = strchr(path + start, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        int result = mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+        *slash = '/';
+
+        if (result != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : EndEntry
+*
+* PURPOSE : Closes the file extracted, with the mode of its header, and adds
+*           it to the manifest
+*
+*-----------------------------------------------------------------------------*/
+static void EndEntry(TarExtract *tar)
+{
+    char line[CS1_PATH_MAX + 24] = {'\0'};
+
+    if (tar->type == TAR_TYPE_LONG_NAME) {
+        tar->long_name[tar->long_name_length] = '\0';
+        tar->long_name_pending = true;
+        return;
+    }
+
+    if (tar->fd == -1) {
+        return;
+    }
+
+    mode_t mode = GetNumber(tar->header + TAR_MODE, TAR_MODE_SIZE) & 07777;
+    unsigned long size = GetNumber(tar->header + TAR_SIZE, TAR_SIZE_SIZE);
+
+    if (fchmod(tar->fd, mode) != 0 || close(tar->fd) != 0) {
+        tar->error = TAR_IO_ERROR;
+    }
+
+    tar->fd = -1;
+    tar->files++;
+    tar->bytes += size;
+
+    snprintf(line, sizeof(line), "%lu %s\n", size, tar->path + strlen(tar->dir) + 1);
+    tar->manifest += line;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : BeginEntry
+*
+* PURPOSE : Reads the header of the next entry, opens the file or creates the
+*           directory
+*
+*-----------------------------------------------------------------------------*/
+static void BeginEntry(TarExtract *tar)
+{
+    char name[CS1_PATH_MAX] = {'\0'};
+    const char *header = tar->header;
+
+    if (IsZeroBlock(header)) {
+        tar->done = true;
+        return;
+    }
+
+    if (!ChecksumMatches(header)) {
+        tar->error = TAR_BAD_ARCHIVE;
+        return;
+    }
+
+    unsigned long size = GetNumber(header + TAR_SIZE, TAR_SIZE_SIZE);
+
+    tar->type = header[TAR_TYPE];
+    tar->remaining = size;
+    tar->padding = (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+    tar->fd = -1;
+
+    if (tar->type == TAR_TYPE_LONG_NAME) {
+        if (size >= CS1_PATH_MAX) {
+            tar->error = TAR_BAD_ARCHIVE;
+        }
+
+        tar->long_name_length = 0;
+        return;
+    }
+
+    if (tar->long_name_pending) {
+        snprintf(name, CS1_PATH_MAX, "%s", tar->long_name);
+        tar->long_name_pending = false;
+    } else if (memcmp(header + TAR_MAGIC, "ustar", 5) == 0 && header[TAR_PREFIX] != '\0') {
+        snprintf(name, CS1_PATH_MAX, "%.*s/%.*s", TAR_PREFIX_SIZE, header + TAR_PREFIX,
+                                                  TAR_NAME_SIZE, header + TAR_NAME);
+    } else {
+        snprintf(name, CS1_PATH_MAX, "%.*s", TAR_NAME_SIZE, header + TAR_NAME);
+    }
+
+    bool is_file = (tar->type == TAR_TYPE_FILE || tar->type == TAR_TYPE_OLD_FILE
+                                               || tar->type == TAR_TYPE_CONTIGUOUS);
+
+    if (!is_file && tar->type != TAR_TYPE_DIRECTORY) {
+        return;                     // skipped
+    }
+
+    if (!IsSafeName(name)) {
+        tar->error = TAR_BAD_ARCHIVE;
+        return;
+    }
+
+    if (snprintf(tar->path, CS1_PATH_MAX, "%s/%s", tar->dir, name) >= CS1_PATH_MAX
+                                        || !MakeParents(tar->path, strlen(tar->dir) + 1)) {
+        tar->error = TAR_IO_ERROR;
+        return;
+    }
+
+    if (!is_file) {
+        mode_t mode = GetNumber(header + TAR_MODE, TAR_MODE_SIZE) & 07777;
+
+        if ((mkdir(tar->path, mode | S_IRWXU) != 0 && errno != EEXIST) || chmod(tar->path, mode | S_IRWXU) != 0) {
+            tar->error = TAR_IO_ERROR;
+        }
+        return;
+    }
+
+    // owner only while it is written, the mode of the header is set once complete
+    if ((tar->fd = open(tar->path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) == -1) {
+        tar->error = TAR_IO_ERROR;
+        return;
+    }
+
+    if (size == 0) {
+        EndEntry(tar);
+    }
+}
+
+void TarExtract_Init(TarExtract *tar, const char *dir)
+{
+    snprintf(tar->dir, CS1_PATH_MAX, "%s", dir);
+    tar->path[0] = '\0';
+    tar->header_length = 0;
+    tar->long_name_length = 0;
+    tar->long_name_pending = false;
+    tar->fd = -1;
+    tar->type = 0;
+    tar->remaining = 0;
+    tar->padding = 0;
+    tar->done = false;
+    tar->error = TAR_OK;
+    tar->files = 0;
+    tar->bytes = 0;
+    tar->manifest.clear();
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : TarExtract_Write
+*
+* PURPOSE : Extracts the next 'size' bytes of the archive
+*
+* RETURN : false on error (see tar->error)
+*
+*-----------------------------------------------------------------------------*/
+bool TarExtract_Write(TarExtract *tar, const unsigned char *data, size_t size)
+{
+    while (size > 0 && tar->error == TAR_OK && !tar->done) {
+        size_t chunk = 0;
+
+        if (tar->remaining > 0) {
+            chunk = (size < tar->remaining) ? size : tar->remaining;
+
+            if (tar->type == TAR_TYPE_LONG_NAME) {
+                memcpy(tar->long_name + tar->long_name_length, data, chunk);
+                tar->long_name_length += chunk;
+            } else if (tar->fd != -1) {
+                for (size_t written = 0; written < chunk; ) {
+                    ssize_t n = write(tar->fd, data + written, chunk - written);
+
+                    if (n < 0 && errno != EINTR) {
+                        tar->error = TAR_IO_ERROR;
+                        return false;
+                    }
+
+                    written += (n > 0) ? n : 0;
+                }
+            }
+
+            tar->remaining -= chunk;
+
+            if (tar->remaining == 0) {
+                EndEntry(tar);
+            }
+        } else if (tar->padding > 0) {
+            chunk = (size < tar->padding) ? size : tar->padding;
+            tar->padding -= chunk;
+        } else {
+            chunk = TAR_BLOCK_SIZE - tar->header_length;
+            chunk = (size < chunk) ? size : chunk;
+
+            memcpy(tar->header + tar->header_length, data, chunk);
+            tar->header_length += chunk;
+
+            if (tar->header_length == TAR_BLOCK_SIZE) {
+                tar->header_length = 0;
+                BeginEntry(tar);
+            }
+        }
+
+        data += chunk;
+        size -= chunk;
+    }
+
+    return tar->error == TAR_OK;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : TarExtract_Finish
+*
+* PURPOSE : Checks that the archive did not stop in the middle of an entry,
+*           the file partly extracted is removed
+*
+* RETURN : TAR_OK or the error
+*
+*-----------------------------------------------------------------------------*/
+int TarExtract_Finish(TarExtract *tar)
+{
+    if (tar->error == TAR_OK && (tar->remaining > 0 || tar->header_length > 0)) {
+        tar->error = TAR_BAD_ARCHIVE;
+    }
+
+    if (tar->fd != -1) {
+        close(tar->fd);
+        remove(tar->path);
+        tar->fd = -1;
+    }
+
+    return tar->error;
+}
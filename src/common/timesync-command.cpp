@@ -0,0 +1,320 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : timesync-command.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "common/commands.h"
+#include "shakespeare.h"
+#include "SpaceDecl.h"
+#include "common/timesync-command.h"
+#include "common/subsystems.h"
+#include "common/command-registry.h"
+
+static CommandRegistrar<TimeSyncCommand> registrar(TIMESYNC_CMD, TIMESYNC_CMD_SIZE);
+
+long long TimeSyncCommand::arrival_realtime = 0;
+long long TimeSyncCommand::arrival_monotonic = 0;
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : MarkArrival
+*
+* PURPOSE : Takes t1 as a command is read from the ground, before it waits
+*           to be logged and created. The next Create uses it.
+*
+*-----------------------------------------------------------------------------*/
+void TimeSyncCommand::MarkArrival()
+{
+    arrival_realtime = TimeSyncCommand::Now(CLOCK_REALTIME);
+    arrival_monotonic = TimeSyncCommand::Now(CLOCK_MONOTONIC);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground, t1
+*           is the time of MarkArrival, or now without one : the time spent
+*           after it is on the satellite side of the exchange, not on the link
+*
+*-----------------------------------------------------------------------------*/
+ICommand* TimeSyncCommand::Create(char* data, size_t length, void* storage) {
+    long long t1_realtime = arrival_realtime;
+    long long t1_monotonic = arrival_monotonic;
+
+    if (t1_monotonic == 0) {
+        t1_realtime = TimeSyncCommand::Now(CLOCK_REALTIME);
+        t1_monotonic = TimeSyncCommand::Now(CLOCK_MONOTONIC);
+    }
+
+    arrival_realtime = 0;
+    arrival_monotonic = 0;
+
+    return ConstructCommand<TimeSyncCommand>(storage, TimeSyncSchema::Get<TIMESYNC_FIELD_OP>(data),
+                                             TimeSyncSchema::Get<TIMESYNC_FIELD_VALUE>(data),
+                                             t1_realtime, t1_monotonic);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : TimeSyncCommand
+*
+* PURPOSE : Used by the GroundCommander to parse the results
+*
+*-----------------------------------------------------------------------------*/
+TimeSyncCommand::TimeSyncCommand()
+{
+    this->op = TIMESYNC_OP_SAMPLE;
+    this->value = 0;
+    this->t1_realtime = 0;
+    this->t1_monotonic = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : TimeSyncCommand
+*
+* ARGUMENTS : op    - TIMESYNC_OP_SAMPLE or TIMESYNC_OP_SLEW
+*             value - t0, or the nanoseconds to add to the clock
+*
+*-----------------------------------------------------------------------------*/
+TimeSyncCommand::TimeSyncCommand(char op, long long value)
+{
+    this->op = op;
+    this->value = value;
+    this->t1_realtime = 0;
+    this->t1_monotonic = 0;
+}
+
+TimeSyncCommand::TimeSyncCommand(char op, long long value, long long t1_realtime, long long t1_monotonic)
+{
+    this->op = op;
+    this->value = value;
+    this->t1_realtime = t1_realtime;
+    this->t1_monotonic = t1_monotonic;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ~TimeSyncCommand
+*
+*-----------------------------------------------------------------------------*/
+TimeSyncCommand::~TimeSyncCommand()
+{
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Now
+*
+* RETURN : 'clock' in nanoseconds, 0 if it can't be read
+*
+*-----------------------------------------------------------------------------*/
+long long TimeSyncCommand::Now(clockid_t clock)
+{
+    struct timespec now = {0, 0};
+
+    if (clock_gettime(clock, &now) != 0) {
+        return 0;
+    }
+
+    return (long long)now.tv_sec * TIMESYNC_NS_PER_SEC + now.tv_nsec;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Slew
+*
+* PURPOSE : Adds 'nanoseconds' to the clock with adjtime, it replaces the
+*           adjustment in progress
+*
+* RETURN : false on failure, 'previous' is what remained of the adjustment
+*          replaced
+*
+*-----------------------------------------------------------------------------*/
+static bool Slew(long long nanoseconds, long long *previous)
+{
+    long long microseconds = nanoseconds / 1000;
+    struct timeval delta = {0, 0};
+    struct timeval old = {0, 0};
+
+    // both negative for a negative delta, as adjtime expects
+    delta.tv_sec = (time_t)(microseconds / 1000000);
+    delta.tv_usec = (suseconds_t)(microseconds % 1000000);
+
+    if (adjtime(&delta, &old) != 0) {
+        return false;
+    }
+
+    *previous = ((long long)old.tv_sec * 1000000 + old.tv_usec) * 1000;
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+*
+* PURPOSE : TIMESYNC_OP_SAMPLE : returns t0, t1 and t2
+*           TIMESYNC_OP_SLEW : slews the clock
+*
+* RESULT : see timesync-command.h, t2 is taken last
+*
+*-----------------------------------------------------------------------------*/
+void TimeSyncCommand::Execute(ResultBuffer& result)
+{
+    char* data = result.Alloc(TIMESYNC_RTN_SIZE_TOTAL);
+    char status = CS1_SUCCESS;
+
+    if (!data) {
+        return;
+    }
+
+    memset(data, 0, TIMESYNC_RTN_SIZE_TOTAL);
+    TimeSyncResultSchema::Init(data);
+    TimeSyncResultSchema::Put<TIMESYNC_FIELD_RESULT_OP>(data, this->op);
+    TimeSyncResultSchema::Put<TIMESYNC_FIELD_T0>(data, this->value);
+
+    if (this->op == TIMESYNC_OP_SAMPLE) {
+        TimeSyncResultSchema::Put<TIMESYNC_FIELD_T1_REALTIME>(data, this->t1_realtime);
+        TimeSyncResultSchema::Put<TIMESYNC_FIELD_T1_MONOTONIC>(data, this->t1_monotonic);
+    } else if (this->op == TIMESYNC_OP_SLEW) {
+        long long previous = 0;
+
+        if (llabs(this->value) > TIMESYNC_MAX_SLEW_NS || !Slew(this->value, &previous)) {
+            status = CS1_FAILURE;
+        }
+
+        TimeSyncResultSchema::Put<TIMESYNC_FIELD_PREVIOUS_SLEW>(data, previous);
+
+        snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "TimeSync: slew of %lld us %s", this->value / 1000,
+                                                      (status == CS1_SUCCESS) ? "started" : "refused");
+        Shakespeare::log((status == CS1_SUCCESS) ? Shakespeare::NOTICE : Shakespeare::ERROR,
+                                                   cs1_systems[CS1_COMMANDER], this->log_buffer);
+    } else {
+        status = CS1_FAILURE;
+    }
+
+    TimeSyncResultSchema::Put<CMD_STS>(data, status);
+    TimeSyncResultSchema::Put<TIMESYNC_FIELD_T2_REALTIME>(data, TimeSyncCommand::Now(CLOCK_REALTIME));
+    TimeSyncResultSchema::Put<TIMESYNC_FIELD_T2_MONOTONIC>(data, TimeSyncCommand::Now(CLOCK_MONOTONIC));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Build_TimeSyncCommand
+*
+* PURPOSE : Builds a TimeSyncCommand into 'cmd_buf' (TIMESYNC_CMD_SIZE bytes).
+*           For a sample, take t0 with Now(CLOCK_REALTIME) right before
+*           sending it.
+*
+* RETURN : the number of bytes written
+*
+*-----------------------------------------------------------------------------*/
+size_t TimeSyncCommand::Build_TimeSyncCommand(char* cmd_buf, char op, long long value)
+{
+    TimeSyncSchema::Init(cmd_buf);
+    TimeSyncSchema::Put<TIMESYNC_FIELD_OP>(cmd_buf, op);
+    TimeSyncSchema::Put<TIMESYNC_FIELD_VALUE>(cmd_buf, value);
+
+    return TIMESYNC_CMD_SIZE;
+}
+
+char* TimeSyncCommand::GetCmdStr(char* cmd_buf)
+{
+    TimeSyncCommand::Build_TimeSyncCommand(cmd_buf, this->op, this->value);
+    return cmd_buf;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Estimate
+*
+* PURPOSE : Offset of the satellite clock from 'count' samples : the one of
+*           lowest delay is kept, its error is the smallest bound (NTP clock
+*           filter). A sample is discarded if the satellite clock was set
+*           between t1 and t2, or if its times are not in order.
+*
+* RETURN : false if no sample is valid
+*
+*-----------------------------------------------------------------------------*/
+bool TimeSyncCommand::Estimate(const TimeSyncSample* samples, size_t count, TimeSyncEstimate* estimate)
+{
+    estimate->offset = 0;
+    estimate->delay = 0;
+    estimate->samples = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const TimeSyncSample& sample = samples[i];
+        long long on_board = sample.t2_monotonic - sample.t1_monotonic;
+        long long stepped = (sample.t2_realtime - sample.t1_realtime) - on_board;
+        long long delay = (sample.t3 - sample.t0) - on_board;
+
+        if (on_board < 0 || delay < 0 || llabs(stepped) > TIMESYNC_STEP_TOLERANCE_NS) {
+            continue;
+        }
+
+        if (estimate->samples == 0 || delay < estimate->delay) {
+            estimate->offset = ((sample.t1_realtime - sample.t0) + (sample.t2_realtime - sample.t3)) / 2;
+            estimate->delay = delay;
+        }
+
+        estimate->samples++;
+    }
+
+    return estimate->samples > 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ParseResult
+*
+* PURPOSE : Parses the result buffer returned by the execute function, the
+*           caller fills 'sample.t3' for Estimate
+*
+* RETURN : struct InfoBytes* to STATIC memory
+*
+*-----------------------------------------------------------------------------*/
+InfoBytes* TimeSyncCommand::ParseResult(char *result)
+{
+    static struct InfoBytesTimeSync info_bytes;
+
+    memset(&info_bytes.sample, 0, sizeof(info_bytes.sample));
+    info_bytes.slew = 0;
+    info_bytes.previous_slew = 0;
+
+    if (!TimeSyncResultSchema::Check(result)) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "TimeSync failure: Can't parse result");
+        info_bytes.timesync_status = CS1_FAILURE;
+        return &info_bytes;
+    }
+
+    info_bytes.timesync_status = TimeSyncResultSchema::Get<CMD_STS>(result);
+    info_bytes.op = TimeSyncResultSchema::Get<TIMESYNC_FIELD_RESULT_OP>(result);
+
+    if (info_bytes.op == TIMESYNC_OP_SLEW) {
+        info_bytes.slew = TimeSyncResultSchema::Get<TIMESYNC_FIELD_SLEW>(result);
+        info_bytes.previous_slew = TimeSyncResultSchema::Get<TIMESYNC_FIELD_PREVIOUS_SLEW>(result);
+
+        snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "TimeSync %s: slew of %lld us",
+                    (info_bytes.timesync_status == CS1_SUCCESS) ? "success" : "failure", info_bytes.slew / 1000);
+        Shakespeare::log((info_bytes.timesync_status == CS1_SUCCESS) ? Shakespeare::NOTICE : Shakespeare::ERROR,
+                                                                  cs1_systems[CS1_COMMANDER], this->log_buffer);
+        return &info_bytes;
+    }
+
+    info_bytes.sample.t0 = TimeSyncResultSchema::Get<TIMESYNC_FIELD_T0>(result);
+    info_bytes.sample.t1_realtime = TimeSyncResultSchema::Get<TIMESYNC_FIELD_T1_REALTIME>(result);
+    info_bytes.sample.t1_monotonic = TimeSyncResultSchema::Get<TIMESYNC_FIELD_T1_MONOTONIC>(result);
+    info_bytes.sample.t2_realtime = TimeSyncResultSchema::Get<TIMESYNC_FIELD_T2_REALTIME>(result);
+    info_bytes.sample.t2_monotonic = TimeSyncResultSchema::Get<TIMESYNC_FIELD_T2_MONOTONIC>(result);
+
+    return &info_bytes;
+}
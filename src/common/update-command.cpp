@@ -1,57 +1,365 @@
 #include "common/update-command.h"
 #include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 #include "space-commander/base64.h"
 #include <cstring>
+#include "common/async-log.h"
 #include "common/commands.h"
 #include "common/subsystems.h"
 #include "SpaceString.h"
 #include "SpaceDecl.h"
 #include "shakespeare.h"
+#include "common/command-registry.h"
+#include "common/command-factory.h"
+#include "common/wire.h"
+#include "common/crc32.h"
+#include "common/lzss.h"
 
-void* UpdateCommand::Execute(size_t* pSize) {
+static CommandRegistrar<UpdateCommand> registrar(UPDATE_CMD, UPDATE_CMD_MIN_SIZE,
+                                                                    UPDATE_CMD_MIN_SIZE_V2);
+static CommandRegistrar<UpdateCommand> registrar_lz(UPDATE_LZ_CMD, UPDATE_CMD_MIN_SIZE,
+                                                                    UPDATE_CMD_MIN_SIZE_V2);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground, in
+*           the wire format of the session (see update-command.h)
+*
+* RETURN : 0 if the path or the data runs past 'length'
+*
+*-----------------------------------------------------------------------------*/
+ICommand* UpdateCommand::Create(char* data, size_t length, void* storage) {
+    const int PATH_LENGTH = 3;
+    size_t offset = 1;
+    unsigned int pathLength = 0;
+    unsigned int fileDataLength = 0;
+    bool compressed = (data[CMD_ID] == UPDATE_LZ_CMD);
+
+    if (Wire::GetVersion() >= WIRE_V2) {
+        size_t read = Wire::GetVarint(data + offset, length - offset, &pathLength);
+
+        offset += read;
+        if (read == 0 || !Wire::Fits(offset, pathLength, length)) {
+            return 0;
+        }
+
+        WireView path(data + offset, pathLength);
+
+        offset += pathLength;
+        read = Wire::GetVarint(data + offset, length - offset, &fileDataLength);
+
+        offset += read;
+        if (read == 0 || !Wire::Fits(offset, fileDataLength, length)) {
+            return 0;
+        }
+
+        WireView fileData(data + offset, fileDataLength);
+
+        return ConstructCommand<UpdateCommand>(storage, path, fileData, compressed);
+    }
+
+    pathLength = CommandFactory::GetLength3(data, offset);
+
+    offset += PATH_LENGTH;
+    if (!Wire::Fits(offset, pathLength + PATH_LENGTH, length)) {
+        return 0;
+    }
+
+    WireView path(data + offset, pathLength);
+
+    offset += pathLength;
+    fileDataLength = CommandFactory::GetLength3(data, offset);
+
+    offset += PATH_LENGTH;
+    if (!Wire::Fits(offset, fileDataLength, length)) {
+        return 0;
+    }
+
+    WireView fileData(data + offset, fileDataLength);
+
+    UpdateCommand* result = ConstructCommand<UpdateCommand>(storage, path, fileData, compressed);
+    return result;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdSize
+*
+* RETURN : the size of the command in the wire format of the session, 0 if
+*          it can not be encoded (WIRE_V1 and a length > UPDATE_V1_MAX_LENGTH)
+*
+*-----------------------------------------------------------------------------*/
+size_t UpdateCommand::GetCmdSize(size_t path_length, size_t data_length)
+{
+    if (Wire::GetVersion() >= WIRE_V2) {
+        return CMD_HEAD_SIZE + Wire::VarintSize(path_length) + path_length
+                             + Wire::VarintSize(data_length) + data_length;
+    }
+
+    if (path_length > UPDATE_V1_MAX_LENGTH || data_length > UPDATE_V1_MAX_LENGTH) {
+        return 0;
+    }
+
+    return CMD_HEAD_SIZE + 3 + path_length + 3 + data_length;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Build_UpdateCommand
+*
+* PURPOSE : Builds an UpdateCommand into 'cmd_buf' (at least GetCmdSize bytes),
+*           an UPDATE_LZ_CMD if 'data' is compressed
+*
+* RETURN : the number of bytes written, 0 if the command can not be encoded
+*
+*-----------------------------------------------------------------------------*/
+size_t UpdateCommand::Build_UpdateCommand(char* cmd_buf, WireView path, WireView data, bool compressed)
+{
+    char length[4] = {'\0'};
+    size_t size = UpdateCommand::GetCmdSize(path.length, data.length);
+    size_t offset = CMD_HEAD_SIZE;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    cmd_buf[CMD_ID] = compressed ? UPDATE_LZ_CMD : UPDATE_CMD;
+
+    if (Wire::GetVersion() >= WIRE_V2) {
+        offset += Wire::PutVarint(cmd_buf + offset, path.length);
+    } else {
+        snprintf(length, sizeof(length), "%03u", (unsigned int)path.length);
+        memcpy(cmd_buf + offset, length, 3);
+        offset += 3;
+    }
+
+    memcpy(cmd_buf + offset, path.data, path.length);
+    offset += path.length;
+
+    if (Wire::GetVersion() >= WIRE_V2) {
+        offset += Wire::PutVarint(cmd_buf + offset, data.length);
+    } else {
+        snprintf(length, sizeof(length), "%03u", (unsigned int)data.length);
+        memcpy(cmd_buf + offset, length, 3);
+        offset += 3;
+    }
+
+    memcpy(cmd_buf + offset, data.data, data.length);
+
+    return size;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Build_UpdateChunk
+*
+* PURPOSE : (ground) Builds into 'cmd_buf' the command of at most 'cmd_size'
+*           bytes that appends the most of 'file' from 'offset' to 'path',
+*           the board having the first 'offset' bytes already. Compressed
+*           with the end of those as dictionary, unless it does not carry
+*           more than the raw bytes.
+*
+* RETURN : the number of bytes written, 0 if the command can not be encoded.
+*          'consumed' is the number of bytes of 'file' it carries.
+*
+*-----------------------------------------------------------------------------*/
+size_t UpdateCommand::Build_UpdateChunk(char* cmd_buf, size_t cmd_size, WireView path, WireView file,
+                                                                    size_t offset, size_t* consumed)
+{
+    const unsigned char* bytes = (const unsigned char*)file.data;
+    size_t capacity = cmd_size;
+    size_t cmd_length = 0;
+    size_t dict_used = 0;
+
+    *consumed = 0;
+
+    // the largest payload that fits
+    while (capacity > 0 && ((cmd_length = UpdateCommand::GetCmdSize(path.length, capacity)) == 0
+                                                                        || cmd_length > cmd_size)) {
+        capacity--;
+    }
+
+    if (capacity == 0 || offset > file.length) {
+        return 0;
+    }
+
+    size_t raw = (file.length - offset < capacity) ? file.length - offset : capacity;
+    size_t input = (file.length - offset < UPDATE_LZ_MAX_SIZE) ? file.length - offset : UPDATE_LZ_MAX_SIZE;
+    size_t lz_consumed = 0;
+    std::vector<char> payload(UPDATE_LZ_HEAD_MAX_SIZE + capacity);
+
+    size_t lz_size = (capacity > UPDATE_LZ_HEAD_MAX_SIZE)
+                        ? Lzss_Compress(bytes, offset, bytes + offset, input,
+                                        (unsigned char*)&payload[UPDATE_LZ_HEAD_MAX_SIZE],
+                                        capacity - UPDATE_LZ_HEAD_MAX_SIZE, &lz_consumed, &dict_used)
+                        : 0;
+
+    if (lz_consumed <= raw) {
+        *consumed = raw;
+        return UpdateCommand::Build_UpdateCommand(cmd_buf, path, WireView(file.data + offset, raw));
+    }
+
+    // [size][dictionary size][dictionary crc], then the lzss stream moved up behind it
+    size_t head = Wire::PutVarint(&payload[0], lz_consumed);
+    head += Wire::PutVarint(&payload[head], dict_used);
+
+    if (dict_used > 0) {
+        Wire::PutUInt32(&payload[head], Crc32(bytes + offset - dict_used, dict_used));
+        head += 4;
+    }
+
+    memmove(&payload[head], &payload[UPDATE_LZ_HEAD_MAX_SIZE], lz_size);
+
+    *consumed = lz_consumed;
+    return UpdateCommand::Build_UpdateCommand(cmd_buf, path, WireView(&payload[0], head + lz_size), true);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdStr / GetCmdSize
+*
+* PURPOSE : Same as above, with the members of the command
+*
+*-----------------------------------------------------------------------------*/
+char* UpdateCommand::GetCmdStr(char* cmd_buf)
+{
+    if (UpdateCommand::Build_UpdateCommand(cmd_buf, this->path, this->file_data, this->compressed) == 0) {
+        return 0;
+    }
+
+    return cmd_buf;
+}
+
+size_t UpdateCommand::GetCmdSize()
+{
+    return UpdateCommand::GetCmdSize(this->path.length, this->file_data.length);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Decompress
+*
+* PURPOSE : Decompresses the data of an UPDATE_LZ_CMD into 'out' (at least
+*           UPDATE_LZ_MAX_SIZE bytes), with the end of the file 'fd' as
+*           dictionary
+*
+* RETURN : the number of bytes decompressed, -1 if the data is corrupt or
+*          the file does not end with the dictionary
+*
+*-----------------------------------------------------------------------------*/
+ssize_t UpdateCommand::Decompress(int fd, unsigned char* out)
+{
+    unsigned char dict[LZSS_WINDOW_SIZE];
+    const char* in = this->file_data.data;
+    size_t length = this->file_data.length;
+    unsigned int size = 0, dict_size = 0;
+    size_t offset = 0;
+    struct stat file_stat;
+
+    // the varints are read from a copy, they may end past the data
+    char head[UPDATE_LZ_HEAD_MAX_SIZE + WIRE_VARINT_MAX_SIZE] = {'\0'};
+    memcpy(head, in, (length < UPDATE_LZ_HEAD_MAX_SIZE) ? length : UPDATE_LZ_HEAD_MAX_SIZE);
+
+    offset += Wire::GetVarint(head, &size);
+    offset += Wire::GetVarint(head + offset, &dict_size);
+
+    if (size > UPDATE_LZ_MAX_SIZE || dict_size > LZSS_WINDOW_SIZE || offset > length
+            || fstat(fd, &file_stat) != 0 || (off_t)dict_size > file_stat.st_size) {
+        return -1;
+    }
+
+    if (dict_size > 0) {
+        if (offset + 4 > length || pread(fd, dict, dict_size, file_stat.st_size - dict_size) != (ssize_t)dict_size
+                                || Crc32(dict, dict_size) != Wire::GetUInt32(in + offset)) {
+            return -1;
+        }
+        offset += 4;
+    }
+
+    if (!Lzss_Decompress(dict, dict_size, (const unsigned char*)in + offset, length - offset, out, size)) {
+        return -1;
+    }
+
+    return size;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+*
+* PURPOSE : Appends the data (decompressed if UPDATE_LZ_CMD) to the file
+*
+*-----------------------------------------------------------------------------*/
+void UpdateCommand::Execute(ResultBuffer& result) {
     FILE* fp_update_file = NULL;
-    char* result = NULL;
+    char* data = NULL;
     int retry = 10000;
+    char path[CS1_PATH_MAX] = {'\0'};
+    unsigned char inflated[UPDATE_LZ_MAX_SIZE];
+    const char* bytes = this->file_data.data;
+    ssize_t length = this->file_data.length;
+    long long bytes_written = -1;
+    bool path_fits = this->path.CopyTo(path, CS1_PATH_MAX);
+
+    if (path_fits) {
+        CS1_LOG_STRING(CS1_LOG_NOTICE, CS1_COMMANDER, "Uploading file %s", path);
+    } else {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Update failure: path too long");
+    }
 
-    while(retry > 0 && fp_update_file == NULL){
-        fp_update_file = fopen(this->GetPath(), "ab+");
+    while(path_fits && retry > 0 && fp_update_file == NULL){
+        fp_update_file = fopen(path, "ab+");
         retry =- 1;
     }
 
-    printf("Uploading file %s\n", this->GetPath());
+    if (fp_update_file != NULL && this->compressed) {
+        length = this->Decompress(fileno(fp_update_file), inflated);
+        bytes = (const char*)inflated;
+
+        if (length < 0) {
+            snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Update failure: %s, bad data or dictionary", path);
+            Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], this->log_buffer);
+            fclose(fp_update_file);
+            fp_update_file = NULL;
+        }
+    }
 
     if(fp_update_file != NULL) {
         retry = 10000;
-        size_t bytes_left = this->GetDataLength();
-        size_t bytes_written = 0;
+        size_t bytes_left = length;
+        size_t written = 0;
         while(retry > 0 && bytes_left > 0){
-            bytes_left -= bytes_written;
-            bytes_written += fwrite(this->file_data + bytes_written, sizeof(char), bytes_left, fp_update_file);
+            bytes_left -= written;
+            written += fwrite(bytes + written, sizeof(char), bytes_left, fp_update_file);
             retry =- 1;
         }
 
         fclose(fp_update_file); 
-
-        result = (char* )malloc(sizeof(char) * (50 + CMD_RES_HEAD_SIZE) );
-        *pSize = 50 + CMD_RES_HEAD_SIZE;
-        memset(result + CMD_RES_HEAD_SIZE, '\0', sizeof(char) * 50);
-        sprintf(result, "%lld", (long long)bytes_written);
-        result[0] = UPDATE_CMD;
-        result[1] = CS1_SUCCESS;
+        bytes_written = written;
     }
 
-    return result;         
+    data = result.Alloc(sizeof(char) * (50 + CMD_RES_HEAD_SIZE));
+    if (data) {
+        memset(data + CMD_RES_HEAD_SIZE, '\0', sizeof(char) * 50);
+        snprintf(data + CMD_RES_HEAD_SIZE, 50, "%lld", bytes_written);
+        data[0] = this->compressed ? UPDATE_LZ_CMD : UPDATE_CMD;
+        data[1] = (bytes_written >= 0) ? CS1_SUCCESS : CS1_FAILURE;
+    }
 }
 InfoBytes* UpdateCommand::ParseResult(char *result)
 { 
     static struct InfoBytesUpdate info_bytes;
-    if(!result || result[0] != SETTIME_CMD) {
+    if(!WireResultHead<UPDATE_CMD>::Check(result) && !WireResultHead<UPDATE_LZ_CMD>::Check(result)) {
         Shakespeare::log(Shakespeare::ERROR,cs1_systems[CS1_COMMANDER],"Possible update failure: Can't parse result");
         info_bytes.update_status = CS1_FAILURE;
         return &info_bytes;
     }
 
-    info_bytes.update_status = result[1];
+    info_bytes.update_status = WireResultHead<UPDATE_CMD>::Get<CMD_STS>(result);
     info_bytes.bytes_written = result + CMD_RES_HEAD_SIZE; 
 
 
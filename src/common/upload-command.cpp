@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <string.h>
+#include "common/upload-command.h"
+#include "common/commands.h"
+#include "common/subsystems.h"
+#include "common/command-registry.h"
+#include "shakespeare.h"
+#include "SpaceDecl.h"
+#include "SpaceString.h"
+
+static CommandRegistrar<UploadCommand> registrar(UPLOAD_CMD, UPLOAD_CMD_MIN_SIZE);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground, the
+*           fields are read in Execute, within 'length' (see upload-command.h)
+*
+* RETURN : 0 for a write at an offset that is not a block boundary
+*
+*-----------------------------------------------------------------------------*/
+ICommand* UploadCommand::Create(char* data, size_t length, void* storage)
+{
+    if (UploadSchema::Get<UPLOAD_FIELD_OP>(data) == UPLOAD_WRITE && Wire::Fits(0, UploadWriteSchema::SIZE, length)
+                && UploadWriteSchema::Get<UPLOAD_WRITE_FIELD_OFFSET>(data) % UPLOAD_BLOCK_SIZE != 0) {
+        return 0;
+    }
+
+    return ConstructCommand<UploadCommand>(storage, WireView(data, length));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Build_Open / Build_Write / Build_Missing / Build_Finalize / Build_Abort
+*
+* PURPOSE : Builds the command into 'cmd_buf'
+*
+* RETURN : the number of bytes written, 0 if the command can not be encoded
+*          (a path too long, a write at an offset that is not a block 
+*          boundary)
+*
+*-----------------------------------------------------------------------------*/
+static size_t Build_Head(char* cmd_buf, char op, unsigned int id)
+{
+    UploadSchema::Init(cmd_buf);
+    UploadSchema::Put<UPLOAD_FIELD_OP>(cmd_buf, op);
+    UploadSchema::Put<UPLOAD_FIELD_ID>(cmd_buf, id);
+
+    return UploadSchema::SIZE;
+}
+
+size_t UploadCommand::Build_Open(char* cmd_buf, unsigned int id, unsigned int size, unsigned int crc, WireView path)
+{
+    if (path.length > UPLOAD_MAX_PATH_LENGTH) {
+        return 0;
+    }
+
+    Build_Head(cmd_buf, UPLOAD_OPEN, id);
+    UploadOpenSchema::Put<UPLOAD_OPEN_FIELD_SIZE>(cmd_buf, size);
+    UploadOpenSchema::Put<UPLOAD_OPEN_FIELD_CRC>(cmd_buf, crc);
+    UploadOpenSchema::Put<UPLOAD_OPEN_FIELD_PATH_LENGTH>(cmd_buf, (char)path.length);
+    memcpy(cmd_buf + UploadOpenSchema::SIZE, path.data, path.length);
+
+    return UploadOpenSchema::SIZE + path.length;
+}
+
+size_t UploadCommand::Build_Write(char* cmd_buf, unsigned int id, unsigned int offset, WireView data)
+{
+    if (offset % UPLOAD_BLOCK_SIZE != 0) {
+        return 0;
+    }
+
+    Build_Head(cmd_buf, UPLOAD_WRITE, id);
+    UploadWriteSchema::Put<UPLOAD_WRITE_FIELD_OFFSET>(cmd_buf, offset);
+    UploadWriteSchema::Put<UPLOAD_WRITE_FIELD_LENGTH>(cmd_buf, data.length);
+    memcpy(cmd_buf + UploadWriteSchema::SIZE, data.data, data.length);
+
+    return UploadWriteSchema::SIZE + data.length;
+}
+
+size_t UploadCommand::Build_Missing(char* cmd_buf, unsigned int id, unsigned int from)
+{
+    Build_Head(cmd_buf, UPLOAD_MISSING, id);
+    UploadMissingSchema::Put<UPLOAD_MISSING_FIELD_FROM>(cmd_buf, from);
+
+    return UploadMissingSchema::SIZE;
+}
+
+size_t UploadCommand::Build_Finalize(char* cmd_buf, unsigned int id)
+{
+    return Build_Head(cmd_buf, UPLOAD_FINALIZE, id);
+}
+
+size_t UploadCommand::Build_Abort(char* cmd_buf, unsigned int id)
+{
+    return Build_Head(cmd_buf, UPLOAD_ABORT, id);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+*
+* PURPOSE : Runs the operation on the upload session
+*
+* RESULT : [UPLOAD_CMD][STS][op][value]([count][ranges] for 'M')
+*
+*-----------------------------------------------------------------------------*/
+void UploadCommand::Execute(ResultBuffer& result)
+{
+    const char* command = this->command.data;
+    size_t length = this->command.length;
+    char op = UploadSchema::Get<UPLOAD_FIELD_OP>(command);
+    unsigned int id = UploadSchema::Get<UPLOAD_FIELD_ID>(command);
+    UploadSession* session = (op == UPLOAD_OPEN) ? 0 : UploadSession::Find(id);
+    UploadRange ranges[UPLOAD_MAX_RANGES];
+    size_t range_count = 0;
+    char status = CS1_FAILURE;
+    unsigned int value = 0;
+
+    switch (op) {
+        case UPLOAD_OPEN : {
+            char path[CS1_PATH_MAX] = {'\0'};
+
+            if (!Wire::Fits(0, UploadOpenSchema::SIZE, length)) {
+                break;
+            }
+
+            WireView path_view(command + UploadOpenSchema::SIZE,
+                               (unsigned char)UploadOpenSchema::Get<UPLOAD_OPEN_FIELD_PATH_LENGTH>(command));
+
+            if (Wire::Fits(UploadOpenSchema::SIZE, path_view.length, length) && path_view.CopyTo(path, CS1_PATH_MAX)) {
+                session = UploadSession::Open(id, path,
+                                              UploadOpenSchema::Get<UPLOAD_OPEN_FIELD_SIZE>(command),
+                                              UploadOpenSchema::Get<UPLOAD_OPEN_FIELD_CRC>(command));
+            }
+
+            if (session) {
+                status = CS1_SUCCESS;
+                value = session->GetReceived();
+            }
+            break;
+        }
+        case UPLOAD_WRITE :
+            if (session && Wire::Fits(0, UploadWriteSchema::SIZE, length)
+                        && Wire::Fits(UploadWriteSchema::SIZE, UploadWriteSchema::Get<UPLOAD_WRITE_FIELD_LENGTH>(command), length)
+                        && session->Write(UploadWriteSchema::Get<UPLOAD_WRITE_FIELD_OFFSET>(command),
+                                          command + UploadWriteSchema::SIZE,
+                                          UploadWriteSchema::Get<UPLOAD_WRITE_FIELD_LENGTH>(command))) {
+                status = CS1_SUCCESS;
+            }
+
+            value = session ? session->GetReceived() : 0;
+            break;
+        case UPLOAD_MISSING :
+            if (session && Wire::Fits(0, UploadMissingSchema::SIZE, length)) {
+                range_count = session->GetMissing(UploadMissingSchema::Get<UPLOAD_MISSING_FIELD_FROM>(command),
+                                                  ranges, UPLOAD_MAX_RANGES);
+                value = session->GetReceived();
+                status = CS1_SUCCESS;
+            }
+            break;
+        case UPLOAD_FINALIZE :
+            if (session && session->Finalize(&value)) {
+                status = CS1_SUCCESS;
+            }
+            break;
+        case UPLOAD_ABORT :
+            if (session) {
+                session->Abort();
+                status = CS1_SUCCESS;
+            }
+            break;
+        default :
+            break;
+    }
+
+    if (status != CS1_SUCCESS) {
+        snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Upload failure: op '%c', upload %u%s", op, id,
+                                                (session || op == UPLOAD_OPEN) ? "" : " not open");
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], this->log_buffer);
+    }
+
+    size_t size = UploadResultSchema::SIZE + ((op == UPLOAD_MISSING) ? 1 + range_count * UploadRangeSchema::SIZE : 0);
+    char* data = result.Alloc(size);
+
+    if (!data) {
+        return;
+    }
+
+    UploadResultSchema::Init(data);
+    UploadResultSchema::Put<CMD_STS>(data, status);
+    UploadResultSchema::Put<UPLOAD_RES_FIELD_OP>(data, op);
+    UploadResultSchema::Put<UPLOAD_RES_FIELD_VALUE>(data, value);
+
+    if (op == UPLOAD_MISSING) {
+        char* range = data + UploadResultSchema::SIZE;
+        *range++ = (char)range_count;
+
+        for (size_t i = 0; i < range_count; i++, range += UploadRangeSchema::SIZE) {
+            UploadRangeSchema::Put<UPLOAD_RANGE_FIELD_OFFSET>(range, ranges[i].offset);
+            UploadRangeSchema::Put<UPLOAD_RANGE_FIELD_LENGTH>(range, ranges[i].length);
+        }
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ParseResult
+*
+*-----------------------------------------------------------------------------*/
+InfoBytes* UploadCommand::ParseResult(char* result)
+{
+    static InfoBytesUpload info_bytes;
+
+    info_bytes.range_count = 0;
+    info_bytes.value = 0;
+    info_bytes.op = 0;
+
+    if (!UploadResultSchema::Check(result)) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Upload failure: Can't parse result");
+        info_bytes.upload_status = CS1_FAILURE;
+        return &info_bytes;
+    }
+
+    info_bytes.upload_status = UploadResultSchema::Get<CMD_STS>(result);
+    info_bytes.op = UploadResultSchema::Get<UPLOAD_RES_FIELD_OP>(result);
+    info_bytes.value = UploadResultSchema::Get<UPLOAD_RES_FIELD_VALUE>(result);
+
+    if (info_bytes.op == UPLOAD_MISSING && info_bytes.upload_status == CS1_SUCCESS) {
+        const char* range = result + UploadResultSchema::SIZE;
+        info_bytes.range_count = (unsigned char)*range++;
+
+        if (info_bytes.range_count > UPLOAD_MAX_RANGES) {
+            info_bytes.range_count = UPLOAD_MAX_RANGES;
+        }
+
+        for (size_t i = 0; i < info_bytes.range_count; i++, range += UploadRangeSchema::SIZE) {
+            info_bytes.ranges[i].offset = UploadRangeSchema::Get<UPLOAD_RANGE_FIELD_OFFSET>(range);
+            info_bytes.ranges[i].length = UploadRangeSchema::Get<UPLOAD_RANGE_FIELD_LENGTH>(range);
+        }
+    }
+
+    snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Upload %s: op '%c', %u",
+                    (info_bytes.upload_status == CS1_SUCCESS) ? "success" : "failure", info_bytes.op, info_bytes.value);
+    Shakespeare::log(info_bytes.upload_status == CS1_SUCCESS ? Shakespeare::NOTICE : Shakespeare::ERROR,
+                                                    cs1_systems[CS1_COMMANDER], this->log_buffer);
+
+    return &info_bytes;
+}
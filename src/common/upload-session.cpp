@@ -0,0 +1,473 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : upload-session.cpp
+*
+* DESCRIPTION : see upload-session.h
+*
+*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "shakespeare.h"
+#include "common/crc32.h"
+#include "common/subsystems.h"
+#include "common/upload-session.h"
+#include "common/wire.h"
+
+static UploadSession sessions[UPLOAD_MAX_SESSIONS];
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetFilePath
+*
+* PURPOSE : 'path' followed by 'extension' into 'buffer' (CS1_PATH_MAX bytes)
+*
+*-----------------------------------------------------------------------------*/
+static bool GetFilePath(char *buffer, const char *path, const char *extension)
+{
+    return snprintf(buffer, CS1_PATH_MAX, "%s%s", path, extension) < CS1_PATH_MAX;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : WriteAt
+*
+* PURPOSE : pwrite(2) until 'size' bytes are written
+*
+*-----------------------------------------------------------------------------*/
+static bool WriteAt(int fd, const void *data, size_t size, off_t offset)
+{
+    const char *bytes = (const char*)data;
+
+    while (size > 0) {
+        ssize_t n = pwrite(fd, bytes, size, offset);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        bytes += n;
+        offset += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : UploadSession
+*
+*-----------------------------------------------------------------------------*/
+UploadSession::UploadSession()
+{
+    this->id = 0;
+    this->size = 0;
+    this->crc = 0;
+    this->path[0] = '\0';
+    this->fd = -1;
+    this->state_fd = -1;
+    this->bitmap = 0;
+    this->blocks = 0;
+    this->received_blocks = 0;
+}
+
+UploadSession::~UploadSession()
+{
+    this->Close();
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Open
+*
+* PURPOSE : Opens the upload 'id' of 'size' bytes to 'path'. The upload
+*           resumes if 'path.upload' describes the same one, starts over
+*           otherwise. Opening an upload already open does nothing.
+*
+* RETURN : the session, 0 on failure
+*
+*-----------------------------------------------------------------------------*/
+UploadSession* UploadSession::Open(unsigned int id, const char *path, unsigned int size, unsigned int crc)
+{
+    char state_path[CS1_PATH_MAX] = {'\0'};
+    UploadSession *session = UploadSession::Find(id);
+
+    if (!path || path[0] == '\0' || size == 0 || size > UPLOAD_MAX_SIZE
+                                 || !GetFilePath(state_path, path, UPLOAD_STATE_EXT)) {
+        return 0;
+    }
+
+    if (session) {
+        if (strcmp(session->path, path) == 0 && session->size == size && session->crc == crc) {
+            return session;
+        }
+
+        session->Close();
+    }
+
+    for (int i = 0; i < UPLOAD_MAX_SESSIONS && !session; i++) {
+        if (!sessions[i].IsOpen()) {
+            session = &sessions[i];
+        }
+    }
+
+    if (!session) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Upload failure: too many uploads open");
+        return 0;
+    }
+
+    session->id = id;
+    session->size = size;
+    session->crc = crc;
+    session->blocks = (size + UPLOAD_BLOCK_SIZE - 1) / UPLOAD_BLOCK_SIZE;
+    session->received_blocks = 0;
+    snprintf(session->path, CS1_PATH_MAX, "%s", path);
+    session->bitmap = (unsigned char*)calloc((session->blocks + 7) / 8, 1);
+
+    if (!session->bitmap || !(session->Load() || session->Create())) {
+        session->Close();
+        return 0;
+    }
+
+    return session;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Find
+*
+* RETURN : the open upload 'id', 0 if there is none
+*
+*-----------------------------------------------------------------------------*/
+UploadSession* UploadSession::Find(unsigned int id)
+{
+    for (int i = 0; i < UPLOAD_MAX_SESSIONS; i++) {
+        if (sessions[i].IsOpen() && sessions[i].id == id) {
+            return &sessions[i];
+        }
+    }
+
+    return 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : CloseAll
+*
+* PURPOSE : Closes the uploads, their files are kept (i.e. before a reboot)
+*
+*-----------------------------------------------------------------------------*/
+void UploadSession::CloseAll()
+{
+    for (int i = 0; i < UPLOAD_MAX_SESSIONS; i++) {
+        sessions[i].Close();
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Load
+*
+* PURPOSE : Reads the bitmap of an interrupted upload from 'path.upload'
+*
+* RETURN : false if there is none, or it is not the same upload
+*
+*-----------------------------------------------------------------------------*/
+bool UploadSession::Load()
+{
+    char part_path[CS1_PATH_MAX] = {'\0'};
+    char state_path[CS1_PATH_MAX] = {'\0'};
+    char head[UPLOAD_STATE_HEAD_SIZE] = {'\0'};
+    size_t bitmap_size = (this->blocks + 7) / 8;
+
+    GetFilePath(part_path, this->path, UPLOAD_PART_EXT);
+    GetFilePath(state_path, this->path, UPLOAD_STATE_EXT);
+
+    this->fd = open(part_path, O_RDWR);
+    this->state_fd = open(state_path, O_RDWR);
+
+    if (this->fd == -1 || this->state_fd == -1
+            || pread(this->state_fd, head, UPLOAD_STATE_HEAD_SIZE, 0) != UPLOAD_STATE_HEAD_SIZE
+            || Wire::GetUInt32(head) != UPLOAD_STATE_MAGIC
+            || Wire::GetUInt32(head + 4) != this->id
+            || Wire::GetUInt32(head + 8) != this->size
+            || Wire::GetUInt32(head + 12) != this->crc
+            || pread(this->state_fd, this->bitmap, bitmap_size, UPLOAD_STATE_HEAD_SIZE) != (ssize_t)bitmap_size) {
+        if (this->fd != -1) {
+            close(this->fd);
+            this->fd = -1;
+        }
+
+        if (this->state_fd != -1) {
+            close(this->state_fd);
+            this->state_fd = -1;
+        }
+
+        return false;
+    }
+
+    for (unsigned int block = 0; block < this->blocks; block++) {
+        this->received_blocks += this->IsReceived(block);
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Creates 'path.part', its blocks reserved, and 'path.upload' with
+*           no block received
+*
+*-----------------------------------------------------------------------------*/
+bool UploadSession::Create()
+{
+    char part_path[CS1_PATH_MAX] = {'\0'};
+    char state_path[CS1_PATH_MAX] = {'\0'};
+    char head[UPLOAD_STATE_HEAD_SIZE] = {'\0'};
+    size_t bitmap_size = (this->blocks + 7) / 8;
+
+    GetFilePath(part_path, this->path, UPLOAD_PART_EXT);
+    GetFilePath(state_path, this->path, UPLOAD_STATE_EXT);
+
+    Wire::PutUInt32(head, UPLOAD_STATE_MAGIC);
+    Wire::PutUInt32(head + 4, this->id);
+    Wire::PutUInt32(head + 8, this->size);
+    Wire::PutUInt32(head + 12, this->crc);
+    memset(this->bitmap, 0, bitmap_size);
+    this->received_blocks = 0;
+
+    this->fd = open(part_path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    this->state_fd = open(state_path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+
+    if (this->fd == -1 || this->state_fd == -1) {
+        return false;
+    }
+
+    if (posix_fallocate(this->fd, 0, this->size) == ENOSPC) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Upload failure: no space left");
+        return false;
+    }
+
+    return ftruncate(this->fd, this->size) == 0
+                && WriteAt(this->state_fd, head, UPLOAD_STATE_HEAD_SIZE, 0)
+                && ftruncate(this->state_fd, UPLOAD_STATE_HEAD_SIZE + bitmap_size) == 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Write
+*
+* PURPOSE : Writes a chunk at 'offset' and marks the blocks it covers as
+*           received. A chunk is whole blocks : 'offset' is a multiple of
+*           UPLOAD_BLOCK_SIZE, and so is 'length' unless the chunk ends the
+*           file (the last block ends at 'size').
+*
+* RETURN : false if the chunk is not aligned, out of the file, or not written
+*
+*-----------------------------------------------------------------------------*/
+bool UploadSession::Write(unsigned int offset, const char *data, size_t length)
+{
+    if (!this->IsOpen() || length == 0 || offset > this->size || length > this->size - offset) {
+        return false;
+    }
+
+    unsigned int end = offset + length;
+
+    if (offset % UPLOAD_BLOCK_SIZE != 0 || (end % UPLOAD_BLOCK_SIZE != 0 && end != this->size)) {
+        return false;
+    }
+
+    if (!WriteAt(this->fd, data, length, offset)) {
+        return false;
+    }
+
+    this->Mark(offset / UPLOAD_BLOCK_SIZE, (end - 1) / UPLOAD_BLOCK_SIZE);
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Mark
+*
+* PURPOSE : Marks the blocks 'first' to 'last' as received, in the bitmap
+*           and in 'path.upload'. The data is written before, a block
+*           marked is always on disk.
+*
+*-----------------------------------------------------------------------------*/
+void UploadSession::Mark(unsigned int first, unsigned int last)
+{
+    for (unsigned int block = first; block <= last; block++) {
+        if (!this->IsReceived(block)) {
+            this->bitmap[block / 8] |= (unsigned char)(1 << (block % 8));
+            this->received_blocks++;
+        }
+    }
+
+    if (!WriteAt(this->state_fd, this->bitmap + first / 8, last / 8 - first / 8 + 1,
+                                                UPLOAD_STATE_HEAD_SIZE + first / 8)) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Upload: can't save the bitmap");
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetMissing
+*
+* PURPOSE : Fills 'ranges' with the ranges not received from the block of
+*           'from', at most 'max_ranges'
+*
+* RETURN : the number of ranges
+*
+*-----------------------------------------------------------------------------*/
+size_t UploadSession::GetMissing(unsigned int from, UploadRange *ranges, size_t max_ranges) const
+{
+    size_t count = 0;
+    unsigned int block = from / UPLOAD_BLOCK_SIZE;
+
+    while (count < max_ranges && block < this->blocks) {
+        if (this->IsReceived(block)) {
+            block++;
+            continue;
+        }
+
+        unsigned int start = block;
+        while (block < this->blocks && !this->IsReceived(block)) {
+            block++;
+        }
+
+        unsigned int end = block * UPLOAD_BLOCK_SIZE;
+        ranges[count].offset = start * UPLOAD_BLOCK_SIZE;
+        ranges[count].length = ((end < this->size) ? end : this->size) - ranges[count].offset;
+        count++;
+    }
+
+    return count;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetReceived
+*
+* RETURN : the number of bytes received
+*
+*-----------------------------------------------------------------------------*/
+unsigned int UploadSession::GetReceived() const
+{
+    unsigned int received = this->received_blocks * UPLOAD_BLOCK_SIZE;
+
+    if (this->blocks > 0 && this->IsReceived(this->blocks - 1)) {
+        received -= this->blocks * UPLOAD_BLOCK_SIZE - this->size;     // the last block is shorter
+    }
+
+    return received;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Finalize
+*
+* PURPOSE : Checks the CRC of the complete file and renames it to 'path',
+*           the session is closed. If the CRC does not match, every block
+*           is missing again.
+*
+* ARGUMENTS : crc   : output - the CRC of the file, 0 if blocks are missing
+*
+*-----------------------------------------------------------------------------*/
+bool UploadSession::Finalize(unsigned int *crc)
+{
+    char part_path[CS1_PATH_MAX] = {'\0'};
+    char state_path[CS1_PATH_MAX] = {'\0'};
+
+    *crc = 0;
+
+    if (!this->IsOpen() || this->received_blocks != this->blocks) {
+        return false;
+    }
+
+    if (fsync(this->fd) != 0 || !Crc32_File(this->fd, crc)) {
+        return false;
+    }
+
+    if (*crc != this->crc) {
+        memset(this->bitmap, 0, (this->blocks + 7) / 8);
+        this->received_blocks = 0;
+        WriteAt(this->state_fd, this->bitmap, (this->blocks + 7) / 8, UPLOAD_STATE_HEAD_SIZE);
+        return false;
+    }
+
+    GetFilePath(part_path, this->path, UPLOAD_PART_EXT);
+    GetFilePath(state_path, this->path, UPLOAD_STATE_EXT);
+
+    if (rename(part_path, this->path) != 0) {
+        return false;
+    }
+
+    remove(state_path);
+    this->Close();
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Abort
+*
+* PURPOSE : Closes the session and removes 'path.part' and 'path.upload'
+*
+*-----------------------------------------------------------------------------*/
+void UploadSession::Abort()
+{
+    char part_path[CS1_PATH_MAX] = {'\0'};
+    char state_path[CS1_PATH_MAX] = {'\0'};
+
+    GetFilePath(part_path, this->path, UPLOAD_PART_EXT);
+    GetFilePath(state_path, this->path, UPLOAD_STATE_EXT);
+
+    this->Close();
+
+    remove(part_path);
+    remove(state_path);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Close
+*
+* PURPOSE : Closes the session, its files are kept
+*
+*-----------------------------------------------------------------------------*/
+void UploadSession::Close()
+{
+    if (this->fd != -1) {
+        close(this->fd);
+    }
+
+    if (this->state_fd != -1) {
+        close(this->state_fd);
+    }
+
+    free(this->bitmap);
+
+    this->fd = -1;
+    this->state_fd = -1;
+    this->bitmap = 0;
+    this->id = 0;
+    this->size = 0;
+    this->crc = 0;
+    this->blocks = 0;
+    this->received_blocks = 0;
+    this->path[0] = '\0';
+}
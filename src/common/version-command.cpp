@@ -0,0 +1,144 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : version-command.cpp
+*
+*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/commands.h"
+#include "shakespeare.h"
+#include "SpaceDecl.h"
+#include "common/version-command.h"
+#include "common/subsystems.h"
+#include "common/command-registry.h"
+
+static CommandRegistrar<VersionCommand> registrar(VERSION_CMD, VERSION_CMD_SIZE);
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Create
+*
+* PURPOSE : Builds the command from the buffer received from the ground
+*
+*-----------------------------------------------------------------------------*/
+ICommand* VersionCommand::Create(char* data, size_t length, void* storage) {
+    return ConstructCommand<VersionCommand>(storage, (unsigned char)VersionSchema::Get<VERSION_FIELD_VERSION>(data));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : VersionCommand
+*
+* PURPOSE : Used by the GroundCommander to parse the results
+*
+*-----------------------------------------------------------------------------*/
+VersionCommand::VersionCommand()
+{
+    this->version = WIRE_MAX_VERSION;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : VersionCommand
+*
+* ARGUMENTS : version - highest version supported by the sender
+*
+*-----------------------------------------------------------------------------*/
+VersionCommand::VersionCommand(unsigned char version)
+{
+    this->version = version;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ~VersionCommand
+*
+*-----------------------------------------------------------------------------*/
+VersionCommand::~VersionCommand()
+{
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : Execute
+*
+* PURPOSE : Switches the session to the highest version supported by both
+*           sides. The commands received after this one are decoded with it.
+*
+* RESULT : [VERSION_CMD][STS][version in use], CS1_FAILURE if the ground does
+*          not even support WIRE_V1 (the version is not changed)
+*
+*-----------------------------------------------------------------------------*/
+void VersionCommand::Execute(ResultBuffer& result)
+{
+    unsigned char version = this->version;
+    char* data = result.Alloc(CMD_RES_HEAD_SIZE + VERSION_RTN_SIZE);
+
+    if (!data) {
+        return;
+    }
+
+    if (version > WIRE_MAX_VERSION) {
+        version = WIRE_MAX_VERSION;
+    }
+
+    VersionResultSchema::Init(data);
+    VersionResultSchema::Put<CMD_STS>(data, Wire::SetVersion(version) ? CS1_SUCCESS : CS1_FAILURE);
+    VersionResultSchema::Put<VERSION_FIELD_VERSION_IN_USE>(data, (char)Wire::GetVersion());
+
+    snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Wire format version %d (ground supports %d)",
+                                                            Wire::GetVersion(), this->version);
+    Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], this->log_buffer);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetCmdStr
+*
+* PURPOSE : Builds the command into 'cmd_buf' (VERSION_CMD_SIZE bytes)
+*
+*-----------------------------------------------------------------------------*/
+char* VersionCommand::GetCmdStr(char* cmd_buf)
+{
+    VersionSchema::Init(cmd_buf);
+    VersionSchema::Put<VERSION_FIELD_VERSION>(cmd_buf, (char)this->version);
+
+    return cmd_buf;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : ParseResult
+*
+* PURPOSE : Parses the result buffer returned by the execute function, on
+*           success the ground uses the version of the satellite from now on.
+*
+* RETURN : struct InfoBytes* to STATIC memory
+*
+*-----------------------------------------------------------------------------*/
+InfoBytes* VersionCommand::ParseResult(char *result)
+{
+    static struct InfoBytesVersion info_bytes;
+
+    if (!VersionResultSchema::Check(result)) {
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Version failure: Can't parse result");
+        info_bytes.version_status = CS1_FAILURE;
+        return &info_bytes;
+    }
+
+    info_bytes.version_status = VersionResultSchema::Get<CMD_STS>(result);
+    info_bytes.version = (unsigned char)VersionResultSchema::Get<VERSION_FIELD_VERSION_IN_USE>(result);
+
+    if (info_bytes.version_status == CS1_SUCCESS && Wire::SetVersion(info_bytes.version)) {
+        snprintf(this->log_buffer, CS1_MAX_LOG_ENTRY, "Version success: wire format version %d", info_bytes.version);
+        Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], this->log_buffer);
+    } else {
+        info_bytes.version_status = CS1_FAILURE;
+        Shakespeare::log(Shakespeare::ERROR, cs1_systems[CS1_COMMANDER], "Version failure: staying in the current version");
+    }
+
+    return &info_bytes;
+}
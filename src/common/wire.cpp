@@ -0,0 +1,198 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : wire.cpp
+*
+*----------------------------------------------------------------------------*/
+#include "common/wire.h"
+
+unsigned char Wire::version = WIRE_V1;
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : SetVersion
+*
+* RETURN : false if 'version' is not supported, the version is not changed
+*
+*-----------------------------------------------------------------------------*/
+bool Wire::SetVersion(unsigned char version)
+{
+    if (version < WIRE_V1 || version > WIRE_MAX_VERSION) {
+        return false;
+    }
+
+    Wire::version = version;
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : PutVarint
+*
+* PURPOSE : Writes 'value' as a varint into 'buffer' (at least
+*           WIRE_VARINT_MAX_SIZE bytes)
+*
+* RETURN : the number of bytes written
+*
+*-----------------------------------------------------------------------------*/
+size_t Wire::PutVarint(char *buffer, unsigned int value)
+{
+    size_t i = 0;
+
+    while (value >= 0x80) {
+        buffer[i++] = (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+
+    buffer[i++] = (char)value;
+
+    return i;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetVarint
+*
+* PURPOSE : Reads the varint at 'buffer' into 'value'
+*
+* RETURN : the number of bytes read, 0 if the varint is longer than
+*          WIRE_VARINT_MAX_SIZE ('value' is set to 0)
+*
+*-----------------------------------------------------------------------------*/
+size_t Wire::GetVarint(const char *buffer, unsigned int *value)
+{
+    unsigned int result = 0;
+
+    for (size_t i = 0; i < WIRE_VARINT_MAX_SIZE; i++) {
+        unsigned char byte = (unsigned char)buffer[i];
+        result |= (unsigned int)(byte & 0x7F) << (7 * i);
+
+        if (!(byte & 0x80)) {
+            *value = result;
+            return i + 1;
+        }
+    }
+
+    *value = 0;
+    return 0;
+}
+
+/* Same as above, the varint has to end within the 'size' bytes of 'buffer' */
+size_t Wire::GetVarint(const char *buffer, size_t size, unsigned int *value)
+{
+    char varint[WIRE_VARINT_MAX_SIZE] = {'\0'};
+
+    memcpy(varint, buffer, (size < WIRE_VARINT_MAX_SIZE) ? size : WIRE_VARINT_MAX_SIZE);
+
+    size_t read = Wire::GetVarint(varint, value);
+
+    if (read > size) {
+        *value = 0;
+        return 0;
+    }
+
+    return read;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : VarintSize
+*
+* RETURN : the number of bytes PutVarint writes for 'value'
+*
+*-----------------------------------------------------------------------------*/
+size_t Wire::VarintSize(unsigned int value)
+{
+    size_t size = 1;
+
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+
+    return size;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : PutUInt32
+*
+* PURPOSE : Writes 'value' as 4 bytes little-endian, whatever the host
+*
+*-----------------------------------------------------------------------------*/
+void Wire::PutUInt32(char *buffer, unsigned int value)
+{
+    buffer[0] = (char)(value & 0xFF);
+    buffer[1] = (char)((value >> 8) & 0xFF);
+    buffer[2] = (char)((value >> 16) & 0xFF);
+    buffer[3] = (char)((value >> 24) & 0xFF);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : GetUInt32
+*
+*-----------------------------------------------------------------------------*/
+unsigned int Wire::GetUInt32(const char *buffer)
+{
+    const unsigned char *bytes = (const unsigned char*)buffer;
+
+    return (unsigned int)bytes[0]
+         | ((unsigned int)bytes[1] << 8)
+         | ((unsigned int)bytes[2] << 16)
+         | ((unsigned int)bytes[3] << 24);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : PutInt64 / GetInt64
+*
+* PURPOSE : 8 bytes little-endian, two's complement (nanoseconds)
+*
+*-----------------------------------------------------------------------------*/
+void Wire::PutInt64(char *buffer, long long value)
+{
+    unsigned long long bits = (unsigned long long)value;
+
+    Wire::PutUInt32(buffer, (unsigned int)(bits & 0xFFFFFFFFULL));
+    Wire::PutUInt32(buffer + WIRE_UINT32_SIZE, (unsigned int)(bits >> 32));
+}
+
+long long Wire::GetInt64(const char *buffer)
+{
+    unsigned long long bits = (unsigned long long)Wire::GetUInt32(buffer)
+                            | ((unsigned long long)Wire::GetUInt32(buffer + WIRE_UINT32_SIZE) << 32);
+
+    return (long long)bits;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : CopyTo
+*
+* PURPOSE : Copies the view into 'buffer' as a null terminated string, i.e.
+*           to open a path.
+*
+* RETURN : false if it does not fit in 'size' bytes ('buffer' is then empty)
+*
+*-----------------------------------------------------------------------------*/
+bool WireView::CopyTo(char *buffer, size_t size) const
+{
+    if (size == 0) {
+        return false;
+    }
+
+    if (this->length >= size) {
+        buffer[0] = '\0';
+        return false;
+    }
+
+    if (this->length > 0) {
+        memcpy(buffer, this->data, this->length);
+    }
+
+    buffer[this->length] = '\0';
+
+    return true;
+}
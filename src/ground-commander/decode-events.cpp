@@ -0,0 +1,85 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : decode-events.cpp
+*
+* DESCRIPTION : Renders the event logs of the space-commander (see
+*               event-log.h) as text, or as CSV with -c.
+*
+*               usage : decode-events [-c] commander.evt...
+*
+*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "common/event-log.h"
+
+static bool ReadFile(const char *path, std::string *data)
+{
+    char buffer[4096];
+    size_t size = 0;
+    FILE *file = fopen(path, "rb");
+
+    if (!file) {
+        return false;
+    }
+
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data->append(buffer, size);
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    bool csv = (argc > 1 && strcmp(argv[1], "-c") == 0);
+    int first = csv ? 2 : 1;
+    int status = 0;
+
+    if (argc <= first) {
+        fprintf(stderr, "usage : %s [-c] commander.evt...\n", argv[0]);
+        return 1;
+    }
+
+    if (csv) {
+        printf("time,event,command,status,size,duration_us\n");
+    }
+
+    for (int i = first; i < argc; i++) {
+        std::string data;
+
+        if (!ReadFile(argv[i], &data)) {
+            perror(argv[i]);
+            status = 1;
+            continue;
+        }
+
+        if (data.size() < EVENT_LOG_FILE_HEADER_SIZE || data.compare(0, EVENT_LOG_MAGIC_SIZE, EVENT_LOG_MAGIC) != 0
+                                                     || data[EVENT_LOG_MAGIC_SIZE] != EVENT_LOG_VERSION) {
+            fprintf(stderr, "%s : not an event log (version %d)\n", argv[i], EVENT_LOG_VERSION);
+            status = 1;
+            continue;
+        }
+
+        char line[256];
+        size_t offset = EVENT_LOG_FILE_HEADER_SIZE;
+        size_t size = 0;
+
+        while ((size = EventLog::Format(data.data() + offset, data.size() - offset, line, sizeof(line), csv)) > 0) {
+            printf("%s\n", line);
+            offset += size;
+        }
+
+        if (offset != data.size()) {
+            fprintf(stderr, "%s : %lu bytes of a truncated record ignored\n", argv[i], (unsigned long)(data.size() - offset));
+        }
+    }
+
+    return status;
+}
@@ -2,20 +2,24 @@
 #include <cstdlib>
 #include <time.h>
 #include <cstring>
+#include <ctype.h>
 #include <signal.h>
 #include <sstream>
 #include <unistd.h>
 #include <inttypes.h>
 #include <fstream>
+#include <deque>
+#include <vector>
 
 #include "space-commander/Net2Com.h"
-#include "common/command-factory.h"
+#include "common/command-journal.h"
+#include "common/command-pipeline.h"
+#include "common/timesync-command.h"
+#include "common/update-command.h"
 #include "shakespeare.h"
 #include "common/subsystems.h"
 #include "SpaceDecl.h"
 
-const char MAGIC_BYTE = 0;
-
 const string LAST_COMMAND_FILENAME("last-command");
 const int COMMAND_RESEND_INDEX = 0;
 const char COMMAND_RESEND_CHAR = '!';
@@ -31,13 +35,55 @@ static char info_buffer[255] = {'\0'};
 static Net2Com* commander = 0; 
 static string stored_command;
 
+// a line read from the journal, 'end' its offset once read. The journal is
+// committed up to the last line done with every line before it done too.
+struct PendingLine {
+    off_t end;
+    bool done;
+};
+static std::deque<PendingLine> pending;
+
+// the "timesync N" line in progress : N samples, then the slew, see
+// timesync-command.h. 'end' is -1 when there is none.
+#define TIMESYNC_MAX_SAMPLES PIPELINE_WINDOW
+struct TimeSyncRun {
+    off_t end;
+    size_t wanted;
+    size_t replies;
+    bool slewing;
+    std::vector<TimeSyncSample> samples;
+};
+static TimeSyncRun timesync;
+static long long reply_realtime = 0;    // t3, when the last reply was read
+
+// the "update <file> <path on board>" line in progress : one chunk in
+// flight, the next one is compressed with the bytes before it as dictionary
+struct UpdateRun {
+    off_t end;
+    string file;
+    string path;
+    size_t offset;          // bytes the board has
+    size_t consumed;        // bytes of the chunk in flight
+};
+static UpdateRun update;
+
 const char* LOGNAME = cs1_systems[CS1_COMMANDER];
-const char CMD_INPUT_FILE[] = "/home/todo"; 
-const char CMD_TEMP_FILE[] = "/home/groundCommanderTemp"; //###MAKE SURE TO HAVE WRITE PERMISSIONS###
+const char CMD_INPUT_FILE[] = "/home/todo";     // a CommandJournal, its cursor is /home/todo.cursor
+static CommandJournal journal(CMD_INPUT_FILE);
 string* GetGarbage(char* result_buffer);
 void perform(int bytes);
-void read_command();
-void delete_command();
+void read_commands();
+static size_t parse_command(const string& line, char* cmd_buf, size_t cmd_size);
+static bool send_frame(const char* frame, size_t size, void* context);
+static void on_reply(unsigned char id, InfoBytes* info, long tag, void* context);
+static void commit_done();
+static void line_done(off_t end);
+static bool start_timesync(const string& line, off_t end);
+static void on_timesync_reply(InfoBytes* info);
+static bool start_update(const string& line, off_t end);
+static bool send_update_chunk();
+static void on_update_reply(InfoBytes* info);
+static CommandPipeline pipeline(send_frame, on_reply, 0);     // the commands in flight, see command-pipeline.h
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
  *
  * NAME : main 
@@ -45,24 +91,36 @@ void delete_command();
  * DESCRIPTION : space-commander main 
  *
  *-----------------------------------------------------------------------------*/
-int main() 
+int main(int argc, char** argv) 
 {
+    // ground-commander 'command'... : queues the commands and exits
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            if (!CommandJournal::Append(CMD_INPUT_FILE, argv[i])) {
+                cout << "Command not queued : " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
     commander = new Net2Com(Dcom_w_net_r, Dnet_w_com_r, Icom_w_net_r, Inet_w_com_r);
+    timesync.end = -1;
+    update.end = -1;
 
     while (true)
     {
         memset(info_buffer, 0, sizeof(char) * 255);
         
-        //int bytes = commander->ReadFromInfoPipe(info_buffer, 255);
-        int bytes = 1;
+        int bytes = commander->ReadFromInfoPipe(info_buffer, 255);
         if (bytes > 0) {
             //get result
- //           perform(bytes);
+            perform(bytes);
         }
 
-        read_command();
-        delete_command();
-        sleep(COMMANER_SLEEP_TIME);
+        read_commands();
+        pipeline.Pump();     // the frames without a reply are sent again
+        journal.Wait(pipeline.InFlight() > 0 ? PIPELINE_TIMEOUT / 4 : COMMANER_SLEEP_TIME * 1000);
     }        
     
     if (commander) {
@@ -72,45 +130,297 @@ int main()
     return 0;
 }
 
-void read_command(){
-    ifstream infile(CMD_INPUT_FILE);
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : read_commands 
+ *
+ * DESCRIPTION : keeps the window of the pipeline full with the commands
+ *               queued. A line is done once its command got its reply or
+ *               was given up, see on_reply, and the journal is committed
+ *               up to the last line done in order : a restart sends again
+ *               the ones without a reply.
+ *
+ *-----------------------------------------------------------------------------*/
+void read_commands(){
+    char cmd_buf[MAX_COMMAND_SIZE];
+
+    while (pipeline.InFlight() + pipeline.Queued() < PIPELINE_WINDOW && journal.Next(&stored_command)) {
+        PendingLine line;
+        line.end = journal.GetOffset();
+        line.done = false;
 
-    if(infile.good()){
-        getline(infile, stored_command);
+        size_t size = parse_command(stored_command, cmd_buf, sizeof(cmd_buf));
         cout << stored_command << endl;
+
+        pending.push_back(line);
+
+        if (stored_command.compare(0, 8, "timesync") == 0) {
+            pending.back().done = !start_timesync(stored_command, line.end);
+            continue;
+        }
+
+        if (stored_command.compare(0, 7, "update ") == 0) {
+            pending.back().done = !start_update(stored_command, line.end);
+            continue;
+        }
+
+        if (size == 0 || !pipeline.Submit(cmd_buf, size, (long)line.end)) {
+            snprintf(log_buffer, sizeof(log_buffer), "Command not understood, dropped : %s", stored_command.c_str());
+            Shakespeare::log(Shakespeare::ERROR, LOGNAME, log_buffer);
+            pending.back().done = true;
+        }
     }
 
-    //TODO: write to pipes
-    infile.close();
+    commit_done();
 }
 
-void delete_command(){
-    string read_command;
-    ifstream in(CMD_INPUT_FILE);
-    int temp;
-    
-    if( !in.is_open()){
-        cout << "Command input file failed to open" << endl;
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : commit_done 
+ *
+ * DESCRIPTION : commits the journal up to the last line done with every
+ *               line before it done too
+ *
+ *-----------------------------------------------------------------------------*/
+void commit_done(){
+    off_t end = -1;
+
+    while (!pending.empty() && pending.front().done) {
+        end = pending.front().end;
+        pending.pop_front();
+    }
+
+    if (end >= 0) {
+        journal.Commit(end);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : start_timesync 
+ *
+ * DESCRIPTION : "timesync N" : submits N TIMESYNC_OP_SAMPLE (8 without N, at
+ *               most TIMESYNC_MAX_SAMPLES), their t0 is stamped by send_frame.
+ *               One at a time.
+ *
+ * RETURN : false if the line is dropped
+ *
+ *-----------------------------------------------------------------------------*/
+bool start_timesync(const string& line, off_t end){
+    char cmd_buf[TIMESYNC_CMD_SIZE];
+    int wanted = TIMESYNC_MAX_SAMPLES;
+
+    if (timesync.end >= 0 || (line.size() > 8 && sscanf(line.c_str() + 8, "%d", &wanted) != 1)
+                || wanted < 1 || wanted > TIMESYNC_MAX_SAMPLES) {
+        snprintf(log_buffer, sizeof(log_buffer), "TimeSync not started, dropped : %s", line.c_str());
+        Shakespeare::log(Shakespeare::ERROR, LOGNAME, log_buffer);
+        return false;
+    }
+
+    timesync.end = end;
+    timesync.wanted = (size_t)wanted;
+    timesync.replies = 0;
+    timesync.slewing = false;
+    timesync.samples.clear();
+
+    TimeSyncCommand::Build_TimeSyncCommand(cmd_buf, TIMESYNC_OP_SAMPLE, 0);
+
+    for (int i = 0; i < wanted; i++) {
+        if (!pipeline.Submit(cmd_buf, sizeof(cmd_buf), (long)end)) {
+            timesync.end = -1;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : on_timesync_reply 
+ *
+ * DESCRIPTION : a sample (0 if given up) or the slew of the timesync in
+ *               progress. Once every sample is in, the offset is estimated
+ *               and the opposite is slewed on board.
+ *
+ *-----------------------------------------------------------------------------*/
+void on_timesync_reply(InfoBytes* info){
+    InfoBytesTimeSync* result = (InfoBytesTimeSync*)info;
+    off_t end = timesync.end;
+
+    if (timesync.slewing) {
+        timesync.end = -1;
+        line_done(end);
         return;
     }
-    
-    ofstream out(CMD_TEMP_FILE);
 
-    if( !out.is_open()){
-        cout << "Temp file failed to open. Check directory permmissions" << endl;
+    if (result && result->timesync_status == CS1_SUCCESS && result->op == TIMESYNC_OP_SAMPLE) {
+        TimeSyncSample sample = result->sample;
+        sample.t3 = reply_realtime;
+        timesync.samples.push_back(sample);
+    }
+
+    if (++timesync.replies < timesync.wanted) {
         return;
     }
 
-    while( getline(in,read_command) ){
-        if(read_command.compare(stored_command) != 0){
-            out << read_command << "\n";
+    TimeSyncEstimate estimate;
+    char cmd_buf[TIMESYNC_CMD_SIZE];
+
+    if (timesync.samples.empty() || !TimeSyncCommand::Estimate(&timesync.samples[0], timesync.samples.size(), &estimate)) {
+        Shakespeare::log(Shakespeare::ERROR, LOGNAME, "TimeSync: no valid sample");
+    } else if (llabs(estimate.offset) > TIMESYNC_MAX_SLEW_NS) {
+        snprintf(log_buffer, sizeof(log_buffer), "TimeSync: offset of %lld us, set the time first", estimate.offset / 1000);
+        Shakespeare::log(Shakespeare::ERROR, LOGNAME, log_buffer);
+    } else {
+        snprintf(log_buffer, sizeof(log_buffer), "TimeSync: offset of %lld us (+/- %lld us, %lu samples)",
+                        estimate.offset / 1000, estimate.delay / 2000, (unsigned long)estimate.samples);
+        Shakespeare::log(Shakespeare::NOTICE, LOGNAME, log_buffer);
+
+        TimeSyncCommand::Build_TimeSyncCommand(cmd_buf, TIMESYNC_OP_SLEW, -estimate.offset);
+        timesync.slewing = pipeline.Submit(cmd_buf, sizeof(cmd_buf), (long)end);
+    }
+
+    if (!timesync.slewing) {
+        timesync.end = -1;
+        line_done(end);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : start_update 
+ *
+ * DESCRIPTION : "update <file> <path on board>" : sends the file in
+ *               UPDATE_CMD / UPDATE_LZ_CMD chunks (see update-command.h),
+ *               one at a time : they are appended in order. The file must
+ *               not exist on board, a restart sends it again from the start.
+ *               One at a time.
+ *
+ * RETURN : false if the line is dropped
+ *
+ *-----------------------------------------------------------------------------*/
+bool start_update(const string& line, off_t end){
+    std::istringstream fields(line.substr(7));
+    string file_name;
+
+    update.path.clear();
+
+    if (update.end >= 0 || !(fields >> file_name >> update.path)) {
+        snprintf(log_buffer, sizeof(log_buffer), "Update not started, dropped : %s", line.c_str());
+        Shakespeare::log(Shakespeare::ERROR, LOGNAME, log_buffer);
+        return false;
+    }
+
+    std::ifstream file(file_name.c_str(), std::ios::in | std::ios::binary);
+    std::ostringstream bytes;
+
+    if (!file || !(bytes << file.rdbuf())) {
+        snprintf(log_buffer, sizeof(log_buffer), "Update not started, can't read : %s", file_name.c_str());
+        Shakespeare::log(Shakespeare::ERROR, LOGNAME, log_buffer);
+        return false;
+    }
+
+    update.end = end;
+    update.file = bytes.str();
+    update.offset = 0;
+
+    if (!send_update_chunk()) {
+        update.end = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : send_update_chunk 
+ *
+ * DESCRIPTION : submits the chunk of the update from 'update.offset'
+ *
+ * RETURN : false if it can't be built
+ *
+ *-----------------------------------------------------------------------------*/
+bool send_update_chunk(){
+    char cmd_buf[MAX_COMMAND_SIZE];
+    size_t size = UpdateCommand::Build_UpdateChunk(cmd_buf, sizeof(cmd_buf), WireView(update.path.c_str()),
+                                    WireView(update.file.data(), update.file.size()), update.offset, &update.consumed);
+
+    if (size == 0 || !pipeline.Submit(cmd_buf, size, (long)update.end)) {
+        snprintf(log_buffer, sizeof(log_buffer), "Update of %s : can't build the chunk at %lu",
+                                                update.path.c_str(), (unsigned long)update.offset);
+        Shakespeare::log(Shakespeare::ERROR, LOGNAME, log_buffer);
+        return false;
+    }
+
+    return true;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : on_update_reply 
+ *
+ * DESCRIPTION : the reply to a chunk of the update in progress (0 if given
+ *               up) : the next chunk, or the update is done
+ *
+ *-----------------------------------------------------------------------------*/
+void on_update_reply(InfoBytes* info){
+    InfoBytesUpdate* result = (InfoBytesUpdate*)info;
+    off_t end = update.end;
+
+    if (result && result->update_status == CS1_SUCCESS) {
+        update.offset += update.consumed;
+
+        if (update.offset < update.file.size() && send_update_chunk()) {
+            return;
+        }
+    }
+
+    snprintf(log_buffer, sizeof(log_buffer), "Update of %s %s : %lu of %lu bytes", update.path.c_str(),
+                    (update.offset == update.file.size()) ? "done" : "stopped",
+                    (unsigned long)update.offset, (unsigned long)update.file.size());
+    Shakespeare::log((update.offset == update.file.size()) ? Shakespeare::NOTICE : Shakespeare::ERROR, LOGNAME, log_buffer);
+
+    update.end = -1;
+    update.file.clear();
+    line_done(end);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : parse_command 
+ *
+ * DESCRIPTION : a line of the journal is the command buffer in hex, two
+ *               digits a byte, spaces allowed : "31" is a GetTimeCommand.
+ *               The other lines are "timesync N" (see start_timesync) and
+ *               "update <file> <path on board>" (see start_update).
+ *
+ * RETURN : the size of the command, 0 if the line is not hex or too long
+ *
+ *-----------------------------------------------------------------------------*/
+size_t parse_command(const string& line, char* cmd_buf, size_t cmd_size){
+    size_t size = 0;
+    size_t i = 0;
+
+    while (i < line.size()) {
+        unsigned int byte = 0;
+
+        if (line[i] == ' ' || line[i] == '\t' || line[i] == '\r') {
+            i++;
+            continue;
         }
+
+        if (size == cmd_size || i + 1 >= line.size() || !isxdigit((unsigned char)line[i])
+                || !isxdigit((unsigned char)line[i + 1]) || sscanf(line.c_str() + i, "%2x", &byte) != 1) {
+            return 0;
+        }
+
+        cmd_buf[size++] = (char)byte;
+        i += 2;
     }
 
-    in.close();
-    out.close();    
-    remove(CMD_INPUT_FILE);
-    rename(CMD_TEMP_FILE,CMD_INPUT_FILE);
+    return size;
 }
 
 
@@ -134,15 +444,23 @@ void perform(int bytes){
                     data_bytes = commander->ReadFromDataPipe(buffer, read_total);
 
                     if (data_bytes > 0) {
+                        reply_realtime = TimeSyncCommand::Now(CLOCK_REALTIME);
+
                         if (data_bytes != read_total) {
                             Shakespeare::log(Shakespeare::ERROR, LOGNAME, "Something went wrong !!");
                             read_total = 0;
                             break;
                         }
 
+                        if (pipeline.OnReply(buffer, data_bytes) || buffer[CMD_ID] == (char)PIPELINE_FRAME) {
+                            free(buffer);       // matched to its command, or a reply already received
+                            buffer = NULL;
+                            break;
+                        }
+
                         string* obtainedSpaceGarbage = GetGarbage(buffer);
                         if (obtainedSpaceGarbage != NULL) { // success
-                            if (buffer[MAGIC_BYTE] == GETLOG_CMD) {
+                            if (buffer[CMD_ID] == GETLOG_CMD) {
                                 // TODO: log to proper system (get log)
                             } else {
                                 Shakespeare::log(Shakespeare::NOTICE, "GROUND_COMMANDER", obtainedSpaceGarbage->c_str());
@@ -150,7 +468,6 @@ void perform(int bytes){
 
                             delete obtainedSpaceGarbage;
                             obtainedSpaceGarbage = NULL;
-                            delete_command();
                         }
 
                         free(buffer);
@@ -178,34 +495,85 @@ void perform(int bytes){
     return; 
 }
 
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : send_frame 
+ *
+ * DESCRIPTION : sends a frame of the pipeline to the satellite, stamps t0
+ *               of the timesync samples
+ *
+ *-----------------------------------------------------------------------------*/
+bool send_frame(const char* frame, size_t size, void* context){
+    char stamped[PIPELINE_HEAD_SIZE + TIMESYNC_CMD_SIZE];
+    const char* command = frame + PIPELINE_HEAD_SIZE;
+
+    // t0 of a timesync sample is the time it leaves, a frame sent again is a new sample
+    if (size == sizeof(stamped) && command[CMD_ID] == (char)TIMESYNC_CMD
+                && TimeSyncSchema::Get<TIMESYNC_FIELD_OP>(command) == TIMESYNC_OP_SAMPLE) {
+        memcpy(stamped, frame, size);
+        TimeSyncSchema::Put<TIMESYNC_FIELD_VALUE>(stamped + PIPELINE_HEAD_SIZE, TimeSyncCommand::Now(CLOCK_REALTIME));
+        frame = stamped;
+    }
+
+    return commander && commander->WriteToDataPipe(frame, (int)size) == (int)size;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : on_reply 
+ *
+ * DESCRIPTION : the reply to a command of the pipeline, 0 if it got none.
+ *               'tag' is the offset of the end of its line in the journal.
+ *
+ *-----------------------------------------------------------------------------*/
+void on_reply(unsigned char id, InfoBytes* info, long tag, void* context){
+    if (id == TIMESYNC_CMD && timesync.end >= 0 && (off_t)tag == timesync.end) {
+        on_timesync_reply(info);
+        return;
+    }
+
+    if ((id == UPDATE_CMD || id == UPDATE_LZ_CMD) && update.end >= 0 && (off_t)tag == update.end) {
+        on_update_reply(info);
+        return;
+    }
+
+    if (!info) {
+        Shakespeare::log(Shakespeare::ERROR, "GROUND_COMMANDER", "No reply to the command, given up");
+    } else {
+        string* garbage = info->ToString();
+        Shakespeare::log(Shakespeare::NOTICE, "GROUND_COMMANDER", garbage->c_str());
+        delete garbage;
+    }
+
+    line_done((off_t)tag);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : line_done 
+ *
+ * DESCRIPTION : the line of the journal ending at 'end' is done
+ *
+ *-----------------------------------------------------------------------------*/
+void line_done(off_t end){
+    for (std::deque<PendingLine>::iterator it = pending.begin(); it != pending.end(); ++it) {
+        if (it->end == end) {
+            it->done = true;
+            break;
+        }
+    }
+
+    commit_done();
+}
+
 string* GetGarbage(char* result_buffer){
 
-            InfoBytes* result2;
-            switch(result_buffer[MAGIC_BYTE]){
-                
-                case UPDATE_CMD: 
-                    result2 = (InfoBytes* )UpdateCommand::ParseResult(result_buffer);
-                    break;
-                case GETTIME_CMD: 
-                    result2 = (InfoBytes* )GetTimeCommand::ParseResult(result_buffer);
-                    break;
-                case SETTIME_CMD:
-                    result2 = (InfoBytes* )SetTimeCommand::ParseResult(result_buffer);
-                    break;
-//                case GETLOG_CMD:
-//                    result2 = (InfoBytes* )GetLogCommand::ParseResult(result_buffer);
-//                    break;
-//                case DELETELOG_CMD:
-//                    result2 = (InfoBytes* )DeleteLogCommand::ParseResult(result_buffer);
-//                    break;
-                case REBOOT_CMD:
-                    result2 = (InfoBytes* )RebootCommand::ParseResult(result_buffer);
-                    break;
-                case DECODE_CMD:
-                    result2 = (InfoBytes* )DecodeCommand::ParseResult(result_buffer);
-                    break;
-                default:
-                    cout << "Goodbye world!" << endl;
+            // every command registers its parser, see command-registry.h
+            InfoBytes* result2 = CommandRegistry::Parse(result_buffer);
+
+            if (!result2) {
+                cout << "Goodbye world!" << endl;
+                return NULL;
             }
 
             string *garbage = result2->ToString();       
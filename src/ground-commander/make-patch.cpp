@@ -0,0 +1,68 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : make-patch.cpp
+*
+* DESCRIPTION : Makes the delta patch between the version of a file on board
+*               and its new version (see delta-patch.h). The patch is sent with
+*               the UploadCommand, then applied with the PatchCommand.
+*
+*               usage : make-patch old new patch
+*
+*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <string>
+
+#include "common/delta-patch.h"
+
+static bool ReadFile(const char *path, std::string *data)
+{
+    char buffer[DELTA_PATCH_BUFFER_SIZE];
+    size_t size = 0;
+    FILE *file = fopen(path, "rb");
+
+    if (!file) {
+        return false;
+    }
+
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data->append(buffer, size);
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    std::string old_data, new_data, patch;
+
+    if (argc != 4) {
+        fprintf(stderr, "usage : %s old new patch\n", argv[0]);
+        return 1;
+    }
+
+    if (!ReadFile(argv[1], &old_data) || !ReadFile(argv[2], &new_data)) {
+        perror("make-patch");
+        return 1;
+    }
+
+    if (!DeltaPatch_Create((const unsigned char*)old_data.data(), old_data.size(),
+                           (const unsigned char*)new_data.data(), new_data.size(), &patch)) {
+        fprintf(stderr, "make-patch : files too large\n");
+        return 1;
+    }
+
+    FILE *file = fopen(argv[3], "wb");
+
+    if (!file || fwrite(patch.data(), 1, patch.size(), file) != patch.size() || fclose(file) != 0) {
+        perror("make-patch");
+        return 1;
+    }
+
+    printf("%s : %lu bytes (new file : %lu bytes)\n", argv[3], (unsigned long)patch.size(), (unsigned long)new_data.size());
+    return 0;
+}
@@ -193,6 +193,32 @@ int NamedPipe::WriteToPipe(const void* buffer, int size)
     return bytes_written;
 }
 
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : WriteToPipe
+* 
+* PURPOSE : Writes the whole 'result' to the pipe, segment by segment (writev,
+*           splice), see ResultBuffer::WriteTo.
+*
+* RETURN : Number of bytes written, negative value if it is incomplete.
+*
+*-----------------------------------------------------------------------------*/
+int NamedPipe::WriteToPipe(const ResultBuffer& result)
+{
+    if(!Open('w')) {
+       return -1;
+    }
+
+    ssize_t bytes_written = result.WriteTo(fifo);
+
+    if (bytes_written < 0) {
+        fprintf(stderr, "Couldn't write the result to the fifo : %s\n", strerror(errno));
+        return -1;
+    }
+
+    return (int)bytes_written;
+}
+
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
 * NAME : Exist
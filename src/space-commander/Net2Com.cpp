@@ -104,6 +104,11 @@ int Net2Com::WriteToDataPipe(const void* data, int size)
     return result;
 }
 
+int Net2Com::WriteToDataPipe(const ResultBuffer& result)
+{
+    return dataPipe_w->WriteToPipe(result);
+}
+
 int Net2Com::WriteToDataPipe(unsigned char number)
 {
     unsigned char byte = number;
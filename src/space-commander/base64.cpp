@@ -1,4 +1,4 @@
-/* 
+/*
    base64.cpp and base64.h
 
    Copyright (C) 2004-2008 René Nyffenegger
@@ -25,98 +25,432 @@
 
 */
 
+/*
+   ALTERED by Space Concordia 2015 : encodes and decodes caller-provided
+   buffers with lookup tables, SSSE3 / AVX2 decoding on x86. base64_encode
+   and base64_decode are wrappers returning the same strings as the
+   original version.
+*/
+
+#include <string.h>
+
 #include "space-commander/base64.h"
-#include <iostream>
 
-static const std::string base64_chars = 
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(BASE64_NO_SIMD) \
+        && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define BASE64_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#define BASE64_INVALID 0x80
+
+static const char base64_chars[] =
              "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
              "abcdefghijklmnopqrstuvwxyz"
              "0123456789+/";
 
+/* value of each character, BASE64_INVALID for '=' and the non base64 ones */
+static const unsigned char base64_values[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3e, 0x80, 0x80, 0x80, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : base64_encode_buffer
+*
+* PURPOSE : Encodes 'len' bytes into 'out', BASE64_ENCODED_SIZE(len) bytes,
+*           padded with '=', not null terminated.
+*
+* RETURN : the number of characters written, BASE64_ENCODED_SIZE(len)
+*
+*-----------------------------------------------------------------------------*/
+size_t base64_encode_buffer(const unsigned char *in, size_t len, char *out)
+{
+    char *start = out;
+    size_t i = 0;
+
+    for (; i + 3 <= len; i += 3) {
+        unsigned int v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+
+        out[0] = base64_chars[v >> 18];
+        out[1] = base64_chars[(v >> 12) & 0x3f];
+        out[2] = base64_chars[(v >> 6) & 0x3f];
+        out[3] = base64_chars[v & 0x3f];
+        out += 4;
+    }
+
+    if (i < len) {
+        unsigned int v = in[i] << 16;
+
+        if (i + 1 < len) {
+            v |= in[i + 1] << 8;
+        }
+
+        out[0] = base64_chars[v >> 18];
+        out[1] = base64_chars[(v >> 12) & 0x3f];
+        out[2] = (i + 1 < len) ? base64_chars[(v >> 6) & 0x3f] : '=';
+        out[3] = '=';
+        out += 4;
+    }
 
-static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
+    return out - start;
 }
 
-std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  while (in_len--) {
-    char_array_3[i++] = *(bytes_to_encode++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-
-      for(i = 0; (i <4) ; i++)
-        ret += base64_chars[char_array_4[i]];
-      i = 0;
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : base64_decode_scalar
+*
+* PURPOSE : Decodes 'in' into 'out' (BASE64_DECODED_MAX_SIZE(len) bytes) one
+*           group of 4 characters at a time, until the first '=' or non
+*           base64 character. A last group of n < 4 characters gives n - 1
+*           bytes.
+*
+* RETURN : the number of bytes written
+*
+*-----------------------------------------------------------------------------*/
+size_t base64_decode_scalar(const char *in, size_t len, unsigned char *out)
+{
+    const unsigned char *p = (const unsigned char*)in;
+    unsigned char *start = out;
+    size_t i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+        unsigned int a = base64_values[p[i]];
+        unsigned int b = base64_values[p[i + 1]];
+        unsigned int c = base64_values[p[i + 2]];
+        unsigned int d = base64_values[p[i + 3]];
+
+        if ((a | b | c | d) & BASE64_INVALID) {
+            break;
+        }
+
+        unsigned int v = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = (unsigned char)(v >> 16);
+        out[1] = (unsigned char)(v >> 8);
+        out[2] = (unsigned char)v;
+        out += 3;
     }
-  }
 
-  if (i)
-  {
-    for(j = i; j < 3; j++)
-      char_array_3[j] = '\0';
+    // last group : the valid characters before the end or the first invalid one
+    unsigned int values[3] = {0};
+    size_t n = 0;
+
+    while (n < 3 && i + n < len && !(base64_values[p[i + n]] & BASE64_INVALID)) {
+        values[n] = base64_values[p[i + n]];
+        n++;
+    }
 
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
+    if (n >= 2) {
+        *out++ = (unsigned char)((values[0] << 2) | (values[1] >> 4));
+    }
 
-    for (j = 0; (j < i + 1); j++)
-      ret += base64_chars[char_array_4[j]];
+    if (n == 3) {
+        *out++ = (unsigned char)((values[1] << 4) | (values[2] >> 2));
+    }
 
-    while((i++ < 3))
-      ret += '=';
+    return out - start;
+}
 
-  }
+#ifdef BASE64_X86_SIMD
+/*
+ * Vector decoding : each character is translated by adding the offset of its
+ * range (A-Z : -65, a-z : -71, 0-9 : +4, '+' : +19, '/' : +16), then the 6 bit
+ * values are packed with two multiply-adds and a shuffle. A block holding a
+ * character out of the ranges is left to base64_decode_scalar.
+ */
+#define BASE64_IN_RANGE(c, lo, hi, set1, cmpgt, and_) \
+        and_(cmpgt(c, set1((lo) - 1)), cmpgt(set1((hi) + 1), c))
 
-  return ret;
+__attribute__((target("ssse3")))
+static size_t decode_ssse3(const char *in, size_t len, unsigned char *out, size_t *consumed)
+{
+    const __m128i pack_pairs = _mm_set1_epi32(0x01400140);
+    const __m128i pack_quads = _mm_set1_epi32(0x00011000);
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0, o = 0;
 
+    for (; i + 16 <= len; i += 16, o += 12) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(in + i));
+
+        __m128i upper = BASE64_IN_RANGE(c, 'A', 'Z', _mm_set1_epi8, _mm_cmpgt_epi8, _mm_and_si128);
+        __m128i lower = BASE64_IN_RANGE(c, 'a', 'z', _mm_set1_epi8, _mm_cmpgt_epi8, _mm_and_si128);
+        __m128i digit = BASE64_IN_RANGE(c, '0', '9', _mm_set1_epi8, _mm_cmpgt_epi8, _mm_and_si128);
+        __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+        __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+        __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+
+        if (_mm_movemask_epi8(valid) != 0xFFFF) {
+            break;
+        }
+
+        __m128i shift = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)),
+                                                  _mm_and_si128(lower, _mm_set1_epi8(-71))),
+                                     _mm_or_si128(_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(4)),
+                                                               _mm_and_si128(plus, _mm_set1_epi8(19))),
+                                                  _mm_and_si128(slash, _mm_set1_epi8(16))));
+
+        __m128i values = _mm_add_epi8(c, shift);
+        values = _mm_madd_epi16(_mm_maddubs_epi16(values, pack_pairs), pack_quads);
+        values = _mm_shuffle_epi8(values, order);
+
+        _mm_storel_epi64((__m128i*)(out + o), values);
+        *(int*)(out + o + 8) = _mm_cvtsi128_si32(_mm_srli_si128(values, 8));
+    }
+
+    *consumed = i;
+    return o;
 }
 
-std::string base64_decode(std::string const& encoded_string) {
-  int in_len = encoded_string.size();
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
-  std::string ret;
-
-  while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_]; in_++;
-    if (i ==4) {
-      for (i = 0; i <4; i++)
-        char_array_4[i] = base64_chars.find(char_array_4[i]);
-
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-      for (i = 0; (i < 3); i++)
-        ret += char_array_3[i];
-      i = 0;
+__attribute__((target("avx2")))
+static size_t decode_avx2(const char *in, size_t len, unsigned char *out, size_t *consumed)
+{
+    const __m256i pack_pairs = _mm256_set1_epi32(0x01400140);
+    const __m256i pack_quads = _mm256_set1_epi32(0x00011000);
+    const __m256i order = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                           2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t i = 0, o = 0;
+
+    for (; i + 32 <= len; i += 32, o += 24) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(in + i));
+
+        __m256i upper = BASE64_IN_RANGE(c, 'A', 'Z', _mm256_set1_epi8, _mm256_cmpgt_epi8, _mm256_and_si256);
+        __m256i lower = BASE64_IN_RANGE(c, 'a', 'z', _mm256_set1_epi8, _mm256_cmpgt_epi8, _mm256_and_si256);
+        __m256i digit = BASE64_IN_RANGE(c, '0', '9', _mm256_set1_epi8, _mm256_cmpgt_epi8, _mm256_and_si256);
+        __m256i plus = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('+'));
+        __m256i slash = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('/'));
+
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                        _mm256_or_si256(_mm256_or_si256(digit, plus), slash));
+
+        if (_mm256_movemask_epi8(valid) != -1) {
+            break;
+        }
+
+        __m256i shift = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-65)),
+                                                        _mm256_and_si256(lower, _mm256_set1_epi8(-71))),
+                                        _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(4)),
+                                                                        _mm256_and_si256(plus, _mm256_set1_epi8(19))),
+                                                        _mm256_and_si256(slash, _mm256_set1_epi8(16))));
+
+        __m256i values = _mm256_add_epi8(c, shift);
+        values = _mm256_madd_epi16(_mm256_maddubs_epi16(values, pack_pairs), pack_quads);
+        values = _mm256_shuffle_epi8(values, order);
+        values = _mm256_permutevar8x32_epi32(values, lanes);      // the 24 bytes first
+
+        _mm_storeu_si128((__m128i*)(out + o), _mm256_castsi256_si128(values));
+        _mm_storel_epi64((__m128i*)(out + o + 16), _mm256_extracti128_si256(values, 1));
+    }
+
+    *consumed = i;
+    return o;
+}
+
+typedef size_t (*DecodeBlocksFn)(const char *in, size_t len, unsigned char *out, size_t *consumed);
+
+static DecodeBlocksFn select_decode_blocks()
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return decode_avx2;
+    }
+
+    if (__builtin_cpu_supports("ssse3")) {
+        return decode_ssse3;
+    }
+
+    return 0;
+}
+
+static const DecodeBlocksFn decode_blocks = select_decode_blocks();    // when the process starts
+#endif
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : base64_decode_buffer
+*
+* PURPOSE : Same as base64_decode_scalar, the blocks of valid characters are
+*           decoded with the vector unit if there is one.
+*
+* RETURN : the number of bytes written, at most BASE64_DECODED_MAX_SIZE(len)
+*
+*-----------------------------------------------------------------------------*/
+size_t base64_decode_buffer(const char *in, size_t len, unsigned char *out)
+{
+    size_t consumed = 0;
+    size_t written = 0;
+
+#ifdef BASE64_X86_SIMD
+    if (decode_blocks) {
+        written = decode_blocks(in, len, out, &consumed);
+    }
+#endif
+
+    return written + base64_decode_scalar(in + consumed, len - consumed, out + written);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : base64_decode_path
+*
+* RETURN : "avx2", "ssse3" or "scalar", the path used by base64_decode_buffer
+*
+*-----------------------------------------------------------------------------*/
+const char* base64_decode_path()
+{
+#ifdef BASE64_X86_SIMD
+    if (decode_blocks == decode_avx2) {
+        return "avx2";
+    }
+
+    if (decode_blocks == decode_ssse3) {
+        return "ssse3";
+    }
+#endif
+
+    return "scalar";
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : base64_stream_init
+*
+*-----------------------------------------------------------------------------*/
+void base64_stream_init(Base64Stream *stream)
+{
+    stream->pending = 0;
+    stream->done = false;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : base64_stream_decode
+*
+* PURPOSE : Decodes the next chunk of the stream into 'out'
+*           (BASE64_STREAM_MAX_SIZE(len) bytes). The characters of a group
+*           that does not end in this chunk are kept for the next one.
+*
+* RETURN : the number of bytes written, 0 once the end of the base64 data
+*          was reached
+*
+*-----------------------------------------------------------------------------*/
+size_t base64_stream_decode(Base64Stream *stream, const char *in, size_t len, unsigned char *out)
+{
+    const unsigned char *p = (const unsigned char*)in;
+    size_t written = 0;
+    size_t i = 0;
+
+    if (stream->done) {
+        return 0;
+    }
+
+    // 1. the group started in the previous chunk
+    while (stream->pending > 0 && i < len) {
+        unsigned int value = base64_values[p[i++]];
+
+        if (value & BASE64_INVALID) {
+            return base64_stream_finish(stream, out);
+        }
+
+        if (stream->pending < 3) {
+            stream->group[stream->pending++] = (unsigned char)value;
+            continue;
+        }
+
+        unsigned int v = (stream->group[0] << 18) | (stream->group[1] << 12) | (stream->group[2] << 6) | value;
+        out[0] = (unsigned char)(v >> 16);
+        out[1] = (unsigned char)(v >> 8);
+        out[2] = (unsigned char)v;
+        written = 3;
+        stream->pending = 0;
     }
-  }
 
-  if (i) {
-    for (j = i; j <4; j++)
-      char_array_4[j] = 0;
+    // 2. the whole groups, an early stop has already decoded its last group
+    size_t length = (len - i) / 4 * 4;
+    size_t decoded = base64_decode_buffer(in + i, length, out + written);
 
-    for (j = 0; j <4; j++)
-      char_array_4[j] = base64_chars.find(char_array_4[j]);
+    written += decoded;
+    i += length;
 
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+    if (decoded != length / 4 * 3) {
+        stream->done = true;
+        return written;
+    }
+
+    // 3. the start of the next group
+    while (i < len) {
+        unsigned int value = base64_values[p[i++]];
+
+        if (value & BASE64_INVALID) {
+            return written + base64_stream_finish(stream, out + written);
+        }
+
+        stream->group[stream->pending++] = (unsigned char)value;
+    }
+
+    return written;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* NAME : base64_stream_finish
+*
+* PURPOSE : Decodes the incomplete group left at the end of the stream into
+*           'out' (2 bytes at most), as base64_decode_scalar does
+*
+* RETURN : the number of bytes written
+*
+*-----------------------------------------------------------------------------*/
+size_t base64_stream_finish(Base64Stream *stream, unsigned char *out)
+{
+    size_t written = 0;
+
+    if (!stream->done && stream->pending >= 2) {
+        out[written++] = (unsigned char)((stream->group[0] << 2) | (stream->group[1] >> 4));
+    }
+
+    if (!stream->done && stream->pending == 3) {
+        out[written++] = (unsigned char)((stream->group[1] << 4) | (stream->group[2] >> 2));
+    }
+
+    stream->pending = 0;
+    stream->done = true;
+
+    return written;
+}
+
+std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
+  std::string ret(BASE64_ENCODED_SIZE((size_t)in_len), '\0');
+
+  if (in_len) {
+    base64_encode_buffer(bytes_to_encode, in_len, &ret[0]);
+  }
+
+  return ret;
+}
+
+std::string base64_decode(std::string const& encoded_string) {
+  std::string ret(BASE64_DECODED_MAX_SIZE(encoded_string.size()), '\0');
 
-    for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+  if (!ret.empty()) {
+    ret.resize(base64_decode_buffer(encoded_string.data(), encoded_string.size(), (unsigned char*)&ret[0]));
   }
 
   return ret;
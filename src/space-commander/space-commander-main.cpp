@@ -10,7 +10,12 @@
 #include <unistd.h>
 
 #include "space-commander/Net2Com.h"
+#include "common/async-log.h"
 #include "common/command-factory.h"
+#include "common/command-pipeline.h"
+#include "common/event-log.h"
+#include "common/retention-manager.h"
+#include "common/session-arena.h"
 #include "shakespeare.h"
 #include "common/subsystems.h"
 #include "SpaceDecl.h"
@@ -27,11 +32,14 @@ const char ERROR_EXECUTING_COMMAND = '2';
 // Declarations
 static void out_of_memory_handler();
 static int perform(int bytes);
+static void execute_frame(char* frame, size_t size);
 static void validate();
+static void enforce_retention();
 
 static char log_buffer[CS1_MAX_LOG_ENTRY] = {0};
 static char info_buffer[NET2COM_MAX_INFO_BUFFER_SIZE] = {'\0'};
 static Net2Com* commander = 0; 
+static SessionArena session_arena;          // the command executing and its result, reset after each reply
 
 const char* LOGNAME = cs1_systems[CS1_COMMANDER];
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -45,6 +53,18 @@ int main()
 {
     validate();
     set_new_handler(&out_of_memory_handler);
+    SessionArena::SetCurrent(&session_arena);
+
+    const char* log_level = getenv("CS1_LOG_LEVEL");     // 0 DEBUG .. 4 URGENT, can't go under CS1_LOG_MIN_LEVEL
+    if (log_level) {
+        AsyncLog::SetLevel(atoi(log_level));
+    }
+
+    if (!AsyncLog::Start()) {
+        Shakespeare::log(Shakespeare::WARNING, LOGNAME, "AsyncLog thread not started, logging in the commander thread");
+    }
+
+    EventLog::Start();
 
     commander = new Net2Com(Dcom_w_net_r, Dnet_w_com_r, 
                                                     Icom_w_net_r, Inet_w_com_r);
@@ -68,6 +88,8 @@ int main()
 
         if (bytes > 0) {
             perform(bytes);
+        } else {
+            enforce_retention();    // idle, never delays a command
         }
 
         sleep(COMMANER_SLEEP_TIME);
@@ -90,9 +112,6 @@ int main()
  *-----------------------------------------------------------------------------*/
 int perform(int bytes)
 {
-#ifdef CS1_DEBUG
-    char debug_buffer[255] = {0};
-#endif
     char* buffer = NULL;    // TODO  This buffer scared me ! 
     int read_total = 0;
     ICommand* command  = NULL;
@@ -102,11 +121,7 @@ int perform(int bytes)
     for(int i = 0; i != bytes; i++) {
         read = (unsigned char)info_buffer[i];
 
-#ifdef CS1_DEBUG
-        std::ostringstream msg;
-        msg << "Read from info pipe = " << (unsigned int)read << " bytes";
-        Shakespeare::log(Shakespeare::NOTICE, LOGNAME, msg.str());
-#endif
+        CS1_LOG(CS1_LOG_DEBUG, CS1_COMMANDER, "Read from info pipe = %lu bytes", (long)read);
 
         switch (read) 
         {
@@ -121,17 +136,22 @@ int perform(int bytes)
                     data_bytes = commander->ReadFromDataPipe(buffer, read_total);
 
                     if (data_bytes > 0) {
-#ifdef CS1_DEBUG
+                        if (data_bytes > PIPELINE_HEAD_SIZE && buffer[CMD_ID] == (char)PIPELINE_FRAME
+                                    && buffer[PIPELINE_HEAD_SIZE + CMD_ID] == (char)TIMESYNC_CMD) {
+                            TimeSyncCommand::MarkArrival();     // t1, see timesync-command.h
+                        }
+
+                        if (CS1_LOG_ENABLED(CS1_LOG_DEBUG)) {
+                          char debug_buffer[255] = {0};
                           std::ostringstream msg;
                           msg << "Read " << data_bytes << " bytes from ground station: ";
-                          memset (debug_buffer,0,255);
                           for(uint8_t z = 0; z < data_bytes; ++z){
                               uint8_t c = buffer[z];
                               snprintf(debug_buffer,5, "0x%02X ", c);
                               msg << debug_buffer;
                           }
-                          Shakespeare::log(Shakespeare::NOTICE, LOGNAME, msg.str());
-#endif
+                          Shakespeare::log(Shakespeare::DEBUG, LOGNAME, msg.str());
+                        }
 
                         if (data_bytes != read_total) {
                             Shakespeare::log(Shakespeare::ERROR, LOGNAME, "Something went wrong !!");
@@ -142,7 +162,11 @@ int perform(int bytes)
                         FILE *fp_last_command = NULL;
                         unsigned int retry = 10000;
 
-                        if (buffer[COMMAND_RESEND_INDEX] == COMMAND_RESEND_CHAR) 
+                        if (buffer[CMD_ID] == (char)PIPELINE_FRAME)
+                        {
+                            execute_frame(buffer, data_bytes);     // on arrival, last-command is left alone
+                        }
+                        else if (buffer[COMMAND_RESEND_INDEX] == COMMAND_RESEND_CHAR) 
                         {
                             while(retry > 0 && fp_last_command == NULL){
                                 fp_last_command = fopen(LAST_COMMAND_FILENAME.c_str(), "r");
@@ -151,46 +175,42 @@ int perform(int bytes)
 
                             if (fp_last_command != NULL) 
                             {
-                                fread(previous_command_buffer, sizeof(char), MAX_COMMAND_SIZE, fp_last_command);
+                                size_t command_size = fread(previous_command_buffer, sizeof(char), MAX_COMMAND_SIZE, fp_last_command);
                                 fclose(fp_last_command);
 
-                                command = CommandFactory::CreateCommand(previous_command_buffer);
+                                // the command points into previous_command_buffer, which outlives it
+                                CommandStorage* storage = (CommandStorage*)session_arena.Alloc(sizeof(CommandStorage));
 
-                                if (command != NULL) 
+                                if ((command = CommandFactory::CreateCommand(previous_command_buffer, command_size, storage)) != NULL) 
                                 {
-                                    Shakespeare::log(Shakespeare::NOTICE, 
-                                                                    LOGNAME, 
-                                                                            "Executing command");
+                                    ResultBuffer result;    // released before the arena is reset
+                                    struct timespec start, end;
+
+                                    clock_gettime(CLOCK_MONOTONIC, &start);
+                                    command->Execute(result);
+                                    clock_gettime(CLOCK_MONOTONIC, &end);
+
+                                    EventLog::Command((unsigned char)previous_command_buffer[CMD_ID], result, 
+                                                            (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
 
-                                    size_t size = 0;
-                                    char* result  = (char* )command->Execute(&size);
-                                    if (result != NULL) 
+                                    if (!result.IsEmpty()) 
                                     {
-                                        memset(log_buffer,0,MAX_BUFFER_SIZE);
-                                        snprintf(log_buffer, MAX_BUFFER_SIZE, "Command output = %s\n", result);
-                                        Shakespeare::log(Shakespeare::NOTICE,LOGNAME,log_buffer);
-
-                                        if (size > 0) {
-                                            commander->WriteToDataPipe(result, size);
-                                        } else { // this branch will be remove as soon as ALL commands returns the SIZE ! TODO
-                                                 // Because it is not safe to rely on a NULL terminator in the result buffer.
-                                            commander->WriteToDataPipe(result);
+                                        if (commander->WriteToDataPipe(result) < 0) {
+                                            Shakespeare::log(Shakespeare::ERROR, LOGNAME, "Could not write the whole result to the data pipe");
                                         }
-
-                                        free(result); // TODO allocate result buffer with new in all icommand subclasses and use delete
-                                        result = NULL;
                                     } else {
                                         commander->WriteToInfoPipe(ERROR_EXECUTING_COMMAND);
                                     }
 
                                     if (command) {
-                                        delete command;
+                                        CommandFactory::DestroyCommand(command);
                                         command = NULL;
                                     }
                                 } else {
                                     commander->WriteToInfoPipe(ERROR_CREATING_COMMAND);
                                 }
 
+                                session_arena.Reset();     // the reply is written, nothing of the command is left
                                 memset(previous_command_buffer, '\0', MAX_COMMAND_SIZE);
                             }
                         } else {
@@ -227,6 +247,54 @@ int perform(int bytes)
     return 0;
 }
 
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : execute_frame 
+ *
+ * DESCRIPTION : executes the command of a frame of the pipeline as soon as
+ *               it is read and writes its reply, see command-pipeline.h. A
+ *               frame is never replayed by '!' : the ground sends it again
+ *               when the reply is lost and the PipelineServer answers it
+ *               from its cache.
+ *
+ *-----------------------------------------------------------------------------*/
+void execute_frame(char* frame, size_t size)
+{
+    // the command points into 'frame', which outlives it
+    CommandStorage* storage = (CommandStorage*)session_arena.Alloc(sizeof(CommandStorage));
+    ResultBuffer reply;     // [PIPELINE_FRAME][cid][result], released before the arena is reset
+
+    if (!storage || !PipelineServer::Execute(frame, size, storage, reply)) {
+        commander->WriteToInfoPipe(ERROR_CREATING_COMMAND);
+    } else if (commander->WriteToDataPipe(reply) < 0) {
+        Shakespeare::log(Shakespeare::ERROR, LOGNAME, "Could not write the whole reply to the data pipe");
+    }
+
+    reply.Clear();
+    session_arena.Reset();     // the reply is written, nothing of the command is left
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * NAME : enforce_retention 
+ *
+ * DESCRIPTION : Evicts a few files of CS1_TGZ and CS1_LOGS if they are over 
+ *               their budget, see retention-manager.h
+ *
+ *-----------------------------------------------------------------------------*/
+void enforce_retention()
+{
+    static const char* directories[] = { CS1_TGZ, CS1_LOGS };
+
+    for (size_t i = 0; i < sizeof(directories) / sizeof(directories[0]); i++) {
+        RetentionManager* retention = RetentionManager::GetInstance(directories[i]);
+
+        if (retention) {
+            retention->RunOnce(RETENTION_MAX_EVICTIONS_PER_PASS);
+        }
+    }
+}
+
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
  *
  * NAME : out_of_memory_handler 
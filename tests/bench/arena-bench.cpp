@@ -0,0 +1,161 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : arena-bench.cpp
+*
+* DESCRIPTION : Heap usage of the commands over a simulated day, one command
+*               per second (GetTime, Version and GetLog if CS1_TGZ exists).
+*
+*               - heap  : the command is new'd, its result malloc'd (no arena), as the
+*                         space-commander used to do
+*               - arena : the command and its result are in a SessionArena,
+*                         reset after each command
+*
+*               Between the commands, the other users of the heap (the logs,
+*               the RetentionManager...) are simulated by a ring of blocks of
+*               random size, identical in both runs.
+*
+*               Each run is done in its own process so the RSS is its own.
+*               The allocations are counted by replacing malloc (glibc), the
+*               ones left in the arena run are the std::string built to call
+*               Shakespeare::log.
+*
+*               usage : make bench
+*
+*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common/command-factory.h"
+#include "common/commands.h"
+#include "common/session-arena.h"
+
+#define SIMULATED_SECONDS 86400
+#define BACKGROUND_BLOCKS 256
+#define BACKGROUND_MAX_SIZE 512
+
+extern "C" void* __libc_malloc(size_t size);
+
+static unsigned long number_of_mallocs = 0;
+
+extern "C" void* malloc(size_t size)
+{
+    number_of_mallocs++;
+    return __libc_malloc(size);
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long resident_kb()
+{
+    long size = 0, pages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+
+    if (statm) {
+        if (fscanf(statm, "%ld %ld", &size, &pages) != 2) {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void run(bool use_arena)
+{
+    static SessionArena arena;
+    void *background[BACKGROUND_BLOCKS] = {0};
+    struct stat stat_buf;
+
+    char gettime_buf[GETTIME_CMD_SIZE] = { GETTIME_CMD };
+    char version_buf[VERSION_CMD_SIZE] = { VERSION_CMD, WIRE_V1 };
+    char getlog_buf[GETLOG_CMD_SIZE] = {'\0'};
+    GetLogCommand(OPT_NOOPT, 0, 0, 0).GetCmdStr(getlog_buf);
+
+    char *buffers[] = { gettime_buf, version_buf, getlog_buf };
+    size_t sizes[] = { GETTIME_CMD_SIZE, VERSION_CMD_SIZE, GETLOG_CMD_SIZE };
+    size_t number_of_kinds = (stat(CS1_TGZ, &stat_buf) == 0 && S_ISDIR(stat_buf.st_mode)) ? 3 : 2;
+
+    srand(42);
+    SessionArena::SetCurrent(use_arena ? &arena : 0);
+
+    unsigned long mallocs = number_of_mallocs;
+    double start = now();
+
+    for (size_t second = 0; second < SIMULATED_SECONDS; second++) {
+        size_t kind = second % number_of_kinds;
+        ICommand *command = 0;
+
+        if (use_arena) {
+            CommandStorage *storage = (CommandStorage*)arena.Alloc(sizeof(CommandStorage));
+            command = CommandFactory::CreateCommand(buffers[kind], sizes[kind], storage);
+        } else {
+            command = CommandFactory::CreateCommand(buffers[kind], sizes[kind]);
+        }
+
+        {
+            ResultBuffer result;
+            command->Execute(result);
+        }
+
+        if (use_arena) {
+            CommandFactory::DestroyCommand(command);
+            arena.Reset();
+        } else {
+            delete command;
+        }
+
+        size_t slot = rand() % BACKGROUND_BLOCKS;
+        free(background[slot]);
+        background[slot] = malloc(1 + rand() % BACKGROUND_MAX_SIZE);
+    }
+
+    double elapsed = now() - start;
+    mallocs = number_of_mallocs - mallocs - SIMULATED_SECONDS;   // without the background ones
+
+    printf("%-5s : %8.2f us/command, %8lu mallocs (%.2f per command), RSS %ld kB",
+                    use_arena ? "arena" : "heap", elapsed / 1000 / SIMULATED_SECONDS, mallocs,
+                    (double)mallocs / SIMULATED_SECONDS, resident_kb());
+
+    if (use_arena) {
+        printf(", high water %lu bytes, %lu fallbacks", (unsigned long)arena.GetHighWater(),
+                                                        arena.GetNumberOfFallbacks());
+    }
+
+    printf("\n");
+
+    for (size_t i = 0; i < BACKGROUND_BLOCKS; i++) {
+        free(background[i]);
+    }
+}
+
+int main()
+{
+    printf("%d commands (simulated day, %s)\n", SIMULATED_SECONDS,
+                                                "GetTime, Version, GetLog if " CS1_TGZ " exists");
+    fflush(stdout);
+
+    for (int use_arena = 0; use_arena < 2; use_arena++) {
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            run(use_arena != 0);
+            fflush(stdout);
+            _exit(0);
+        }
+
+        waitpid(pid, 0, 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : base64-bench.cpp
+*
+* DESCRIPTION : Throughput of base64 on a multi-MB buffer, as an uploaded
+*               update would be decoded :
+*
+*               - std::string, original : the string::find decoder base64.cpp
+*                                         used to have (kept here as the reference)
+*               - std::string           : base64_decode, now a wrapper
+*               - buffer, scalar        : base64_decode_scalar (the buildQ6 path)
+*               - buffer                : base64_decode_buffer (SSSE3 / AVX2 on x86)
+*
+*               usage : make bench
+*
+*----------------------------------------------------------------------------*/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+#include "space-commander/base64.h"
+
+#define BENCH_SIZE (8 * 1024 * 1024)
+#define ROUNDS 5
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char *name, double start, size_t bytes)
+{
+    double ns = now() - start;
+    printf("%-26s : %8.1f MB/s\n", name, (bytes * ROUNDS) / (ns / 1e9) / (1024 * 1024));
+}
+
+static const std::string original_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static inline bool is_base64(unsigned char c)
+{
+    return (isalnum(c) || (c == '+') || (c == '/'));
+}
+
+static std::string original_decode(std::string const& encoded_string)
+{
+    int in_len = encoded_string.size();
+    int i = 0;
+    int j = 0;
+    int in_ = 0;
+    unsigned char char_array_4[4], char_array_3[3];
+    std::string ret;
+
+    while (in_len-- && (encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
+        char_array_4[i++] = encoded_string[in_]; in_++;
+        if (i == 4) {
+            for (i = 0; i < 4; i++)
+                char_array_4[i] = original_chars.find(char_array_4[i]);
+
+            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+            for (i = 0; (i < 3); i++)
+                ret += char_array_3[i];
+            i = 0;
+        }
+    }
+
+    if (i) {
+        for (j = i; j < 4; j++)
+            char_array_4[j] = 0;
+
+        for (j = 0; j < 4; j++)
+            char_array_4[j] = original_chars.find(char_array_4[j]);
+
+        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+        for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+    }
+
+    return ret;
+}
+
+int main()
+{
+    unsigned char *bytes = (unsigned char*)malloc(BENCH_SIZE);
+    char *encoded = (char*)malloc(BASE64_ENCODED_SIZE(BENCH_SIZE));
+    unsigned char *decoded = (unsigned char*)malloc(BASE64_DECODED_MAX_SIZE(BASE64_ENCODED_SIZE(BENCH_SIZE)));
+    volatile size_t sink = 0;
+    double start = 0;
+
+    srand(37);
+    for (size_t i = 0; i < BENCH_SIZE; i++) {
+        bytes[i] = (unsigned char)rand();
+    }
+
+    size_t encoded_len = base64_encode_buffer(bytes, BENCH_SIZE, encoded);
+    std::string encoded_string(encoded, encoded_len);
+
+    printf("base64, %d MB decoded, decoder path : %s\n", BENCH_SIZE / (1024 * 1024), base64_decode_path());
+
+    if (original_decode(encoded_string) != base64_decode(encoded_string)
+            || base64_decode_buffer(encoded, encoded_len, decoded) != BENCH_SIZE
+            || memcmp(bytes, decoded, BENCH_SIZE) != 0) {
+        printf("base64 : the decoders disagree\n");
+        return 1;
+    }
+
+    // 1. decode
+    start = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        sink = original_decode(encoded_string).size();
+    }
+    report("decode, string, original", start, BENCH_SIZE);
+
+    start = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        sink = base64_decode(encoded_string).size();
+    }
+    report("decode, string", start, BENCH_SIZE);
+
+    start = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        sink = base64_decode_scalar(encoded, encoded_len, decoded);
+    }
+    report("decode, buffer, scalar", start, BENCH_SIZE);
+
+    start = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        sink = base64_decode_buffer(encoded, encoded_len, decoded);
+    }
+    report("decode, buffer", start, BENCH_SIZE);
+
+    // 2. encode
+    start = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        sink = base64_encode(bytes, BENCH_SIZE).size();
+    }
+    report("encode, string", start, BENCH_SIZE);
+
+    start = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        sink = base64_encode_buffer(bytes, BENCH_SIZE, encoded);
+    }
+    report("encode, buffer", start, BENCH_SIZE);
+
+    (void)sink;
+    free(bytes);
+    free(encoded);
+    free(decoded);
+    return 0;
+}
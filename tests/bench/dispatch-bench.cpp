@@ -0,0 +1,103 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : dispatch-bench.cpp
+*
+* DESCRIPTION : Cost of dispatching a command byte to its factory.
+*
+*               - registry : CommandRegistry::Get, one indexed load
+*               - switch   : the switch CommandFactory::CreateCommand used to
+*                            have, kept here as the reference
+*               - create   : CommandFactory::CreateCommand + delete of a
+*                            GetTimeCommand, i.e. what the commander pays
+*
+*               usage : make bench
+*
+*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <time.h>
+
+#include "common/command-factory.h"
+#include "common/command-registry.h"
+#include "common/commands.h"
+
+#define ITERATIONS 10000000
+#define CREATE_ITERATIONS 1000000
+
+static const unsigned char ids[] = { SETTIME_CMD, GETTIME_CMD, UPDATE_CMD, GETLOG_CMD,
+                                     REBOOT_CMD, DECODE_CMD, DELETELOG_CMD, 0x00 };
+#define NUMBER_OF_IDS (sizeof(ids) / sizeof(ids[0]))
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static CommandCreateFn SwitchDispatch(unsigned char id)
+{
+    switch (id) {
+        case SETTIME_CMD :      return CommandRegistry::Get(SETTIME_CMD)->create;
+        case GETTIME_CMD :      return CommandRegistry::Get(GETTIME_CMD)->create;
+        case UPDATE_CMD :       return CommandRegistry::Get(UPDATE_CMD)->create;
+        case GETLOG_CMD :       return CommandRegistry::Get(GETLOG_CMD)->create;
+        case REBOOT_CMD :       return CommandRegistry::Get(REBOOT_CMD)->create;
+        case DECODE_CMD :       return CommandRegistry::Get(DECODE_CMD)->create;
+        case DELETELOG_CMD :    return CommandRegistry::Get(DELETELOG_CMD)->create;
+    }
+
+    return 0;
+}
+
+int main()
+{
+    volatile unsigned char id = 0;
+    volatile CommandCreateFn sink = 0;
+    double start = 0;
+
+    // 1. registry
+    start = now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        id = ids[i % NUMBER_OF_IDS];
+        const CommandEntry *entry = CommandRegistry::Get(id);
+        sink = entry ? entry->create : 0;
+    }
+    printf("registry : %6.2f ns/dispatch\n", (now() - start) / ITERATIONS);
+
+    // 2. switch
+    CommandCreateFn table[NUMBER_OF_IDS];     // resolve once so the loop only measures the switch
+    for (size_t i = 0; i < NUMBER_OF_IDS; i++) {
+        table[i] = SwitchDispatch(ids[i]);
+    }
+
+    start = now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        id = ids[i % NUMBER_OF_IDS];
+        switch (id) {
+            case SETTIME_CMD :      sink = table[0]; break;
+            case GETTIME_CMD :      sink = table[1]; break;
+            case UPDATE_CMD :       sink = table[2]; break;
+            case GETLOG_CMD :       sink = table[3]; break;
+            case REBOOT_CMD :       sink = table[4]; break;
+            case DECODE_CMD :       sink = table[5]; break;
+            case DELETELOG_CMD :    sink = table[6]; break;
+            default :               sink = 0;
+        }
+    }
+    printf("switch   : %6.2f ns/dispatch\n", (now() - start) / ITERATIONS);
+
+    // 3. full creation
+    char command[GETTIME_CMD_SIZE] = { GETTIME_CMD };
+
+    start = now();
+    for (size_t i = 0; i < CREATE_ITERATIONS; i++) {
+        ICommand *cmd = CommandFactory::CreateCommand(command, GETTIME_CMD_SIZE);
+        delete cmd;
+    }
+    printf("create   : %6.2f ns/command (GetTimeCommand, new + delete)\n", (now() - start) / CREATE_ITERATIONS);
+
+    (void)sink;
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : log-bench.cpp
+*
+* DESCRIPTION : Latency of the commands with the logs written by the caller
+*               (sync, as before) and by the AsyncLog thread (async).
+*
+*               - log     : one NOTICE, memset + snprintf + Shakespeare::log
+*                           against AsyncLog::Log
+*               - getlog  : GetLogCommand::Execute, OPT_NOOPT (if CS1_TGZ exists),
+*                           its NOTICE / DEBUG logs go through AsyncLog
+*
+*               Shakespeare::log opens and appends to the log file, the
+*               latencies are dominated by the file system : run it on the
+*               board for the numbers that matter.
+*
+*               usage : make bench
+*
+*               The Q6 configuration (no CS1_DEBUG, the DEBUG and NOTICE logs
+*               compiled out) on the PC :
+*
+*                   make clean
+*                   make bench ENV="-DPRESERVE -DCS1_IO_URING -DCS1_LOG_MIN_LEVEL=2"
+*
+*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <vector>
+
+#include "SpaceDecl.h"
+#include "shakespeare.h"
+#include "common/async-log.h"
+#include "common/command-factory.h"
+#include "common/commands.h"
+#include "common/getlog-command.h"
+
+#define LOG_ITERATIONS 20000
+#define GETLOG_ITERATIONS 2000
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char* name, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("%-14s : p50 %9.0f ns   p99 %9.0f ns   max %10.0f ns\n", name,
+                latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+}
+
+static void bench_log(const char* name, bool async)
+{
+    char log_buffer[CS1_MAX_LOG_ENTRY];
+    std::vector<double> latencies(LOG_ITERATIONS);
+
+    for (size_t i = 0; i < LOG_ITERATIONS; i++) {
+        double start = now();
+
+        if (async) {
+            AsyncLog::Log(Shakespeare::NOTICE, CS1_COMMANDER, " Execute GetLogCommand with OPT_NOOPT : %ld\n", (long)i);
+        } else {
+            memset(log_buffer, 0, CS1_MAX_LOG_ENTRY);
+            snprintf(log_buffer, CS1_MAX_LOG_ENTRY, " Execute GetLogCommand with OPT_NOOPT : %ld\n", (long)i);
+            Shakespeare::log(Shakespeare::NOTICE, cs1_systems[CS1_COMMANDER], log_buffer);
+        }
+
+        latencies[i] = now() - start;
+
+        if (async && i % (ASYNC_LOG_RING_SIZE / 2) == 0) {
+            AsyncLog::Flush(ASYNC_LOG_FLUSH_TIMEOUT_MS);      // a command every few logs, not a flood
+        }
+    }
+
+    report(name, latencies);
+}
+
+static void bench_getlog(const char* name)
+{
+    char getlog_buf[GETLOG_CMD_SIZE] = {'\0'};
+    std::vector<double> latencies(GETLOG_ITERATIONS);
+
+    GetLogCommand(OPT_NOOPT, 0, 0, 0).GetCmdStr(getlog_buf);
+
+    for (size_t i = 0; i < GETLOG_ITERATIONS; i++) {
+        ICommand* command = CommandFactory::CreateCommand(getlog_buf, GETLOG_CMD_SIZE);
+        ResultBuffer result;
+
+        double start = now();
+        command->Execute(result);
+        latencies[i] = now() - start;
+
+        delete command;
+        AsyncLog::Flush(ASYNC_LOG_FLUSH_TIMEOUT_MS);
+    }
+
+    report(name, latencies);
+}
+
+int main()
+{
+    struct stat stat_buf;
+    bool has_tgz = (stat(CS1_TGZ, &stat_buf) == 0 && S_ISDIR(stat_buf.st_mode));
+
+    bench_log("log sync", false);
+    if (has_tgz) {
+        bench_getlog("getlog sync");
+    }
+
+    AsyncLog::Start();
+
+    bench_log("log async", true);
+    if (has_tgz) {
+        bench_getlog("getlog async");
+    }
+
+    AsyncLog::Stop();
+    printf("dropped : %u\n", AsyncLog::Dropped());
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* AUTHORS : Space Concordia 2015
+*
+* TITLE : schema-bench.cpp
+*
+* DESCRIPTION : Cost of building and parsing a GetLogCommand and a result
+*               header, with the codecs generated from the wire schemas
+*               against the hand-written offsets they replaced (kept here as
+*               the reference).
+*
+*               usage : make bench
+*
+*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <time.h>
+
+#include "SpaceDecl.h"
+#include "SpaceString.h"
+#include "common/commands.h"
+#include "common/getlog-command.h"
+
+#define ITERATIONS 10000000
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void HandBuild(char *buffer, char opt_byte, char subsystem, size_t size, time_t date)
+{
+    buffer[0] = GETLOG_CMD;
+    buffer[1] = opt_byte;
+    buffer[2] = subsystem;
+    SpaceString::get4Char(buffer + 3, size);
+    SpaceString::get4Char(buffer + 7, date);
+}
+
+static unsigned int HandParse(const char *buffer)
+{
+    return buffer[1] + buffer[2] + SpaceString::getUInt(buffer + 3) + SpaceString::getUInt(buffer + 7);
+}
+
+static void SchemaBuild(char *buffer, char opt_byte, char subsystem, size_t size, time_t date)
+{
+    GetLogSchema::Init(buffer);
+    GetLogSchema::Put<GETLOG_FIELD_OPT>(buffer, opt_byte);
+    GetLogSchema::Put<GETLOG_FIELD_SUBSYSTEM>(buffer, subsystem);
+    GetLogSchema::Put<GETLOG_FIELD_SIZE>(buffer, size);
+    GetLogSchema::Put<GETLOG_FIELD_DATE>(buffer, date);
+}
+
+static unsigned int SchemaParse(const char *buffer)
+{
+    return GetLogSchema::Get<GETLOG_FIELD_OPT>(buffer) + GetLogSchema::Get<GETLOG_FIELD_SUBSYSTEM>(buffer)
+                + GetLogSchema::Get<GETLOG_FIELD_SIZE>(buffer) + GetLogSchema::Get<GETLOG_FIELD_DATE>(buffer);
+}
+
+int main()
+{
+    char buffer[GETLOG_CMD_SIZE] = {'\0'};
+    volatile char opt_byte = OPT_SUB;
+    volatile unsigned int sink = 0;
+    double start = 0;
+
+    // 1. build
+    start = now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        HandBuild(buffer, opt_byte, 3, i, 1420070400 + i);
+        sink = buffer[3];
+    }
+    printf("build, hand-written  : %6.2f ns/command\n", (now() - start) / ITERATIONS);
+
+    start = now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        SchemaBuild(buffer, opt_byte, 3, i, 1420070400 + i);
+        sink = buffer[3];
+    }
+    printf("build, schema        : %6.2f ns/command\n", (now() - start) / ITERATIONS);
+
+    // 2. parse
+    start = now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        buffer[3] = (char)i;
+        if (buffer[CMD_ID] == GETLOG_CMD) {
+            sink = HandParse(buffer);
+        }
+    }
+    printf("parse, hand-written  : %6.2f ns/command\n", (now() - start) / ITERATIONS);
+
+    start = now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        buffer[3] = (char)i;
+        if (GetLogSchema::Check(buffer, GETLOG_CMD_SIZE)) {
+            sink = SchemaParse(buffer);
+        }
+    }
+    printf("parse, schema        : %6.2f ns/command (length and CMD_ID checked)\n", (now() - start) / ITERATIONS);
+
+    (void)sink;
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : async-log-test.cpp
+ *
+ * DESCRIPTION : Tests the AsyncLog ring, with a sink that records the messages
+ *               instead of Shakespeare::log
+ *
+ *----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/async-log.h"
+
+#define PRODUCERS 4
+#define RECORDS_PER_PRODUCER 2000
+
+static pthread_mutex_t sink_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<std::string> messages;
+static pthread_t sink_thread;
+static volatile bool sink_blocked = false;
+
+static int RecordingSink(Shakespeare::Priority priority, const char* system, const char* message)
+{
+    while (sink_blocked) {
+        usleep(1000);
+    }
+
+    pthread_mutex_lock(&sink_mutex);
+    messages.push_back(message);
+    sink_thread = pthread_self();
+    pthread_mutex_unlock(&sink_mutex);
+
+    return 0;
+}
+
+static int evaluated = 0;
+
+static long Evaluate(long value)
+{
+    evaluated++;
+    return value;
+}
+
+static void* Produce(void* accepted)
+{
+    for (long i = 0; i < RECORDS_PER_PRODUCER; i++) {
+        if (AsyncLog::Log(Shakespeare::DEBUG, CS1_COMMANDER, "record %ld", i)) {
+            (*(long*)accepted)++;
+        }
+    }
+
+    return 0;
+}
+
+TEST_GROUP(AsyncLogTestGroup)
+{
+    void setup()
+    {
+        messages.clear();
+        sink_blocked = false;
+        evaluated = 0;
+        AsyncLog::SetSink(RecordingSink);
+    }
+
+    void teardown()
+    {
+        sink_blocked = false;
+        AsyncLog::Stop();
+        AsyncLog::SetSink(0);
+        AsyncLog::SetLevel(CS1_LOG_MIN_LEVEL);
+        messages.clear();
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : AsyncLogTestGroup
+*
+* NAME : Log_notStarted_writtenByTheCaller
+*
+*-----------------------------------------------------------------------------*/
+TEST(AsyncLogTestGroup, Log_notStarted_writtenByTheCaller)
+{
+    CHECK(AsyncLog::LogString(Shakespeare::NOTICE, CS1_COMMANDER, " file : %s (%ld bytes)", "a.tgz", 42));
+
+    CHECK_EQUAL(1, messages.size());
+    CHECK(messages[0] == " file : a.tgz (42 bytes)");
+    CHECK(pthread_equal(sink_thread, pthread_self()));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : AsyncLogTestGroup
+*
+* NAME : Log_started_formattedInOrderByTheThread
+*
+*-----------------------------------------------------------------------------*/
+TEST(AsyncLogTestGroup, Log_started_formattedInOrderByTheThread)
+{
+    std::string long_name(200, 'x');
+
+    CHECK(AsyncLog::Start());
+
+    for (long i = 0; i < 10; i++) {
+        CHECK(AsyncLog::Log(Shakespeare::DEBUG, CS1_COMMANDER, " inode %lu, %ld of %ld", 1000 + i, i, 10));
+    }
+    CHECK(AsyncLog::LogString(Shakespeare::NOTICE, CS1_COMMANDER, "%s", long_name.c_str()));
+
+    CHECK(AsyncLog::Flush(ASYNC_LOG_FLUSH_TIMEOUT_MS));
+
+    CHECK_EQUAL(11, messages.size());
+    CHECK(messages[3] == " inode 1003, 3 of 10");
+    CHECK(messages[10] == std::string(ASYNC_LOG_TEXT_SIZE - 1, 'x'));
+    CHECK(!pthread_equal(sink_thread, pthread_self()));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : AsyncLogTestGroup
+*
+* NAME : Log_ringFull_dropsAndReportsTheCount
+*
+*-----------------------------------------------------------------------------*/
+TEST(AsyncLogTestGroup, Log_ringFull_dropsAndReportsTheCount)
+{
+    unsigned int dropped_before = AsyncLog::Dropped();
+    size_t accepted = 0;
+
+    CHECK(AsyncLog::Start());
+    sink_blocked = true;                // the log file is slow
+
+    for (long i = 0; i < ASYNC_LOG_RING_SIZE + 50; i++) {
+        if (AsyncLog::Log(Shakespeare::DEBUG, CS1_COMMANDER, "record %ld", i)) {
+            accepted++;
+        }
+    }
+
+    // the thread may hold one record out of the ring
+    CHECK(accepted >= ASYNC_LOG_RING_SIZE && accepted <= ASYNC_LOG_RING_SIZE + 1);
+    CHECK_EQUAL(ASYNC_LOG_RING_SIZE + 50 - accepted, AsyncLog::Dropped() - dropped_before);
+
+    sink_blocked = false;
+    CHECK(AsyncLog::Flush(ASYNC_LOG_FLUSH_TIMEOUT_MS));
+    AsyncLog::Stop();
+
+    char report[CS1_MAX_LOG_ENTRY];
+    snprintf(report, sizeof(report), "AsyncLog : %u records dropped, the ring was full",
+                                      (unsigned int)(ASYNC_LOG_RING_SIZE + 50 - accepted));
+
+    // reported once the thread catches up, after the record it was writing
+    CHECK_EQUAL(accepted + 1, messages.size());
+    CHECK(messages[0] == "record 0");
+    CHECK(messages[1] == report);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : AsyncLogTestGroup
+*
+* NAME : Log_producers_everyAcceptedRecordWritten
+*
+*-----------------------------------------------------------------------------*/
+TEST(AsyncLogTestGroup, Log_producers_everyAcceptedRecordWritten)
+{
+    pthread_t producers[PRODUCERS];
+    long accepted[PRODUCERS] = {0};
+    long total = 0;
+
+    CHECK(AsyncLog::Start());
+
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_create(&producers[i], 0, Produce, &accepted[i]);
+    }
+
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(producers[i], 0);
+        total += accepted[i];
+    }
+
+    AsyncLog::Stop();
+
+    // plus the reports of the records dropped
+    size_t written = 0;
+    for (size_t i = 0; i < messages.size(); i++) {
+        written += (messages[i].compare(0, 7, "record ") == 0) ? 1 : 0;
+    }
+
+    CHECK(total > 0);
+    CHECK_EQUAL((size_t)total, written);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : AsyncLogTestGroup
+*
+* NAME : CS1_LOG_underTheLevel_argumentsNotEvaluated
+*
+*-----------------------------------------------------------------------------*/
+TEST(AsyncLogTestGroup, CS1_LOG_underTheLevel_argumentsNotEvaluated)
+{
+    AsyncLog::SetLevel(CS1_LOG_NOTICE);
+
+    CS1_LOG(CS1_LOG_DEBUG, CS1_COMMANDER, " inode %lu", Evaluate(1));
+    CS1_LOG_STRING(CS1_LOG_DEBUG, CS1_COMMANDER, " file : %s (%ld)", "a.tgz", Evaluate(2));
+    CS1_LOG(CS1_LOG_NOTICE, CS1_COMMANDER, " inode %lu", Evaluate(3));
+
+    if (CS1_LOG_ENABLED(CS1_LOG_DEBUG)) {
+        Evaluate(4);
+    }
+
+    CHECK_EQUAL(1, evaluated);
+    CHECK_EQUAL(1, messages.size());
+    CHECK(messages[0] == " inode 3");
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : AsyncLogTestGroup
+*
+* NAME : Log_conversionNotLong_refused
+*
+*-----------------------------------------------------------------------------*/
+TEST(AsyncLogTestGroup, Log_conversionNotLong_refused)
+{
+    CHECK(!AsyncLog::Log(Shakespeare::DEBUG, CS1_COMMANDER, " inode %d", 1));
+    CHECK(!AsyncLog::Log(Shakespeare::DEBUG, CS1_COMMANDER, " name %s", 1));
+    CHECK(!AsyncLog::Log(Shakespeare::DEBUG, CS1_COMMANDER, " %ld %ld %ld %ld", 1, 2, 3));
+    CHECK(!AsyncLog::LogString(Shakespeare::DEBUG, CS1_COMMANDER, " %ld %s", "a.tgz", 1));
+    CHECK(!AsyncLog::LogString(Shakespeare::DEBUG, CS1_COMMANDER, " no string", "a.tgz"));
+    CHECK(!AsyncLog::LogString(Shakespeare::DEBUG, CS1_COMMANDER, " %s %s", "a.tgz"));
+
+    CHECK_EQUAL(6, messages.size());
+    CHECK(messages[0] == "AsyncLog : format refused :  inode %d");
+
+    CHECK(AsyncLog::Log(Shakespeare::DEBUG, CS1_COMMANDER, " %08lx %-4lu %+ld 100%%", 255, 7, 3));
+    CHECK(messages[6] == " 000000ff 7    +3 100%");
+}
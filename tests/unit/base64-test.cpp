@@ -0,0 +1,197 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : base64-test.cpp
+ *
+ * DESCRIPTION : Tests the base64 codec, its buffer API and the vector decoder
+ *               against the scalar one
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "space-commander/base64.h"
+
+#define BASE64_TEST_SIZE 3000
+
+static const char *rfc4648_decoded[] = { "", "f", "fo", "foo", "foob", "fooba", "foobar" };
+static const char *rfc4648_encoded[] = { "", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy" };
+
+TEST_GROUP(Base64TestGroup)
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : Base64TestGroup
+*
+* NAME : EncodeDecode_rfc4648Vectors
+*
+*-----------------------------------------------------------------------------*/
+TEST(Base64TestGroup, EncodeDecode_rfc4648Vectors)
+{
+    char encoded[16];
+    unsigned char decoded[16];
+
+    for (size_t i = 0; i < sizeof(rfc4648_decoded) / sizeof(rfc4648_decoded[0]); i++) {
+        size_t len = strlen(rfc4648_decoded[i]);
+        size_t encoded_len = strlen(rfc4648_encoded[i]);
+
+        CHECK_EQUAL(encoded_len, BASE64_ENCODED_SIZE(len));
+        CHECK_EQUAL(encoded_len, base64_encode_buffer((const unsigned char*)rfc4648_decoded[i], len, encoded));
+        CHECK_EQUAL(0, memcmp(rfc4648_encoded[i], encoded, encoded_len));
+
+        CHECK_EQUAL(len, base64_decode_buffer(rfc4648_encoded[i], encoded_len, decoded));
+        CHECK_EQUAL(0, memcmp(rfc4648_decoded[i], decoded, len));
+
+        STRCMP_EQUAL(rfc4648_encoded[i], base64_encode((const unsigned char*)rfc4648_decoded[i], len).c_str());
+        STRCMP_EQUAL(rfc4648_decoded[i], base64_decode(rfc4648_encoded[i]).c_str());
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : Base64TestGroup
+*
+* NAME : Decode_stopsAtTheFirstInvalidCharacter
+*
+* PURPOSE : same output as the original base64_decode : nothing after '=' or
+*           a non base64 character, a group of n < 4 characters gives n - 1
+*           bytes
+*
+*-----------------------------------------------------------------------------*/
+TEST(Base64TestGroup, Decode_stopsAtTheFirstInvalidCharacter)
+{
+    STRCMP_EQUAL("foo", base64_decode("Zm9v\nYmFy").c_str());
+    STRCMP_EQUAL("f", base64_decode("Zg==Zm9v").c_str());
+    STRCMP_EQUAL("fo", base64_decode("Zm9").c_str());
+    STRCMP_EQUAL("f", base64_decode("Zm").c_str());
+    STRCMP_EQUAL("", base64_decode("Z").c_str());
+    STRCMP_EQUAL("", base64_decode("-Zm9v").c_str());
+    STRCMP_EQUAL("foo", base64_decode(std::string("Zm9v\0YmFy", 9)).c_str());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : Base64TestGroup
+*
+* NAME : DecodeBuffer_sameBytesAsTheScalarDecoder
+*
+* PURPOSE : the vector blocks end where the scalar decoder takes over, an
+*           invalid character anywhere in or between the blocks
+*
+*-----------------------------------------------------------------------------*/
+TEST(Base64TestGroup, DecodeBuffer_sameBytesAsTheScalarDecoder)
+{
+    unsigned char *bytes = (unsigned char*)malloc(BASE64_TEST_SIZE);
+    char *encoded = (char*)malloc(BASE64_ENCODED_SIZE(BASE64_TEST_SIZE));
+    unsigned char *expected = (unsigned char*)malloc(BASE64_DECODED_MAX_SIZE(BASE64_ENCODED_SIZE(BASE64_TEST_SIZE)));
+    unsigned char *decoded = (unsigned char*)malloc(BASE64_DECODED_MAX_SIZE(BASE64_ENCODED_SIZE(BASE64_TEST_SIZE)));
+
+    srand(37);
+    for (size_t i = 0; i < BASE64_TEST_SIZE; i++) {
+        bytes[i] = (unsigned char)rand();
+    }
+
+    size_t encoded_len = base64_encode_buffer(bytes, BASE64_TEST_SIZE, encoded);
+
+    CHECK_EQUAL(BASE64_TEST_SIZE, base64_decode_buffer(encoded, encoded_len, decoded));
+    CHECK_EQUAL(0, memcmp(bytes, decoded, BASE64_TEST_SIZE));
+
+    for (size_t at = 0; at < 100; at++) {
+        for (size_t len = encoded_len - 70; len <= encoded_len; len += 7) {
+            char saved = encoded[at];
+            encoded[at] = (at % 2) ? '=' : '\xe1';
+
+            size_t expected_len = base64_decode_scalar(encoded, len, expected);
+
+            CHECK_EQUAL(expected_len, base64_decode_buffer(encoded, len, decoded));
+            CHECK_EQUAL(0, memcmp(expected, decoded, expected_len));
+
+            encoded[at] = saved;
+        }
+    }
+
+    free(bytes);
+    free(encoded);
+    free(expected);
+    free(decoded);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : Base64TestGroup
+*
+* NAME : Stream_anyChunkSize_sameBytesAsOneDecode
+*
+* PURPOSE : the groups split between two chunks, and the end ('=' or an
+*           invalid character) in any chunk
+*
+*-----------------------------------------------------------------------------*/
+TEST(Base64TestGroup, Stream_anyChunkSize_sameBytesAsOneDecode)
+{
+    static const char *inputs[] = { "Zm9vYmFyIGJheiBxdXV4IGNvcmdl", "Zm9vYmFyIGJheiBxdXV4IGNvcmc=",
+                                    "Zm9vYmFyIGJheiBxdXV4IGNvcg", "Zm9vYmF*IGJheiBxdXV4", "Zm9vYmFyIGJheiBxdX" };
+    unsigned char expected[64];
+    unsigned char decoded[64];
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        size_t len = strlen(inputs[i]);
+        size_t expected_len = base64_decode_buffer(inputs[i], len, expected);
+
+        for (size_t chunk = 1; chunk <= len; chunk++) {
+            Base64Stream stream;
+            size_t decoded_len = 0;
+
+            base64_stream_init(&stream);
+            for (size_t at = 0; at < len; at += chunk) {
+                size_t n = (len - at < chunk) ? len - at : chunk;
+                decoded_len += base64_stream_decode(&stream, inputs[i] + at, n, decoded + decoded_len);
+            }
+            decoded_len += base64_stream_finish(&stream, decoded + decoded_len);
+
+            CHECK_EQUAL(expected_len, decoded_len);
+            CHECK_EQUAL(0, memcmp(expected, decoded, expected_len));
+        }
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : Base64TestGroup
+*
+* NAME : DecodeBuffer_doesNotWritePastTheDecodedBytes
+*
+*-----------------------------------------------------------------------------*/
+TEST(Base64TestGroup, DecodeBuffer_doesNotWritePastTheDecodedBytes)
+{
+    char encoded[BASE64_ENCODED_SIZE(48)];
+    unsigned char bytes[48];
+    unsigned char decoded[64];
+
+    memset(bytes, 0x5a, sizeof(bytes));
+    base64_encode_buffer(bytes, sizeof(bytes), encoded);
+
+    for (size_t len = 0; len <= sizeof(encoded); len += 4) {
+        memset(decoded, 0xee, sizeof(decoded));
+
+        size_t decoded_len = base64_decode_buffer(encoded, len, decoded);
+
+        CHECK_EQUAL(len / 4 * 3, decoded_len);
+        for (size_t i = decoded_len; i < sizeof(decoded); i++) {
+            CHECK_EQUAL(0xee, decoded[i]);
+        }
+    }
+}
@@ -0,0 +1,241 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : batch-command-test.cpp
+ *
+ * DESCRIPTION : Tests the BatchCommand : the commands run in order, the
+ *               conditions, stop-on-failure and the reply parsed back
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/batch-command.h"
+#include "common/command-factory.h"
+#include "common/commands.h"
+#include "common/event-log.h"
+#include "common/gettime-command.h"
+#include "common/patch-command.h"
+
+#define BATCH_TEST_DIR CS1_TMP"/batch"
+#define BATCH_TEST_EVENTS BATCH_TEST_DIR"/commander.evt"
+#define BATCH_TEST_RESULT_SIZE (GETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE)
+
+static char gettime_cmd[GETTIME_CMD_SIZE] = { GETTIME_CMD };
+static char patch_cmd[PATCH_CMD_MIN_SIZE + 64];         // fails : nothing to patch
+static size_t patch_size = 0;
+
+TEST_GROUP(BatchCommandTestGroup)
+{
+    char command_buf[256];
+    CommandStorage storage;
+
+    void setup()
+    {
+        mkdir(CS1_TMP, S_IRWXU);
+        mkdir(BATCH_TEST_DIR, S_IRWXU);
+        EventLog::Open(BATCH_TEST_EVENTS);
+
+        patch_size = PatchCommand::Build_PatchCommand(patch_cmd, CS1_TMP"/batch/none", CS1_TMP"/batch/none.patch");
+    }
+
+    void teardown()
+    {
+        EventLog::Close();
+        remove(BATCH_TEST_EVENTS);
+        rmdir(BATCH_TEST_DIR);
+    }
+
+    /* Builds the batch, executes it and parses its result */
+    void Run(char flags, const BatchEntry* entries, size_t count, ResultBuffer& result, InfoBytesBatch** info)
+    {
+        size_t size = BatchCommand::Build_BatchCommand(this->command_buf, sizeof(this->command_buf), flags, entries, count);
+        CHECK(size > 0);
+
+        ICommand* command = CommandFactory::CreateCommand(this->command_buf, size, &this->storage);
+        CHECK(command != 0);
+
+        command->Execute(result);
+        CommandFactory::DestroyCommand(command);
+
+        BatchCommand parser;
+        *info = (InfoBytesBatch*)parser.ParseResult(result.GetData());
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : BatchCommandTestGroup
+*
+* NAME : Execute_allSucceed_resultsInOrder
+*
+*-----------------------------------------------------------------------------*/
+TEST(BatchCommandTestGroup, Execute_allSucceed_resultsInOrder)
+{
+    BatchEntry entries[2] = {
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_ALWAYS, 0 },
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_IF_SUCCEEDED, 0 }
+    };
+    ResultBuffer result;
+    InfoBytesBatch* info = 0;
+
+    this->Run(0, entries, 2, result, &info);
+
+    const char* data = result.GetData();
+    size_t head_size = BatchResultSchema::SIZE + 2 * BATCH_RES_ENTRY_SIZE;
+
+    CHECK_EQUAL(head_size + 2 * BATCH_TEST_RESULT_SIZE, result.GetSize());
+    CHECK_EQUAL(BATCH_CMD, data[CMD_ID]);
+    CHECK_EQUAL(CS1_SUCCESS, data[CMD_STS]);
+    CHECK_EQUAL(GETTIME_CMD, data[head_size + CMD_ID]);
+    CHECK_EQUAL(GETTIME_CMD, data[head_size + BATCH_TEST_RESULT_SIZE + CMD_ID]);
+
+    CHECK_EQUAL(CS1_SUCCESS, info->batch_status);
+    CHECK_EQUAL(2, info->count);
+
+    for (int i = 0; i < 2; i++) {
+        CHECK_EQUAL(BATCH_SUCCEEDED, info->states[i]);
+        CHECK_EQUAL(CS1_SUCCESS, info->statuses[i]);
+        CHECK_EQUAL(BATCH_TEST_RESULT_SIZE, info->sizes[i]);
+        CHECK(info->results[i] == data + head_size + i * BATCH_TEST_RESULT_SIZE);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : BatchCommandTestGroup
+*
+* NAME : Execute_conditions_runOnlyOnTheirBranch
+*
+*-----------------------------------------------------------------------------*/
+TEST(BatchCommandTestGroup, Execute_conditions_runOnlyOnTheirBranch)
+{
+    BatchEntry entries[3] = {
+        { WireView(patch_cmd, patch_size), BATCH_ALWAYS, 0 },
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_IF_SUCCEEDED, 0 },
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_IF_FAILED, 0 }
+    };
+    ResultBuffer result;
+    InfoBytesBatch* info = 0;
+
+    this->Run(0, entries, 3, result, &info);
+
+    CHECK_EQUAL(CS1_FAILURE, info->batch_status);
+    CHECK_EQUAL(BATCH_FAILED, info->states[0]);
+    CHECK_EQUAL(CS1_FAILURE, info->statuses[0]);
+    CHECK_EQUAL(PATCH_CMD, info->results[0][CMD_ID]);
+
+    CHECK_EQUAL(BATCH_SKIPPED, info->states[1]);
+    CHECK_EQUAL(0, info->sizes[1]);
+    CHECK(info->results[1] == 0);
+
+    CHECK_EQUAL(BATCH_SUCCEEDED, info->states[2]);
+    CHECK_EQUAL(GETTIME_CMD, info->results[2][CMD_ID]);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : BatchCommandTestGroup
+*
+* NAME : Execute_stopOnFailure_restNotRun
+*
+*-----------------------------------------------------------------------------*/
+TEST(BatchCommandTestGroup, Execute_stopOnFailure_restNotRun)
+{
+    char unknown_cmd[1] = { (char)0xEE };
+    char nested_cmd[BatchSchema::SIZE] = { (char)BATCH_CMD, 0, 0 };
+    BatchEntry entries[4] = {
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_ALWAYS, 0 },
+        { WireView(nested_cmd, sizeof(nested_cmd)), BATCH_ALWAYS, 0 },
+        { WireView(unknown_cmd, sizeof(unknown_cmd)), BATCH_ALWAYS, 0 },
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_ALWAYS, 0 }
+    };
+    ResultBuffer result;
+    InfoBytesBatch* info = 0;
+
+    this->Run(0, entries, 4, result, &info);
+
+    CHECK_EQUAL(BATCH_SUCCEEDED, info->states[0]);
+    CHECK_EQUAL(BATCH_INVALID, info->states[1]);        // no batch in a batch
+    CHECK_EQUAL(BATCH_INVALID, info->states[2]);
+    CHECK_EQUAL(BATCH_SUCCEEDED, info->states[3]);
+
+    ResultBuffer stopped;
+    this->Run(BATCH_STOP_ON_FAILURE, entries, 4, stopped, &info);
+
+    CHECK_EQUAL(CS1_FAILURE, info->batch_status);
+    CHECK_EQUAL(BATCH_SUCCEEDED, info->states[0]);
+    CHECK_EQUAL(BATCH_INVALID, info->states[1]);
+    CHECK_EQUAL(BATCH_NOT_RUN, info->states[2]);
+    CHECK_EQUAL(BATCH_NOT_RUN, info->states[3]);
+    CHECK_EQUAL(BatchResultSchema::SIZE + 4 * BATCH_RES_ENTRY_SIZE + BATCH_TEST_RESULT_SIZE, stopped.GetSize());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : BatchCommandTestGroup
+*
+* NAME : Execute_entryPastTheLength_invalidAndLast
+*
+*-----------------------------------------------------------------------------*/
+TEST(BatchCommandTestGroup, Execute_entryPastTheLength_invalidAndLast)
+{
+    BatchEntry entries[3] = {
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_ALWAYS, 0 },
+        { WireView(patch_cmd, patch_size), BATCH_ALWAYS, 0 },
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_ALWAYS, 0 }
+    };
+    size_t size = BatchCommand::Build_BatchCommand(this->command_buf, sizeof(this->command_buf), 0, entries, 3);
+    ResultBuffer result;
+
+    // the second one was not received whole
+    size_t received = BatchSchema::SIZE + BATCH_ENTRY_HEAD_SIZE + sizeof(gettime_cmd) + BATCH_ENTRY_HEAD_SIZE + 1;
+    CHECK(received < size);
+
+    ICommand* command = CommandFactory::CreateCommand(this->command_buf, received, &this->storage);
+    CHECK(command != 0);
+
+    command->Execute(result);
+    CommandFactory::DestroyCommand(command);
+
+    BatchCommand parser;
+    InfoBytesBatch* info = (InfoBytesBatch*)parser.ParseResult(result.GetData());
+
+    CHECK_EQUAL(CS1_FAILURE, info->batch_status);
+    CHECK_EQUAL(2, info->count);
+    CHECK_EQUAL(BATCH_SUCCEEDED, info->states[0]);
+    CHECK_EQUAL(BATCH_INVALID, info->states[1]);
+    CHECK_EQUAL(0, info->sizes[1]);
+    CHECK_EQUAL(BatchResultSchema::SIZE + 2 * BATCH_RES_ENTRY_SIZE + BATCH_TEST_RESULT_SIZE, result.GetSize());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : BatchCommandTestGroup
+*
+* NAME : Build_conditionOnALaterEntry_refused
+*
+*-----------------------------------------------------------------------------*/
+TEST(BatchCommandTestGroup, Build_conditionOnALaterEntry_refused)
+{
+    BatchEntry entries[2] = {
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_IF_SUCCEEDED, 1 },
+        { WireView(gettime_cmd, sizeof(gettime_cmd)), BATCH_ALWAYS, 0 }
+    };
+
+    CHECK_EQUAL(0, BatchCommand::Build_BatchCommand(this->command_buf, sizeof(this->command_buf), 0, entries, 2));
+
+    entries[0].condition = BATCH_ALWAYS;
+    CHECK_EQUAL(BatchSchema::SIZE + 2 * (BATCH_ENTRY_HEAD_SIZE + 1),
+                    BatchCommand::Build_BatchCommand(this->command_buf, sizeof(this->command_buf), 0, entries, 2));
+
+    // too small for the second one
+    CHECK_EQUAL(0, BatchCommand::Build_BatchCommand(this->command_buf, BatchSchema::SIZE + BATCH_ENTRY_HEAD_SIZE + 2, 0, entries, 2));
+}
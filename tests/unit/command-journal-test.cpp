@@ -0,0 +1,238 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : command-journal-test.cpp
+ *
+ * DESCRIPTION : Tests the CommandJournal of the ground commander : the order,
+ *               the cursor kept across restarts, the compaction and Wait
+ *
+ *----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/command-journal.h"
+
+#define JOURNAL_TEST_DIR CS1_TMP"/journal"
+#define JOURNAL_TEST_PATH JOURNAL_TEST_DIR"/todo"
+#define JOURNAL_TEST_COMMANDS 8000                 // over JOURNAL_COMPACT_SIZE
+
+static void* AppendLater(void*)
+{
+    usleep(100 * 1000);
+    CommandJournal::Append(JOURNAL_TEST_PATH, "GETTIME");
+
+    return 0;
+}
+
+TEST_GROUP(CommandJournalTestGroup)
+{
+    void setup()
+    {
+        mkdir(CS1_TMP, S_IRWXU);
+        mkdir(JOURNAL_TEST_DIR, S_IRWXU);
+        this->RemoveFiles();
+    }
+
+    void teardown()
+    {
+        this->RemoveFiles();
+        rmdir(JOURNAL_TEST_DIR);
+    }
+
+    void RemoveFiles()
+    {
+        remove(JOURNAL_TEST_PATH);
+        remove(JOURNAL_TEST_PATH JOURNAL_CURSOR_EXT);
+    }
+
+    void CheckNext(CommandJournal& journal, const char* expected)
+    {
+        std::string command;
+
+        CHECK(journal.Next(&command));
+        CHECK(command == expected);
+    }
+
+    void AppendRaw(const char* text)
+    {
+        FILE* file = fopen(JOURNAL_TEST_PATH, "a");
+
+        fputs(text, file);
+        fclose(file);
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandJournalTestGroup
+*
+* NAME : Next_restarted_resumesAtTheLastCommit
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandJournalTestGroup, Next_restarted_resumesAtTheLastCommit)
+{
+    std::string command;
+
+    CHECK(CommandJournal::Append(JOURNAL_TEST_PATH, "GETLOG"));
+    CHECK(CommandJournal::Append(JOURNAL_TEST_PATH, "SETTIME 1433160000"));
+    CHECK(CommandJournal::Append(JOURNAL_TEST_PATH, "REBOOT"));
+    CHECK(!CommandJournal::Append(JOURNAL_TEST_PATH, "two\nlines"));
+
+    {
+        CommandJournal journal(JOURNAL_TEST_PATH);
+
+        this->CheckNext(journal, "GETLOG");
+        CHECK(journal.Commit());
+        this->CheckNext(journal, "SETTIME 1433160000");    // not committed
+    }
+
+    CommandJournal journal(JOURNAL_TEST_PATH);
+
+    this->CheckNext(journal, "SETTIME 1433160000");
+    this->CheckNext(journal, "REBOOT");
+    CHECK(!journal.Next(&command));
+    CHECK(journal.Commit());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandJournalTestGroup
+*
+* NAME : CommitOffset_prefixOnly_restReturnedAfterARestart
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandJournalTestGroup, CommitOffset_prefixOnly_restReturnedAfterARestart)
+{
+    CHECK(CommandJournal::Append(JOURNAL_TEST_PATH, "GETLOG"));
+    CHECK(CommandJournal::Append(JOURNAL_TEST_PATH, "SETTIME 1433160000"));
+    CHECK(CommandJournal::Append(JOURNAL_TEST_PATH, "REBOOT"));
+
+    {
+        CommandJournal journal(JOURNAL_TEST_PATH);
+
+        this->CheckNext(journal, "GETLOG");
+        off_t after_getlog = journal.GetOffset();
+        this->CheckNext(journal, "SETTIME 1433160000");
+        this->CheckNext(journal, "REBOOT");
+
+        CHECK(journal.Commit(after_getlog));
+        CHECK(journal.Commit(after_getlog));            // again : nothing to do
+        CHECK(!journal.Commit(journal.GetOffset() + 1));  // not read yet
+    }
+
+    CommandJournal journal(JOURNAL_TEST_PATH);
+    std::string command;
+
+    this->CheckNext(journal, "SETTIME 1433160000");
+    off_t after_settime = journal.GetOffset();
+    this->CheckNext(journal, "REBOOT");
+
+    CHECK(journal.Commit(after_settime));
+    CHECK(journal.Commit());
+    CHECK(!journal.Next(&command));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandJournalTestGroup
+*
+* NAME : Next_lineBeingWritten_returnedOnceWhole
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandJournalTestGroup, Next_lineBeingWritten_returnedOnceWhole)
+{
+    CommandJournal journal(JOURNAL_TEST_PATH);
+    std::string command;
+    std::string too_long(JOURNAL_READ_SIZE + 10, 'x');
+
+    this->AppendRaw("# a comment\n\nGET");
+    CHECK(!journal.Next(&command));
+
+    this->AppendRaw("TIME\n");
+    this->CheckNext(journal, "GETTIME");
+
+    // a line longer than the buffer is dropped, not the next one
+    this->AppendRaw((too_long + "\nREBOOT\n").c_str());
+    this->CheckNext(journal, "REBOOT");
+    CHECK(!journal.Next(&command));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandJournalTestGroup
+*
+* NAME : Commit_allConsumed_compacted
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandJournalTestGroup, Commit_allConsumed_compacted)
+{
+    char line[64];
+    std::string command;
+    struct stat stat_buf;
+    CommandJournal journal(JOURNAL_TEST_PATH);
+
+    for (int i = 0; i < JOURNAL_TEST_COMMANDS; i++) {
+        snprintf(line, sizeof(line), "GETLOG %d", i);
+        CHECK(CommandJournal::Append(JOURNAL_TEST_PATH, line));
+    }
+
+    // one pass
+    int count = 0;
+    while (journal.Next(&command)) {
+        count++;
+    }
+
+    CHECK_EQUAL(JOURNAL_TEST_COMMANDS, count);
+    CHECK(command == "GETLOG 7999");
+    CHECK(journal.Commit());
+
+    CHECK_EQUAL(1, journal.GetGeneration());
+    CHECK_EQUAL(0, stat(JOURNAL_TEST_PATH, &stat_buf));
+    CHECK_EQUAL(stat_buf.st_size, journal.GetOffset());
+    CHECK(stat_buf.st_size < 32);
+
+    // appended to the new file, and found after a restart
+    CHECK(CommandJournal::Append(JOURNAL_TEST_PATH, "REBOOT"));
+    this->CheckNext(journal, "REBOOT");
+
+    CommandJournal restarted(JOURNAL_TEST_PATH);
+    this->CheckNext(restarted, "REBOOT");
+    CHECK(!restarted.Next(&command));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandJournalTestGroup
+*
+* NAME : Wait_commandAppended_wokenBeforeTheTimeout
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandJournalTestGroup, Wait_commandAppended_wokenBeforeTheTimeout)
+{
+    CommandJournal journal(JOURNAL_TEST_PATH);
+    struct timespec start, end;
+    pthread_t appender;
+    std::string command;
+
+    CHECK(!journal.Next(&command));
+    pthread_create(&appender, 0, AppendLater, 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    CHECK(journal.Wait(5000));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    pthread_join(appender, 0);
+
+    CHECK(end.tv_sec - start.tv_sec < 2);
+    this->CheckNext(journal, "GETTIME");
+}
@@ -0,0 +1,356 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : command-pipeline-test.cpp
+ *
+ * DESCRIPTION : Tests the CommandPipeline of the ground and the PipelineServer
+ *               of the satellite over a simulated link : the window, the
+ *               replies matched by cid, the retransmits, the replies
+ *               replayed instead of executing a command twice and the
+ *               frames of another wire version refused
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/command-pipeline.h"
+#include "common/commands.h"
+#include "common/event-log.h"
+#include "common/gettime-command.h"
+#include "common/version-command.h"
+#include "common/wire.h"
+
+#define PIPELINE_TEST_DIR CS1_TMP"/pipeline"
+#define PIPELINE_TEST_EVENTS PIPELINE_TEST_DIR"/commander.evt"
+
+static const char gettime_cmd[GETTIME_CMD_SIZE] = { GETTIME_CMD };
+
+/*
+ * The link : the frames sent by the ground, and the tags of the commands
+ * handed back with their InfoBytes
+ */
+struct PipelineLink {
+    std::vector<std::string> frames;
+    std::vector<long> replied;
+    std::vector<InfoBytes*> infos;
+    bool up;
+};
+
+static bool SendToLink(const char* frame, size_t size, void* context)
+{
+    PipelineLink* link = (PipelineLink*)context;
+
+    if (link->up) {
+        link->frames.push_back(std::string(frame, size));
+    }
+
+    return link->up;
+}
+
+static void ReplyFromLink(unsigned char id, InfoBytes* info, long tag, void* context)
+{
+    PipelineLink* link = (PipelineLink*)context;
+
+    CHECK(id == GETTIME_CMD || id == VERSION_CMD);
+    link->replied.push_back(tag);
+    link->infos.push_back(info);
+}
+
+TEST_GROUP(CommandPipelineTestGroup)
+{
+    PipelineLink link;
+
+    void setup()
+    {
+        mkdir(CS1_TMP, S_IRWXU);
+        mkdir(PIPELINE_TEST_DIR, S_IRWXU);
+        remove(PIPELINE_TEST_EVENTS);
+        EventLog::Open(PIPELINE_TEST_EVENTS);
+        PipelineServer::Reset();
+        Wire::Reset();
+
+        link.up = true;
+    }
+
+    void teardown()
+    {
+        Wire::Reset();
+        EventLog::Close();
+        remove(PIPELINE_TEST_EVENTS);
+        rmdir(PIPELINE_TEST_DIR);
+    }
+
+    /* The satellite : the reply to 'frame' */
+    void Execute(const std::string& frame, std::string* reply)
+    {
+        CommandStorage storage;
+        ResultBuffer result;
+        std::string data(frame);
+
+        reply->clear();
+        CHECK(PipelineServer::Execute(&data[0], data.size(), &storage, result));
+
+        reply->assign(result.GetData(), result.GetSize());
+    }
+
+    bool Deliver(CommandPipeline& pipeline, const std::string& reply)
+    {
+        std::string data(reply);
+        return pipeline.OnReply(&data[0], data.size());
+    }
+
+    off_t EventLogSize()
+    {
+        struct stat stat_buf;
+        return stat(PIPELINE_TEST_EVENTS, &stat_buf) == 0 ? stat_buf.st_size : 0;
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandPipelineTestGroup
+*
+* NAME : Submit_windowFull_restQueued
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandPipelineTestGroup, Submit_windowFull_restQueued)
+{
+    CommandPipeline pipeline(SendToLink, ReplyFromLink, &link, 4);
+
+    for (int i = 0; i < 10; i++) {
+        CHECK(pipeline.Submit(gettime_cmd, sizeof(gettime_cmd), i));
+    }
+
+    // not a command : nothing to parse its reply with
+    const char unknown[1] = { (char)0xEE };
+    CHECK(!pipeline.Submit(unknown, sizeof(unknown)));
+
+    CHECK_EQUAL(4, pipeline.InFlight());
+    CHECK_EQUAL(6, pipeline.Queued());
+    CHECK_EQUAL(4, link.frames.size());
+
+    for (size_t i = 0; i < link.frames.size(); i++) {
+        const std::string& frame = link.frames[i];
+
+        CHECK_EQUAL(PIPELINE_HEAD_SIZE + sizeof(gettime_cmd), frame.size());
+        CHECK_EQUAL(PIPELINE_FRAME, frame[CMD_ID]);
+        CHECK_EQUAL(WIRE_V1, frame[PIPELINE_VERSION]);
+        CHECK_EQUAL(GETTIME_CMD, frame[PIPELINE_HEAD_SIZE]);
+        CHECK(i == 0 || frame.compare(PIPELINE_CID, 2, link.frames[i - 1], PIPELINE_CID, 2) != 0);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandPipelineTestGroup
+*
+* NAME : OnReply_outOfOrder_matchedToItsCommand
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandPipelineTestGroup, OnReply_outOfOrder_matchedToItsCommand)
+{
+    CommandPipeline pipeline(SendToLink, ReplyFromLink, &link);
+    std::string replies[3];
+
+    for (int i = 0; i < 3; i++) {
+        pipeline.Submit(gettime_cmd, sizeof(gettime_cmd), 100 + i);
+        this->Execute(link.frames[i], &replies[i]);
+    }
+
+    CHECK(replies[0].compare(0, PIPELINE_HEAD_SIZE, link.frames[0], 0, PIPELINE_HEAD_SIZE) == 0);
+    CHECK_EQUAL(GETTIME_CMD, replies[0][PIPELINE_HEAD_SIZE + CMD_ID]);
+
+    CHECK(this->Deliver(pipeline, replies[2]));
+    CHECK(this->Deliver(pipeline, replies[0]));
+    CHECK(this->Deliver(pipeline, replies[1]));
+
+    CHECK_EQUAL(3, link.replied.size());
+    CHECK_EQUAL(102, link.replied[0]);
+    CHECK_EQUAL(100, link.replied[1]);
+    CHECK_EQUAL(101, link.replied[2]);
+    CHECK(link.infos[0] != 0 && link.infos[1] != 0 && link.infos[2] != 0);
+    CHECK_EQUAL(0, pipeline.InFlight());
+
+    // the same reply again : already handed over
+    CHECK(!this->Deliver(pipeline, replies[2]));
+    CHECK_EQUAL(3, link.replied.size());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandPipelineTestGroup
+*
+* NAME : Pump_noReply_sentAgainThenGivenUp
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandPipelineTestGroup, Pump_noReply_sentAgainThenGivenUp)
+{
+    CommandPipeline pipeline(SendToLink, ReplyFromLink, &link, PIPELINE_WINDOW, 100);
+    long long now = CommandPipeline::Now();
+
+    link.up = false;        // the first one is lost
+    pipeline.Submit(gettime_cmd, sizeof(gettime_cmd));
+    link.up = true;
+
+    pipeline.Pump(now + 50);
+    CHECK_EQUAL(0, link.frames.size());
+
+    for (int i = 1; i <= PIPELINE_MAX_RETRIES; i++) {
+        pipeline.Pump(now + i * 200);
+        CHECK_EQUAL(i, link.frames.size());
+    }
+
+    CHECK_EQUAL(0, link.replied.size());
+
+    pipeline.Pump(now + (PIPELINE_MAX_RETRIES + 1) * 200);
+    CHECK_EQUAL(PIPELINE_MAX_RETRIES, link.frames.size());
+    CHECK_EQUAL(1, link.replied.size());
+    CHECK(link.infos[0] == 0);
+    CHECK_EQUAL(0, pipeline.InFlight());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandPipelineTestGroup
+*
+* NAME : Execute_frameSentAgain_replayedNotExecuted
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandPipelineTestGroup, Execute_frameSentAgain_replayedNotExecuted)
+{
+    CommandPipeline pipeline(SendToLink, ReplyFromLink, &link, PIPELINE_WINDOW, 100);
+    long long now = CommandPipeline::Now();
+
+    pipeline.Submit(gettime_cmd, sizeof(gettime_cmd));
+    std::string lost, reply;
+
+    this->Execute(link.frames[0], &lost);
+    off_t executed = this->EventLogSize();
+
+    CHECK(executed > 0);
+
+    pipeline.Pump(now + 200);
+    CHECK_EQUAL(2, link.frames.size());
+    CHECK(link.frames[1] == link.frames[0]);
+
+    this->Execute(link.frames[1], &reply);
+
+    CHECK(reply == lost);
+    CHECK_EQUAL(executed, this->EventLogSize());       // not executed again
+
+    CHECK(this->Deliver(pipeline, reply));
+    CHECK_EQUAL(1, link.replied.size());
+
+    // an unknown command : the header alone
+    std::string unknown(link.frames[0]);
+    unknown[PIPELINE_HEAD_SIZE] = (char)0xEE;
+    unknown[PIPELINE_CID] ^= 0x5A;
+
+    this->Execute(unknown, &reply);
+    CHECK(reply == unknown.substr(0, PIPELINE_HEAD_SIZE));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandPipelineTestGroup
+*
+* NAME : Execute_otherVersion_refusedAndTheGroundSwitches
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandPipelineTestGroup, Execute_otherVersion_refusedAndTheGroundSwitches)
+{
+    CommandPipeline pipeline(SendToLink, ReplyFromLink, &link);
+    std::string reply;
+
+    pipeline.Submit(gettime_cmd, sizeof(gettime_cmd), 7);      // built in WIRE_V1
+
+    // the satellite is in WIRE_V2 (the process is both sides here)
+    Wire::SetVersion(WIRE_V2);
+    this->Execute(link.frames[0], &reply);
+
+    CHECK_EQUAL(PIPELINE_HEAD_SIZE, reply.size());
+    CHECK_EQUAL(WIRE_V2, reply[PIPELINE_VERSION]);
+    CHECK_EQUAL(0, this->EventLogSize());                       // not executed
+
+    // the ground, still in WIRE_V1 : given up, then in the version of the satellite
+    Wire::Reset();
+    CHECK(this->Deliver(pipeline, reply));
+    CHECK_EQUAL(1, link.replied.size());
+    CHECK_EQUAL(7, link.replied[0]);
+    CHECK(link.infos[0] == 0);
+    CHECK_EQUAL(WIRE_V2, Wire::GetVersion());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandPipelineTestGroup
+*
+* NAME : Execute_versionCommandSentAgain_replayedInItsVersion
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandPipelineTestGroup, Execute_versionCommandSentAgain_replayedInItsVersion)
+{
+    CommandPipeline pipeline(SendToLink, ReplyFromLink, &link, PIPELINE_WINDOW, 100);
+    char version_cmd[VERSION_CMD_SIZE];
+    std::string lost, reply;
+
+    VersionCommand(WIRE_V2).GetCmdStr(version_cmd);
+    pipeline.Submit(version_cmd, sizeof(version_cmd));
+
+    this->Execute(link.frames[0], &lost);                       // WIRE_V2 from now on
+    CHECK_EQUAL(WIRE_V2, Wire::GetVersion());
+    CHECK_EQUAL(WIRE_V1, lost[PIPELINE_VERSION]);
+
+    // the frame in WIRE_V1 sent again : the reply it got, not refused
+    pipeline.Pump(CommandPipeline::Now() + 200);
+    this->Execute(link.frames[1], &reply);
+
+    CHECK(reply == lost);
+    CHECK(this->Deliver(pipeline, reply));
+    CHECK(link.infos[0] != 0);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandPipelineTestGroup
+*
+* NAME : Pump_manyCommands_oneRoundTripPerWindow
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandPipelineTestGroup, Pump_manyCommands_oneRoundTripPerWindow)
+{
+    const int number_of_commands = 4 * PIPELINE_WINDOW;
+    CommandPipeline pipeline(SendToLink, ReplyFromLink, &link);
+    int round_trips = 0;
+
+    for (int i = 0; i < number_of_commands; i++) {
+        pipeline.Submit(gettime_cmd, sizeof(gettime_cmd));
+    }
+
+    // a round trip : what was sent is executed, the replies come back
+    while (!link.frames.empty()) {
+        std::vector<std::string> sent;
+        sent.swap(link.frames);
+
+        for (size_t i = 0; i < sent.size(); i++) {
+            std::string reply;
+
+            this->Execute(sent[i], &reply);
+            CHECK(this->Deliver(pipeline, reply));
+        }
+
+        round_trips++;
+    }
+
+    CHECK_EQUAL(number_of_commands, (int)link.replied.size());
+    CHECK_EQUAL(number_of_commands / PIPELINE_WINDOW, round_trips);     // lock-step : number_of_commands
+}
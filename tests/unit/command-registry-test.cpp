@@ -0,0 +1,178 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : command-registry-test.cpp
+ *
+ * DESCRIPTION : Tests the CommandRegistry and the registration of the commands,
+ *               and the creation of the commands in a CommandStorage
+ *
+ *----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetector.h"
+#include "CppUTest/MemoryLeakWarningPlugin.h"
+
+#include "SpaceDecl.h"
+#include "common/command-factory.h"
+#include "common/command-registry.h"
+#include "common/commands.h"
+
+// allocations of the current test still alive (malloc and new, see CppUTest)
+static int allocations()
+{
+    return MemoryLeakWarningPlugin::getGlobalDetector()->totalMemoryLeaks(mem_leak_period_checking);
+}
+
+TEST_GROUP(CommandRegistryTestGroup)
+{
+    void setup() { }
+    void teardown() { }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandRegistryTestGroup
+*
+* NAME : Get_everyCommandIsRegistered
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandRegistryTestGroup, Get_everyCommandIsRegistered)
+{
+    const unsigned char ids[] = { SETTIME_CMD, GETTIME_CMD, UPDATE_CMD, GETLOG_CMD,
+                                  REBOOT_CMD, DECODE_CMD, DELETELOG_CMD, VERSION_CMD };
+
+    for (size_t i = 0; i < sizeof(ids); i++) {
+        const CommandEntry *entry = CommandRegistry::Get(ids[i]);
+
+        CHECK(entry != 0);
+        CHECK_EQUAL(ids[i], entry->id);
+        CHECK(entry->create != 0);
+        CHECK(entry->parse != 0);
+        CHECK(entry->min_length >= CMD_HEAD_SIZE);
+    }
+
+    POINTERS_EQUAL(0, CommandRegistry::Get(0x00));
+    POINTERS_EQUAL(0, CommandRegistry::Get(0xFF));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandRegistryTestGroup
+*
+* NAME : CreateCommand_checksTheLength
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandRegistryTestGroup, CreateCommand_checksTheLength)
+{
+    char command_buf[GETLOG_CMD_SIZE] = {'\0'};
+    GetLogCommand ground_cmd(OPT_NOOPT, 0, 0, 0);
+    ground_cmd.GetCmdStr(command_buf);
+
+    POINTERS_EQUAL(0, CommandFactory::CreateCommand(command_buf, GETLOG_CMD_SIZE - 1));
+
+    ICommand *command = CommandFactory::CreateCommand(command_buf, GETLOG_CMD_SIZE);
+    CHECK(command != 0);
+    delete command;
+
+    command_buf[CMD_ID] = 0x00;
+    POINTERS_EQUAL(0, CommandFactory::CreateCommand(command_buf, GETLOG_CMD_SIZE));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandRegistryTestGroup
+*
+* NAME : Parse_usesTheRegisteredParser
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandRegistryTestGroup, Parse_usesTheRegisteredParser)
+{
+    char result[REBOOT_RTN_SIZE] = { REBOOT_CMD, CS1_SUCCESS };
+
+    InfoBytesReboot *info = (InfoBytesReboot*)CommandRegistry::Parse(result);
+
+    CHECK(info != 0);
+    CHECK_EQUAL(CS1_SUCCESS, info->reboot_status);
+
+    result[CMD_ID] = 0x00;
+    POINTERS_EQUAL(0, CommandRegistry::Parse(result));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandRegistryTestGroup
+*
+* NAME : CreateCommand_inStorage_allocatesNothing
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandRegistryTestGroup, CreateCommand_inStorage_allocatesNothing)
+{
+    CommandStorage storage;
+    char gettime_buf[GETTIME_CMD_SIZE] = { GETTIME_CMD };
+    char getlog_buf[GETLOG_CMD_SIZE] = {'\0'};
+    char update_buf[100] = {'\0'};
+    const char payload[] = { 'a', '\0', 'b', '\0' };      // binary
+
+    GetLogCommand ground_cmd(OPT_SUB, 0x01, 0, 0);
+    ground_cmd.GetCmdStr(getlog_buf);
+    size_t update_size = UpdateCommand::Build_UpdateCommand(update_buf, "/home/apps/new/a.out", 
+                                                            WireView(payload, sizeof(payload)));
+
+    char *buffers[] = { gettime_buf, getlog_buf, update_buf };
+    size_t sizes[] = { GETTIME_CMD_SIZE, GETLOG_CMD_SIZE, update_size };
+
+    for (size_t i = 0; i < 3; i++) {
+        int before = allocations();
+        ICommand *command = CommandFactory::CreateCommand(buffers[i], sizes[i], &storage);
+
+        CHECK(command != 0);
+        POINTERS_EQUAL(&storage, command);
+        CHECK_EQUAL(before, allocations());
+
+        CommandFactory::DestroyCommand(command);
+    }
+
+    UpdateCommand *update = (UpdateCommand*)CommandFactory::CreateCommand(update_buf, update_size, &storage);
+    CHECK_EQUAL(sizeof(payload), update->GetDataLength());
+    CHECK_EQUAL(0, memcmp(payload, update->GetData().data, sizeof(payload)));
+    POINTERS_EQUAL(update_buf + update_size - sizeof(payload), update->GetData().data);   // a view, not a copy
+    CommandFactory::DestroyCommand(update);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : CommandRegistryTestGroup
+*
+* NAME : CreateCommand_viewPastTheLength_refused
+*
+*-----------------------------------------------------------------------------*/
+TEST(CommandRegistryTestGroup, CreateCommand_viewPastTheLength_refused)
+{
+    CommandStorage storage;
+    char update_buf[100] = {'\0'};
+    char patch_buf[100] = {'\0'};
+    char getlog_buf[GETLOG_CMD_SIZE_WITH_ACKS(2)] = {'\0'};
+    const char payload[] = "0123456789";
+
+    size_t update_size = UpdateCommand::Build_UpdateCommand(update_buf, "/home/apps/new/a.out", payload);
+    size_t patch_size = PatchCommand::Build_PatchCommand(patch_buf, "/home/apps/a.out", payload);
+
+    GetLogCommand ground_cmd(OPT_NOOPT, 0, 0, 0);
+    ground_cmd.AddAck(1, 1);
+    ground_cmd.AddAck(2, 2);
+    ground_cmd.GetCmdStr(getlog_buf);
+
+    char *buffers[] = { update_buf, patch_buf, getlog_buf };
+    size_t sizes[] = { update_size, patch_size, GETLOG_CMD_SIZE_WITH_ACKS(2) };
+
+    for (size_t i = 0; i < 3; i++) {
+        POINTERS_EQUAL(0, CommandFactory::CreateCommand(buffers[i], sizes[i] - 1, &storage));
+
+        ICommand *command = CommandFactory::CreateCommand(buffers[i], sizes[i], &storage);
+        CHECK(command != 0);
+        CommandFactory::DestroyCommand(command);
+    }
+}
@@ -23,7 +23,10 @@
 
 #include "SpaceDecl.h"
 #include "common/command-factory.h"
+#include "common/command-pipeline.h"
 #include "common/icommand.h"
+#include "common/archive-index.h"
+#include "common/retention-manager.h"
 #include "fileIO.h"
 #include "SpaceString.h"
 #include "space-commander/Net2Com.h"
@@ -81,6 +84,10 @@ TEST_GROUP(CommanderTestGroup)
 
         DeleteDirectoryContent(CS1_PIPES);
 
+        // the process wide index and marks must not outlive the test (memory leak detection)
+        ArchiveIndex::GetInstance(CS1_TGZ)->Clear();
+        RetentionManager::GetInstance(CS1_TGZ)->Clear();
+
         if (netman) {
             delete netman;
             netman = NULL;
@@ -98,7 +105,7 @@ TEST_GROUP(CommanderTestGroup)
 TEST(CommanderTestGroup, GetLog_Oldest_Success) 
 {
     const char* path = CS1_TGZ"/Watch-Puppy20140101.txt";  
-    size_t result_size;
+    ResultBuffer result_buffer;
     UTestUtls::CreateFile(CS1_TGZ"/Watch-Puppy20140101.txt", "file a");
     usleep(1000000);
     UTestUtls::CreateFile(CS1_TGZ"/Updater20140102.txt", "file b");
@@ -115,7 +122,8 @@ TEST(CommanderTestGroup, GetLog_Oldest_Success)
     ground_cmd.GetCmdStr(command_buf);
 
     GetLogCommand *command = (GetLogCommand*)CommandFactory::CreateCommand(command_buf);
-    result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    result = result_buffer.GetData();
 
     GetLogInfoBytes* getlog_info = (GetLogInfoBytes*)command->ParseResult(result, dest);
 
@@ -134,11 +142,6 @@ TEST(CommanderTestGroup, GetLog_Oldest_Success)
         command = NULL;
     }
 
-    if (result) {
-        free(result);
-        result = 0;
-    }
-
 }
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
  *
@@ -327,3 +330,41 @@ TEST(CommanderTestGroup, GetTime_Success)
         CHECK(gettime_info->time_status == CS1_SUCCESS); 
     CHECK(gettime_info->time_set == rawtime);
 }
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * GROUP : CommanderTestGroup
+ *
+ * NAME : PipelineFrame_onArrival_executedWithoutTheResendChar 
+ *
+ *-----------------------------------------------------------------------------*/
+TEST(CommanderTestGroup, PipelineFrame_onArrival_executedWithoutTheResendChar) 
+{
+    char result[RESULT_BUF_SIZE] = {0};
+    const char frame[PIPELINE_HEAD_SIZE + GETTIME_CMD_SIZE] = { (char)PIPELINE_FRAME, WIRE_V1, 0x34, 0x12, GETTIME_CMD };
+    const char last_command[] = "previous";
+
+    UTestUtls::CreateFile("last-command", last_command);
+
+    // no '!' : the frame is executed as soon as it is read
+    netman->WriteToInfoPipe((unsigned char)sizeof(frame));
+    netman->WriteToDataPipe(frame, sizeof(frame));
+    netman->WriteToInfoPipe((unsigned char)0xFF);
+
+    while (netman->ReadFromDataPipe(result, RESULT_BUF_SIZE) == 0) {
+        usleep(1000);
+    }
+
+    CHECK_EQUAL((char)PIPELINE_FRAME, result[0]);
+    CHECK_EQUAL(WIRE_V1, result[PIPELINE_VERSION]);
+    CHECK_EQUAL(0x34, result[PIPELINE_CID]);
+    CHECK_EQUAL(0x12, result[PIPELINE_CID + 1]);
+    CHECK_EQUAL(GETTIME_CMD, result[PIPELINE_HEAD_SIZE]);
+
+    // and last-command is left alone
+    char read_back[sizeof(last_command)] = {0};
+    FILE* file = fopen("last-command", "r");
+    CHECK(file != NULL);
+    CHECK(fread(read_back, 1, sizeof(read_back), file) > 0);
+    fclose(file);
+    STRCMP_EQUAL(last_command, read_back);
+}
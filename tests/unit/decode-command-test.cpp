@@ -0,0 +1,307 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : decode-command-test.cpp
+ *
+ * DESCRIPTION : Tests the DecodeCommand, a file of several chunks decoded to
+ *               its destination, and a base64 tgz unpacked into a directory
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/command-factory.h"
+#include "common/decode-command.h"
+#include "common/icommand.h"
+#include "space-commander/base64.h"
+
+#define DECODE_TEST_SRC CS1_TGZ"/decode-test.b64"
+#define DECODE_TEST_DEST CS1_TGZ"/decode-test.bin"
+#define DECODE_TEST_SIZE (3 * DECODE_CHUNK_SIZE + 1001)     // several chunks, a group across two of them
+#define DECODE_TEST_TAR_DIR CS1_TGZ"/decode-test-tar"
+#define DECODE_TEST_TGZ CS1_TGZ"/decode-test.tgz"
+#define DECODE_TEST_UNPACK_DIR CS1_TGZ"/decode-test-unpack"
+
+static char command_buf[DECODE_CMD_MIN_SIZE + 2 * CS1_PATH_MAX] = {'\0'};
+
+TEST_GROUP(DecodeTestGroup)
+{
+    unsigned char *bytes;
+    size_t tgz_size;
+
+    void setup()
+    {
+        mkdir(CS1_TGZ, S_IRWXU);
+
+        bytes = (unsigned char*)malloc(DECODE_TEST_SIZE);
+        char *encoded = (char*)malloc(BASE64_ENCODED_SIZE(DECODE_TEST_SIZE));
+
+        srand(38);
+        for (size_t i = 0; i < DECODE_TEST_SIZE; i++) {
+            bytes[i] = (unsigned char)rand();
+        }
+
+        FILE *file = fopen(DECODE_TEST_SRC, "w");
+        fwrite(encoded, 1, base64_encode_buffer(bytes, DECODE_TEST_SIZE, encoded), file);
+        fclose(file);
+
+        free(encoded);
+    }
+
+    void teardown()
+    {
+        free(bytes);
+        remove(DECODE_TEST_SRC);
+        remove(DECODE_TEST_DEST);
+        remove(DECODE_TEST_TGZ);
+        CHECK_EQUAL(0, system("rm -rf " DECODE_TEST_TAR_DIR " " DECODE_TEST_UNPACK_DIR));
+    }
+
+    ICommand* BuildCommand(unsigned int size)
+    {
+        size_t cmd_size = DecodeCommand::Build_DecodeCommand(command_buf, DECODE_TEST_SRC, DECODE_TEST_DEST, 0, size);
+        return CommandFactory::CreateCommand(command_buf, cmd_size);
+    }
+
+    ICommand* BuildUnpackCommand(unsigned int size)
+    {
+        size_t cmd_size = DecodeCommand::Build_DecodeCommand(command_buf, DECODE_TEST_SRC, DECODE_TEST_UNPACK_DIR,
+                                                                                    DECODE_MODE_UNPACK, size);
+        return CommandFactory::CreateCommand(command_buf, cmd_size);
+    }
+
+    void WriteFile(const char *path, const unsigned char *data, size_t size, mode_t mode)
+    {
+        FILE *file = fopen(path, "w");
+        fwrite(data, 1, size, file);
+        fclose(file);
+        chmod(path, mode);
+    }
+
+    bool FileMatches(const char *path, const unsigned char *data, size_t size)
+    {
+        unsigned char *read_back = (unsigned char*)malloc(size + 1);
+        FILE *file = fopen(path, "r");
+        size_t read_size = 0;
+
+        if (file) {
+            read_size = fread(read_back, 1, size + 1, file);
+            fclose(file);
+        }
+
+        bool matches = (read_size == size && memcmp(data, read_back, size) == 0);
+        free(read_back);
+
+        return matches;
+    }
+
+    /*
+     * DECODE_TEST_SRC : the base64 of a tgz of app/bin/app (executable, several
+     * windows of gunzip) and app/etc/app.conf. 'corrupt' flips a byte of the tgz,
+     * 'members' are archived as given (-P : a ".." is kept).
+     */
+    void MakeTgz(bool corrupt, const char *members = "app")
+    {
+        char tar_command[256];
+        mkdir(DECODE_TEST_TAR_DIR, S_IRWXU);
+        mkdir(DECODE_TEST_TAR_DIR "/app", S_IRWXU);
+        mkdir(DECODE_TEST_TAR_DIR "/app/bin", S_IRWXU);
+        mkdir(DECODE_TEST_TAR_DIR "/app/etc", S_IRWXU);
+
+        WriteFile(DECODE_TEST_TAR_DIR "/app/bin/app", bytes, DECODE_TEST_SIZE, S_IRWXU);
+        WriteFile(DECODE_TEST_TAR_DIR "/app/etc/app.conf", (const unsigned char*)"period=10\n", 10, S_IRUSR | S_IWUSR);
+
+        snprintf(tar_command, sizeof(tar_command), "tar czPf " DECODE_TEST_TGZ " -C " DECODE_TEST_TAR_DIR " %s", members);
+        CHECK_EQUAL(0, system(tar_command));
+
+        struct stat tgz_stat;
+        stat(DECODE_TEST_TGZ, &tgz_stat);
+
+        unsigned char *tgz = (unsigned char*)malloc(tgz_stat.st_size);
+        char *encoded = (char*)malloc(BASE64_ENCODED_SIZE(tgz_stat.st_size));
+
+        FILE *file = fopen(DECODE_TEST_TGZ, "r");
+        CHECK_EQUAL(tgz_stat.st_size, fread(tgz, 1, tgz_stat.st_size, file));
+        fclose(file);
+
+        if (corrupt) {
+            tgz[tgz_stat.st_size / 2] ^= 0x10;
+        }
+
+        file = fopen(DECODE_TEST_SRC, "w");
+        fwrite(encoded, 1, base64_encode_buffer(tgz, tgz_stat.st_size, encoded), file);
+        fclose(file);
+
+        free(tgz);
+        free(encoded);
+
+        tgz_size = tgz_stat.st_size;
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DecodeTestGroup
+*
+* NAME : Execute_severalChunks_decodesTheFile
+*
+*-----------------------------------------------------------------------------*/
+TEST(DecodeTestGroup, Execute_severalChunks_decodesTheFile)
+{
+    ICommand *command = BuildCommand(DECODE_TEST_SIZE);
+    ResultBuffer result_buffer;
+    struct stat dest_stat;
+    unsigned char *decoded = (unsigned char*)malloc(DECODE_TEST_SIZE);
+
+    command->Execute(result_buffer);
+    char *result = result_buffer.GetData();
+
+    CHECK_EQUAL(DECODE_CMD, result[CMD_ID]);
+    CHECK_EQUAL(CS1_SUCCESS, result[CMD_STS]);
+    CHECK_EQUAL(DECODE_TEST_SIZE, atoi(result + CMD_RES_HEAD_SIZE));
+
+    CHECK_EQUAL(0, stat(DECODE_TEST_DEST, &dest_stat));
+    CHECK_EQUAL(DECODE_TEST_SIZE, dest_stat.st_size);
+
+    FILE *file = fopen(DECODE_TEST_DEST, "r");
+    CHECK_EQUAL(DECODE_TEST_SIZE, fread(decoded, 1, DECODE_TEST_SIZE, file));
+    fclose(file);
+
+    CHECK_EQUAL(0, memcmp(bytes, decoded, DECODE_TEST_SIZE));
+    CHECK(access(DECODE_TEST_SRC, F_OK) != 0);     // removed
+
+    free(decoded);
+    delete command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DecodeTestGroup
+*
+* NAME : Execute_wrongSize_failsAndKeepsTheSource
+*
+*-----------------------------------------------------------------------------*/
+TEST(DecodeTestGroup, Execute_wrongSize_failsAndKeepsTheSource)
+{
+    ICommand *command = BuildCommand(DECODE_TEST_SIZE + 1);
+    ResultBuffer result_buffer;
+
+    command->Execute(result_buffer);
+    char *result = result_buffer.GetData();
+
+    CHECK_EQUAL(CS1_FAILURE, result[CMD_STS]);
+    CHECK_EQUAL(DECODE_TEST_SIZE, atoi(result + CMD_RES_HEAD_SIZE));
+    CHECK_EQUAL(0, access(DECODE_TEST_SRC, F_OK));
+    CHECK(access(DECODE_TEST_DEST, F_OK) != 0);
+
+    InfoBytesDecode *info = (InfoBytesDecode*)command->ParseResult(result);
+    CHECK_EQUAL(CS1_FAILURE, info->decode_status);
+
+    delete command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DecodeTestGroup
+*
+* NAME : Execute_noSource_fails
+*
+*-----------------------------------------------------------------------------*/
+TEST(DecodeTestGroup, Execute_noSource_fails)
+{
+    ICommand *command = BuildCommand(DECODE_TEST_SIZE);
+    ResultBuffer result_buffer;
+
+    remove(DECODE_TEST_SRC);
+    command->Execute(result_buffer);
+
+    CHECK_EQUAL(CS1_FAILURE, result_buffer.GetData()[CMD_STS]);
+    CHECK_EQUAL(-1, atoi(result_buffer.GetData() + CMD_RES_HEAD_SIZE));
+
+    delete command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DecodeTestGroup
+*
+* NAME : Execute_unpack_extractsTheFilesWithTheirModes
+*
+*-----------------------------------------------------------------------------*/
+TEST(DecodeTestGroup, Execute_unpack_extractsTheFilesWithTheirModes)
+{
+    MakeTgz(false);
+    ICommand *command = BuildUnpackCommand(tgz_size);
+    ResultBuffer result_buffer;
+
+    command->Execute(result_buffer);
+    char *result = result_buffer.GetData();
+
+    CHECK_EQUAL(CS1_SUCCESS, result[CMD_STS]);
+    CHECK_EQUAL(DECODE_TEST_SIZE + 10, atoi(result + CMD_RES_HEAD_SIZE));
+
+    CHECK(FileMatches(DECODE_TEST_UNPACK_DIR "/app/bin/app", bytes, DECODE_TEST_SIZE));
+    CHECK(FileMatches(DECODE_TEST_UNPACK_DIR "/app/etc/app.conf", (const unsigned char*)"period=10\n", 10));
+    CHECK_EQUAL(0, access(DECODE_TEST_UNPACK_DIR "/app/bin/app", X_OK));
+    CHECK(access(DECODE_TEST_UNPACK_DIR "/app/etc/app.conf", X_OK) != 0);
+    CHECK(access(DECODE_TEST_SRC, F_OK) != 0);
+
+    InfoBytesDecode *info = (InfoBytesDecode*)command->ParseResult(result);
+    CHECK_EQUAL(CS1_SUCCESS, info->decode_status);
+    CHECK(info->manifest.find("10 app/etc/app.conf\n") != string::npos);
+    CHECK(info->manifest.find(" app/bin/app\n") != string::npos);
+
+    delete command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DecodeTestGroup
+*
+* NAME : Execute_unpackCorruptTgz_failsAndKeepsTheSource
+*
+*-----------------------------------------------------------------------------*/
+TEST(DecodeTestGroup, Execute_unpackCorruptTgz_failsAndKeepsTheSource)
+{
+    MakeTgz(true);
+    ICommand *command = BuildUnpackCommand(tgz_size);
+    ResultBuffer result_buffer;
+
+    command->Execute(result_buffer);
+
+    CHECK_EQUAL(CS1_FAILURE, result_buffer.GetData()[CMD_STS]);
+    CHECK_EQUAL(-1, atoi(result_buffer.GetData() + CMD_RES_HEAD_SIZE));
+    CHECK_EQUAL(0, access(DECODE_TEST_SRC, F_OK));
+
+    delete command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DecodeTestGroup
+*
+* NAME : Execute_unpackNameOutOfTheDirectory_failsAndKeepsTheSource
+*
+*-----------------------------------------------------------------------------*/
+TEST(DecodeTestGroup, Execute_unpackNameOutOfTheDirectory_failsAndKeepsTheSource)
+{
+    MakeTgz(false, "app/../app/etc/app.conf");
+    ICommand *command = BuildUnpackCommand(tgz_size);
+    ResultBuffer result_buffer;
+
+    command->Execute(result_buffer);
+
+    CHECK_EQUAL(CS1_FAILURE, result_buffer.GetData()[CMD_STS]);
+    CHECK(access(DECODE_TEST_UNPACK_DIR "/app/etc/app.conf", F_OK) != 0);
+    CHECK_EQUAL(0, access(DECODE_TEST_SRC, F_OK));
+
+    delete command;
+}
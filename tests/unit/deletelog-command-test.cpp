@@ -2,6 +2,7 @@
 #include <sys/stat.h>
 #include <unistd.h>     // rmdir()
 #include <sys/types.h>
+#include <sys/time.h>   // utimes()
 
 #include "CppUTest/TestHarness.h"
 #include "CppUTest/MemoryLeakDetectorMallocMacros.h"
@@ -9,6 +10,10 @@
 #include "SpaceDecl.h"
 #include "common/command-factory.h"
 #include "common/icommand.h"
+#include "common/archive-index.h"
+#include "common/retention-manager.h"
+#include "common/bulkdeletelog-command.h"
+#include "common/subsystems.h"
 #include "fileIO.h"
 #include "SpaceString.h"
 
@@ -34,6 +39,10 @@ TEST_GROUP(DeleteLogTestGroup)
         DeleteDirectoryContent(CS1_LOGS);
         rmdir(CS1_LOGS);
 #endif
+
+        // the process wide index and marks must not outlive the test (memory leak detection)
+        ArchiveIndex::GetInstance(CS1_TGZ)->Clear();
+        RetentionManager::GetInstance(CS1_TGZ)->Clear();
     }
 };
 
@@ -50,7 +59,7 @@ TEST(DeleteLogTestGroup, DeleteLog_UsingInode_fileIsDeleted)
     char inode_str[5] = {'\0'};
     const char* filetest_path = CS1_TGZ"/filetest.tgz";
     FILE* filetest = fopen(filetest_path, "w+");
-    size_t result_size;
+    ResultBuffer result_buffer;
     fprintf(filetest, "some text to test");
     fclose(filetest);
 
@@ -70,7 +79,9 @@ TEST(DeleteLogTestGroup, DeleteLog_UsingInode_fileIsDeleted)
     #endif
 
     ICommand* command = CommandFactory::CreateCommand(command_buf);
-    char* result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t result_size = result_buffer.GetSize();
 
     CHECK(15 == result_size);    
 
@@ -82,10 +93,6 @@ TEST(DeleteLogTestGroup, DeleteLog_UsingInode_fileIsDeleted)
     strncpy(status, result + 1, 1);
     CHECK_EQUAL(0, atoi(status));
     CHECK(deletelog_info->delete_status == CS1_SUCCESS);
-    if (result) {
-        free(result);
-        result = 0;
-    }
     
     if (command != NULL){
         delete command;
@@ -104,14 +111,16 @@ TEST(DeleteLogTestGroup, Execute_FileIsDeleted)
 {
     const char* filetest_path = CS1_LOGS"/filetest.log";
     FILE* filetest = fopen(filetest_path, "w+");
-    size_t result_size;
+    ResultBuffer result_buffer;
     fprintf(filetest, "some text to test");
     fclose(filetest);
 
     char data[] = "7_filetest.log";
     
     ICommand* command = CommandFactory::CreateCommand(data);
-    char* result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t result_size = result_buffer.GetSize();
     
     CHECK(15==result_size);
 
@@ -121,11 +130,6 @@ TEST(DeleteLogTestGroup, Execute_FileIsDeleted)
     CHECK_EQUAL(-1, access(filetest_path, F_OK));
     CHECK_EQUAL(0, atoi(status));
 
-    if (result != NULL){
-        free(result);
-        result = NULL;
-    }
-
     if (command != NULL) {
         delete command;
         command = NULL;
@@ -186,22 +190,170 @@ TEST(DeleteLogTestGroup, FindType_ReturnsLOG)
 TEST(DeleteLogTestGroup, DeleteLog_NonExistent_File)
 {
     char data[] = "7_filetest.log";
-    size_t result_size;
+    ResultBuffer result_buffer;
     ICommand* command = CommandFactory::CreateCommand(data);
-    char* result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t result_size = result_buffer.GetSize();
 
     CHECK(15==result_size);    
 
     InfoBytesDeleteLog* deletelog_info = (InfoBytesDeleteLog*)((DeleteLogCommand*)command)->ParseResult(result);
 
     CHECK(deletelog_info->delete_status == CS1_FAILURE);
-    if (result) {
-        free(result);
-        result = 0;
-    }
     
     if (command != NULL){
         delete command;
         command = NULL;
     }
 }
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DeleteLogTestGroup 
+*
+* NAME : Create_filenameTooLong_refused
+* 
+*-----------------------------------------------------------------------------*/
+TEST(DeleteLogTestGroup, Create_filenameTooLong_refused)
+{
+    char data[CS1_PATH_MAX + 3];
+    CommandStorage storage;
+
+    data[0] = DELETELOG_CMD;
+    data[1] = '_';
+    memset(data + 2, 'a', CS1_PATH_MAX);
+    data[CS1_PATH_MAX + 2] = '\0';
+
+    CHECK(CommandFactory::CreateCommand(data, sizeof(data), &storage) == 0);
+
+    data[CS1_PATH_MAX + 1] = '\0';     // CS1_PATH_MAX - 1 bytes
+    ICommand* command = CommandFactory::CreateCommand(data, sizeof(data), &storage);
+
+    CHECK(command != 0);
+    CommandFactory::DestroyCommand(command);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DeleteLogTestGroup  
+*
+* NAME : ArchiveIndex_Lookup_followsDirectoryChanges
+* 
+*-----------------------------------------------------------------------------*/
+TEST(DeleteLogTestGroup, ArchiveIndex_Lookup_followsDirectoryChanges)
+{
+    const char* filetest_path = CS1_TGZ"/filetest.tgz";
+    const char* renamed_path = CS1_TGZ"/renamed.tgz";
+    char name[CS1_NAME_MAX] = {'\0'};
+    ArchiveIndex* index = ArchiveIndex::GetInstance(CS1_TGZ);
+
+    FILE* filetest = fopen(filetest_path, "w+");
+    fprintf(filetest, "some text to test");
+    fclose(filetest);
+
+    ino_t inode = GetLogCommand::GetInoT(filetest_path); 
+
+    CHECK(index->Lookup(inode, name, CS1_NAME_MAX));
+    STRCMP_EQUAL("filetest.tgz", name);
+
+    rename(filetest_path, renamed_path);
+
+    CHECK(index->Lookup(inode, name, CS1_NAME_MAX));
+    STRCMP_EQUAL("renamed.tgz", name);
+
+    remove(renamed_path);
+
+    CHECK_FALSE(index->Lookup(inode, name, CS1_NAME_MAX));
+    STRCMP_EQUAL("", name);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DeleteLogTestGroup 
+*
+* NAME : BulkDeleteLog_UsingInodeList_bitmapMatchesDeletedFiles
+* 
+*-----------------------------------------------------------------------------*/
+TEST(DeleteLogTestGroup, BulkDeleteLog_UsingInodeList_bitmapMatchesDeletedFiles)
+{
+    const char* paths[2] = { CS1_TGZ"/first.tgz", CS1_TGZ"/second.tgz" };
+    ino_t inodes[3] = {0};
+    char bulk_buf[BULKDELETE_LIST_CMD_SIZE(3)] = {'\0'};
+    ResultBuffer result_buffer;
+
+    for (int i = 0; i < 2; i++) {
+        FILE* filetest = fopen(paths[i], "w+");
+        fprintf(filetest, "some text to test");
+        fclose(filetest);
+        inodes[i] = GetLogCommand::GetInoT(paths[i]);
+    }
+
+    inodes[2] = inodes[0];     // already deleted by the time it is processed
+
+    BulkDeleteLogCommand bulk(inodes, 3);
+    bulk.GetCmdStr(bulk_buf);
+
+    ICommand* command = CommandFactory::CreateCommand(bulk_buf);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t result_size = result_buffer.GetSize();
+
+    CHECK_EQUAL(BULKDELETE_RTN_HEAD_SIZE + 1, result_size);
+    CHECK_EQUAL(-1, access(paths[0], F_OK));
+    CHECK_EQUAL(-1, access(paths[1], F_OK));
+
+    InfoBytesBulkDeleteLog* info = (InfoBytesBulkDeleteLog*)bulk.ParseResult(result);
+
+    CHECK_EQUAL(CS1_FAILURE, info->delete_status);
+    CHECK_EQUAL(3, info->count);
+    CHECK(info->IsDeleted(0));
+    CHECK(info->IsDeleted(1));
+    CHECK_FALSE(info->IsDeleted(2));
+
+    delete command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : DeleteLogTestGroup 
+*
+* NAME : BulkDeleteLog_UsingPredicate_onlyMatchingFilesAreDeleted
+* 
+*-----------------------------------------------------------------------------*/
+TEST(DeleteLogTestGroup, BulkDeleteLog_UsingPredicate_onlyMatchingFilesAreDeleted)
+{
+    const char* old_power = CS1_TGZ"/Power20140101.log.tgz";
+    const char* new_power = CS1_TGZ"/Power20150101.log.tgz";
+    const char* old_acs = CS1_TGZ"/ACS20140101.log.tgz";
+    const char* paths[3] = { old_power, new_power, old_acs };
+    char bulk_buf[BULKDELETE_PRED_CMD_SIZE] = {'\0'};
+    ResultBuffer result_buffer;
+    struct timeval times[2] = { {1000, 0}, {1000, 0} };
+
+    for (int i = 0; i < 3; i++) {
+        FILE* filetest = fopen(paths[i], "w+");
+        fprintf(filetest, "some text to test");
+        fclose(filetest);
+    }
+
+    utimes(old_power, times);
+    utimes(old_acs, times);
+
+    BulkDeleteLogCommand bulk(PRED_OLDER | PRED_SUB, POWER, 2000, 0);
+    bulk.GetCmdStr(bulk_buf);
+
+    ICommand* command = CommandFactory::CreateCommand(bulk_buf);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+
+    InfoBytesBulkDeleteLog* info = (InfoBytesBulkDeleteLog*)bulk.ParseResult(result);
+
+    CHECK_EQUAL(CS1_SUCCESS, info->delete_status);
+    CHECK_EQUAL(1, info->count);
+    CHECK_FALSE(info->more);
+    CHECK_EQUAL(-1, access(old_power, F_OK));
+    CHECK_EQUAL(0, access(new_power, F_OK));
+    CHECK_EQUAL(0, access(old_acs, F_OK));
+
+    delete command;
+}
@@ -0,0 +1,189 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : event-log-test.cpp
+ *
+ * DESCRIPTION : Tests the EventLog : the records written, read back with
+ *               Format as the ground does, and the rotation
+ *
+ *----------------------------------------------------------------------------*/
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/commands.h"
+#include "common/event-log.h"
+
+#define EVENT_TEST_DIR CS1_TMP"/events"
+#define EVENT_TEST_PATH EVENT_TEST_DIR"/commander.evt"
+
+TEST_GROUP(EventLogTestGroup)
+{
+    void setup()
+    {
+        mkdir(CS1_TMP, S_IRWXU);
+        mkdir(EVENT_TEST_DIR, S_IRWXU);
+        this->RemoveFiles();
+        EventLog::Open(EVENT_TEST_PATH);
+    }
+
+    void teardown()
+    {
+        EventLog::Close();
+        this->RemoveFiles();
+        rmdir(EVENT_TEST_DIR);
+    }
+
+    void RemoveFiles()
+    {
+        char path[CS1_PATH_MAX];
+        DIR* dir = opendir(EVENT_TEST_DIR);
+        struct dirent* entry = 0;
+
+        while (dir && (entry = readdir(dir)) != 0) {
+            if (entry->d_name[0] != '.') {
+                snprintf(path, sizeof(path), "%s/%s", EVENT_TEST_DIR, entry->d_name);
+                remove(path);
+            }
+        }
+
+        if (dir) {
+            closedir(dir);
+        }
+    }
+
+    std::string ReadFile(const char* path)
+    {
+        char buffer[1024];
+        size_t size = 0;
+        std::string data;
+        FILE* file = fopen(path, "rb");
+
+        while (file && (size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.append(buffer, size);
+        }
+
+        if (file) {
+            fclose(file);
+        }
+
+        return data;
+    }
+
+    /* The rendered line without its time */
+    std::string Event(const std::string& data, size_t* offset, bool csv)
+    {
+        char line[256] = {'\0'};
+        size_t size = EventLog::Format(data.data() + *offset, data.size() - *offset, line, sizeof(line), csv);
+
+        *offset += size;
+        return std::string(csv ? strchr(line, ',') : line + strlen("2015-06-01 12:00:00"));
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : EventLogTestGroup
+*
+* NAME : Command_written_decodedBack
+*
+*-----------------------------------------------------------------------------*/
+TEST(EventLogTestGroup, Command_written_decodedBack)
+{
+    CHECK(EventLog::Start());
+    CHECK(EventLog::Command(GETLOG_CMD, CS1_SUCCESS, 190, 1234));
+    CHECK(EventLog::Command(REBOOT_CMD, EVENT_STATUS_NO_RESULT, 0, 5));
+
+    std::string data = this->ReadFile(EVENT_TEST_PATH);
+    size_t offset = EVENT_LOG_FILE_HEADER_SIZE;
+
+    CHECK(data.compare(0, EVENT_LOG_MAGIC_SIZE, EVENT_LOG_MAGIC) == 0);
+    CHECK_EQUAL(EVENT_LOG_VERSION, data[EVENT_LOG_MAGIC_SIZE]);
+
+    // the start is the header alone, the commands 12 and 10 bytes
+    CHECK_EQUAL(EVENT_LOG_FILE_HEADER_SIZE + EVENT_LOG_HEADER_SIZE + 12 + 10, data.size());
+
+    CHECK(this->Event(data, &offset, false) == " START");
+    CHECK(this->Event(data, &offset, false) == " COMMAND 0x33 GetLog status 0, 190 bytes, 1234 us");
+    CHECK(this->Event(data, &offset, false) == " COMMAND 0x34 Reboot no result, 5 us");
+    CHECK_EQUAL(data.size(), offset);
+
+    offset = EVENT_LOG_FILE_HEADER_SIZE + EVENT_LOG_HEADER_SIZE;
+    CHECK(this->Event(data, &offset, true) == ",COMMAND,0x33,0,190,1234");
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : EventLogTestGroup
+*
+* NAME : Format_truncatedOrUnknown_skipped
+*
+*-----------------------------------------------------------------------------*/
+TEST(EventLogTestGroup, Format_truncatedOrUnknown_skipped)
+{
+    const char fields[3] = {1, 2, 3};
+    char line[256];
+
+    CHECK(EventLog::Write(42, fields, sizeof(fields)));
+    CHECK(EventLog::Command(UPDATE_CMD, CS1_FAILURE, 100000, 70000));
+
+    std::string data = this->ReadFile(EVENT_TEST_PATH);
+    size_t offset = EVENT_LOG_FILE_HEADER_SIZE;
+
+    CHECK(this->Event(data, &offset, false) == " event 42 (3 bytes)");
+
+    // the last record cut by a reboot
+    CHECK_EQUAL(0, EventLog::Format(data.data() + offset, data.size() - offset - 1, line, sizeof(line), false));
+    CHECK(this->Event(data, &offset, false) == " COMMAND 0x32 Update status 1, 100000 bytes, 70000 us");
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : EventLogTestGroup
+*
+* NAME : Write_maxSize_rotated
+*
+*-----------------------------------------------------------------------------*/
+TEST(EventLogTestGroup, Write_maxSize_rotated)
+{
+    size_t events = EVENT_LOG_MAX_SIZE / (EVENT_LOG_HEADER_SIZE + 4) + 10;     // 10 bytes each
+
+    for (size_t i = 0; i < events; i++) {
+        CHECK(EventLog::Command(GETTIME_CMD, CS1_SUCCESS, 9, 100));
+    }
+
+    size_t files = 0, total = 0;
+    DIR* dir = opendir(EVENT_TEST_DIR);
+    struct dirent* entry = 0;
+
+    while ((entry = readdir(dir)) != 0) {
+        char path[CS1_PATH_MAX];
+
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", EVENT_TEST_DIR, entry->d_name);
+        std::string data = this->ReadFile(path);
+
+        CHECK(strncmp(entry->d_name, "commander.evt", strlen("commander.evt")) == 0);
+        CHECK(data.size() <= EVENT_LOG_MAX_SIZE);
+        CHECK(data.compare(0, EVENT_LOG_MAGIC_SIZE, EVENT_LOG_MAGIC) == 0);
+
+        files++;
+        total += (data.size() - EVENT_LOG_FILE_HEADER_SIZE) / (EVENT_LOG_HEADER_SIZE + 4);
+    }
+
+    closedir(dir);
+
+    CHECK_EQUAL(2, files);
+    CHECK_EQUAL(events, total);
+}
@@ -21,6 +21,10 @@
 #include "SpaceString.h"
 #include "common/command-factory.h"
 #include "common/getlog-command.h"
+#include "common/batch-file-reader.h"
+#include "common/crc32.h"
+#include "common/archive-index.h"
+#include "common/retention-manager.h"
 #include "common/icommand.h"
 #include "fileIO.h"
 #include "common/commands.h"
@@ -44,6 +48,10 @@ TEST_GROUP(GetLogTestGroup)
     void teardown(){
         DeleteDirectoryContent(CS1_TGZ);
         rmdir(CS1_TGZ);
+
+        // the process wide index and marks must not outlive the test (memory leak detection)
+        ArchiveIndex::GetInstance(CS1_TGZ)->Clear();
+        RetentionManager::GetInstance(CS1_TGZ)->Clear();
     }
 };
 
@@ -63,12 +71,14 @@ void create_file(const char* path, const char* msg)
 TEST(GetLogTestGroup, Execute_OPT_NOOPT_NOFILES)
 {
     // This is the Command to create on the ground.
-    size_t result_size;
+    ResultBuffer result_buffer;
     GetLogCommand ground_cmd(OPT_NOOPT, 0, 0, 0);
     ground_cmd.GetCmdStr(command_buf);
 
     ICommand *command = CommandFactory::CreateCommand(command_buf);
-    char* result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t result_size = result_buffer.GetSize();
 
     CHECK(result_size == 4 );
     CHECK(result[1] == CS1_FAILURE);
@@ -80,11 +90,6 @@ TEST(GetLogTestGroup, Execute_OPT_NOOPT_NOFILES)
         delete command;
         command = NULL;
     }
-
-    if (result) {
-        free(result);
-        result = 0;
-    }
 }
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
@@ -119,7 +124,7 @@ TEST(GetLogTestGroup, GetInfoBytes_returnsCorrectInfoBytes)
 TEST(GetLogTestGroup, Execute_OPT_DATE_OPT_SUB_getTgz_returnsCorrectFile)
 {
     const char* path = CS1_TGZ"/Updater20140102.txt";  
-    size_t result_size;
+    ResultBuffer result_buffer;
 
     create_file(CS1_TGZ"/Watch-Puppy20140101.txt", "file a");
     usleep(1000000);
@@ -139,7 +144,9 @@ TEST(GetLogTestGroup, Execute_OPT_DATE_OPT_SUB_getTgz_returnsCorrectFile)
 
     // This is the Command that the space-commander will create
     GetLogCommand *command = (GetLogCommand*)CommandFactory::CreateCommand(command_buf);
-    result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    result = result_buffer.GetData();
+    size_t result_size = result_buffer.GetSize();
 
     CHECK(result_size == 16);
 
@@ -165,11 +172,6 @@ TEST(GetLogTestGroup, Execute_OPT_DATE_OPT_SUB_getTgz_returnsCorrectFile)
         delete command;
         command = NULL;
     }
-
-    if (result) {
-        free(result);
-        result = 0;
-    }
 }
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -183,7 +185,7 @@ TEST(GetLogTestGroup, Execute_OPT_NOOPT_get2TGZ_returns2OldestTgz)
 {
     const char* path = CS1_TGZ"/Watch-Puppy20140101.txt";  
     const char* path2 = CS1_TGZ"/Updater20140102.txt";  
-    size_t result_size;
+    ResultBuffer result_buffer;
     
     create_file(CS1_TGZ"/Watch-Puppy20140101.txt", "file a");
     usleep(1000000);
@@ -201,7 +203,8 @@ TEST(GetLogTestGroup, Execute_OPT_NOOPT_get2TGZ_returns2OldestTgz)
     ground_cmd.GetCmdStr(command_buf);
 
     ICommand *command = CommandFactory::CreateCommand(command_buf);
-    result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    result = result_buffer.GetData();
 
     FILE *pFile = fopen(dest, "wb");
 
@@ -228,11 +231,6 @@ TEST(GetLogTestGroup, Execute_OPT_NOOPT_get2TGZ_returns2OldestTgz)
         command = NULL;
     }
 
-    if (result) {
-        free(result);
-        result = 0;
-    }
-
 }
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -245,7 +243,7 @@ TEST(GetLogTestGroup, Execute_OPT_NOOPT_get2TGZ_returns2OldestTgz)
 TEST(GetLogTestGroup, Execute_OPT_NOOPT_returnsOldestTgz)
 {
     const char* path = CS1_TGZ"/Watch-Puppy20140101.txt";  
-    size_t result_size;
+    ResultBuffer result_buffer;
 
     create_file(CS1_TGZ"/Watch-Puppy20140101.txt", "file a");
     usleep(1000000);
@@ -262,7 +260,8 @@ TEST(GetLogTestGroup, Execute_OPT_NOOPT_returnsOldestTgz)
     ground_cmd.GetCmdStr(command_buf);
 
     ICommand *command = CommandFactory::CreateCommand(command_buf);
-    result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    result = result_buffer.GetData();
 
     FILE *pFile = fopen(dest, "wb");
 
@@ -278,11 +277,66 @@ TEST(GetLogTestGroup, Execute_OPT_NOOPT_returnsOldestTgz)
         delete command;
         command = NULL;
     }
+}
 
-    if (result) {
-        free(result);
-        result = 0;
-    }
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GetLogTestGroup
+*
+* NAME : Execute_OPT_ACK_deletesVerifiedTgzAndReturnsNextOne
+* 
+*-----------------------------------------------------------------------------*/
+TEST(GetLogTestGroup, Execute_OPT_ACK_deletesVerifiedTgzAndReturnsNextOne)
+{
+    const char* path = CS1_TGZ"/Watch-Puppy20140101.txt";  
+    const char* path2 = CS1_TGZ"/Updater20140102.txt";  
+    char ack_buf[GETLOG_CMD_SIZE_WITH_ACKS(2)] = {'\0'};
+    ResultBuffer result_buffer;
+
+    create_file(path, "file a");
+    usleep(1000000);
+    create_file(path2, "file b");
+
+    // 1. First pass, no acknowledgement
+    GetLogCommand ground_cmd(OPT_NOOPT, 0, 0, 0);
+    ground_cmd.GetCmdStr(command_buf);
+
+    ICommand *command = CommandFactory::CreateCommand(command_buf);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+
+    GetLogInfoBytes* info = (GetLogInfoBytes*)ground_cmd.ParseResult(result);
+    CHECK_EQUAL(CS1_SUCCESS, info->getlog_status);
+    CHECK_EQUAL(GetLogCommand::GetInoT(path), info->inode);
+
+    ino_t inode = info->inode;
+    unsigned int crc = Crc32(info->getlog_message, info->message_bytes_size);
+
+    result_buffer.Clear();
+    delete command;
+
+    // 2. Second pass, acknowledges the first file (and a file with a bad CRC)
+    GetLogCommand ground_cmd2(OPT_NOOPT, 0, 0, 0);
+    CHECK(ground_cmd2.AddAck(inode, crc));
+    CHECK(ground_cmd2.AddAck(GetLogCommand::GetInoT(path2), crc));
+    ground_cmd2.GetCmdStr(ack_buf);
+    CHECK_EQUAL(GETLOG_CMD_SIZE_WITH_ACKS(2), ground_cmd2.GetCmdSize());
+
+    command = CommandFactory::CreateCommand(ack_buf);
+    command->Execute(result_buffer);
+    result = result_buffer.GetData();
+
+    info = (GetLogInfoBytes*)ground_cmd2.ParseResult(result);
+    CHECK_EQUAL(2, info->number_of_acks);
+    CHECK(info->IsAckApplied(0));
+    CHECK_FALSE(info->IsAckApplied(1));
+    CHECK_EQUAL(-1, access(path, F_OK));
+    CHECK_EQUAL(0, access(path2, F_OK));
+
+    CHECK_EQUAL(CS1_SUCCESS, info->getlog_status);
+    CHECK_EQUAL(GetLogCommand::GetInoT(path2), info->inode);
+
+    delete command;
 }
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -311,6 +365,52 @@ TEST(GetLogTestGroup, ReadFile_FromStartToEnd_success)
    CHECK(diff(dest, path));     
 }
 
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GetLogTestGroup
+*
+* NAME : BatchFileReader_ReadAll_readsEveryFile 
+* 
+*-----------------------------------------------------------------------------*/
+TEST(GetLogTestGroup, BatchFileReader_ReadAll_readsEveryFile)
+{
+    const char* paths[3] = { CS1_TGZ"/Updater20140101.txt", 
+                             CS1_TGZ"/DoesNotExist.txt",
+                             CS1_TGZ"/Updater20140102.txt" };
+    char buffers[3][CS1_MAX_FRAME_SIZE] = {{0}};
+    BatchFileEntry entries[3];
+    BatchFileReader reader;
+
+    create_file(paths[0], data_6_bytes);
+    create_file(paths[2], "data");
+
+    for (int i = 0; i < 3; i++) {
+        entries[i].path = paths[i];
+        entries[i].buffer = buffers[i];
+        entries[i].capacity = CS1_MAX_FRAME_SIZE;
+    }
+
+    CHECK_EQUAL(2, reader.ReadAll(entries, 3));
+
+    CHECK_EQUAL(UTEST_SIZE_OF_TEST_FILES, entries[0].bytes);
+    CHECK_EQUAL(0, memcmp(data_6_bytes, buffers[0], UTEST_SIZE_OF_TEST_FILES));
+    CHECK_EQUAL(GetLogCommand::GetInoT(paths[0]), entries[0].inode);
+
+    CHECK(entries[1].error != 0);
+    CHECK_EQUAL(0, entries[1].bytes);
+
+    CHECK_EQUAL(4, entries[2].bytes);
+    CHECK_EQUAL(GetLogCommand::GetInoT(paths[2]), entries[2].inode);
+    CHECK_EQUAL(GetLogCommand::GetFileLastModifTimeT(paths[2]), entries[2].mtime);
+
+    // nothing of the first batch is left in the ring
+    CHECK_EQUAL(1, reader.ReadAll(entries + 1, 2));
+    CHECK(entries[1].error != 0);
+    CHECK_EQUAL(0, entries[1].inode);
+    CHECK_EQUAL(4, entries[2].bytes);
+    CHECK_EQUAL(GetLogCommand::GetInoT(paths[2]), entries[2].inode);
+}
+
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 *
 * GROUP : GetLogTestGroup
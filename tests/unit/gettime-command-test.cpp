@@ -52,12 +52,14 @@ TEST_GROUP(GetTimeTestGroup)
 TEST(GetTimeTestGroup, Check_Gettime)
 {   
     ICommand* command = CommandFactory::CreateCommand(command_buf);
-    size_t size;
-    char* result = (char*)command->Execute(&size);
+    ResultBuffer result_buffer;
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t size = result_buffer.GetSize();
     InfoBytesGetTime* gettime_info = (InfoBytesGetTime*)command->ParseResult(result);
 
     CHECK(gettime_info->time_status == CS1_SUCCESS);
-    CHECK(size == (sizeof(time_t) + CMD_RES_HEAD_SIZE));
+    CHECK(size == (GETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE));
     time_t newtime;
     time(&newtime);
     CHECK(newtime-gettime_info->time_set < 1);        
@@ -72,9 +74,4 @@ TEST(GetTimeTestGroup, Check_Gettime)
         delete command;
         command = NULL;
     }
-
-    if (result) {
-        free(result);
-        result = 0;
-     }
 }
@@ -0,0 +1,268 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : gunzip-test.cpp
+ *
+ * DESCRIPTION : Tests Gunzip_Run on malformed input : truncated streams, a
+ *               corrupt header, block or trailer, and failing read / write.
+ *               The streams are built here with stored (uncompressed) blocks,
+ *               the compressed ones are covered by the DecodeTestGroup.
+ *
+ *----------------------------------------------------------------------------*/
+#include <string.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "common/crc32.h"
+#include "common/gunzip.h"
+
+#define GUNZIP_TEST_SIZE 1000
+#define GUNZIP_TEST_PIECE 7             // bytes handed by each read, the fields cross the pieces
+
+struct GunzipTestInput
+{
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+    bool read_fails;
+    bool write_fails;
+    std::string output;
+};
+
+static ssize_t ReadPiece(void *context, const unsigned char **data)
+{
+    GunzipTestInput *input = (GunzipTestInput*)context;
+
+    if (input->read_fails) {
+        return -1;
+    }
+
+    size_t piece = input->size - input->position;
+    piece = (piece < GUNZIP_TEST_PIECE) ? piece : GUNZIP_TEST_PIECE;
+
+    *data = input->data + input->position;
+    input->position += piece;
+
+    return piece;
+}
+
+static bool WriteOutput(void *context, const unsigned char *data, size_t size)
+{
+    GunzipTestInput *input = (GunzipTestInput*)context;
+
+    if (input->write_fails) {
+        return false;
+    }
+
+    input->output.append((const char*)data, size);
+    return true;
+}
+
+TEST_GROUP(GunzipTestGroup)
+{
+    unsigned char plain[GUNZIP_TEST_SIZE];
+    unsigned char stream[GUNZIP_TEST_SIZE + 64];
+    size_t stream_size;
+    Gunzip *state;
+
+    void setup()
+    {
+        for (size_t i = 0; i < GUNZIP_TEST_SIZE; i++) {
+            plain[i] = (unsigned char)(i * 7 + 3);
+        }
+
+        stream_size = MakeStoredMember(stream, plain, GUNZIP_TEST_SIZE);
+        state = new Gunzip;
+    }
+
+    void teardown()
+    {
+        delete state;
+    }
+
+    /*
+     * [gzip header][one stored block, last][CRC-32][ISIZE]
+     */
+    size_t MakeStoredMember(unsigned char *out, const unsigned char *data, size_t size)
+    {
+        static const unsigned char header[10] = { 0x1f, 0x8b, 0x08, 0, 0, 0, 0, 0, 0, 0x03 };
+        unsigned int crc = Crc32(data, size);
+        size_t i = 0;
+
+        memcpy(out, header, sizeof(header));
+        i += sizeof(header);
+
+        out[i++] = 0x01;                        // BFINAL, BTYPE 00
+        out[i++] = size & 0xff;
+        out[i++] = (size >> 8) & 0xff;
+        out[i++] = ~size & 0xff;
+        out[i++] = (~size >> 8) & 0xff;
+
+        memcpy(out + i, data, size);
+        i += size;
+
+        for (int byte = 0; byte < 4; byte++) {
+            out[i++] = (crc >> (8 * byte)) & 0xff;
+        }
+        for (int byte = 0; byte < 4; byte++) {
+            out[i++] = (size >> (8 * byte)) & 0xff;
+        }
+
+        return i;
+    }
+
+    int Run(size_t size, GunzipTestInput *input)
+    {
+        input->data = stream;
+        input->size = size;
+        input->position = 0;
+
+        return Gunzip_Run(state, ReadPiece, WriteOutput, input);
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GunzipTestGroup
+*
+* NAME : Run_storedMember_decompressed
+*
+*-----------------------------------------------------------------------------*/
+TEST(GunzipTestGroup, Run_storedMember_decompressed)
+{
+    GunzipTestInput input;
+    input.read_fails = false;
+    input.write_fails = false;
+
+    CHECK_EQUAL(GUNZIP_OK, Run(stream_size, &input));
+    CHECK_EQUAL(GUNZIP_TEST_SIZE, input.output.size());
+    CHECK_EQUAL(0, memcmp(plain, input.output.data(), GUNZIP_TEST_SIZE));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GunzipTestGroup
+*
+* NAME : Run_truncatedAnywhere_badData
+*
+*-----------------------------------------------------------------------------*/
+TEST(GunzipTestGroup, Run_truncatedAnywhere_badData)
+{
+    // in the header, the block header, the data and the trailer
+    for (size_t size = 0; size < stream_size; size++) {
+        GunzipTestInput input;
+        input.read_fails = false;
+        input.write_fails = false;
+
+        CHECK_EQUAL(GUNZIP_BAD_DATA, Run(size, &input));
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GunzipTestGroup
+*
+* NAME : Run_notGzip_badData
+*
+*-----------------------------------------------------------------------------*/
+TEST(GunzipTestGroup, Run_notGzip_badData)
+{
+    GunzipTestInput input;
+    input.read_fails = false;
+    input.write_fails = false;
+
+    stream[1] = 0x8c;                           // ID2
+    CHECK_EQUAL(GUNZIP_BAD_DATA, Run(stream_size, &input));
+
+    stream[1] = 0x8b;
+    stream[2] = 0x07;                           // CM, not deflate
+    CHECK_EQUAL(GUNZIP_BAD_DATA, Run(stream_size, &input));
+    CHECK_EQUAL(0, input.output.size());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GunzipTestGroup
+*
+* NAME : Run_corruptBlock_badData
+*
+*-----------------------------------------------------------------------------*/
+TEST(GunzipTestGroup, Run_corruptBlock_badData)
+{
+    GunzipTestInput input;
+    input.read_fails = false;
+    input.write_fails = false;
+
+    stream[10] = 0x07;                          // BFINAL, BTYPE 11 (reserved)
+    CHECK_EQUAL(GUNZIP_BAD_DATA, Run(stream_size, &input));
+
+    stream[10] = 0x01;
+    stream[13] ^= 0x01;                         // NLEN is not the complement of LEN
+    CHECK_EQUAL(GUNZIP_BAD_DATA, Run(stream_size, &input));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GunzipTestGroup
+*
+* NAME : Run_corruptTrailer_badData
+*
+*-----------------------------------------------------------------------------*/
+TEST(GunzipTestGroup, Run_corruptTrailer_badData)
+{
+    GunzipTestInput input;
+    input.read_fails = false;
+    input.write_fails = false;
+
+    stream[stream_size - 8] ^= 0x01;            // CRC-32
+    CHECK_EQUAL(GUNZIP_BAD_DATA, Run(stream_size, &input));
+
+    stream[stream_size - 8] ^= 0x01;
+    stream[stream_size - 4] ^= 0x01;            // ISIZE
+    CHECK_EQUAL(GUNZIP_BAD_DATA, Run(stream_size, &input));
+
+    stream[stream_size - 4] ^= 0x01;
+    stream[20] ^= 0x01;                         // the data, caught by the CRC-32
+    CHECK_EQUAL(GUNZIP_BAD_DATA, Run(stream_size, &input));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GunzipTestGroup
+*
+* NAME : Run_garbageAfterTheMember_badData
+*
+*-----------------------------------------------------------------------------*/
+TEST(GunzipTestGroup, Run_garbageAfterTheMember_badData)
+{
+    GunzipTestInput input;
+    input.read_fails = false;
+    input.write_fails = false;
+
+    stream[stream_size] = 0x00;                 // read as the start of a second member
+    CHECK_EQUAL(GUNZIP_BAD_DATA, Run(stream_size + 1, &input));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : GunzipTestGroup
+*
+* NAME : Run_readOrWriteFails_ioError
+*
+*-----------------------------------------------------------------------------*/
+TEST(GunzipTestGroup, Run_readOrWriteFails_ioError)
+{
+    GunzipTestInput input;
+    input.read_fails = true;
+    input.write_fails = false;
+
+    CHECK_EQUAL(GUNZIP_IO_ERROR, Run(stream_size, &input));
+
+    input.read_fails = false;
+    input.write_fails = true;
+
+    CHECK_EQUAL(GUNZIP_IO_ERROR, Run(stream_size, &input));
+}
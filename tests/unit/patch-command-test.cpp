@@ -0,0 +1,207 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : patch-command-test.cpp
+ *
+ * DESCRIPTION : Tests the delta patches (DeltaPatch_Create/Apply) and the
+ *               PatchCommand
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/command-factory.h"
+#include "common/crc32.h"
+#include "common/icommand.h"
+#include "common/patch-command.h"
+
+#define PATCH_TEST_TARGET CS1_TGZ"/patch-test.bin"
+#define PATCH_TEST_PATCH CS1_TGZ"/patch-test.patch"
+#define PATCH_TEST_SIZE (64 * 1024)
+
+static char command_buf[CS1_PATH_MAX] = {'\0'};
+
+TEST_GROUP(PatchTestGroup)
+{
+    std::string old_data;
+    std::string new_data;
+
+    void setup()
+    {
+        mkdir(CS1_TGZ, S_IRWXU);
+
+        srand(40);
+        for (size_t i = 0; i < PATCH_TEST_SIZE; i++) {
+            old_data += (char)rand();
+        }
+
+        // a few bytes changed, then a block inserted : the rest is shifted
+        new_data = old_data;
+        for (size_t i = 100; i < PATCH_TEST_SIZE; i += 4096) {
+            new_data[i] ^= 0x5A;
+        }
+        new_data.insert(PATCH_TEST_SIZE / 2, "space concordia, version 2");
+    }
+
+    void teardown()
+    {
+        remove(PATCH_TEST_TARGET);
+        remove(PATCH_TEST_TARGET PATCH_NEW_EXT);
+        remove(PATCH_TEST_PATCH);
+    }
+
+    void WriteFile(const char* path, const std::string& data)
+    {
+        FILE* file = fopen(path, "w");
+        fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+    }
+
+    std::string ReadFile(const char* path)
+    {
+        std::string data;
+        char buffer[4096];
+        size_t size = 0;
+        FILE* file = fopen(path, "r");
+
+        if (file) {
+            while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+                data.append(buffer, size);
+            }
+
+            fclose(file);
+        }
+
+        return data;
+    }
+
+    void MakePatch(const std::string& from, const std::string& to, std::string* patch)
+    {
+        CHECK(DeltaPatch_Create((const unsigned char*)from.data(), from.size(),
+                                (const unsigned char*)to.data(), to.size(), patch));
+    }
+
+    InfoBytesPatch* Send()
+    {
+        size_t size = PatchCommand::Build_PatchCommand(command_buf, WireView(PATCH_TEST_TARGET), WireView(PATCH_TEST_PATCH));
+        ICommand* command = CommandFactory::CreateCommand(command_buf, size);
+        ResultBuffer result;
+
+        command->Execute(result);
+        InfoBytesPatch* info = (InfoBytesPatch*)command->ParseResult(result.GetData());
+
+        delete command;
+        return info;
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : PatchTestGroup
+*
+* NAME : Patch_smallChange_patchIsSmallAndTargetReplaced
+*
+*-----------------------------------------------------------------------------*/
+TEST(PatchTestGroup, Patch_smallChange_patchIsSmallAndTargetReplaced)
+{
+    std::string patch;
+    MakePatch(old_data, new_data, &patch);
+    CHECK(patch.size() < new_data.size() / 10);
+
+    WriteFile(PATCH_TEST_TARGET, old_data);
+    WriteFile(PATCH_TEST_PATCH, patch);
+    chmod(PATCH_TEST_TARGET, S_IRWXU);
+
+    InfoBytesPatch* info = Send();
+    CHECK_EQUAL(CS1_SUCCESS, info->patch_status);
+    CHECK_EQUAL(DELTA_OK, info->error);
+    CHECK_EQUAL(Crc32(new_data.data(), new_data.size()), info->crc);
+
+    CHECK(ReadFile(PATCH_TEST_TARGET) == new_data);
+    CHECK(access(PATCH_TEST_TARGET PATCH_NEW_EXT, F_OK) != 0);
+    CHECK(access(PATCH_TEST_PATCH, F_OK) != 0);
+    CHECK(access(PATCH_TEST_TARGET, X_OK) == 0);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : PatchTestGroup
+*
+* NAME : Patch_unrelatedFiles_resultIsStillExact
+*
+*-----------------------------------------------------------------------------*/
+TEST(PatchTestGroup, Patch_unrelatedFiles_resultIsStillExact)
+{
+    std::string other(old_data.rbegin(), old_data.rend());
+    std::string patch;
+
+    MakePatch(other, new_data.substr(0, 1000), &patch);
+    WriteFile(PATCH_TEST_TARGET, other);
+    WriteFile(PATCH_TEST_PATCH, patch);
+
+    CHECK_EQUAL(DELTA_OK, Send()->error);
+    CHECK(ReadFile(PATCH_TEST_TARGET) == new_data.substr(0, 1000));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : PatchTestGroup
+*
+* NAME : Patch_wrongTarget_targetUntouched
+*
+*-----------------------------------------------------------------------------*/
+TEST(PatchTestGroup, Patch_wrongTarget_targetUntouched)
+{
+    std::string other = old_data;
+    std::string patch;
+    other[10] ^= 1;
+
+    MakePatch(old_data, new_data, &patch);
+    WriteFile(PATCH_TEST_TARGET, other);
+    WriteFile(PATCH_TEST_PATCH, patch);
+
+    InfoBytesPatch* info = Send();
+    CHECK_EQUAL(CS1_FAILURE, info->patch_status);
+    CHECK_EQUAL(DELTA_OLD_MISMATCH, info->error);
+
+    CHECK(ReadFile(PATCH_TEST_TARGET) == other);
+    CHECK(access(PATCH_TEST_TARGET PATCH_NEW_EXT, F_OK) != 0);
+    CHECK(access(PATCH_TEST_PATCH, F_OK) == 0);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : PatchTestGroup
+*
+* NAME : Patch_corruptOrTruncatedPatch_targetUntouched
+*
+*-----------------------------------------------------------------------------*/
+TEST(PatchTestGroup, Patch_corruptOrTruncatedPatch_targetUntouched)
+{
+    std::string patch;
+    MakePatch(old_data, new_data, &patch);
+    WriteFile(PATCH_TEST_TARGET, old_data);
+
+    std::string corrupt = patch;
+    corrupt[corrupt.size() - 1] ^= 0xFF;
+    WriteFile(PATCH_TEST_PATCH, corrupt);
+    CHECK_EQUAL(CS1_FAILURE, Send()->patch_status);
+
+    WriteFile(PATCH_TEST_PATCH, patch.substr(0, patch.size() / 2));
+    CHECK_EQUAL(CS1_FAILURE, Send()->patch_status);
+
+    WriteFile(PATCH_TEST_PATCH, patch.substr(0, DELTA_PATCH_HEAD_SIZE - 1));
+    CHECK_EQUAL(DELTA_BAD_PATCH, Send()->error);
+
+    CHECK(ReadFile(PATCH_TEST_TARGET) == old_data);
+    CHECK(access(PATCH_TEST_TARGET PATCH_NEW_EXT, F_OK) != 0);
+}
@@ -0,0 +1,266 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : result-buffer-test.cpp
+ *
+ * DESCRIPTION : Tests the ResultBuffer, its segments and WriteTo
+ *
+ *----------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/result-buffer.h"
+#include "common/session-arena.h"
+
+#define RESULT_TEST_FILE CS1_TGZ"/result-buffer-test.txt"
+
+static const char *file_content = "0123456789abcdef";
+
+TEST_GROUP(ResultBufferTestGroup)
+{
+    int fd;
+
+    void setup()
+    {
+        mkdir(CS1_TGZ, S_IRWXU);
+
+        FILE *file = fopen(RESULT_TEST_FILE, "w");
+        fputs(file_content, file);
+        fclose(file);
+
+        fd = open(RESULT_TEST_FILE, O_RDONLY);
+    }
+
+    void teardown()
+    {
+        close(fd);
+        remove(RESULT_TEST_FILE);
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : ResultBufferTestGroup
+*
+* NAME : Alloc_Truncate_GetData_flattensTheSegments
+*
+*-----------------------------------------------------------------------------*/
+TEST(ResultBufferTestGroup, Alloc_Truncate_GetData_flattensTheSegments)
+{
+    ResultBuffer result;
+    static const char tail[] = "tail";
+
+    CHECK(result.IsEmpty());
+    POINTERS_EQUAL(0, result.GetData());
+
+    char *head = result.Alloc(10);
+    memcpy(head, "head", 4);
+    result.Truncate(4);
+
+    CHECK_EQUAL(4, result.GetSize());
+    POINTERS_EQUAL(head, result.GetData());     // one segment, not copied
+
+    CHECK(result.Append(tail, 4, false));
+
+    CHECK_EQUAL(2, result.GetNumberOfSegments());
+    CHECK_EQUAL(8, result.GetSize());
+    CHECK_EQUAL(0, memcmp("headtail", result.GetData(), 8));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : ResultBufferTestGroup
+*
+* NAME : Append_whenFull_returnsFalse
+*
+*-----------------------------------------------------------------------------*/
+TEST(ResultBufferTestGroup, Append_whenFull_returnsFalse)
+{
+    ResultBuffer result;
+
+    for (int i = 0; i < RESULT_MAX_SEGMENTS; i++) {
+        CHECK(result.Append(file_content + i, 1, false));
+    }
+
+    CHECK(!result.Append(file_content, 1, false));
+    CHECK(!result.AppendFile(fd, 0, 1, false));
+    POINTERS_EQUAL(0, result.Alloc(1));
+    CHECK_EQUAL(0, memcmp(file_content, result.GetData(), RESULT_MAX_SEGMENTS));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : ResultBufferTestGroup
+*
+* NAME : Prepend_fileSegment_headerFirst
+*
+*-----------------------------------------------------------------------------*/
+TEST(ResultBufferTestGroup, Prepend_fileSegment_headerFirst)
+{
+    ResultBuffer result;
+
+    CHECK(result.Append("ab", 2, false));
+    CHECK(result.AppendFile(fd, 10, 6, false));
+    CHECK(result.Prepend("head", 4, false));
+
+    CHECK_EQUAL(3, result.GetNumberOfSegments());
+    CHECK_EQUAL(12, result.GetSize());
+    CHECK(memcmp(result.GetData(), "headababcdef", 12) == 0);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : ResultBufferTestGroup
+*
+* NAME : AppendResult_tooManySegments_flattened
+*
+*-----------------------------------------------------------------------------*/
+TEST(ResultBufferTestGroup, AppendResult_tooManySegments_flattened)
+{
+    ResultBuffer result;
+    ResultBuffer other;
+
+    CHECK(other.Append("ab", 2, false));
+    CHECK(other.AppendFile(fd, 10, 6, false));
+    CHECK(result.AppendResult(other));
+
+    CHECK(other.IsEmpty());
+    CHECK_EQUAL(2, result.GetNumberOfSegments());
+
+    for (int i = 0; i < RESULT_MAX_SEGMENTS - 3; i++) {
+        CHECK(result.Append("-", 1, false));
+    }
+
+    memcpy(other.Alloc(2), "xy", 2);
+    CHECK(other.AppendFile(fd, 10, 2, false));
+    CHECK(result.AppendResult(other));
+
+    CHECK(other.IsEmpty());
+    CHECK_EQUAL(RESULT_MAX_SEGMENTS, result.GetNumberOfSegments());
+    CHECK_EQUAL(8 + RESULT_MAX_SEGMENTS - 3 + 4, result.GetSize());
+    CHECK(memcmp(result.GetData(), "ababcdef-----xyab", result.GetSize()) == 0);
+
+    CHECK(other.Append("z", 1, false));
+    CHECK(!result.AppendResult(other));
+    CHECK_EQUAL(1, other.GetSize());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : ResultBufferTestGroup
+*
+* NAME : WriteTo_pipe_sendsMemoryAndFileSegmentsInOrder
+*
+*-----------------------------------------------------------------------------*/
+TEST(ResultBufferTestGroup, WriteTo_pipe_sendsMemoryAndFileSegmentsInOrder)
+{
+    ResultBuffer result;
+    int pipe_fds[2];
+    char read_back[32] = {'\0'};
+
+    CHECK_EQUAL(0, pipe(pipe_fds));
+
+    result.Append("head:", 5, false);
+    result.AppendFile(fd, 10, 6, false);        // abcdef
+    result.Append(":tail", 5, false);
+
+    CHECK_EQUAL(16, result.WriteTo(pipe_fds[1]));
+    CHECK_EQUAL(16, read(pipe_fds[0], read_back, sizeof(read_back)));
+    STRCMP_EQUAL("head:abcdef:tail", read_back);
+
+    CHECK_EQUAL(0, memcmp("head:abcdef:tail", result.GetData(), result.GetSize()));
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : ResultBufferTestGroup
+*
+* NAME : WriteTo_file_copiesTheFileSegment
+*
+* PURPOSE : splice needs a pipe on one side, the segment is copied
+*
+*-----------------------------------------------------------------------------*/
+TEST(ResultBufferTestGroup, WriteTo_file_copiesTheFileSegment)
+{
+    ResultBuffer result;
+    char read_back[32] = {'\0'};
+    int out = open(RESULT_TEST_FILE".out", O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    result.AppendFile(fd, 0, 10, false);
+
+    CHECK_EQUAL(10, result.WriteTo(out));
+    CHECK_EQUAL(10, pread(out, read_back, sizeof(read_back), 0));
+    STRCMP_EQUAL("0123456789", read_back);
+
+    close(out);
+    remove(RESULT_TEST_FILE".out");
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : ResultBufferTestGroup
+*
+* NAME : Swap_transfersOwnership
+*
+* PURPOSE : the owned segments are released once, by the last owner (the leak
+*           detector fails the test otherwise)
+*
+*-----------------------------------------------------------------------------*/
+TEST(ResultBufferTestGroup, Swap_transfersOwnership)
+{
+    ResultBuffer outer;
+
+    {
+        ResultBuffer inner;
+        memcpy(inner.Alloc(3), "abc", 3);
+        CHECK(inner.AppendFile(dup(fd), 0, 3, true));      // closed by the result
+
+        outer.Swap(inner);
+
+        CHECK(inner.IsEmpty());
+    }
+
+    CHECK_EQUAL(6, outer.GetSize());
+    CHECK_EQUAL(0, memcmp("abc012", outer.GetData(), 6));
+
+    outer.Clear();
+
+    CHECK(outer.IsEmpty());
+    CHECK_EQUAL(0, outer.GetSize());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : ResultBufferTestGroup
+*
+* NAME : Alloc_withCurrentArena_allocatesInTheArena
+*
+*-----------------------------------------------------------------------------*/
+TEST(ResultBufferTestGroup, Alloc_withCurrentArena_allocatesInTheArena)
+{
+    SessionArena arena;
+    SessionArena::SetCurrent(&arena);
+
+    {
+        ResultBuffer result;
+        char *data = result.Alloc(16);
+
+        CHECK(arena.Owns(data));
+
+        result.Append(file_content, 4, false);
+        CHECK(arena.Owns(result.GetData()));       // flattened in the arena too
+    }
+
+    SessionArena::SetCurrent(0);
+}
@@ -0,0 +1,210 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : retention-manager-test.cpp
+ *
+ * DESCRIPTION : Tests the RetentionManager class
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>   // utimes()
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/archive-index.h"
+#include "common/getlog-command.h"
+#include "common/retention-manager.h"
+#include "common/subsystems.h"
+#include "fileIO.h"
+
+#define UTEST_FILE_SIZE 100
+
+static void create_file(const char* path, time_t mtime)
+{
+    char data[UTEST_FILE_SIZE];
+    struct timeval times[2] = { {mtime, 0}, {mtime, 0} };
+
+    memset(data, 'x', UTEST_FILE_SIZE);
+
+    FILE* file = fopen(path, "w+");
+    fwrite(data, 1, UTEST_FILE_SIZE, file);
+    fclose(file);
+
+    utimes(path, times);
+}
+
+TEST_GROUP(RetentionTestGroup)
+{
+    RetentionManager* retention;
+    size_t default_budget;
+
+    void setup()
+    {
+        mkdir(CS1_TGZ, S_IRWXU);
+        retention = RetentionManager::GetInstance(CS1_TGZ);
+        default_budget = retention->GetBudget();
+    }
+
+    void teardown()
+    {
+        DeleteDirectoryContent(CS1_TGZ);
+        rmdir(CS1_TGZ);
+
+        retention->SetBudget(default_budget);
+        for (int i = 0; i < RETENTION_NUMBER_OF_SUBSYSTEMS; i++) {
+            retention->SetFloor(i, 0);
+        }
+
+        ArchiveIndex::GetInstance(CS1_TGZ)->Clear();
+        retention->Clear();
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : RetentionTestGroup
+*
+* NAME : GetUsage_followsDirectoryChanges
+*
+*-----------------------------------------------------------------------------*/
+TEST(RetentionTestGroup, GetUsage_followsDirectoryChanges)
+{
+    create_file(CS1_TGZ"/Power20140101.log.tgz", 1000);
+    CHECK_EQUAL(UTEST_FILE_SIZE, retention->GetUsage());
+
+    create_file(CS1_TGZ"/Power20140102.log.tgz", 2000);
+    CHECK_EQUAL(2 * UTEST_FILE_SIZE, retention->GetUsage());
+
+    remove(CS1_TGZ"/Power20140101.log.tgz");
+    CHECK_EQUAL(UTEST_FILE_SIZE, retention->GetUsage());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : RetentionTestGroup
+*
+* NAME : GetUsage_fileStillOpen_followsItsWrites
+*
+*-----------------------------------------------------------------------------*/
+TEST(RetentionTestGroup, GetUsage_fileStillOpen_followsItsWrites)
+{
+    char data[UTEST_FILE_SIZE];
+    FILE* file = fopen(CS1_TGZ"/Power20140101.log", "w");
+
+    memset(data, 'x', UTEST_FILE_SIZE);
+    CHECK_EQUAL(0, retention->GetUsage());
+
+    fwrite(data, 1, UTEST_FILE_SIZE, file);
+    fflush(file);
+    CHECK_EQUAL(UTEST_FILE_SIZE, retention->GetUsage());
+
+    fwrite(data, 1, UTEST_FILE_SIZE, file);
+    fflush(file);
+    CHECK_EQUAL(2 * UTEST_FILE_SIZE, retention->GetUsage());
+
+    fclose(file);
+    CHECK_EQUAL(2 * UTEST_FILE_SIZE, retention->GetUsage());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : RetentionTestGroup
+*
+* NAME : MarkDelivered_fileUnlinked_forgotten
+*
+*-----------------------------------------------------------------------------*/
+TEST(RetentionTestGroup, MarkDelivered_fileUnlinked_forgotten)
+{
+    const char* path = CS1_TGZ"/Power20140101.log.tgz";
+
+    create_file(path, 1000);
+    CHECK_EQUAL(UTEST_FILE_SIZE, retention->GetUsage());
+
+    ino_t inode = GetLogCommand::GetInoT(path);
+    retention->MarkDelivered(inode);
+
+    create_file(path, 2000);    // written again, still the same file
+    CHECK_EQUAL(UTEST_FILE_SIZE, retention->GetUsage());
+    CHECK(retention->IsDelivered(inode));
+
+    remove(path);
+    CHECK_EQUAL(0, retention->GetUsage());
+    CHECK_FALSE(retention->IsDelivered(inode));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : RetentionTestGroup
+*
+* NAME : RunOnce_evictsDeliveredThenOldest
+*
+*-----------------------------------------------------------------------------*/
+TEST(RetentionTestGroup, RunOnce_evictsDeliveredThenOldest)
+{
+    const char* oldest = CS1_TGZ"/Power20140101.log.tgz";
+    const char* delivered = CS1_TGZ"/Power20140103.log.tgz";
+    const char* newest = CS1_TGZ"/ACS20140104.log.tgz";
+
+    create_file(oldest, 1000);
+    create_file(CS1_TGZ"/ACS20140102.log.tgz", 2000);
+    create_file(delivered, 3000);
+    create_file(newest, 4000);
+
+    retention->MarkDelivered(GetLogCommand::GetInoT(delivered));
+    retention->SetBudget(2 * UTEST_FILE_SIZE);
+
+    CHECK(retention->IsOverBudget());
+    CHECK_EQUAL(1, retention->RunOnce(1));     // bounded
+    CHECK_EQUAL(-1, access(delivered, F_OK));
+
+    CHECK_EQUAL(1, retention->RunOnce(RETENTION_MAX_EVICTIONS_PER_PASS));
+    CHECK_EQUAL(-1, access(oldest, F_OK));
+    CHECK_EQUAL(0, access(newest, F_OK));
+
+    CHECK_FALSE(retention->IsOverBudget());
+    CHECK_EQUAL(0, retention->RunOnce(RETENTION_MAX_EVICTIONS_PER_PASS));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : RetentionTestGroup
+*
+* NAME : RunOnce_keepsSubsystemFloor
+*
+*-----------------------------------------------------------------------------*/
+TEST(RetentionTestGroup, RunOnce_keepsSubsystemFloor)
+{
+    create_file(CS1_TGZ"/Power20140101.log.tgz", 1000);
+    create_file(CS1_TGZ"/ACS20140102.log.tgz", 2000);
+    create_file(CS1_TGZ"/ACS20140103.log.tgz", 3000);
+
+    retention->SetFloor(POWER, 1);
+    retention->SetBudget(UTEST_FILE_SIZE);
+
+    CHECK_EQUAL(2, retention->RunOnce(RETENTION_MAX_EVICTIONS_PER_PASS));
+    CHECK_EQUAL(0, access(CS1_TGZ"/Power20140101.log.tgz", F_OK));
+    CHECK_EQUAL(-1, access(CS1_TGZ"/ACS20140102.log.tgz", F_OK));
+    CHECK_EQUAL(-1, access(CS1_TGZ"/ACS20140103.log.tgz", F_OK));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : RetentionTestGroup
+*
+* NAME : GetSubsystem_matchesLongestPrefix
+*
+*-----------------------------------------------------------------------------*/
+TEST(RetentionTestGroup, GetSubsystem_matchesLongestPrefix)
+{
+    CHECK_EQUAL(COMMANDER, RetentionManager::GetSubsystem("Commander20140101.log.tgz"));
+    CHECK_EQUAL(COMMS, RetentionManager::GetSubsystem("Comms20140101.log.tgz"));
+    CHECK_EQUAL(GROUND_COMMANDER, RetentionManager::GetSubsystem("GroundCommander20140101.log"));
+    CHECK_EQUAL(RETENTION_NO_SUBSYSTEM, RetentionManager::GetSubsystem("unknown.tgz"));
+}
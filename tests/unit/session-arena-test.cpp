@@ -0,0 +1,163 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : session-arena-test.cpp
+ *
+ * DESCRIPTION : Tests the SessionArena and the commands executed in it
+ *
+ *----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetector.h"
+#include "CppUTest/MemoryLeakWarningPlugin.h"
+
+#include "SpaceDecl.h"
+#include "common/command-factory.h"
+#include "common/commands.h"
+#include "common/result-buffer.h"
+#include "common/session-arena.h"
+
+// allocations of the current test still alive (malloc and new, see CppUTest)
+static int allocations()
+{
+    return MemoryLeakWarningPlugin::getGlobalDetector()->totalMemoryLeaks(mem_leak_period_checking);
+}
+
+static SessionArena arena;
+
+TEST_GROUP(SessionArenaTestGroup)
+{
+    void setup()
+    {
+        arena.Reset();
+    }
+
+    void teardown()
+    {
+        SessionArena::SetCurrent(0);
+        arena.Reset();
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : SessionArenaTestGroup
+*
+* NAME : Alloc_isAligned_ResetReclaimsEverything
+*
+*-----------------------------------------------------------------------------*/
+TEST(SessionArenaTestGroup, Alloc_isAligned_ResetReclaimsEverything)
+{
+    int before = allocations();
+
+    char *first = (char*)arena.Alloc(3);
+    char *second = (char*)arena.Alloc(10);
+
+    CHECK(first != 0);
+    CHECK_EQUAL(SESSION_ARENA_ALIGN, second - first);
+    CHECK_EQUAL(0, (size_t)second % SESSION_ARENA_ALIGN);
+    CHECK_EQUAL(SESSION_ARENA_ALIGN + 16, arena.GetUsed());
+    CHECK(arena.Owns(second));
+    CHECK_EQUAL(before, allocations());
+
+    arena.Reset();
+
+    CHECK_EQUAL(0, arena.GetUsed());
+    CHECK(arena.GetHighWater() >= SESSION_ARENA_ALIGN + 16);
+    POINTERS_EQUAL(first, arena.Alloc(1));     // same memory again
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : SessionArenaTestGroup
+*
+* NAME : Alloc_whenFull_fallsBackToTheHeap
+*
+* PURPOSE : the heap blocks are freed by Reset (the leak detector checks it)
+*
+*-----------------------------------------------------------------------------*/
+TEST(SessionArenaTestGroup, Alloc_whenFull_fallsBackToTheHeap)
+{
+    unsigned long fallbacks = arena.GetNumberOfFallbacks();
+
+    char *inside = (char*)arena.Alloc(SESSION_ARENA_SIZE - 8);
+    char *outside = (char*)arena.Alloc(100);
+    char *huge = (char*)arena.Alloc(2 * SESSION_ARENA_SIZE);
+
+    CHECK(inside != 0 && outside != 0 && huge != 0);
+    memset(outside, 'x', 100);
+    memset(huge, 'x', 2 * SESSION_ARENA_SIZE);
+
+    CHECK(arena.Owns(inside));
+    CHECK(arena.Owns(outside));
+    CHECK(arena.Owns(huge));
+    CHECK_EQUAL(fallbacks + 2, arena.GetNumberOfFallbacks());
+
+    arena.Reset();
+
+    CHECK(!arena.Owns(outside));
+    CHECK(!arena.Owns(huge));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : SessionArenaTestGroup
+*
+* NAME : Execute_withCurrentArena_allocatesNothing
+*
+* PURPOSE : the command and its result are both in the arena, as in the
+*           space-commander
+*
+*-----------------------------------------------------------------------------*/
+TEST(SessionArenaTestGroup, Execute_withCurrentArena_allocatesNothing)
+{
+    char gettime_buf[GETTIME_CMD_SIZE] = { GETTIME_CMD };
+
+    SessionArena::SetCurrent(&arena);
+    int before = allocations();
+
+    CommandStorage *storage = (CommandStorage*)arena.Alloc(sizeof(CommandStorage));
+    ICommand *command = CommandFactory::CreateCommand(gettime_buf, GETTIME_CMD_SIZE, storage);
+
+    {
+        ResultBuffer result_buffer;
+        command->Execute(result_buffer);
+        char *result = result_buffer.GetData();
+
+        CHECK(result != 0);
+        CHECK(arena.Owns(command));
+        CHECK(arena.Owns(result));
+        CHECK_EQUAL(GETTIME_CMD, result[CMD_ID]);
+        CHECK_EQUAL(CS1_SUCCESS, result[CMD_STS]);
+        CHECK_EQUAL(before, allocations());
+    }   // released before the Reset, as in the space-commander
+
+    CommandFactory::DestroyCommand(command);
+    arena.Reset();
+
+    CHECK_EQUAL(0, arena.GetUsed());
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : SessionArenaTestGroup
+*
+* NAME : ResultBuffer_withoutArena_frees
+*
+*-----------------------------------------------------------------------------*/
+TEST(SessionArenaTestGroup, ResultBuffer_withoutArena_frees)
+{
+    char gettime_buf[GETTIME_CMD_SIZE] = { GETTIME_CMD };
+    ResultBuffer result_buffer;
+
+    ICommand *command = CommandFactory::CreateCommand(gettime_buf, GETTIME_CMD_SIZE);
+    command->Execute(result_buffer);
+
+    CHECK(!arena.Owns(result_buffer.GetData()));
+
+    result_buffer.Clear();          // the leak detector fails the test otherwise
+    delete command;
+}
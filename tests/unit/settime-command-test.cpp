@@ -12,6 +12,7 @@
  *                 else.
  *
  *----------------------------------------------------------------------------*/
+#include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
 #include <dirent.h>
@@ -27,6 +28,8 @@
 #include "common/commands.h"
 #include "common/command-factory.h"
 #include "common/icommand.h"
+#include "common/gettime-command.h"
+#include "common/rtc-writer.h"
 #include "common/settime-command.h"
 #include "common/subsystems.h"
 #include "fileIO.h"
@@ -36,6 +39,17 @@ static const char* RTC_DEV_PATH = "/dev/rtc1";
 static bool checkRoot();
 static char command_buf[SETTIME_CMD_SIZE] = {'\0'};
 
+// a slow I2C bus
+static volatile int rtc_writes = 0;
+static int rtc_result = 0;
+
+static int SlowWriteToRtc(struct rtc_time rt, int bus)
+{
+    usleep(50000);
+    rtc_writes++;
+    return rtc_result;
+}
+
 TEST_GROUP(SetTimeTestGroup) {
     void setup() {
         // clears the command buffer
@@ -44,7 +58,9 @@ TEST_GROUP(SetTimeTestGroup) {
     }
 
     void teardown() {
-        //*/
+        RtcWriter::Reset();
+        rtc_writes = 0;
+        rtc_result = 0;
     }
 };
 
@@ -63,14 +79,16 @@ TEST(SetTimeTestGroup, Check_Settime) {
 
     time_t rawtime = 0;
     time_t newtime = 0;
-    size_t result_size = 0;
+    ResultBuffer result_buffer;
     time(&rawtime);
 
     SpaceString::getTimetInChar(command_buf + CMD_HEAD_SIZE, rawtime);
     command_buf[SETTIME_CMD_SIZE - 1] = 0xFF;   
     ICommand* command = CommandFactory::CreateCommand(command_buf);
 
-    char* result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t result_size = result_buffer.GetSize();
     CHECK(result_size == SETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE);
 
     InfoBytesSetTime* settime_info = (InfoBytesSetTime*)command->ParseResult(result);
@@ -90,11 +108,6 @@ TEST(SetTimeTestGroup, Check_Settime) {
         delete command;
         command = NULL;
     }
-
-    if (result) {
-        free(result);
-        result = 0;
-    }
 }
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -173,14 +186,16 @@ TEST(SetTimeTestGroup, Check_Settime_Rtc) {
 
     ifs.close();
     time_t rawtime;
-    size_t resultBufferSize;
+    ResultBuffer result_buffer;
     time(&rawtime);
     
     SpaceString::getTimetInChar(command_buf+1,rawtime);
     command_buf[SETTIME_CMD_SIZE - 1] = 0x01; // 0x01 -> RTC_BYTE ON      TODO !!! remove this magic number !!!
      
     ICommand* command = CommandFactory::CreateCommand(command_buf);
-    char* result = (char*)command->Execute(&resultBufferSize);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t resultBufferSize = result_buffer.GetSize();
     CHECK_EQUAL(SETTIME_RTN_SIZE_TOTAL, resultBufferSize);
     InfoBytesSetTime* settime_info = (InfoBytesSetTime*)command->ParseResult(result);
 
@@ -202,11 +217,6 @@ TEST(SetTimeTestGroup, Check_Settime_Rtc) {
         delete command;
         command = NULL;
     }
-
-    if (result) {
-        free(result);
-        result = 0;
-    }
 }
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -222,12 +232,14 @@ TEST(SetTimeTestGroup, Check_Settime_Fail) {
     }
 
     time_t rawtime = -1;
-    size_t result_size; 
+    ResultBuffer result_buffer;
     
     SpaceString::getTimetInChar(command_buf+1,rawtime);
     command_buf[SETTIME_CMD_SIZE - 1] = 0xFF;   
     ICommand* command = CommandFactory::CreateCommand(command_buf);
-    char* result = (char*)command->Execute(&result_size);
+    command->Execute(result_buffer);
+    char* result = result_buffer.GetData();
+    size_t result_size = result_buffer.GetSize();
     
     CHECK(result_size == SETTIME_RTN_SIZE + CMD_RES_HEAD_SIZE);    
 
@@ -239,11 +251,63 @@ TEST(SetTimeTestGroup, Check_Settime_Fail) {
         delete command;
         command = NULL;
     }
-     
-    if (result) {
-        free(result);
-        result = 0;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * GROUP : SetTimeTestGroup
+ *
+ * NAME : RtcWriter_slowBus_returnsAtOnceAndCoalesces
+ * 
+ *-----------------------------------------------------------------------------*/
+TEST(SetTimeTestGroup, RtcWriter_slowBus_returnsAtOnceAndCoalesces) {
+    struct timeval start, end;
+    RtcWriter::SetWriteFunction(SlowWriteToRtc);
+
+    gettimeofday(&start, 0);
+    for (int i = 0; i < 5; i++) {
+        RtcWriter::Submit(1);
     }
+    gettimeofday(&end, 0);
+
+    CHECK((end.tv_sec - start.tv_sec) * 1000000L + (end.tv_usec - start.tv_usec) < 25000);
+    CHECK_EQUAL(RTC_STATUS_PENDING, RtcWriter::GetStatus());
+
+    CHECK(RtcWriter::Flush(RTC_FLUSH_TIMEOUT_MS));
+    CHECK_EQUAL(RTC_STATUS_OK, RtcWriter::GetStatus());
+
+    // the first request may have been taken before the others came
+    CHECK(rtc_writes >= 1 && rtc_writes <= 2);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * GROUP : SetTimeTestGroup
+ *
+ * NAME : RtcWriter_failure_reportedByGetTime
+ * 
+ *-----------------------------------------------------------------------------*/
+TEST(SetTimeTestGroup, RtcWriter_failure_reportedByGetTime) {
+    char gettime_buf[GETTIME_CMD_SIZE] = {GETTIME_CMD};
+    ResultBuffer result_buffer;
+    ICommand* command = CommandFactory::CreateCommand(gettime_buf);
+
+    command->Execute(result_buffer);
+    CHECK_EQUAL(RTC_STATUS_NONE, ((InfoBytesGetTime*)command->ParseResult(result_buffer.GetData()))->rtc_status);
+
+    rtc_result = -1;
+    RtcWriter::SetWriteFunction(SlowWriteToRtc);
+    RtcWriter::Submit(1);
+    RtcWriter::Flush(RTC_FLUSH_TIMEOUT_MS);
+
+    result_buffer.Clear();
+    command->Execute(result_buffer);
+    InfoBytesGetTime* gettime_info = (InfoBytesGetTime*)command->ParseResult(result_buffer.GetData());
+
+    CHECK_EQUAL(CS1_SUCCESS, gettime_info->time_status);
+    CHECK_EQUAL(RTC_STATUS_FAILED, gettime_info->rtc_status);
+
+    delete command;
 }
 
 /*++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
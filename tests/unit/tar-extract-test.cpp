@@ -0,0 +1,228 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : tar-extract-test.cpp
+ *
+ * DESCRIPTION : Tests TarExtract on malformed archives : a bad header
+ *               checksum, names out of the directory, an entry larger than
+ *               the input. The archives are built here, header by header.
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/tar-extract.h"
+
+#define TAR_TEST_DIR CS1_TGZ"/tar-test"
+#define TAR_TEST_OUT_DIR CS1_TGZ"/tar-test/out"
+#define TAR_TEST_ARCHIVE_SIZE (8 * TAR_BLOCK_SIZE)
+
+TEST_GROUP(TarExtractTestGroup)
+{
+    unsigned char archive[TAR_TEST_ARCHIVE_SIZE];
+    size_t archive_size;
+    TarExtract *tar;
+
+    void setup()
+    {
+        mkdir(CS1_TGZ, S_IRWXU);
+        mkdir(TAR_TEST_DIR, S_IRWXU);
+        mkdir(TAR_TEST_OUT_DIR, S_IRWXU);
+
+        memset(archive, 0, sizeof(archive));
+        archive_size = 0;
+
+        tar = new TarExtract;
+        TarExtract_Init(tar, TAR_TEST_OUT_DIR);
+    }
+
+    void teardown()
+    {
+        delete tar;
+        CHECK_EQUAL(0, system("rm -rf " TAR_TEST_DIR));
+    }
+
+    /*
+     * Appends a ustar header and 'size' bytes of data, padded to a block
+     */
+    void AddEntry(const char *name, char type, const char *data, size_t size)
+    {
+        char *header = (char*)archive + archive_size;
+
+        snprintf(header, 100, "%s", name);
+        snprintf(header + 100, 8, "%07o", 0644);
+        snprintf(header + 124, 12, "%011o", (unsigned int)size);
+        header[156] = type;
+        memcpy(header + 257, "ustar", 6);
+
+        unsigned int sum = 0;
+        memset(header + 148, ' ', 8);
+        for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+            sum += (unsigned char)header[i];
+        }
+        snprintf(header + 148, 8, "%06o", sum);
+
+        archive_size += TAR_BLOCK_SIZE;
+        memcpy(archive + archive_size, data, size);
+        archive_size += (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+    }
+
+    void AddEnd()
+    {
+        archive_size += 2 * TAR_BLOCK_SIZE;     // zero blocks
+    }
+
+    bool Exists(const char *path)
+    {
+        return access(path, F_OK) == 0;
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TarExtractTestGroup
+*
+* NAME : Write_byteByByte_extracted
+*
+*-----------------------------------------------------------------------------*/
+TEST(TarExtractTestGroup, Write_byteByByte_extracted)
+{
+    AddEntry("etc/app.conf", '0', "period=10\n", 10);
+    AddEnd();
+
+    for (size_t i = 0; i < archive_size; i++) {
+        CHECK(TarExtract_Write(tar, archive + i, 1));
+    }
+
+    CHECK_EQUAL(TAR_OK, TarExtract_Finish(tar));
+    CHECK_EQUAL(1, tar->files);
+    CHECK(tar->manifest == "10 etc/app.conf\n");
+    CHECK(Exists(TAR_TEST_OUT_DIR "/etc/app.conf"));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TarExtractTestGroup
+*
+* NAME : Write_badChecksum_badArchive
+*
+*-----------------------------------------------------------------------------*/
+TEST(TarExtractTestGroup, Write_badChecksum_badArchive)
+{
+    AddEntry("app.conf", '0', "period=10\n", 10);
+    AddEnd();
+    archive[0] = 'b';                           // the name, after the checksum was computed
+
+    CHECK(!TarExtract_Write(tar, archive, archive_size));
+    CHECK_EQUAL(TAR_BAD_ARCHIVE, tar->error);
+    CHECK_EQUAL(TAR_BAD_ARCHIVE, TarExtract_Finish(tar));
+    CHECK(!Exists(TAR_TEST_OUT_DIR "/app.conf"));
+    CHECK(!Exists(TAR_TEST_OUT_DIR "/bpp.conf"));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TarExtractTestGroup
+*
+* NAME : Write_nameOutOfTheDirectory_badArchive
+*
+*-----------------------------------------------------------------------------*/
+TEST(TarExtractTestGroup, Write_nameOutOfTheDirectory_badArchive)
+{
+    const char *names[] = { "../escape", "etc/../../escape", "..", "/tmp/escape" };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        memset(archive, 0, sizeof(archive));
+        archive_size = 0;
+        TarExtract_Init(tar, TAR_TEST_OUT_DIR);
+
+        AddEntry(names[i], '0', "x", 1);
+        AddEnd();
+
+        CHECK(!TarExtract_Write(tar, archive, archive_size));
+        CHECK_EQUAL(TAR_BAD_ARCHIVE, TarExtract_Finish(tar));
+    }
+
+    CHECK(!Exists(TAR_TEST_DIR "/escape"));
+    CHECK_EQUAL(0, tar->files);
+
+    // a directory entry is checked too
+    memset(archive, 0, sizeof(archive));
+    archive_size = 0;
+    TarExtract_Init(tar, TAR_TEST_OUT_DIR);
+
+    AddEntry("../escape-dir", '5', "", 0);
+    CHECK(!TarExtract_Write(tar, archive, archive_size));
+    CHECK(!Exists(TAR_TEST_DIR "/escape-dir"));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TarExtractTestGroup
+*
+* NAME : Finish_entryLargerThanTheInput_badArchiveAndRemoved
+*
+*-----------------------------------------------------------------------------*/
+TEST(TarExtractTestGroup, Finish_entryLargerThanTheInput_badArchiveAndRemoved)
+{
+    char data[3 * TAR_BLOCK_SIZE];
+    memset(data, 'a', sizeof(data));
+
+    AddEntry("bin/app", '0', data, sizeof(data));
+
+    // the header says 3 blocks, only 1 arrives
+    CHECK(TarExtract_Write(tar, archive, 2 * TAR_BLOCK_SIZE));
+    CHECK_EQUAL(TAR_BAD_ARCHIVE, TarExtract_Finish(tar));
+    CHECK(!Exists(TAR_TEST_OUT_DIR "/bin/app"));
+    CHECK_EQUAL(0, tar->files);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TarExtractTestGroup
+*
+* NAME : Finish_truncatedHeader_badArchive
+*
+*-----------------------------------------------------------------------------*/
+TEST(TarExtractTestGroup, Finish_truncatedHeader_badArchive)
+{
+    AddEntry("app.conf", '0', "period=10\n", 10);
+
+    CHECK(TarExtract_Write(tar, archive, TAR_BLOCK_SIZE / 2));
+    CHECK_EQUAL(TAR_BAD_ARCHIVE, TarExtract_Finish(tar));
+    CHECK(!Exists(TAR_TEST_OUT_DIR "/app.conf"));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TarExtractTestGroup
+*
+* NAME : Write_longNameTooLong_badArchive
+*
+*-----------------------------------------------------------------------------*/
+TEST(TarExtractTestGroup, Write_longNameTooLong_badArchive)
+{
+    AddEntry("././@LongLink", 'L', "", 0);
+
+    // the size field of the 'L' entry claims CS1_PATH_MAX bytes of name
+    char *header = (char*)archive;
+    snprintf(header + 124, 12, "%011o", (unsigned int)CS1_PATH_MAX);
+
+    unsigned int sum = 0;
+    memset(header + 148, ' ', 8);
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        sum += (unsigned char)header[i];
+    }
+    snprintf(header + 148, 8, "%06o", sum);
+
+    CHECK(!TarExtract_Write(tar, archive, archive_size));
+    CHECK_EQUAL(TAR_BAD_ARCHIVE, tar->error);
+}
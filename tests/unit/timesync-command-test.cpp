@@ -0,0 +1,222 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : timesync-command-test.cpp
+ *
+ * DESCRIPTION : Tests the TimeSyncCommand over a simulated link : the ground
+ *               clock is the satellite clock shifted by GROUND_SHIFT_NS, the
+ *               uplink and the downlink sleep for the delays of the test.
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/command-factory.h"
+#include "common/icommand.h"
+#include "common/timesync-command.h"
+
+#define GROUND_SHIFT_NS 2345678901LL    // the ground is late
+#define MS 1000000LL
+
+static char command_buf[TIMESYNC_CMD_SIZE] = {'\0'};
+
+TEST_GROUP(TimeSyncTestGroup)
+{
+    void setup()
+    {
+        memset(command_buf, 0, TIMESYNC_CMD_SIZE);
+    }
+
+    void teardown()
+    {
+    }
+
+    long long GroundNow()
+    {
+        return TimeSyncCommand::Now(CLOCK_REALTIME) - GROUND_SHIFT_NS;
+    }
+
+    /* One exchange over the simulated link */
+    void Exchange(useconds_t uplink_us, useconds_t downlink_us, TimeSyncSample* sample)
+    {
+        ResultBuffer result;
+        TimeSyncCommand ground_cmd;
+
+        TimeSyncCommand::Build_TimeSyncCommand(command_buf, TIMESYNC_OP_SAMPLE, GroundNow());
+        usleep(uplink_us);
+
+        ICommand* command = CommandFactory::CreateCommand(command_buf, TIMESYNC_CMD_SIZE);
+        command->Execute(result);
+        delete command;
+
+        usleep(downlink_us);
+
+        InfoBytesTimeSync* info = (InfoBytesTimeSync*)ground_cmd.ParseResult(result.GetData());
+        *sample = info->sample;
+        sample->t3 = GroundNow();
+
+        CHECK_EQUAL(CS1_SUCCESS, info->timesync_status);
+        CHECK_EQUAL(TIMESYNC_OP_SAMPLE, info->op);
+    }
+
+    void Slew(long long nanoseconds, InfoBytesTimeSync* info)
+    {
+        ResultBuffer result;
+        TimeSyncCommand ground_cmd;
+
+        TimeSyncCommand::Build_TimeSyncCommand(command_buf, TIMESYNC_OP_SLEW, nanoseconds);
+        ICommand* command = CommandFactory::CreateCommand(command_buf, TIMESYNC_CMD_SIZE);
+        command->Execute(result);
+        delete command;
+
+        *info = *(InfoBytesTimeSync*)ground_cmd.ParseResult(result.GetData());
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TimeSyncTestGroup
+*
+* NAME : Estimate_asymmetricLinks_offsetWithinHalfTheBestDelay
+*
+*-----------------------------------------------------------------------------*/
+TEST(TimeSyncTestGroup, Estimate_asymmetricLinks_offsetWithinHalfTheBestDelay)
+{
+    // uplink, downlink (us) : jitter, one direction much slower than the other
+    const useconds_t links[][2] = { {40000, 5000}, {8000, 30000}, {25000, 25000}, {3000, 12000},
+                                    {60000, 2000}, {4000, 4000}, {15000, 45000}, {2000, 20000} };
+    const size_t count = sizeof(links) / sizeof(links[0]);
+    TimeSyncSample samples[count];
+    TimeSyncEstimate estimate;
+
+    for (size_t i = 0; i < count; i++) {
+        this->Exchange(links[i][0], links[i][1], &samples[i]);
+    }
+
+    CHECK(TimeSyncCommand::Estimate(samples, count, &estimate));
+    CHECK_EQUAL(count, estimate.samples);
+
+    // the {4000, 4000} sample, the scheduler may add a few ms
+    CHECK(estimate.delay >= 8 * MS && estimate.delay < 15 * MS);
+    CHECK(llabs(estimate.offset - GROUND_SHIFT_NS) <= estimate.delay / 2 + 1 * MS);
+
+    // a single sample over the slowest link is bounded by its delay only
+    CHECK(TimeSyncCommand::Estimate(&samples[4], 1, &estimate));
+    CHECK(llabs(estimate.offset - GROUND_SHIFT_NS) <= estimate.delay / 2 + 1 * MS);
+    CHECK(llabs(estimate.offset - GROUND_SHIFT_NS) > 20 * MS);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TimeSyncTestGroup
+*
+* NAME : Estimate_clockSetOnBoard_sampleDiscarded
+*
+*-----------------------------------------------------------------------------*/
+TEST(TimeSyncTestGroup, Estimate_clockSetOnBoard_sampleDiscarded)
+{
+    TimeSyncSample samples[3];
+    TimeSyncEstimate estimate;
+
+    this->Exchange(1000, 1000, &samples[0]);
+    samples[1] = samples[0];
+    samples[2] = samples[0];
+
+    samples[1].t2_realtime += 5 * TIMESYNC_NS_PER_SEC;      // SetTime between t1 and t2
+    samples[2].t3 = samples[2].t0 - 1;                      // not in order
+
+    CHECK(!TimeSyncCommand::Estimate(&samples[1], 2, &estimate));
+    CHECK_EQUAL(0, estimate.samples);
+
+    CHECK(TimeSyncCommand::Estimate(samples, 3, &estimate));
+    CHECK_EQUAL(1, estimate.samples);
+    CHECK(llabs(estimate.offset - GROUND_SHIFT_NS) <= estimate.delay / 2 + 1 * MS);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TimeSyncTestGroup
+*
+* NAME : Execute_slewTooLarge_refused
+*
+*-----------------------------------------------------------------------------*/
+TEST(TimeSyncTestGroup, Execute_slewTooLarge_refused)
+{
+    InfoBytesTimeSync info;
+
+    this->Slew(-(TIMESYNC_MAX_SLEW_NS + 1), &info);
+
+    CHECK_EQUAL(CS1_FAILURE, info.timesync_status);
+    CHECK_EQUAL(TIMESYNC_OP_SLEW, info.op);
+    CHECK(info.slew == -(TIMESYNC_MAX_SLEW_NS + 1));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TimeSyncTestGroup
+*
+* NAME : Execute_slew_replacesTheAdjustmentInProgress
+*
+*-----------------------------------------------------------------------------*/
+TEST(TimeSyncTestGroup, Execute_slew_replacesTheAdjustmentInProgress)
+{
+    InfoBytesTimeSync info;
+
+    if (getuid() != 0) {
+        printf("[WARNING] test needs root... SKIPPING TEST\n");
+        return;
+    }
+
+    this->Slew(-5 * MS, &info);
+    CHECK_EQUAL(CS1_SUCCESS, info.timesync_status);
+
+    // cancels it, what was left of the -5 ms is reported
+    this->Slew(0, &info);
+    CHECK_EQUAL(CS1_SUCCESS, info.timesync_status);
+    CHECK(info.previous_slew < 0 && info.previous_slew >= -5 * MS);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : TimeSyncTestGroup
+*
+* NAME : Create_afterMarkArrival_t1IsTheArrival
+*
+*-----------------------------------------------------------------------------*/
+TEST(TimeSyncTestGroup, Create_afterMarkArrival_t1IsTheArrival)
+{
+    ResultBuffer result;
+    TimeSyncCommand ground_cmd;
+
+    TimeSyncCommand::Build_TimeSyncCommand(command_buf, TIMESYNC_OP_SAMPLE, GroundNow());
+    TimeSyncCommand::MarkArrival();
+    long long arrived = TimeSyncCommand::Now(CLOCK_MONOTONIC);
+
+    usleep(20000);      // logged, queued... on board
+
+    ICommand* command = CommandFactory::CreateCommand(command_buf, TIMESYNC_CMD_SIZE);
+    command->Execute(result);
+    delete command;
+
+    InfoBytesTimeSync* info = (InfoBytesTimeSync*)ground_cmd.ParseResult(result.GetData());
+
+    CHECK(info->sample.t1_monotonic <= arrived);
+    CHECK(info->sample.t2_monotonic - info->sample.t1_monotonic >= 20 * MS);
+
+    // used once : the next one takes t1 when it is created
+    ResultBuffer next_result;
+
+    command = CommandFactory::CreateCommand(command_buf, TIMESYNC_CMD_SIZE);
+    command->Execute(next_result);
+    delete command;
+
+    info = (InfoBytesTimeSync*)ground_cmd.ParseResult(next_result.GetData());
+    CHECK(info->sample.t1_monotonic > arrived);
+}
@@ -0,0 +1,224 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : update-command-test.cpp
+ *
+ * DESCRIPTION : Tests the compressed UpdateCommand (UPDATE_LZ_CMD) : a file
+ *               sent in chunks built with Build_UpdateChunk
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/command-factory.h"
+#include "common/icommand.h"
+#include "common/lzss.h"
+#include "common/update-command.h"
+#include "common/wire.h"
+
+#define UPDATE_TEST_PATH CS1_TGZ"/update-test.conf"
+#define UPDATE_TEST_CMD_SIZE 255       // MAX_COMMAND_SIZE of the commanders
+
+static char command_buf[UPDATE_TEST_CMD_SIZE] = {'\0'};
+
+TEST_GROUP(UpdateTestGroup)
+{
+    std::string text;
+
+    void setup()
+    {
+        char line[100];
+
+        mkdir(CS1_TGZ, S_IRWXU);
+        Wire::SetVersion(WIRE_V2);
+
+        srand(42);
+        for (int i = 0; i < 200; i++) {
+            snprintf(line, sizeof(line), "payload.sensor_%d.period_ms=%d\npayload.sensor_%d.enabled=%s\n",
+                                          i, 100 * (rand() % 50), i, (rand() % 2) ? "true" : "false");
+            text += line;
+        }
+    }
+
+    void teardown()
+    {
+        Wire::Reset();
+        remove(UPDATE_TEST_PATH);
+    }
+
+    char Send(size_t cmd_size)
+    {
+        ICommand* command = CommandFactory::CreateCommand(command_buf, cmd_size);
+        ResultBuffer result;
+
+        command->Execute(result);
+        char status = ((InfoBytesUpdate*)command->ParseResult(result.GetData()))->update_status;
+
+        delete command;
+        return status;
+    }
+
+    std::string ReadFile()
+    {
+        std::string data;
+        char buffer[1024];
+        size_t size = 0;
+        FILE* file = fopen(UPDATE_TEST_PATH, "r");
+
+        if (file) {
+            while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+                data.append(buffer, size);
+            }
+            fclose(file);
+        }
+
+        return data;
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UpdateTestGroup
+*
+* NAME : Lzss_withDictionary_roundTrip
+*
+*-----------------------------------------------------------------------------*/
+TEST(UpdateTestGroup, Lzss_withDictionary_roundTrip)
+{
+    const unsigned char* bytes = (const unsigned char*)text.data();
+    unsigned char out[UPDATE_LZ_MAX_SIZE];
+    unsigned char back[UPDATE_LZ_MAX_SIZE];
+    size_t consumed = 0, dict_used = 0;
+
+    size_t size = Lzss_Compress(bytes, 1000, bytes + 1000, 2000, out, sizeof(out), &consumed, &dict_used);
+
+    CHECK_EQUAL(2000, consumed);
+    CHECK(size < consumed / 2);
+    CHECK(dict_used > 0 && dict_used <= 1000);
+
+    CHECK(Lzss_Decompress(bytes + 1000 - dict_used, dict_used, out, size, back, consumed));
+    CHECK_EQUAL(0, memcmp(bytes + 1000, back, consumed));
+
+    // a dictionary too short, or a truncated stream
+    CHECK(!Lzss_Decompress(bytes + 1000 - dict_used + 1, dict_used - 1, out, size, back, consumed));
+    CHECK(!Lzss_Decompress(bytes + 1000 - dict_used, dict_used, out, size - 1, back, consumed));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UpdateTestGroup
+*
+* NAME : UpdateChunk_textFile_fewerCommandsAndSameFile
+*
+*-----------------------------------------------------------------------------*/
+TEST(UpdateTestGroup, UpdateChunk_textFile_fewerCommandsAndSameFile)
+{
+    WireView file(text.data(), text.size());
+    size_t offset = 0, consumed = 0, commands = 0, uplink = 0;
+
+    while (offset < text.size()) {
+        size_t cmd_size = UpdateCommand::Build_UpdateChunk(command_buf, UPDATE_TEST_CMD_SIZE, UPDATE_TEST_PATH,
+                                                                                        file, offset, &consumed);
+        CHECK(cmd_size > 0 && cmd_size <= UPDATE_TEST_CMD_SIZE);
+        CHECK_EQUAL(UPDATE_LZ_CMD, command_buf[CMD_ID]);
+        CHECK_EQUAL(CS1_SUCCESS, Send(cmd_size));
+
+        offset += consumed;
+        uplink += cmd_size;
+        commands++;
+    }
+
+    size_t raw_commands = (text.size() + UPDATE_TEST_CMD_SIZE - 30) / (UPDATE_TEST_CMD_SIZE - 30);
+
+    CHECK(ReadFile() == text);
+    CHECK(uplink * 3 < text.size());
+    CHECK(commands * 3 < raw_commands);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UpdateTestGroup
+*
+* NAME : UpdateChunk_chunkLost_nextOneFailsAndWritesNothing
+*
+*-----------------------------------------------------------------------------*/
+TEST(UpdateTestGroup, UpdateChunk_chunkLost_nextOneFailsAndWritesNothing)
+{
+    WireView file(text.data(), text.size());
+    size_t first = 0, second = 0;
+
+    size_t cmd_size = UpdateCommand::Build_UpdateChunk(command_buf, UPDATE_TEST_CMD_SIZE, UPDATE_TEST_PATH,
+                                                                                    file, 0, &first);
+    CHECK_EQUAL(CS1_SUCCESS, Send(cmd_size));
+
+    UpdateCommand::Build_UpdateChunk(command_buf, UPDATE_TEST_CMD_SIZE, UPDATE_TEST_PATH, file, first, &second);
+    cmd_size = UpdateCommand::Build_UpdateChunk(command_buf, UPDATE_TEST_CMD_SIZE, UPDATE_TEST_PATH,
+                                                                            file, first + second, &second);
+    CHECK_EQUAL(CS1_FAILURE, Send(cmd_size));
+
+    CHECK(ReadFile() == text.substr(0, first));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UpdateTestGroup
+*
+* NAME : UpdateChunk_randomBytes_sentRaw
+*
+*-----------------------------------------------------------------------------*/
+TEST(UpdateTestGroup, UpdateChunk_randomBytes_sentRaw)
+{
+    char bytes[1000];
+    size_t consumed = 0;
+
+    for (size_t i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = (char)rand();
+    }
+
+    size_t cmd_size = UpdateCommand::Build_UpdateChunk(command_buf, UPDATE_TEST_CMD_SIZE, UPDATE_TEST_PATH,
+                                                       WireView(bytes, sizeof(bytes)), 0, &consumed);
+
+    CHECK_EQUAL(UPDATE_CMD, command_buf[CMD_ID]);
+    CHECK_EQUAL(UPDATE_TEST_CMD_SIZE, cmd_size);
+    CHECK_EQUAL(CS1_SUCCESS, Send(cmd_size));
+    CHECK(ReadFile() == std::string(bytes, consumed));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UpdateTestGroup
+*
+* NAME : Execute_pathTooLong_failureResult
+*
+*-----------------------------------------------------------------------------*/
+TEST(UpdateTestGroup, Execute_pathTooLong_failureResult)
+{
+    char path[CS1_PATH_MAX + 8];
+    char cmd_buf[sizeof(path) + 16];
+    ResultBuffer result;
+
+    memset(path, 'a', sizeof(path));
+
+    size_t cmd_size = UpdateCommand::Build_UpdateCommand(cmd_buf, WireView(path, sizeof(path)), WireView("data"));
+    ICommand* command = CommandFactory::CreateCommand(cmd_buf, cmd_size);
+
+    CHECK(command != 0);
+    command->Execute(result);
+
+    const char* data = result.GetData();
+
+    CHECK(data != 0);
+    CHECK_EQUAL(UPDATE_CMD, data[CMD_ID]);
+    CHECK_EQUAL(CS1_FAILURE, data[CMD_STS]);
+
+    delete command;
+}
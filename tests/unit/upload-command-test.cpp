@@ -0,0 +1,279 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : upload-command-test.cpp
+ *
+ * DESCRIPTION : Tests the UploadCommand and the UploadSession : chunks out of
+ *               order, lost, sent twice, and an upload resumed
+ *
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/command-factory.h"
+#include "common/crc32.h"
+#include "common/icommand.h"
+#include "common/upload-command.h"
+
+#define UPLOAD_TEST_PATH CS1_TGZ"/upload-test.bin"
+#define UPLOAD_TEST_ID 39
+#define UPLOAD_TEST_SIZE 1000       // the last block is shorter
+#define UPLOAD_TEST_CHUNK (7 * UPLOAD_BLOCK_SIZE)
+#define UPLOAD_TEST_CHUNKS ((UPLOAD_TEST_SIZE + UPLOAD_TEST_CHUNK - 1) / UPLOAD_TEST_CHUNK)
+
+static char command_buf[UPLOAD_TEST_CHUNK + CS1_PATH_MAX] = {'\0'};
+
+TEST_GROUP(UploadTestGroup)
+{
+    char bytes[UPLOAD_TEST_SIZE];
+    unsigned int crc;
+
+    void setup()
+    {
+        mkdir(CS1_TGZ, S_IRWXU);
+
+        srand(39);
+        for (size_t i = 0; i < UPLOAD_TEST_SIZE; i++) {
+            bytes[i] = (char)rand();
+        }
+
+        crc = Crc32(bytes, UPLOAD_TEST_SIZE);
+    }
+
+    void teardown()
+    {
+        UploadSession::CloseAll();
+        remove(UPLOAD_TEST_PATH);
+        remove(UPLOAD_TEST_PATH UPLOAD_PART_EXT);
+        remove(UPLOAD_TEST_PATH UPLOAD_STATE_EXT);
+    }
+
+    InfoBytesUpload* Send(size_t cmd_size)
+    {
+        ICommand* command = CommandFactory::CreateCommand(command_buf, cmd_size);
+        ResultBuffer result;
+
+        command->Execute(result);
+        InfoBytesUpload* info = (InfoBytesUpload*)command->ParseResult(result.GetData());
+
+        delete command;
+        return info;
+    }
+
+    InfoBytesUpload* Open(unsigned int crc)
+    {
+        return Send(UploadCommand::Build_Open(command_buf, UPLOAD_TEST_ID, UPLOAD_TEST_SIZE, crc, UPLOAD_TEST_PATH));
+    }
+
+    InfoBytesUpload* WriteChunk(int chunk)
+    {
+        unsigned int offset = chunk * UPLOAD_TEST_CHUNK;
+        size_t length = (UPLOAD_TEST_SIZE - offset < UPLOAD_TEST_CHUNK) ? UPLOAD_TEST_SIZE - offset : UPLOAD_TEST_CHUNK;
+
+        return Send(UploadCommand::Build_Write(command_buf, UPLOAD_TEST_ID, offset, WireView(bytes + offset, length)));
+    }
+
+    bool FileMatches(const char* path)
+    {
+        char read_back[UPLOAD_TEST_SIZE + 1];
+        FILE* file = fopen(path, "r");
+
+        if (!file) {
+            return false;
+        }
+
+        size_t size = fread(read_back, 1, sizeof(read_back), file);
+        fclose(file);
+
+        return size == UPLOAD_TEST_SIZE && memcmp(bytes, read_back, UPLOAD_TEST_SIZE) == 0;
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UploadTestGroup
+*
+* NAME : Upload_outOfOrderAndDuplicated_fileIsComplete
+*
+*-----------------------------------------------------------------------------*/
+TEST(UploadTestGroup, Upload_outOfOrderAndDuplicated_fileIsComplete)
+{
+    CHECK_EQUAL(CS1_SUCCESS, Open(crc)->upload_status);
+
+    for (int chunk = UPLOAD_TEST_CHUNKS - 1; chunk >= 0; chunk--) {
+        CHECK_EQUAL(CS1_SUCCESS, WriteChunk(chunk)->upload_status);
+        CHECK_EQUAL(CS1_SUCCESS, WriteChunk(chunk)->upload_status);
+    }
+
+    InfoBytesUpload* info = Send(UploadCommand::Build_Missing(command_buf, UPLOAD_TEST_ID, 0));
+    CHECK_EQUAL(UPLOAD_MISSING, info->op);
+    CHECK_EQUAL(UPLOAD_TEST_SIZE, info->value);
+    CHECK_EQUAL(0, info->range_count);
+
+    info = Send(UploadCommand::Build_Finalize(command_buf, UPLOAD_TEST_ID));
+    CHECK_EQUAL(CS1_SUCCESS, info->upload_status);
+    CHECK_EQUAL(crc, info->value);
+
+    CHECK(FileMatches(UPLOAD_TEST_PATH));
+    CHECK(access(UPLOAD_TEST_PATH UPLOAD_PART_EXT, F_OK) != 0);
+    CHECK(access(UPLOAD_TEST_PATH UPLOAD_STATE_EXT, F_OK) != 0);
+    POINTERS_EQUAL(0, UploadSession::Find(UPLOAD_TEST_ID));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UploadTestGroup
+*
+* NAME : Upload_lostChunks_missingAndResumedAfterRestart
+*
+* PURPOSE : the sessions are closed between the passes, as after a reboot of
+*           the space-commander
+*
+*-----------------------------------------------------------------------------*/
+TEST(UploadTestGroup, Upload_lostChunks_missingAndResumedAfterRestart)
+{
+    Open(crc);
+
+    for (int chunk = 0; chunk < UPLOAD_TEST_CHUNKS; chunk++) {
+        if (chunk != 1 && chunk != UPLOAD_TEST_CHUNKS - 1) {
+            WriteChunk(chunk);
+        }
+    }
+
+    // the first finalize fails, nothing is renamed
+    InfoBytesUpload* info = Send(UploadCommand::Build_Finalize(command_buf, UPLOAD_TEST_ID));
+    CHECK_EQUAL(CS1_FAILURE, info->upload_status);
+    CHECK(access(UPLOAD_TEST_PATH, F_OK) != 0);
+
+    UploadSession::CloseAll();
+
+    info = Open(crc);
+    CHECK_EQUAL(CS1_SUCCESS, info->upload_status);
+    CHECK_EQUAL(UPLOAD_TEST_SIZE - UPLOAD_TEST_CHUNK - (UPLOAD_TEST_SIZE - (UPLOAD_TEST_CHUNKS - 1) * UPLOAD_TEST_CHUNK),
+                info->value);
+
+    info = Send(UploadCommand::Build_Missing(command_buf, UPLOAD_TEST_ID, 0));
+    CHECK_EQUAL(2, info->range_count);
+    CHECK_EQUAL(UPLOAD_TEST_CHUNK, info->ranges[0].offset);
+    CHECK_EQUAL(UPLOAD_TEST_CHUNK, info->ranges[0].length);
+    CHECK_EQUAL((UPLOAD_TEST_CHUNKS - 1) * UPLOAD_TEST_CHUNK, info->ranges[1].offset);
+    CHECK_EQUAL(UPLOAD_TEST_SIZE, info->ranges[1].offset + info->ranges[1].length);
+
+    info = Send(UploadCommand::Build_Missing(command_buf, UPLOAD_TEST_ID, 2 * UPLOAD_TEST_CHUNK));
+    CHECK_EQUAL(1, info->range_count);
+
+    WriteChunk(1);
+    WriteChunk(UPLOAD_TEST_CHUNKS - 1);
+
+    CHECK_EQUAL(CS1_SUCCESS, Send(UploadCommand::Build_Finalize(command_buf, UPLOAD_TEST_ID))->upload_status);
+    CHECK(FileMatches(UPLOAD_TEST_PATH));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UploadTestGroup
+*
+* NAME : Write_unalignedChunk_refused
+*
+*-----------------------------------------------------------------------------*/
+TEST(UploadTestGroup, Write_unalignedChunk_refused)
+{
+    Open(crc);
+
+    // an offset in a block : not built, and not created from the bytes received
+    CHECK_EQUAL(0, UploadCommand::Build_Write(command_buf, UPLOAD_TEST_ID, 10, WireView(bytes + 10, UPLOAD_BLOCK_SIZE)));
+
+    size_t cmd_size = UploadCommand::Build_Write(command_buf, UPLOAD_TEST_ID, 0, WireView(bytes, UPLOAD_BLOCK_SIZE));
+    UploadWriteSchema::Put<UPLOAD_WRITE_FIELD_OFFSET>(command_buf, 10);
+    CHECK(CommandFactory::CreateCommand(command_buf, cmd_size) == 0);
+
+    // a length that ends in a block, before the end of the file
+    InfoBytesUpload* info = Send(UploadCommand::Build_Write(command_buf, UPLOAD_TEST_ID, 0,
+                                                            WireView(bytes, UPLOAD_BLOCK_SIZE + 8)));
+    CHECK_EQUAL(CS1_FAILURE, info->upload_status);
+    CHECK_EQUAL(0, info->value);
+
+    // the last chunk is shorter
+    unsigned int last = UPLOAD_TEST_SIZE / UPLOAD_BLOCK_SIZE * UPLOAD_BLOCK_SIZE;
+    info = Send(UploadCommand::Build_Write(command_buf, UPLOAD_TEST_ID, last, WireView(bytes + last, UPLOAD_TEST_SIZE - last)));
+    CHECK_EQUAL(CS1_SUCCESS, info->upload_status);
+    CHECK_EQUAL(UPLOAD_TEST_SIZE - last, info->value);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UploadTestGroup
+*
+* NAME : Finalize_wrongCrc_everyBlockIsMissingAgain
+*
+*-----------------------------------------------------------------------------*/
+TEST(UploadTestGroup, Finalize_wrongCrc_everyBlockIsMissingAgain)
+{
+    Open(crc + 1);
+
+    for (int chunk = 0; chunk < UPLOAD_TEST_CHUNKS; chunk++) {
+        WriteChunk(chunk);
+    }
+
+    InfoBytesUpload* info = Send(UploadCommand::Build_Finalize(command_buf, UPLOAD_TEST_ID));
+    CHECK_EQUAL(CS1_FAILURE, info->upload_status);
+    CHECK_EQUAL(crc, info->value);
+    CHECK(access(UPLOAD_TEST_PATH, F_OK) != 0);
+
+    info = Send(UploadCommand::Build_Missing(command_buf, UPLOAD_TEST_ID, 0));
+    CHECK_EQUAL(0, info->value);
+    CHECK_EQUAL(1, info->range_count);
+    CHECK_EQUAL(UPLOAD_TEST_SIZE, info->ranges[0].length);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UploadTestGroup
+*
+* NAME : Write_outOfTheFileOrNotOpen_fails
+*
+*-----------------------------------------------------------------------------*/
+TEST(UploadTestGroup, Write_outOfTheFileOrNotOpen_fails)
+{
+    CHECK_EQUAL(CS1_FAILURE, WriteChunk(0)->upload_status);         // not open
+
+    Open(crc);
+
+    CHECK_EQUAL(CS1_FAILURE, Send(UploadCommand::Build_Write(command_buf, UPLOAD_TEST_ID, UPLOAD_TEST_SIZE - 8,
+                                                             WireView(bytes, 16)))->upload_status);
+
+    CHECK_EQUAL(CS1_SUCCESS, Send(UploadCommand::Build_Abort(command_buf, UPLOAD_TEST_ID))->upload_status);
+    CHECK(access(UPLOAD_TEST_PATH UPLOAD_PART_EXT, F_OK) != 0);
+    CHECK(access(UPLOAD_TEST_PATH UPLOAD_STATE_EXT, F_OK) != 0);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : UploadTestGroup
+*
+* NAME : Write_lengthPastTheCommand_fails
+*
+*-----------------------------------------------------------------------------*/
+TEST(UploadTestGroup, Write_lengthPastTheCommand_fails)
+{
+    Open(crc);
+
+    size_t cmd_size = UploadCommand::Build_Write(command_buf, UPLOAD_TEST_ID, 0, WireView(bytes, UPLOAD_TEST_CHUNK));
+    InfoBytesUpload* info = Send(cmd_size - 1);         // the last byte was not received
+
+    CHECK_EQUAL(CS1_FAILURE, info->upload_status);
+    CHECK_EQUAL(0, info->value);
+
+    info = Send(cmd_size);
+
+    CHECK_EQUAL(CS1_SUCCESS, info->upload_status);
+    CHECK_EQUAL(UPLOAD_TEST_CHUNK, info->value);
+}
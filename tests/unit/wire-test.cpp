@@ -0,0 +1,380 @@
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ *
+ * AUTHORS : Space Concordia 2015
+ *
+ * TITLE : wire-test.cpp
+ *
+ * DESCRIPTION : Tests the wire formats (WIRE_V1/WIRE_V2), the wire schemas and
+ *               the VersionCommand
+ *
+ *----------------------------------------------------------------------------*/
+#include <string.h>
+#include <stdlib.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+
+#include "SpaceDecl.h"
+#include "common/command-factory.h"
+#include "common/commands.h"
+#include "common/session-arena.h"
+#include "common/version-command.h"
+#include "common/wire.h"
+#include "common/wire-schema.h"
+
+#define UTEST_PATH "/home/apps/new/space-commander"     // 30 bytes
+#define UTEST_DATA_SIZE 1500                            // more than WIRE_V1 can carry
+
+static char command_buf[UTEST_DATA_SIZE + 100] = {'\0'};
+
+TEST_GROUP(WireTestGroup)
+{
+    void setup()
+    {
+        memset(command_buf, 0, sizeof(command_buf));
+    }
+
+    void teardown()
+    {
+        Wire::Reset();
+    }
+};
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : Varint_roundTrip
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, Varint_roundTrip)
+{
+    const unsigned int values[] = { 0, 127, 128, 999, 16383, 16384, 0xFFFFFFFF };
+    const size_t sizes[]        = { 1, 1,   2,   2,   2,     3,     5 };
+    char buffer[WIRE_VARINT_MAX_SIZE] = {'\0'};
+    unsigned int value = 0;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        CHECK_EQUAL(sizes[i], Wire::PutVarint(buffer, values[i]));
+        CHECK_EQUAL(sizes[i], Wire::VarintSize(values[i]));
+        CHECK_EQUAL(sizes[i], Wire::GetVarint(buffer, &value));
+        CHECK_EQUAL(values[i], value);
+    }
+
+    memset(buffer, 0x80, WIRE_VARINT_MAX_SIZE);      // never terminated
+    CHECK_EQUAL(0, Wire::GetVarint(buffer, &value));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : UInt32_isLittleEndian
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, UInt32_isLittleEndian)
+{
+    char buffer[WIRE_UINT32_SIZE] = {'\0'};
+
+    Wire::PutUInt32(buffer, 0x12345678);
+
+    CHECK_EQUAL(0x78, (unsigned char)buffer[0]);
+    CHECK_EQUAL(0x12, (unsigned char)buffer[3]);
+    CHECK_EQUAL(0x12345678, Wire::GetUInt32(buffer));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : VersionCommand_negotiatesTheLowestVersion
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, VersionCommand_negotiatesTheLowestVersion)
+{
+    ResultBuffer result_buffer;
+    char *result = 0;
+    VersionCommand ground_cmd(WIRE_MAX_VERSION + 1);
+    ground_cmd.GetCmdStr(command_buf);
+
+    CHECK_EQUAL(WIRE_V1, Wire::GetVersion());
+
+    ICommand *command = CommandFactory::CreateCommand(command_buf, VERSION_CMD_SIZE);
+    command->Execute(result_buffer);
+    result = result_buffer.GetData();
+    size_t size = result_buffer.GetSize();
+
+    CHECK_EQUAL(CMD_RES_HEAD_SIZE + VERSION_RTN_SIZE, size);
+    CHECK_EQUAL(CS1_SUCCESS, result[CMD_STS]);
+    CHECK_EQUAL(WIRE_MAX_VERSION, result[CMD_RES_HEAD_SIZE]);
+    CHECK_EQUAL(WIRE_MAX_VERSION, Wire::GetVersion());
+
+    // the ground follows the satellite
+    Wire::Reset();
+    InfoBytesVersion *info = (InfoBytesVersion*)ground_cmd.ParseResult(result);
+    CHECK_EQUAL(CS1_SUCCESS, info->version_status);
+    CHECK_EQUAL(WIRE_MAX_VERSION, Wire::GetVersion());
+
+    result_buffer.Clear();
+    delete command;
+
+    // a ground that does not support any version changes nothing
+    VersionCommand bad_cmd(0);
+    bad_cmd.Execute(result_buffer);
+    result = result_buffer.GetData();
+    CHECK_EQUAL(CS1_FAILURE, result[CMD_STS]);
+    CHECK_EQUAL(WIRE_MAX_VERSION, Wire::GetVersion());
+
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : VersionCommand_negotiatedVersion_keptInTheNextSession
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, VersionCommand_negotiatedVersion_keptInTheNextSession)
+{
+    SessionArena arena;
+    CommandStorage storage;
+    VersionCommand ground_cmd(WIRE_V2);
+
+    // first session : the ground negotiates WIRE_V2
+    SessionArena::SetCurrent(&arena);
+    {
+        ResultBuffer result_buffer;
+        ground_cmd.GetCmdStr(command_buf);
+
+        ICommand *command = CommandFactory::CreateCommand(command_buf, VERSION_CMD_SIZE, &storage);
+        command->Execute(result_buffer);
+        CommandFactory::DestroyCommand(command);
+
+        CHECK_EQUAL(CS1_SUCCESS, result_buffer.GetData()[CMD_STS]);
+    }
+    arena.Reset();
+
+    // next session : no VersionCommand, a WIRE_V2 command is read as one
+    size_t size = DecodeCommand::Build_DecodeCommand(command_buf, UTEST_PATH ".b64", UTEST_PATH, 1, 123456);
+    DecodeCommand *command = (DecodeCommand*)CommandFactory::CreateCommand(command_buf, size, &storage);
+
+    CHECK_EQUAL(WIRE_V2, Wire::GetVersion());
+    CHECK(command != 0);
+    CHECK(command->GetSrcPath().Equals(UTEST_PATH ".b64"));
+    CHECK(command->GetDestPath().Equals(UTEST_PATH));
+    CHECK_EQUAL(123456, command->GetTotalSize());
+
+    CommandFactory::DestroyCommand(command);
+    arena.Reset();
+    SessionArena::SetCurrent(0);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : Update_V2_carriesMoreThan999Bytes
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, Update_V2_carriesMoreThan999Bytes)
+{
+    char data[UTEST_DATA_SIZE];
+    memset(data, 'u', UTEST_DATA_SIZE);
+    data[10] = '\0';        // binary data
+
+    CHECK_EQUAL(0, UpdateCommand::Build_UpdateCommand(command_buf, UTEST_PATH, WireView(data, UTEST_DATA_SIZE)));
+
+    Wire::SetVersion(WIRE_V2);
+    size_t size = UpdateCommand::Build_UpdateCommand(command_buf, UTEST_PATH, WireView(data, UTEST_DATA_SIZE));
+    CHECK_EQUAL(UpdateCommand::GetCmdSize(strlen(UTEST_PATH), UTEST_DATA_SIZE), size);
+
+    UpdateCommand *command = (UpdateCommand*)CommandFactory::CreateCommand(command_buf, size);
+
+    CHECK(command != 0);
+    CHECK(command->GetPath().Equals(UTEST_PATH));
+    CHECK_EQUAL(UTEST_DATA_SIZE, command->GetDataLength());
+    CHECK_EQUAL(0, memcmp(data, command->GetData().data, UTEST_DATA_SIZE));     // past the NUL
+
+    delete command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : Decode_V1_V2_roundTrip
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, Decode_V1_V2_roundTrip)
+{
+    for (unsigned char version = WIRE_V1; version <= WIRE_MAX_VERSION; version++) {
+        Wire::SetVersion(version);
+
+        size_t size = DecodeCommand::Build_DecodeCommand(command_buf, UTEST_PATH ".b64", UTEST_PATH, 1, 123456);
+        DecodeCommand *command = (DecodeCommand*)CommandFactory::CreateCommand(command_buf, size);
+
+        CHECK(command != 0);
+        CHECK(command->GetSrcPath().Equals(UTEST_PATH ".b64"));
+        CHECK(command->GetDestPath().Equals(UTEST_PATH));
+        CHECK_EQUAL(1, command->IsExecutable());
+        CHECK_EQUAL(123456, command->GetTotalSize());
+
+        delete command;
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : SetTime_V2_roundTrip
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, SetTime_V2_roundTrip)
+{
+    Wire::SetVersion(WIRE_V2);
+
+    SetTimeCommand ground_cmd(1420070400, 0x01);
+    ground_cmd.GetCmdStr(command_buf);
+
+    CHECK_EQUAL(SETTIME_CMD_SIZE_V2, ground_cmd.GetCmdSize());
+    CHECK_EQUAL(1420070400, Wire::GetUInt32(command_buf + CMD_HEAD_SIZE));
+
+    SetTimeCommand *command = (SetTimeCommand*)CommandFactory::CreateCommand(command_buf, SETTIME_CMD_SIZE_V2);
+
+    CHECK(command != 0);
+    CHECK_EQUAL(1420070400, command->GetSeconds());
+    CHECK_EQUAL(0x01, command->rtc_bus_number);
+
+    delete command;
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : GetCmdSize_V2_isNeverLarger
+*
+* PURPOSE : Byte counts of the commands in both versions (see the README)
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, GetCmdSize_V2_isNeverLarger)
+{
+    const size_t path = strlen(UTEST_PATH);
+    size_t v1[3], v2[3];
+
+    v1[0] = UpdateCommand::GetCmdSize(path, 190);
+    v1[1] = DecodeCommand::GetCmdSize(path + 4, path, 100000);
+    v1[2] = SetTimeCommand().GetCmdSize();
+
+    Wire::SetVersion(WIRE_V2);
+    v2[0] = UpdateCommand::GetCmdSize(path, 190);
+    v2[1] = DecodeCommand::GetCmdSize(path + 4, path, 100000);
+    v2[2] = SetTimeCommand().GetCmdSize();
+
+    CHECK_EQUAL(1 + 3 + path + 3 + 190, v1[0]);
+    CHECK_EQUAL(1 + 1 + path + 2 + 190, v2[0]);
+
+    CHECK_EQUAL(1 + 1 + 3 + (path + 4) + 3 + path + 10, v1[1]);
+    CHECK_EQUAL(1 + 1 + 1 + (path + 4) + 1 + path + 3, v2[1]);
+
+    CHECK_EQUAL(CMD_HEAD_SIZE + sizeof(time_t) + RTC_BYTE_SIZE, v1[2]);
+    CHECK_EQUAL(6, v2[2]);
+
+    for (size_t i = 0; i < 3; i++) {
+        CHECK(v2[i] <= v1[i]);
+    }
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : Schema_sizesAndOffsets_matchTheFormats
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, Schema_sizesAndOffsets_matchTheFormats)
+{
+    CHECK_EQUAL(11, GETLOG_CMD_SIZE);
+    CHECK_EQUAL(3, GetLogSchema::At<GETLOG_FIELD_SIZE>::OFFSET);
+    CHECK_EQUAL(7, GetLogSchema::At<GETLOG_FIELD_DATE>::OFFSET);
+    CHECK_EQUAL(8, GETLOG_ACK_SIZE);
+
+    CHECK_EQUAL(CMD_HEAD_SIZE + sizeof(time_t) + RTC_BYTE_SIZE, SETTIME_CMD_SIZE);
+    CHECK_EQUAL(6, SETTIME_CMD_SIZE_V2);
+    CHECK_EQUAL(2, VERSION_CMD_SIZE);
+    CHECK_EQUAL(CMD_RES_HEAD_SIZE, WireResultHead<UPDATE_CMD>::SIZE);
+    CHECK_EQUAL(12, BULKDELETE_PRED_CMD_SIZE);
+    CHECK_EQUAL(4, BULKDELETE_RTN_HEAD_SIZE);
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : Schema_GetLog_sameBytesAsTheCommand
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, Schema_GetLog_sameBytesAsTheCommand)
+{
+    char schema_buf[GETLOG_CMD_SIZE] = {'\0'};
+
+    GetLogCommand(OPT_SUB | OPT_DATE, 3, 2048, 1420070400).GetCmdStr(command_buf);
+
+    GetLogSchema::Init(schema_buf);
+    GetLogSchema::Put<GETLOG_FIELD_OPT>(schema_buf, OPT_SUB | OPT_DATE);
+    GetLogSchema::Put<GETLOG_FIELD_SUBSYSTEM>(schema_buf, 3);
+    GetLogSchema::Put<GETLOG_FIELD_SIZE>(schema_buf, 2048);
+    GetLogSchema::Put<GETLOG_FIELD_DATE>(schema_buf, 1420070400);
+
+    CHECK_EQUAL(0, memcmp(command_buf, schema_buf, GETLOG_CMD_SIZE));
+    CHECK_EQUAL(GETLOG_CMD, (unsigned char)schema_buf[CMD_ID]);
+    CHECK_EQUAL(3, GetLogSchema::Get<GETLOG_FIELD_SUBSYSTEM>(schema_buf));
+    CHECK_EQUAL(2048, GetLogSchema::Get<GETLOG_FIELD_SIZE>(schema_buf));
+    CHECK_EQUAL(1420070400, GetLogSchema::Get<GETLOG_FIELD_DATE>(schema_buf));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : Schema_Check_rejectsShortOrOtherCommands
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, Schema_Check_rejectsShortOrOtherCommands)
+{
+    char buffer[GETLOG_CMD_SIZE] = {'\0'};
+    GetLogSchema::Init(buffer);
+
+    CHECK(GetLogSchema::Check(buffer, GETLOG_CMD_SIZE));
+    CHECK(!GetLogSchema::Check(buffer, GETLOG_CMD_SIZE - 1));
+    CHECK(!GetLogSchema::Check(0, GETLOG_CMD_SIZE));
+
+    buffer[CMD_ID] = GETTIME_CMD;
+    CHECK(!GetLogSchema::Check(buffer, GETLOG_CMD_SIZE));
+}
+
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+*
+* GROUP : WireTestGroup
+*
+* NAME : UpdateCommand_ParseResult_checksUpdateCmd
+*
+* PURPOSE : it used to check SETTIME_CMD
+*
+*-----------------------------------------------------------------------------*/
+TEST(WireTestGroup, UpdateCommand_ParseResult_checksUpdateCmd)
+{
+    char result[] = { UPDATE_CMD, CS1_SUCCESS, '1', '9', '0', '\0' };
+    UpdateCommand parser;
+
+    InfoBytesUpdate *info = (InfoBytesUpdate*)parser.ParseResult(result);
+
+    CHECK_EQUAL(CS1_SUCCESS, info->update_status);
+    STRCMP_EQUAL("190", info->bytes_written);
+
+    result[CMD_ID] = SETTIME_CMD;
+    info = (InfoBytesUpdate*)parser.ParseResult(result);
+
+    CHECK_EQUAL(CS1_FAILURE, info->update_status);
+}